@@ -33,7 +33,9 @@ main(int argc,
     QString projectName,mainProcessServerName;
     QStringList writers;
     std::list<std::pair<int,int> > frameRanges;
-    AppManager::parseCmdLineArgs(argc,argv,&isBackground,projectName,writers,frameRanges,mainProcessServerName);
+    RenderFarmArgs farmArgs;
+    ProfilingArgs profilingArgs;
+    AppManager::parseCmdLineArgs(argc,argv,&isBackground,projectName,writers,frameRanges,mainProcessServerName,&farmArgs,&profilingArgs);
 
     setShutDownSignal(SIGINT);   // shut down on ctrl-c
     setShutDownSignal(SIGTERM);   // shut down on killall
@@ -51,7 +53,7 @@ main(int argc,
         }
         AppManager manager;
 
-        if ( !manager.load(argc,argv,projectName,writers,frameRanges,mainProcessServerName) ) {
+        if ( !manager.load(argc,argv,projectName,writers,frameRanges,mainProcessServerName,farmArgs,profilingArgs) ) {
             AppManager::printUsage(argv[0]);
             return 1;
         } else {
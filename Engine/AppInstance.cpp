@@ -28,6 +28,7 @@
 #include "Engine/Node.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/BlockingBackgroundRender.h"
+#include "Engine/RenderFarm.h"
 #include "Engine/NodeSerialization.h"
 #include "Engine/FileDownloader.h"
 #include "Engine/Settings.h"
@@ -293,7 +294,11 @@ AppInstance::load(const QString & projectName,
         if ( !_imp->_currentProject->loadProject(path,name) ) {
             throw std::invalid_argument("Project file loading failed.");
         }
-        startWritersRendering(writersWork);
+        if (appPTR->getRenderFarmArgs().isWorker) {
+            renderFarmChunks();
+        } else {
+            startWritersRendering(writersWork);
+        }
     }
 }
 
@@ -605,7 +610,30 @@ void
 AppInstance::startWritersRendering(const std::list<RenderWork>& writers)
 {
     
-    if ( appPTR->isBackground() ) {
+    const RenderFarmArgs& farmArgs = appPTR->getRenderFarmArgs();
+    if ( appPTR->isBackground() && (farmArgs.nWorkers > 1) && !farmArgs.isWorker ) {
+        
+        ///Let worker processes render the frames, we just coordinate them
+        std::list<RenderFarm::WriterRange> work;
+        for (std::list<RenderWork>::const_iterator it = writers.begin(); it != writers.end(); ++it) {
+            RenderFarm::WriterRange r;
+            r.writerName = it->writer->getName().c_str();
+            getWriterFrameRange(*it, &r.firstFrame, &r.lastFrame);
+            std::string sequentialNode;
+            r.sequential = it->writer->getNode()->hasSequentialOnlyNodeUpstream(sequentialNode);
+            work.push_back(r);
+        }
+        QString projectPath = getProject()->getProjectPath();
+        if ( !projectPath.isEmpty() && !projectPath.endsWith( QDir::separator() ) ) {
+            projectPath += QDir::separator();
+        }
+        projectPath += getProject()->getProjectName();
+        
+        RenderFarm farm(projectPath, work, farmArgs.nWorkers, farmArgs.diskCachePath);
+        if ( !farm.blockingRender() && !appPTR->hasAbortAnyProcessingBeenCalled() ) {
+            throw std::runtime_error("Some frames could not be rendered by the render farm workers.");
+        }
+    } else if ( appPTR->isBackground() ) {
         
         //blocking call, we don't want this function to return pre-maturely, in which case it would kill the app
         QtConcurrent::blockingMap( writers,boost::bind(&AppInstance::startRenderingFullSequence,this,_1,false,QString()) );
@@ -623,19 +651,41 @@ AppInstance::startWritersRendering(const std::list<RenderWork>& writers)
 }
 
 void
-AppInstance::startRenderingFullSequence(const RenderWork& writerWork,bool /*renderInSeparateProcess*/,const QString& /*savePath*/)
+AppInstance::renderFarmChunks()
 {
-    BlockingBackgroundRender backgroundRender(writerWork.writer);
+    QString writerName;
     int first,last;
+    while ( appPTR->requestRenderChunk(&writerName, &first, &last) ) {
+        RenderRequest r;
+        r.writerName = writerName;
+        r.firstFrame = first;
+        r.lastFrame = last;
+        std::list<RenderRequest> chunk;
+        chunk.push_back(r);
+        startWritersRendering(chunk);
+    }
+}
+
+void
+AppInstance::getWriterFrameRange(const RenderWork& writerWork,int* first,int* last) const
+{
     if (writerWork.firstFrame == INT_MIN || writerWork.lastFrame == INT_MAX) {
-        writerWork.writer->getFrameRange_public(writerWork.writer->getHash(), &first, &last);
-        if (first == INT_MIN || last == INT_MAX) {
-            getFrameRange(&first, &last);
+        writerWork.writer->getFrameRange_public(writerWork.writer->getHash(), first, last);
+        if (*first == INT_MIN || *last == INT_MAX) {
+            getFrameRange(first, last);
         }
     } else {
-        first = writerWork.firstFrame;
-        last = writerWork.lastFrame;
+        *first = writerWork.firstFrame;
+        *last = writerWork.lastFrame;
     }
+}
+
+void
+AppInstance::startRenderingFullSequence(const RenderWork& writerWork,bool /*renderInSeparateProcess*/,const QString& /*savePath*/)
+{
+    BlockingBackgroundRender backgroundRender(writerWork.writer);
+    int first,last;
+    getWriterFrameRange(writerWork, &first, &last);
     
     backgroundRender.blockingRender(first,last); //< doesn't return before rendering is finished
 }
@@ -27,6 +27,8 @@ namespace boost {
 namespace archive {
 class xml_iarchive;
 class xml_oarchive;
+class binary_iarchive;
+class binary_oarchive;
 }
 }
 
@@ -44,6 +46,20 @@ class EffectInstance;
 class OutputEffectInstance;
 }
 
+/**
+ * @brief The serialization of the GUI of a project, taken on the main thread and encoded later from any thread.
+ **/
+class ProjectGuiSnapshot
+{
+public:
+
+    virtual ~ProjectGuiSnapshot()
+    {
+    }
+
+    virtual void encode(boost::archive::binary_oarchive & archive) const = 0;
+};
+
 struct CreateNodeArgs
 {
     ///The pluginID corresponds to something generated by
@@ -234,6 +250,23 @@ public:
     {
     }
 
+    virtual void loadProjectGui(boost::archive::binary_iarchive & /*archive*/) const
+    {
+    }
+
+    virtual void saveProjectGui(boost::archive::binary_oarchive & /*archive*/)
+    {
+    }
+
+    /**
+     * @brief Returns the serialization of the GUI of the project, to be encoded later. Must be called on the main thread.
+     * Returns NULL if there is no GUI.
+     **/
+    virtual boost::shared_ptr<ProjectGuiSnapshot> snapshotProjectGui() const
+    {
+        return boost::shared_ptr<ProjectGuiSnapshot>();
+    }
+
     virtual void setupViewersForViews(int /*viewsCount*/)
     {
     }
@@ -303,6 +336,12 @@ public:
     void startWritersRendering(const std::list<RenderWork>& writers);
 
     virtual void startRenderingFullSequence(const RenderWork& writerWork,bool renderInSeparateProcess,const QString& savePath);
+    
+    /**
+     * @brief Returns the frame range of the work, falling back on the range of the writer then the project's
+     * if none was given.
+     **/
+    void getWriterFrameRange(const RenderWork& writerWork,int* first,int* last) const;
 
     virtual void clearViewersLastRenderedTexture() {}
 
@@ -368,6 +407,11 @@ private:
     virtual void createBackDrop()
     {
     }
+    
+    /**
+     * @brief For a worker process of a RenderFarm: renders the frames handed by the coordinator until it has nothing left.
+     **/
+    void renderFarmChunks();
 
     boost::shared_ptr<Natron::Node> createNodeInternal(const QString & pluginID,const std::string & multiInstanceParentName,
                                                        int majorVersion,int minorVersion,
@@ -17,6 +17,9 @@
 
 #include <clocale>
 #include <cstddef>
+#include <algorithm>
+#include <list>
+#include <iostream>
 #include <QDebug>
 #include <QTextCodec>
 #include <QAbstractSocket>
@@ -24,6 +27,8 @@
 #include <QThread>
 #include <QThreadPool>
 #include <QtCore/QAtomicInt>
+#include <QtCore/QFuture>
+#include <QtConcurrentRun>
 
 #include "Global/MemoryInfo.h"
 #include "Global/QtCompat.h" // for removeRecursively
@@ -41,6 +46,7 @@
 #include "Engine/Image.h"
 #include "Engine/FrameEntry.h"
 #include "Engine/Format.h"
+#include "Engine/FileSystemModel.h"
 #include "Engine/Log.h"
 #include "Engine/Cache.h"
 #include "Engine/Variant.h"
@@ -49,6 +55,11 @@
 #include "Engine/DiskCacheNode.h"
 #include "Engine/NoOp.h"
 #include "Engine/Project.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/RenderTrace.h"
+#include "Engine/RenderStats.h"
+#include "Engine/PreviewScheduler.h"
+#include "Engine/Timer.h"
 
 BOOST_CLASS_EXPORT(Natron::FrameParams)
 BOOST_CLASS_EXPORT(Natron::ImageParams)
@@ -57,6 +68,45 @@ BOOST_CLASS_EXPORT(Natron::ImageParams)
 
 using namespace Natron;
 
+namespace {
+///Measures the phases of AppManager::loadInternal, printed with --startup-profile
+class StartupProfile
+{
+public:
+
+    StartupProfile()
+    : _clock()
+    , _phaseStart(0.)
+    , _phases()
+    {
+    }
+
+    ///Ends the current phase, the next one starts now
+    void endPhase(const char* name)
+    {
+        double now = _clock.getTimeSinceCreation();
+
+        _phases.push_back( std::make_pair(std::string(name), now - _phaseStart) );
+        _phaseStart = now;
+    }
+
+    void print(std::ostream & os) const
+    {
+        os << "Startup profile:" << std::endl;
+        for (std::list<std::pair<std::string,double> >::const_iterator it = _phases.begin(); it != _phases.end(); ++it) {
+            os << "    " << it->first << ": " << it->second * 1000. << " ms" << std::endl;
+        }
+        os << "    Total: " << _phaseStart * 1000. << " ms" << std::endl;
+    }
+
+private:
+
+    TimeLapse _clock;
+    double _phaseStart; //< clock time at which the current phase started
+    std::list<std::pair<std::string,double> > _phases; //< name and duration in seconds, in order
+};
+}
+
 AppManager* AppManager::_instance = 0;
 struct AppManagerPrivate
 {
@@ -78,6 +128,8 @@ struct AppManagerPrivate
     
     ProcessInputChannel* _backgroundIPC; //< object used to communicate with the main app
     //if this app is background, see the ProcessInputChannel def
+    RenderFarmArgs farmArgs; //< how the background render is split across processes, never changes after load()
+    ProfilingArgs profilingArgs; //< never changes after load()
     bool _loaded; //< true when the first instance is completly loaded.
     QString _binaryPath; //< the path to the application's binary
     mutable QMutex _wasAbortCalledMutex;
@@ -112,6 +164,14 @@ struct AppManagerPrivate
     // Another method could be to analyse all cores running, but this is way more expensive and would impair performances.
     QAtomicInt runningThreadsCount;
     
+    boost::scoped_ptr<RenderQueue> renderQueue; //< arbitrates between interactive, playback and background renders
+    boost::scoped_ptr<RenderTrace> renderTrace; //< timings of the last render steps
+    boost::scoped_ptr<RenderStatsRegistry> renderStats; //< statistics of the nodes and caches
+    boost::scoped_ptr<PreviewScheduler> previewScheduler; //< computes the previews of the nodes
+    QMutex cachesRestoresMutex; //< protects cachesRestores
+    QMutex saveCachesMutex; //< saveCaches is called from the main thread and from the auto-saves in the global thread pool
+    std::list< QFuture<void> > cachesRestores; //< the disk caches tables of contents being restored in the global thread pool
+    
      //To by-pass a bug introduced in RC2 / RC3 with the serialization of bezier curves
     bool lastProjectLoadedCreatedDuringRC2Or3;
     
@@ -131,6 +191,7 @@ struct AppManagerPrivate
         , diskCachesLocationMutex()
         , diskCachesLocation()
         ,_backgroundIPC(0)
+        ,farmArgs()
         ,_loaded(false)
         ,_binaryPath()
         ,_wasAbortAnyProcessingCalled(false)
@@ -146,6 +207,13 @@ struct AppManagerPrivate
         ,useThreadPool(true)
         ,nThreadsMutex()
         ,runningThreadsCount()
+        ,renderQueue(new RenderQueue)
+        ,renderTrace(new RenderTrace)
+        ,renderStats(new RenderStatsRegistry)
+        ,previewScheduler(new PreviewScheduler)
+        ,cachesRestoresMutex()
+        ,saveCachesMutex()
+        ,cachesRestores()
         ,lastProjectLoadedCreatedDuringRC2Or3(false)
     {
         setMaxCacheFiles();
@@ -165,6 +233,10 @@ struct AppManagerPrivate
 
     void restoreCaches();
 
+    ///Waits for the tables of contents launched by restoreCaches to be restored in the caches.
+    ///This may be called from any thread: all callers return once the restores are done.
+    void waitForCachesRestored();
+
     bool checkForCacheDiskStructure(const QString & cachePath);
 
     void cleanUpCacheDiskStructure(const QString & cachePath);
@@ -175,6 +247,9 @@ struct AppManagerPrivate
     void setMaxCacheFiles();
     
     Natron::Plugin* findPluginById(const QString& oldId,int major, int minor) const;
+
+    ///Writes the render trace to the file given by --trace, if any
+    void exportRenderTrace();
 };
 
 void
@@ -212,6 +287,16 @@ AppManager::printUsage(const std::string& programName)
                              " name following the this argument. If no such node exists in the project file, the process will abort."
                              "Note that if you don't pass the --writer argument, it will try to start rendering with all the writers in the project's file. After the writer node name you can pass an optional frame range in the format "
                              " firstFrame-lastFrame (e.g: 10-40). ").toStdString() << std::endl;
+    std::cout << QObject::tr("[--workers <N>] When in background mode, splits the frame range of the writers in chunks rendered by N "
+                             "processes launched on this computer. Each process uses its share of the CPU cores.").toStdString() << std::endl;
+    std::cout << QObject::tr("[--cache-dir <directory>] When in background mode, the disk cache is located in the given directory instead "
+                             "of the one set in the preferences. This can be used to share the disk cache between render processes.").toStdString() << std::endl;
+    std::cout << QObject::tr("[--trace <file>] When in background mode, records the time spent by each node, tile and thread and writes it "
+                             "to the given file when the render is finished. The file can be opened in chrome://tracing.").toStdString() << std::endl;
+    std::cout << QObject::tr("[--stats] When in background mode, prints the render time, the cache hits and the memory of each node "
+                             "when the render is finished.").toStdString() << std::endl;
+    std::cout << QObject::tr("[--startup-profile] Prints the time spent in each phase of the startup (settings, caches, plug-ins, "
+                             "project loading) once the project is loaded.").toStdString() << std::endl;
     std::cout << QObject::tr("An example of usage of the renderer can be: \n"
                              "./NatronRenderer -w MyWriter 1-100 /Users/Me/MyNatronProjects/MyProject.ntp").toStdString() << std::endl;
 
@@ -227,6 +312,36 @@ static void appendFakeFrameRange(std::list<std::pair<int,int> >& frameRanges)
     frameRanges.push_back(range);
 }
 
+namespace {
+///The value expected after an option of the command line
+enum CmdLineValueEnum
+{
+    eCmdLineValueNone = 0,
+    eCmdLineValueWriterName,
+    eCmdLineValuePipeFileName,
+    eCmdLineValueWorkersCount,
+    eCmdLineValueCacheDir,
+    eCmdLineValueTraceFile
+};
+
+static bool
+isCmdLineOption(const QString & arg)
+{
+    static const char* options[] = {
+        "--background", "-b", "--writer", "-w", "--IPCpipe", "--workers", "--cache-dir", "--farm-worker",
+        "--trace", "--stats", "--startup-profile"
+    };
+
+    for (std::size_t i = 0; i < sizeof(options) / sizeof(options[0]); ++i) {
+        if (arg == options[i]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+}
+
 bool
 AppManager::parseCmdLineArgs(int argc,
                              char* argv[],
@@ -234,15 +349,17 @@ AppManager::parseCmdLineArgs(int argc,
                              QString & projectFilename,
                              QStringList & writers,
                              std::list<std::pair<int,int> >& frameRanges,
-                             QString & mainProcessServerName)
+                             QString & mainProcessServerName,
+                             RenderFarmArgs* farmArgs,
+                             ProfilingArgs* profilingArgs)
 {
     if (!argv) {
         return false;
     }
 
     *isBackground = false;
-    bool expectWriterNameOnNextArg = false;
-    bool expectPipeFileNameOnNextArg = false;
+    ///The option before the current argument expects it as its value
+    CmdLineValueEnum expectedValue = eCmdLineValueNone;
     bool expectedFrameRange = false;
     QStringList args;
     for (int i = 0; i < argc; ++i) {
@@ -251,8 +368,11 @@ AppManager::parseCmdLineArgs(int argc,
 
     for (int i = 0; i < args.size(); ++i) {
         
-        if ( args.at(i).contains("." NATRON_PROJECT_FILE_EXT) ) {
-            if (expectWriterNameOnNextArg || expectPipeFileNameOnNextArg) {
+        const QString & arg = args.at(i);
+        bool isProject = arg.contains("." NATRON_PROJECT_FILE_EXT);
+        if ( isProject || isCmdLineOption(arg) ) {
+            ///The value of the previous option is missing
+            if (expectedValue != eCmdLineValueNone) {
                 AppManager::printUsage(argv[0]);
 
                 return false;
@@ -261,44 +381,63 @@ AppManager::parseCmdLineArgs(int argc,
                 expectedFrameRange = false;
                 appendFakeFrameRange(frameRanges);
             }
-            projectFilename = args.at(i);
-            continue;
-        } else if ( (args.at(i) == "--background") || (args.at(i) == "-b") ) {
-            if (expectWriterNameOnNextArg  || expectPipeFileNameOnNextArg) {
-                AppManager::printUsage(argv[0]);
-
-                return false;
-            }
-            if (expectedFrameRange) {
-                expectedFrameRange = false;
-                appendFakeFrameRange(frameRanges);
+            if (isProject) {
+                projectFilename = arg;
+            } else if ( (arg == "--background") || (arg == "-b") ) {
+                *isBackground = true;
+            } else if ( (arg == "--writer") || (arg == "-w") ) {
+                expectedValue = eCmdLineValueWriterName;
+            } else if (arg == "--IPCpipe") {
+                expectedValue = eCmdLineValuePipeFileName;
+            } else if (arg == "--workers") {
+                expectedValue = eCmdLineValueWorkersCount;
+            } else if (arg == "--cache-dir") {
+                expectedValue = eCmdLineValueCacheDir;
+            } else if (arg == "--trace") {
+                expectedValue = eCmdLineValueTraceFile;
+            } else if (arg == "--stats") {
+                profilingArgs->printStats = true;
+            } else if (arg == "--startup-profile") {
+                profilingArgs->printStartupProfile = true;
+            } else if (arg == "--farm-worker") {
+                ///Internal option passed by the RenderFarm to the processes it launches
+                farmArgs->isWorker = true;
             }
-            *isBackground = true;
             continue;
-        } else if ( (args.at(i) == "--writer") || (args.at(i) == "-w") ) {
-            if (expectWriterNameOnNextArg  || expectPipeFileNameOnNextArg) {
+        }
+        
+        switch (expectedValue) {
+        case eCmdLineValueWorkersCount: {
+            bool ok;
+            farmArgs->nWorkers = arg.toInt(&ok);
+            if (!ok || farmArgs->nWorkers < 1) {
                 AppManager::printUsage(argv[0]);
-
+                
                 return false;
             }
-            if (expectedFrameRange) {
-                expectedFrameRange = false;
-                appendFakeFrameRange(frameRanges);
-            }
-            expectWriterNameOnNextArg = true;
+            expectedValue = eCmdLineValueNone;
             continue;
-        } else if (args.at(i) == "--IPCpipe") {
-            if (expectWriterNameOnNextArg || expectPipeFileNameOnNextArg) {
-                AppManager::printUsage(argv[0]);
-
-                return false;
-            }
-            if (expectedFrameRange) {
-                expectedFrameRange = false;
-                appendFakeFrameRange(frameRanges);
-            }
-            expectPipeFileNameOnNextArg = true;
+        }
+        case eCmdLineValueCacheDir:
+            farmArgs->diskCachePath = arg;
+            expectedValue = eCmdLineValueNone;
             continue;
+        case eCmdLineValueTraceFile:
+            profilingArgs->traceFilePath = arg;
+            expectedValue = eCmdLineValueNone;
+            continue;
+        case eCmdLineValueWriterName:
+            assert(!expectedFrameRange);
+            writers << arg;
+            expectedValue = eCmdLineValueNone;
+            expectedFrameRange = true;
+            continue;
+        case eCmdLineValuePipeFileName:
+            mainProcessServerName = arg;
+            expectedValue = eCmdLineValueNone;
+            continue;
+        case eCmdLineValueNone:
+            break;
         }
         
         if (expectedFrameRange) {
@@ -335,23 +474,9 @@ AppManager::parseCmdLineArgs(int argc,
             expectedFrameRange = false;
             continue;
         }
-        
-        if (expectWriterNameOnNextArg) {
-            assert(!expectPipeFileNameOnNextArg);
-            writers << args.at(i);
-            expectWriterNameOnNextArg = false;
-            expectedFrameRange = true;
-            continue;
-        }
-        if (expectPipeFileNameOnNextArg) {
-            assert(!expectWriterNameOnNextArg);
-            mainProcessServerName = args.at(i);
-            expectPipeFileNameOnNextArg = false;
-            continue;
-        }
     }
 
-    if (expectWriterNameOnNextArg || expectPipeFileNameOnNextArg) {
+    if (expectedValue != eCmdLineValueNone) {
         AppManager::printUsage(argv[0]);
         
         return false;
@@ -376,8 +501,13 @@ AppManager::load(int &argc,
                  const QString & projectFilename,
                  const QStringList & writers,
                  const std::list<std::pair<int,int> >& frameRanges,
-                 const QString & mainProcessServerName)
+                 const QString & mainProcessServerName,
+                 const RenderFarmArgs& farmArgs,
+                 const ProfilingArgs& profilingArgs)
 {
+    _imp->farmArgs = farmArgs;
+    _imp->profilingArgs = profilingArgs;
+    
     ///if the user didn't specify launch arguments (e.g unit testing)
     ///find out the binary path
     bool hadArgs = true;
@@ -396,6 +526,11 @@ AppManager::load(int &argc,
     initializeQApp(argc, argv);
 
     _imp->idealThreadCount = QThread::idealThreadCount();
+    if (farmArgs.isWorker && farmArgs.nWorkers > 1) {
+        ///The workers of a render farm share the cores of the computer
+        _imp->idealThreadCount = std::max(1, _imp->idealThreadCount / farmArgs.nWorkers);
+        QThreadPool::globalInstance()->setMaxThreadCount(_imp->idealThreadCount);
+    }
     QThreadPool::globalInstance()->setExpiryTimeout(-1); //< make threads never exit on their own
     //otherwise it might crash with thread local storage
     _imp->diskCachesLocation = Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache) ;
@@ -441,6 +576,8 @@ AppManager::~AppManager()
         // ignore errors
     }
 
+    _imp->previewScheduler->quitThread();
+
     _instance = 0;
 
     ///Caches may have launched some threads to delete images, wait for them to be done
@@ -490,6 +627,8 @@ AppManager::loadInternal(const QString & projectFilename,
 {
     assert(!_imp->_loaded);
 
+    StartupProfile profile;
+
     _imp->_binaryPath = QCoreApplication::applicationDirPath();
 
     registerEngineMetaTypes();
@@ -555,13 +694,21 @@ AppManager::loadInternal(const QString & projectFilename,
     std::setlocale(LC_NUMERIC,"C"); // set the locale for LC_NUMERIC only
 
     Natron::Log::instance(); //< enable logging
+    profile.endPhase("Locale and logging");
 
     _imp->_settings->initializeKnobsPublic();
     ///Call restore after initializing knobs
     _imp->_settings->restoreSettings();
+    
+    ///The disk cache location passed on the command line overrides the preferences, the caches are created below
+    if ( !_imp->farmArgs.diskCachePath.isEmpty() ) {
+        setDiskCacheLocation(_imp->farmArgs.diskCachePath);
+    }
+    profile.endPhase("Settings");
 
     ///basically show a splashScreen
     initGui();
+    profile.endPhase("Splash screen");
 
 
     try {
@@ -578,9 +725,12 @@ AppManager::loadInternal(const QString & projectFilename,
     } catch (std::logic_error) {
         // ignore
     }
+    profile.endPhase("Caches creation");
 
+    ///Only in GUI mode: the background renders start with empty disk caches
     setLoadingStatus( tr("Restoring the image cache...") );
     _imp->restoreCaches();
+    profile.endPhase("Disk caches tables of contents");
 
     setLoadingStatus( tr("Restoring user settings...") );
 
@@ -594,7 +744,9 @@ AppManager::loadInternal(const QString & projectFilename,
 
     /*loading all plugins*/
     loadAllPlugins();
+    profile.endPhase("Plug-ins");
     _imp->loadBuiltinFormats();
+    profile.endPhase("Formats");
 
 
     if ( isBackground() && !mainProcessServerName.isEmpty() ) {
@@ -616,8 +768,37 @@ AppManager::loadInternal(const QString & projectFilename,
     } else {
         _imp->_appType = eAppTypeGui;
     }
+    
+    ///The trace is only recorded when asked for: with --trace or, in the GUI, from the Render menu
+    _imp->renderTrace->setEnabled( !_imp->profilingArgs.traceFilePath.isEmpty() );
+    ///The coordinator of a render farm does not render anything, the workers print their own statistics
+    bool printStats = isBackground() && _imp->profilingArgs.printStats && !(_imp->farmArgs.nWorkers > 1 && !_imp->farmArgs.isWorker);
+    _imp->renderStats->setEnabled(printStats);
 
-    AppInstance* mainInstance = newAppInstance(projectFilename,writers,frameRanges);
+    AppInstance* mainInstance = 0;
+    try {
+        mainInstance = newAppInstance(projectFilename,writers,frameRanges);
+    } catch (...) {
+        ///The trace of a failed render is the most useful one
+        _imp->exportRenderTrace();
+        throw;
+    }
+    ///In background mode with a project, this includes the render
+    profile.endPhase("Main instance");
+    ///The restores overlapped the loading: finish them now rather than leaving them in the global thread pool
+    ///while the user starts rendering
+    _imp->waitForCachesRestored();
+    profile.endPhase("Disk caches restore");
+    if (_imp->profilingArgs.printStartupProfile) {
+        profile.print(std::cout);
+    }
+    
+    if ( isBackground() ) {
+        _imp->exportRenderTrace();
+    }
+    if (printStats) {
+        _imp->renderStats->print(std::cout);
+    }
 
     hideSplashScreen();
 
@@ -721,6 +902,7 @@ AppManager::clearPlaybackCache()
 void
 AppManager::clearDiskCache()
 {
+    _imp->waitForCachesRestored();
     clearLastRenderedTextures();
     _imp->_viewerCache->clear();
     _imp->_diskCache->clear();
@@ -739,6 +921,7 @@ void
 AppManager::clearPluginsLoadedCache()
 {
     _imp->ofxHost->clearPluginsLoadedCache();
+    FileSystemModel::clearDirectoriesIndex();
 }
 
 void
@@ -746,6 +929,7 @@ AppManager::clearAllCaches()
 {
     clearDiskCache();
     clearNodeCache();
+    FileSystemModel::clearDirectoriesIndex();
 
     ///for each app instance clear all its nodes cache
     for (std::map<int,AppInstanceRef>::iterator it = _imp->_appInstances.begin(); it != _imp->_appInstances.end(); ++it) {
@@ -824,6 +1008,18 @@ AppManager::isLoaded() const
     return _imp->_loaded;
 }
 
+void
+AppManagerPrivate::exportRenderTrace()
+{
+    if ( profilingArgs.traceFilePath.isEmpty() ) {
+        return;
+    }
+    if ( !renderTrace->exportChromeTrace( profilingArgs.traceFilePath.toStdString() ) ) {
+        std::cout << QObject::tr("Could not write the render trace to ").toStdString()
+                  << profilingArgs.traceFilePath.toStdString() << std::endl;
+    }
+}
+
 void
 AppManagerPrivate::initProcessInputChannel(const QString & mainProcessServerName)
 {
@@ -870,6 +1066,29 @@ AppManager::writeToOutputPipe(const QString & longMessage,
     return true;
 }
 
+bool
+AppManager::requestRenderChunk(QString* writerName,
+                               int* firstFrame,
+                               int* lastFrame)
+{
+    if (!_imp->_backgroundIPC) {
+        return false;
+    }
+    return _imp->_backgroundIPC->requestRenderChunk(writerName, firstFrame, lastFrame);
+}
+
+const RenderFarmArgs&
+AppManager::getRenderFarmArgs() const
+{
+    return _imp->farmArgs;
+}
+
+const ProfilingArgs&
+AppManager::getProfilingArgs() const
+{
+    return _imp->profilingArgs;
+}
+
 void
 AppManager::registerAppInstance(AppInstance* app)
 {
@@ -1315,6 +1534,12 @@ AppManager::createOFXEffect(const std::string & pluginID,
     return _imp->ofxHost->createOfxEffect(pluginID, node,serialization,paramValues,allowFileDialogs,disableRenderScaleSupport);
 }
 
+void
+AppManager::loadOFXPluginsConcurrently(const std::set< std::pair<std::string,int> > & plugins) const
+{
+    _imp->ofxHost->loadPluginsConcurrently(plugins);
+}
+
 void
 AppManager::removeFromNodeCache(const boost::shared_ptr<Natron::Image> & image)
 {
@@ -1374,6 +1599,8 @@ bool
 AppManager::getImage(const Natron::ImageKey & key,
                      std::list<boost::shared_ptr<Natron::Image> >* returnValue) const
 {
+    RenderTraceSpan traceSpan(RenderTraceEvent::eSpanKindCacheLookup);
+    
     return _imp->_nodeCache->get(key,returnValue);
 }
 
@@ -1383,12 +1610,16 @@ AppManager::getImageOrCreate(const Natron::ImageKey & key,
                              ImageLocker* imageLocker,
                              boost::shared_ptr<Natron::Image>* returnValue) const
 {
+    RenderTraceSpan traceSpan(RenderTraceEvent::eSpanKindCacheLookup);
+    
     return _imp->_nodeCache->getOrCreate(key,params,imageLocker,returnValue);
 }
 
 bool
 AppManager::getImage_diskCache(const Natron::ImageKey & key,std::list<boost::shared_ptr<Natron::Image> >* returnValue) const
 {
+    RenderTraceSpan traceSpan(RenderTraceEvent::eSpanKindCacheLookup);
+    
     return _imp->_diskCache->get(key, returnValue);
 }
 
@@ -1397,6 +1628,8 @@ AppManager::getImageOrCreate_diskCache(const Natron::ImageKey & key,const boost:
                                 ImageLocker* imageLocker,
                                 boost::shared_ptr<Natron::Image>* returnValue) const
 {
+    RenderTraceSpan traceSpan(RenderTraceEvent::eSpanKindCacheLookup);
+    
     return _imp->_diskCache->getOrCreate(key, params, imageLocker, returnValue);
 }
 
@@ -1546,6 +1779,10 @@ AppManager::getDiskCacheLocation() const
 void
 AppManagerPrivate::saveCaches()
 {
+    ///Both callers would write the same tables of contents files
+    QMutexLocker k(&saveCachesMutex);
+
+    waitForCachesRestored();
     saveCache<FrameEntry>(_viewerCache.get());
     saveCache<Image>(_diskCache.get());
 } // saveCaches
@@ -1597,7 +1834,9 @@ void restoreCache(AppManagerPrivate* p,Natron::Cache<T>* cache)
         QFile restoreFile( settingsFilePath.c_str() );
         restoreFile.remove();
         
-        cache->restore(tableOfContents);
+        ///Creating the entries is the expensive part: do it while the application keeps loading, the cache is thread-safe
+        QMutexLocker k(&p->cachesRestoresMutex);
+        p->cachesRestores.push_back( QtConcurrent::run(cache, &Natron::Cache<T>::restore, tableOfContents) );
     }
 }
 
@@ -1649,6 +1888,18 @@ AppManagerPrivate::restoreCaches()
     }
 } // restoreCaches
 
+void
+AppManagerPrivate::waitForCachesRestored()
+{
+    ///Held while waiting so that a concurrent caller does not see an empty list before the restores are done
+    QMutexLocker k(&cachesRestoresMutex);
+
+    for (std::list< QFuture<void> >::iterator it = cachesRestores.begin(); it != cachesRestores.end(); ++it) {
+        it->waitForFinished();
+    }
+    cachesRestores.clear();
+}
+
 bool
 AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath)
 {
@@ -2101,10 +2352,35 @@ AppManager::getNRunningThreads() const
     return (int)_imp->runningThreadsCount;
 }
 
+RenderQueue*
+AppManager::getRenderQueue() const
+{
+    return _imp->renderQueue.get();
+}
+
+RenderTrace*
+AppManager::getRenderTrace() const
+{
+    return _imp->renderTrace.get();
+}
+
+RenderStatsRegistry*
+AppManager::getRenderStats() const
+{
+    return _imp->renderStats.get();
+}
+
+PreviewScheduler*
+AppManager::getPreviewScheduler() const
+{
+    return _imp->previewScheduler.get();
+}
+
 void
-AppManager::setThreadAsActionCaller(bool actionCaller)
+AppManager::setThreadAsActionCaller(OFX::Host::ImageEffect::ImageEffectPlugin* plugin,
+                                    bool actionCaller)
 {
-    _imp->ofxHost->setThreadAsActionCaller(actionCaller);
+    _imp->ofxHost->setThreadAsActionCaller(plugin, actionCaller);
 }
 
 
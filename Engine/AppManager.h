@@ -11,6 +11,9 @@
 #ifndef NATRON_GLOBAL_APPMANAGER_H_
 #define NATRON_GLOBAL_APPMANAGER_H_
 
+#include <set>
+#include <string>
+
 #include "Global/GlobalDefines.h"
 CLANG_DIAG_OFF(deprecated)
 // /usr/include/qt5/QtCore/qgenericatomic.h:177:13: warning: 'register' storage class specifier is deprecated [-Wdeprecated]
@@ -38,8 +41,20 @@ class Format;
 class Settings;
 class KnobHolder;
 class NodeSerialization;
+class RenderQueue;
+class RenderTrace;
+class RenderStatsRegistry;
+class PreviewScheduler;
 class KnobSerialization;
 
+namespace OFX {
+namespace Host {
+namespace ImageEffect {
+class ImageEffectPlugin;
+}
+}
+}
+
 namespace Natron {
 class Node;
 class EffectInstance;
@@ -66,6 +81,40 @@ struct AppInstanceRef
     Natron::AppInstanceStatusEnum status;
 };
 
+/**
+ * @brief The command-line options of a background render split across several local processes, @see RenderFarm
+ **/
+struct RenderFarmArgs
+{
+    int nWorkers; //< the number of worker processes to spread the frames on, 0 or 1 renders in this process
+    bool isWorker; //< true if this process is a worker launched by a RenderFarm and gets its frames from it
+    QString diskCachePath; //< if not empty, the disk cache location to use instead of the one of the preferences
+    
+    RenderFarmArgs()
+    : nWorkers(0)
+    , isWorker(false)
+    , diskCachePath()
+    {
+    }
+};
+
+/**
+ * @brief The command-line options used to find out where the time goes
+ **/
+struct ProfilingArgs
+{
+    QString traceFilePath; //< if not empty, the render trace is recorded and written to this file when a background render ends
+    bool printStats; //< if true, the render statistics are printed when a background render ends
+    bool printStartupProfile; //< if true, the time spent in each phase of the startup is printed once the project is loaded
+    
+    ProfilingArgs()
+    : traceFilePath()
+    , printStats(false)
+    , printStartupProfile(false)
+    {
+    }
+};
+
 struct AppManagerPrivate;
 class AppManager
     : public QObject, public boost::noncopyable
@@ -100,11 +149,15 @@ public:
      * If empty all writers in the project will be rendered.
      * @param mainProcessServerName The name of the main process named pipe so the background application can communicate with the
      * main process.
+     * @param farmArgs How a background application should split its render across several processes.
+     * @param profilingArgs What should be measured and reported.
      **/
     bool load( int &argc, char **argv, const QString & projectFilename,
                const QStringList & writers,
                const std::list<std::pair<int,int> >& frameRanges,
-               const QString & mainProcessServerName  );
+               const QString & mainProcessServerName,
+               const RenderFarmArgs& farmArgs = RenderFarmArgs(),
+               const ProfilingArgs& profilingArgs = ProfilingArgs() );
 
     virtual ~AppManager();
 
@@ -137,6 +190,12 @@ public:
                                             bool allowFileDialogs,
                                             bool disableRenderScaleSupport) const;
 
+    /**
+     * @brief Loads concurrently the OFX plug-ins (identifier and major version) that are about to be instantiated.
+     * @see Natron::OfxHost::loadPluginsConcurrently
+     **/
+    void loadOFXPluginsConcurrently(const std::set< std::pair<std::string,int> > & plugins) const;
+
     void registerAppInstance(AppInstance* app);
 
     AppInstance* getAppInstance(int appID) const WARN_UNUSED_RETURN;
@@ -227,6 +286,22 @@ public:
      * short message. Otherwise the longMessage is printed to stdout
      **/
     bool writeToOutputPipe(const QString & longMessage,const QString & shortMessage);
+    
+    /**
+     * @brief For a render farm worker, asks the coordinator process for the next frames to render.
+     * This is blocking and returns false when there is nothing left to render. @see ProcessInputChannel::requestRenderChunk
+     **/
+    bool requestRenderChunk(QString* writerName,int* firstFrame,int* lastFrame);
+    
+    /**
+     * @brief Returns the options passed to load() to split a background render across several processes.
+     **/
+    const RenderFarmArgs& getRenderFarmArgs() const WARN_UNUSED_RETURN;
+    
+    /**
+     * @brief Returns the profiling options passed to load().
+     **/
+    const ProfilingArgs& getProfilingArgs() const WARN_UNUSED_RETURN;
 
     void abortAnyProcessing();
 
@@ -242,7 +317,9 @@ public:
                                  QString & projectFilename,
                                  QStringList & writers,
                                  std::list<std::pair<int,int> >& frameRanges,
-                                 QString & mainProcessServerName);
+                                 QString & mainProcessServerName,
+                                 RenderFarmArgs* farmArgs,
+                                 ProfilingArgs* profilingArgs);
 
     /**
      * @brief Called when the instance is exited
@@ -339,7 +416,27 @@ public:
      **/
     int getNRunningThreads() const;
     
-    void setThreadAsActionCaller(bool actionCaller);
+    /**
+     * @brief Returns the object arbitrating between the interactive, playback and background renders. @see RenderQueue
+     **/
+    RenderQueue* getRenderQueue() const WARN_UNUSED_RETURN;
+    
+    /**
+     * @brief Returns the recorder of the render steps timings. @see RenderTrace
+     **/
+    RenderTrace* getRenderTrace() const WARN_UNUSED_RETURN;
+    
+    /**
+     * @brief Returns the statistics accumulated by the nodes and the caches. @see RenderStatsRegistry
+     **/
+    RenderStatsRegistry* getRenderStats() const WARN_UNUSED_RETURN;
+    
+    /**
+     * @brief Returns the thread computing the previews of the nodes. @see PreviewScheduler
+     **/
+    PreviewScheduler* getPreviewScheduler() const WARN_UNUSED_RETURN;
+    
+    void setThreadAsActionCaller(OFX::Host::ImageEffect::ImageEffectPlugin* plugin,bool actionCaller);
 
     virtual QString getAppFont() const { return ""; }
     virtual int getAppFontSize() const { return 11; }
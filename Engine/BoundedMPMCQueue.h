@@ -0,0 +1,212 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_BOUNDEDMPMCQUEUE_H_
+#define NATRON_ENGINE_BOUNDEDMPMCQUEUE_H_
+
+#include <list>
+
+#include <QtCore/QAtomicInt>
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_array.hpp>
+#include <boost/noncopyable.hpp>
+#endif
+
+#include "Global/Macros.h"
+
+/**
+ * @brief A fixed capacity FIFO queue that any number of threads can push to and pop from without taking a lock.
+ * Each cell carries a sequence number telling whether it is ready to be written (sequence == position) or
+ * read (sequence == position + 1) for the current lap around the ring, so that a producer and a consumer
+ * only contend on the position counter with a compare-and-swap and never on the same cell.
+ * The positions and sequences are unsigned counters that wrap around modulo 2^32: they are only ever compared through
+ * their difference, so the queue keeps working past 2^32 push/pop. QAtomicInt only holds ints, they are cast when stored.
+ * T must be cheap to copy and copying it must not have side-effects (e.g: frame numbers), because peek()
+ * reads cells that may be overwritten concurrently and discards the copy if so.
+ **/
+template <typename T>
+class BoundedMPMCQueue
+    : public boost::noncopyable
+{
+    struct Cell
+    {
+        QAtomicInt sequence;
+        T data;
+    };
+
+    typedef unsigned int Sequence;
+
+    boost::scoped_array<Cell> _cells;
+    Sequence _mask; //< capacity - 1, the capacity is a power of 2
+
+    ///Producers and consumers hit different counters, keep them on different cache lines
+    char _pad0[64];
+    QAtomicInt _enqueuePos;
+    char _pad1[64];
+    QAtomicInt _dequeuePos;
+    char _pad2[64];
+
+    static Sequence load(const QAtomicInt & atomic)
+    {
+        return (Sequence)(int)atomic;
+    }
+
+    ///Acquire load of the sequence of a cell, pairs with the release store publishing its data
+    static Sequence loadAcquire(const QAtomicInt & atomic)
+    {
+#if QT_VERSION < 0x050000
+        return (Sequence)const_cast<QAtomicInt &>(atomic).fetchAndAddAcquire(0);
+#else
+        return (Sequence)atomic.loadAcquire();
+#endif
+    }
+
+    static int difference(Sequence a,
+                          Sequence b)
+    {
+        return (int)(a - b);
+    }
+
+public:
+
+    /**
+     * @param capacity Rounded up to the next power of 2.
+     * @param firstPosition The position of the first value pushed, only useful to test the counters wrapping around.
+     **/
+    explicit BoundedMPMCQueue(int capacity,
+                              unsigned int firstPosition = 0)
+        : _cells()
+        , _mask(0)
+        , _enqueuePos( (int)firstPosition )
+        , _dequeuePos( (int)firstPosition )
+    {
+        int size = 2;
+
+        while (size < capacity) {
+            size *= 2;
+        }
+        _cells.reset(new Cell[size]);
+        _mask = size - 1;
+        for (Sequence pos = firstPosition; pos != firstPosition + size; ++pos) {
+            _cells[pos & _mask].sequence = (int)pos;
+        }
+    }
+
+    int capacity() const
+    {
+        return (int)_mask + 1;
+    }
+
+    /**
+     * @brief Appends value to the queue. Returns false if the queue is full.
+     **/
+    bool tryPush(const T & value) WARN_UNUSED_RETURN
+    {
+        Cell* cell;
+        Sequence pos = load(_enqueuePos);
+
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            int diff = difference(loadAcquire(cell->sequence), pos);
+            if (diff == 0) {
+                ///The cell is free for this lap, claim it
+                if ( _enqueuePos.testAndSetRelaxed( (int)pos, (int)(pos + 1) ) ) {
+                    break;
+                }
+            } else if (diff < 0) {
+                ///The cell still holds the value of the previous lap: full
+                return false;
+            }
+            pos = load(_enqueuePos);
+        }
+        cell->data = value;
+        ///Publish the value to the consumers
+        cell->sequence.fetchAndStoreRelease( (int)(pos + 1) );
+
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest value of the queue and stores it in value. Returns false if the queue is empty.
+     **/
+    bool tryPop(T* value) WARN_UNUSED_RETURN
+    {
+        Cell* cell;
+        Sequence pos = load(_dequeuePos);
+
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            int diff = difference(loadAcquire(cell->sequence), pos + 1);
+            if (diff == 0) {
+                if ( _dequeuePos.testAndSetRelaxed( (int)pos, (int)(pos + 1) ) ) {
+                    break;
+                }
+            } else if (diff < 0) {
+                ///Nothing was published in this cell yet: empty
+                return false;
+            }
+            pos = load(_dequeuePos);
+        }
+        *value = cell->data;
+        ///Hand the cell back to the producers for the next lap
+        cell->sequence.fetchAndStoreRelease( (int)(pos + _mask + 1) );
+
+        return true;
+    }
+
+    /**
+     * @brief Appends to values up to maxCount of the oldest values of the queue without removing them.
+     * This is a snapshot: the values may have been popped by the time the function returns.
+     **/
+    void peek(int maxCount,
+              std::list<T>* values) const
+    {
+        Sequence pos = load(_dequeuePos);
+
+        for (int i = 0; i < maxCount; ++i, ++pos) {
+            const Cell & cell = _cells[pos & _mask];
+            Sequence sequence = loadAcquire(cell.sequence);
+            if (sequence != pos + 1) {
+                break;
+            }
+            T value = cell.data;
+            ///The cell was popped and possibly refilled while copying it, the copy cannot be trusted
+            if (loadAcquire(cell.sequence) != sequence) {
+                break;
+            }
+            values->push_back(value);
+        }
+    }
+
+    /**
+     * @brief Returns the number of values in the queue. This is only an estimate when other threads push or pop concurrently.
+     **/
+    int size() const
+    {
+        int n = difference( load(_enqueuePos), load(_dequeuePos) );
+
+        return n < 0 ? 0 : ( n > capacity() ? capacity() : n );
+    }
+
+    bool isEmpty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Pops all the values, concurrent pushes may still land in the queue afterwards.
+     **/
+    void clear()
+    {
+        T value;
+
+        while ( tryPop(&value) ) {
+        }
+    }
+};
+
+#endif // NATRON_ENGINE_BOUNDEDMPMCQUEUE_H_
@@ -56,6 +56,7 @@ CLANG_DIAG_ON(unused-parameter)
 #include "Engine/LRUHashTable.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/ImageLocker.h"
+#include "Engine/RenderStats.h"
 #include "Global/MemoryInfo.h"
 
 #define SERIALIZED_ENTRY_INTRODUCES_SIZE 2
@@ -461,12 +462,18 @@ public:
              std::list<EntryTypePtr>* returnValue) const
     {
 
-        ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        bool found;
+        {
+            ///Be atomic, so it cannot be created by another thread in the meantime
+            QMutexLocker getlocker(&_getLock);
 
-        ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
-        return getInternal(key,returnValue);
+            ///lock the cache before reading it.
+            QMutexLocker locker(&_lock);
+            found = getInternal(key,returnValue);
+        }
+        appPTR->getRenderStats()->addCacheLookup(&_cacheName, found);
+
+        return found;
         
     } // get
     
@@ -656,6 +663,7 @@ public:
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         
+        bool found = false;
         {
             ///Be atomic, so it cannot be created by another thread in the meantime
             QMutexLocker getlocker(&_getLock);
@@ -670,15 +678,25 @@ public:
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
                     if (*(*it)->getParams() == *params) {
                         *returnValue = *it;
-                        return true;
+                        found = true;
+                        break;
                     }
                 }
             }
-            
-            createInternal(key,params,imageLocker,returnValue);
-            return false;
+            if (!found) {
+                createInternal(key,params,imageLocker,returnValue);
+            }
             
         } // getlocker
+
+        ///Record out of the locks so that the statistics never serialize the cache accesses
+        RenderStatsRegistry* stats = appPTR->getRenderStats();
+        stats->addCacheLookup(&_cacheName, found);
+        if (!found && *returnValue) {
+            stats->addCacheEntryCreated( &_cacheName, params->getElementsCount() * sizeof(typename EntryType::data_t) );
+        }
+
+        return found;
     }
     
     /**
@@ -18,6 +18,7 @@
 #include "Engine/Hash64.h"
 #include "Engine/MemoryFile.h"
 #include "Engine/NonKeyParams.h"
+#include "Engine/NUMA.h"
 #include <SequenceParsing.h> // for removePath
 
 namespace Natron {
@@ -93,6 +94,10 @@ public:
         } else if (storage == Natron::eStorageModeRAM) {
             _storageMode = eStorageModeRAM;
             _buffer.resize(count);
+            if (count > 0) {
+                ///If the allocating render thread is pinned to a NUMA node, keep the entry in the memory of that node
+                Natron::NUMA::moveMemoryToCurrentThreadNode( &_buffer.front(), count * sizeof(DataType) );
+            }
         }
     }
 
@@ -284,6 +284,7 @@ Curve::clearKeyFrames()
     QWriteLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    invalidateSegments();
 }
 
 bool
@@ -302,6 +303,7 @@ Curve::clone(const Curve & other)
 
     _imp->keyFrames.clear();
     std::transform( otherKeys.begin(), otherKeys.end(), std::inserter( _imp->keyFrames, _imp->keyFrames.begin() ), KeyFrameCloner() );
+    invalidateSegments();
 }
 
 void
@@ -327,6 +329,7 @@ Curve::clone(const Curve & other,
         }
         _imp->keyFrames.insert(k);
     }
+    invalidateSegments();
 }
 
 double
@@ -445,6 +448,7 @@ Curve::removeKeyFrameWithIndex(int index)
     QWriteLocker l(&_imp->_lock);
 
     removeKeyFrame( atIndex(index) );
+    invalidateSegments();
 }
 
 
@@ -459,6 +463,7 @@ Curve::removeKeyFrameWithTime(double time)
     }
 
     removeKeyFrame(it);
+    invalidateSegments();
 }
 
 void
@@ -477,6 +482,7 @@ Curve::removeKeyFramesBeforeTime(double time,std::list<int>* keyframeRemoved)
     if (!_imp->keyFrames.empty()) {
         refreshDerivatives(Curve::eCurveChangedReasonKeyframeChanged, _imp->keyFrames.begin());
     }
+    invalidateSegments();
 }
 
 void
@@ -497,6 +503,7 @@ Curve::removeKeyFramesAfterTime(double time,std::list<int>* keyframeRemoved)
         --last;
         refreshDerivatives(Curve::eCurveChangedReasonKeyframeChanged, last);
     }
+    invalidateSegments();
 
 }
 
@@ -706,6 +713,145 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
+/// acquire load of the flag, pairs with the release store ending ensureSegments so that the segments are seen fully built
+static inline bool
+areSegmentsValid(QAtomicInt & segmentsValid)
+{
+#if QT_VERSION < 0x050000
+    return segmentsValid.testAndSetAcquire(1, 1);
+#else
+    return segmentsValid.loadAcquire() != 0;
+#endif
+}
+
+void
+Curve::ensureSegments() const
+{
+    // PRIVATE - should not lock the curve, the caller must hold the read lock
+    if ( areSegmentsValid(_imp->segmentsValid) ) {
+        return;
+    }
+
+    // several readers may get here at the same time, only one of them rebuilds the segments
+    QMutexLocker k(&_imp->segmentsMutex);
+    if ( areSegmentsValid(_imp->segmentsValid) ) {
+        return;
+    }
+
+    const KeyFrameSet & keys = _imp->keyFrames;
+    assert( !keys.empty() );
+    int nKeys = (int)keys.size();
+    _imp->keyTimes.resize(nKeys);
+    _imp->segments.resize(nKeys + 1);
+
+    int i = 0;
+    for (KeyFrameSet::const_iterator it = keys.begin(); it != keys.end(); ++it, ++i) {
+        _imp->keyTimes[i] = it->getTime();
+    }
+
+    // segment i is used for times in [keyTimes[i-1],keyTimes[i]), i.e: itup is the i'th keyframe
+    KeyFrameSet::const_iterator itup = keys.begin();
+    for (i = 0; i <= nKeys; ++i) {
+        if (i > 0) {
+            ++itup;
+        }
+        double t = i == 0 ? _imp->keyTimes[0] - 1. : _imp->keyTimes[i - 1];
+        double vcurDerivRight,vnextDerivLeft,vcur,vnext;
+        Natron::KeyframeTypeEnum interp,interpNext;
+        CurveSegment & seg = _imp->segments[i];
+        interParams(keys,
+                    t,
+                    itup,
+                    &seg.tcur,
+                    &vcur,
+                    &vcurDerivRight,
+                    &interp,
+                    &seg.tnext,
+                    &vnext,
+                    &vnextDerivLeft,
+                    &interpNext);
+        Natron::cubicCoefficients(&seg.tcur,vcur,
+                                  vcurDerivRight,
+                                  vnextDerivLeft,
+                                  &seg.tnext,vnext,
+                                  interp,
+                                  interpNext,
+                                  seg.c);
+    }
+
+    // integrate each segment between its keyframes, cubicIntegrate works on x \in [0,1]
+    _imp->keyIntegrals.resize(nKeys);
+    _imp->keyIntegrals[0] = 0.;
+    for (i = 1; i < nKeys; ++i) {
+        const CurveSegment & seg = _imp->segments[i];
+        _imp->keyIntegrals[i] = _imp->keyIntegrals[i - 1] + Natron::integrateCubic(seg.c, 0., 1.) * (seg.tnext - seg.tcur);
+    }
+    _imp->clampedIntegralsValid = false;
+
+    _imp->segmentsValid.fetchAndStoreRelease(1);
+} // ensureSegments
+
+void
+Curve::ensureClampedIntegrals(double vmin,
+                              double vmax) const
+{
+    // PRIVATE - should not lock, the caller must hold the read lock and the segments mutex
+    if ( _imp->clampedIntegralsValid && (_imp->clampedIntegralsMin == vmin) && (_imp->clampedIntegralsMax == vmax) ) {
+        return;
+    }
+    int nKeys = (int)_imp->keyTimes.size();
+    _imp->clampedKeyIntegrals.resize(nKeys);
+    _imp->clampedKeyIntegrals[0] = 0.;
+    for (int i = 1; i < nKeys; ++i) {
+        const CurveSegment & seg = _imp->segments[i];
+        _imp->clampedKeyIntegrals[i] = _imp->clampedKeyIntegrals[i - 1] +
+                                       Natron::integrateCubic_clamp(seg.c, 0., 1., vmin, vmax) * (seg.tnext - seg.tcur);
+    }
+    _imp->clampedIntegralsMin = vmin;
+    _imp->clampedIntegralsMax = vmax;
+    _imp->clampedIntegralsValid = true;
+}
+
+void
+Curve::invalidateSegments()
+{
+    // PRIVATE - should not lock, the caller must hold the write lock
+    _imp->segmentsValid = 0;
+}
+
+/// evaluate the cubic of the segment at t, the same way Natron::interpolate does
+static inline double
+evaluateSegment(const CurveSegment & seg,
+                double t)
+{
+    const double x = (t - seg.tcur) / (seg.tnext - seg.tcur);
+    const double x2 = x * x;
+    const double x3 = x2 * x;
+
+    return seg.c[0] + seg.c[1] * x + seg.c[2] * x2 + seg.c[3] * x3;
+}
+
+double
+Curve::convertValueToCurveType(double v) const
+{
+    // PRIVATE - should not lock
+    switch (_imp->type) {
+    case CurvePrivate::eCurveTypeString:
+    case CurvePrivate::eCurveTypeInt:
+
+        return std::floor(v + 0.5);
+    case CurvePrivate::eCurveTypeDouble:
+
+        return v;
+    case CurvePrivate::eCurveTypeBool:
+
+        return v >= 0.5 ? 1. : 0.;
+    default:
+
+        return v;
+    }
+}
+
 double
 Curve::getValueAt(double t,bool doClamp) const
 {
@@ -720,53 +866,66 @@ Curve::getValueAt(double t,bool doClamp) const
     //    //if there's only 1 keyframe, don't bother interpolating
     //    return (*_imp->keyFrames.begin()).getValue();
     //}
-    double tcur,tnext;
-    double vcurDerivRight,vnextDerivLeft,vcur,vnext;
-    Natron::KeyframeTypeEnum interp,interpNext;
-    KeyFrame k(t,0.);
-    // find the first keyframe with time greater than t
-    KeyFrameSet::const_iterator itup;
-    itup = _imp->keyFrames.upper_bound(k);
-    interParams(_imp->keyFrames,
-                t,
-                itup,
-                &tcur,
-                &vcur,
-                &vcurDerivRight,
-                &interp,
-                &tnext,
-                &vnext,
-                &vnextDerivLeft,
-                &interpNext);
+    ensureSegments();
 
-    double v = Natron::interpolate(tcur,vcur,
-                                   vcurDerivRight,
-                                   vnextDerivLeft,
-                                   tnext,vnext,
-                                   t,
-                                   interp,
-                                   interpNext);
+    // find the first keyframe with time greater than t, its index is the index of the segment
+    std::size_t seg = std::upper_bound(_imp->keyTimes.begin(), _imp->keyTimes.end(), t) - _imp->keyTimes.begin();
+    double v = evaluateSegment(_imp->segments[seg], t);
 
     if ( doClamp && mustClamp() ) {
         v = clampValueToCurveYRange(v);
     }
 
-    switch (_imp->type) {
-    case CurvePrivate::eCurveTypeString:
-    case CurvePrivate::eCurveTypeInt:
+    return convertValueToCurveType(v);
+} // getValueAt
 
-        return std::floor(v + 0.5);
-    case CurvePrivate::eCurveTypeDouble:
+void
+Curve::getValuesAt(const double* times,
+                   int count,
+                   double* values,
+                   bool doClamp) const
+{
+    assert(times && values);
+    QReadLocker l(&_imp->_lock);
 
-        return v;
-    case CurvePrivate::eCurveTypeBool:
+    if ( _imp->keyFrames.empty() ) {
+        throw std::runtime_error("Curve has no control points!");
+    }
 
-        return v >= 0.5 ? 1. : 0.;
-    default:
+    ensureSegments();
 
-        return v;
+    const std::vector<double> & keyTimes = _imp->keyTimes;
+    const std::vector<CurveSegment> & segments = _imp->segments;
+    const int nKeys = (int)keyTimes.size();
+
+    ///Fetch the Y range once for the whole batch instead of once per value
+    const bool clamp = doClamp && mustClamp();
+    std::pair<double,double> minmax;
+    if (clamp) {
+        minmax = getCurveYRange();
     }
-} // getValueAt
+
+    // segment seg covers [keyTimes[seg-1],keyTimes[seg]). Times are usually increasing, so try
+    // the current segment and the next one before falling back on a binary search.
+    int seg = 0;
+    for (int i = 0; i < count; ++i) {
+        const double t = times[i];
+        if ( ( (seg > 0) && (t < keyTimes[seg - 1]) ) || ( (seg + 1 < nKeys) && (t >= keyTimes[seg + 1]) ) ) {
+            seg = std::upper_bound(keyTimes.begin(), keyTimes.end(), t) - keyTimes.begin();
+        } else if ( (seg < nKeys) && (t >= keyTimes[seg]) ) {
+            ++seg;
+        }
+        double v = evaluateSegment(segments[seg], t);
+        if (clamp) {
+            if (v > minmax.second) {
+                v = minmax.second;
+            } else if (v < minmax.first) {
+                v = minmax.first;
+            }
+        }
+        values[i] = convertValueToCurveType(v);
+    }
+} // getValuesAt
 
 double
 Curve::getDerivativeAt(double t) const
@@ -827,6 +986,39 @@ Curve::getDerivativeAt(double t) const
     return d;
 } // getDerivativeAt
 
+/// integrate the segment from x1 to x2, with respect to time
+static inline double
+integrateSegment(const CurveSegment & seg,
+                 double x1,
+                 double x2,
+                 bool clamp,
+                 double vmin,
+                 double vmax)
+{
+    const double h = seg.tnext - seg.tcur;
+
+    return clamp ? Natron::integrateCubic_clamp(seg.c, x1, x2, vmin, vmax) * h : Natron::integrateCubic(seg.c, x1, x2) * h;
+}
+
+/// integrate the segment with index segIndex from the keyframe it starts at to t. The first segment
+/// has no starting keyframe: it is integrated backwards from the first keyframe (at x = 1) to t.
+static inline double
+integrateSegmentFromKey(const CurveSegment & seg,
+                        int segIndex,
+                        double t,
+                        bool clamp,
+                        double vmin,
+                        double vmax)
+{
+    const double x = (t - seg.tcur) / (seg.tnext - seg.tcur);
+
+    if (segIndex == 0) {
+        return -integrateSegment(seg, x, 1., clamp, vmin, vmax);
+    }
+
+    return integrateSegment(seg, 0., x, clamp, vmin, vmax);
+}
+
 double
 Curve::getIntegrateFromTo(double t1,
                           double t2) const
@@ -845,90 +1037,44 @@ Curve::getIntegrateFromTo(double t1,
     }
     assert(_imp->type == CurvePrivate::eCurveTypeDouble); // only real-valued curves can be derived
 
-    // even when there is only one keyframe, there may be tangents!
-    //if (_imp->keyFrames.size() == 1) {
-    //    //if there's only 1 keyframe, don't bother interpolating
-    //    return (*_imp->keyFrames.begin()).getValue();
-    //}
-    double tcur,tnext;
-    double vcurDerivRight,vnextDerivLeft,vcur,vnext;
-    Natron::KeyframeTypeEnum interp,interpNext;
-    KeyFrame k(t1,0.);
-    // find the first keyframe with time strictly greater than t1
-    KeyFrameSet::const_iterator itup;
-    itup = _imp->keyFrames.upper_bound(k);
-    interParams(_imp->keyFrames,
-                t1,
-                itup,
-                &tcur,
-                &vcur,
-                &vcurDerivRight,
-                &interp,
-                &tnext,
-                &vnext,
-                &vnextDerivLeft,
-                &interpNext);
+    ensureSegments();
 
-    double sum = 0.;
-
-    // while there are still keyframes after the current time, add to the total sum and advance
-    while (itup != _imp->keyFrames.end() && itup->getTime() < t2) {
-        // add integral from t1 to itup->getTime() to sum
-        if ( mustClamp() ) {
-            std::pair<double,double> minmax = getCurveYRange();
-            sum += Natron::integrate_clamp(tcur,vcur,
-                                           vcurDerivRight,
-                                           vnextDerivLeft,
-                                           tnext,vnext,
-                                           t1, itup->getTime(),
-                                           minmax.first, minmax.second,
-                                           interp,
-                                           interpNext);
-        } else {
-            sum += Natron::integrate(tcur,vcur,
-                                     vcurDerivRight,
-                                     vnextDerivLeft,
-                                     tnext,vnext,
-                                     t1, itup->getTime(),
-                                     interp,
-                                     interpNext);
-        }
-        // advance
-        t1 = itup->getTime();
-        ++itup;
-        interParams(_imp->keyFrames,
-                    t1,
-                    itup,
-                    &tcur,
-                    &vcur,
-                    &vcurDerivRight,
-                    &interp,
-                    &tnext,
-                    &vnext,
-                    &vnextDerivLeft,
-                    &interpNext);
+    const bool clamp = mustClamp();
+    std::pair<double,double> minmax(0.,0.);
+    if (clamp) {
+        minmax = getCurveYRange();
     }
 
-    assert( itup == _imp->keyFrames.end() || t2 <= itup->getTime() );
-    // add integral from t1 to t2 to sum
-    if ( mustClamp() ) {
-        std::pair<double,double> minmax = getCurveYRange();
-        sum += Natron::integrate_clamp(tcur,vcur,
-                                       vcurDerivRight,
-                                       vnextDerivLeft,
-                                       tnext,vnext,
-                                       t1, t2,
-                                       minmax.first, minmax.second,
-                                       interp,
-                                       interpNext);
+    // find the first keyframes with time strictly greater than t1 and t2, their indices are the indices of the segments
+    const std::vector<double> & keyTimes = _imp->keyTimes;
+    const int seg1 = std::upper_bound(keyTimes.begin(), keyTimes.end(), t1) - keyTimes.begin();
+    const int seg2 = std::upper_bound(keyTimes.begin(), keyTimes.end(), t2) - keyTimes.begin();
+    const CurveSegment & s1 = _imp->segments[seg1];
+    const CurveSegment & s2 = _imp->segments[seg2];
+    double sum;
+
+    if (seg1 == seg2) {
+        sum = integrateSegment(s1,
+                               (t1 - s1.tcur) / (s1.tnext - s1.tcur),
+                               (t2 - s1.tcur) / (s1.tnext - s1.tcur),
+                               clamp, minmax.first, minmax.second);
     } else {
-        sum += Natron::integrate(tcur,vcur,
-                                 vcurDerivRight,
-                                 vnextDerivLeft,
-                                 tnext,vnext,
-                                 t1, t2,
-                                 interp,
-                                 interpNext);
+        // seg1 < seg2: the integral between the keyframes starting both segments is tabulated,
+        // only the two partial segments remain to be integrated
+        assert(seg1 < seg2);
+        double keyIntegral1,keyIntegral2;
+        if (clamp) {
+            QMutexLocker k(&_imp->segmentsMutex);
+            ensureClampedIntegrals(minmax.first, minmax.second);
+            keyIntegral1 = seg1 > 0 ? _imp->clampedKeyIntegrals[seg1 - 1] : 0.;
+            keyIntegral2 = _imp->clampedKeyIntegrals[seg2 - 1];
+        } else {
+            keyIntegral1 = seg1 > 0 ? _imp->keyIntegrals[seg1 - 1] : 0.;
+            keyIntegral2 = _imp->keyIntegrals[seg2 - 1];
+        }
+        sum = (keyIntegral2 - keyIntegral1)
+              + integrateSegmentFromKey(s2, seg2, t2, clamp, minmax.first, minmax.second)
+              - integrateSegmentFromKey(s1, seg1, t1, clamp, minmax.first, minmax.second);
     }
 
     return opposite ? -sum : sum;
@@ -1305,6 +1451,7 @@ Curve::evaluateCurveChanged(CurveChangedReasonEnum reason,
 {
     // PRIVATE - should not lock
     assert( key != _imp->keyFrames.end() );
+    invalidateSegments();
 
     if ( (key->getInterpolation() != Natron::eKeyframeTypeBroken) && (key->getInterpolation() != Natron::eKeyframeTypeFree)
          && ( reason != eCurveChangedReasonDerivativesChanged) ) {
@@ -221,6 +221,13 @@ public:
 
     double getValueAt(double t,bool clamp = true) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Evaluates the curve at the count times pointed to by times and writes the results in values.
+     * This is equivalent to calling getValueAt for each time, but the curve is locked once and the
+     * interpolation is done on the flattened segments. It is fastest when the times are increasing.
+     **/
+    void getValuesAt(const double* times,int count,double* values,bool clamp = true) const;
+
     double getDerivativeAt(double t) const WARN_UNUSED_RETURN;
 
     double getIntegrateFromTo(double t1, double t2) const WARN_UNUSED_RETURN;
@@ -285,6 +292,19 @@ private:
 
     double clampValueToCurveYRange(double v) const WARN_UNUSED_RETURN;
 
+    ///Rebuilds the flattened segments if the keyframes changed. The read lock must be held.
+    void ensureSegments() const;
+
+    ///Rebuilds the integrals of the curve clamped to [vmin,vmax] at each keyframe if needed.
+    ///The read lock and the segments mutex must be held.
+    void ensureClampedIntegrals(double vmin,double vmax) const;
+
+    ///Marks the flattened segments as invalid. The write lock must be held.
+    void invalidateSegments();
+
+    ///Applies the rounding corresponding to the curve type (int, bool...) to an interpolated value
+    double convertValueToCurveType(double v) const WARN_UNUSED_RETURN;
+
     ///returns an iterator to the new keyframe in the keyframe set and
     ///a boolean indicating whether it removed a keyframe already existing at this time or not
     std::pair<KeyFrameSet::iterator,bool> addKeyFrameNoUpdate(const KeyFrame & cp) WARN_UNUSED_RETURN;
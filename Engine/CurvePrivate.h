@@ -14,7 +14,11 @@
 #ifndef Q_MOC_RUN
 #include <boost/shared_ptr.hpp>
 #endif
+#include <vector>
+
 #include <QReadWriteLock>
+#include <QMutex>
+#include <QtCore/QAtomicInt>
 
 #include "Engine/Rect.h"
 #include "Engine/Variant.h"
@@ -26,6 +30,17 @@ class Curve;
 class KeyFrame;
 class KnobI;
 
+/**
+ * @brief The interpolation between two consecutive keyframes, flattened as a cubic polynomial
+ * c0 + c1*x + c2*x^2 + c3*x^3 with x = (t - tcur) / (tnext - tcur).
+ * The first and last segments are the virtual segments before the first and after the last keyframe.
+ **/
+struct CurveSegment
+{
+    double tcur, tnext;
+    double c[4];
+};
+
 struct CurvePrivate
 {
     enum CurveTypeEnum
@@ -48,6 +63,21 @@ struct CurvePrivate
     bool hasYRange;
     mutable QReadWriteLock _lock; //< the plug-ins can call getValueAt at any moment and we must make sure the user is not playing around
 
+    ///Flattened copy of keyFrames used to evaluate the curve: keyTimes holds the N sorted keyframe times
+    ///and segments the N+1 cubics around them. Rebuilt lazily by the readers after the keyframes changed.
+    mutable std::vector<double> keyTimes;
+    mutable std::vector<CurveSegment> segments;
+    ///keyIntegrals[i] is the integral of the curve from the first keyframe to the i'th keyframe
+    mutable std::vector<double> keyIntegrals;
+    mutable QAtomicInt segmentsValid; //< 0 if keyFrames changed since the segments were computed
+    mutable QMutex segmentsMutex; //< protects the rebuild of the segments by concurrent readers
+
+    ///Same as keyIntegrals but for the curve clamped to [clampedIntegralsMin,clampedIntegralsMax].
+    ///Protected by segmentsMutex since the Y range of the owner may change independently of the keyframes.
+    mutable std::vector<double> clampedKeyIntegrals;
+    mutable double clampedIntegralsMin, clampedIntegralsMax;
+    mutable bool clampedIntegralsValid;
+
 
     CurvePrivate()
         : keyFrames()
@@ -61,11 +91,29 @@ struct CurvePrivate
           , yMax(INT_MAX)
           , hasYRange(false)
           , _lock(QReadWriteLock::Recursive)
+          , keyTimes()
+          , segments()
+          , keyIntegrals()
+          , segmentsValid(0)
+          , segmentsMutex()
+          , clampedKeyIntegrals()
+          , clampedIntegralsMin(0.)
+          , clampedIntegralsMax(0.)
+          , clampedIntegralsValid(false)
     {
     }
 
     CurvePrivate(const CurvePrivate & other)
         : _lock(QReadWriteLock::Recursive)
+          , keyTimes()
+          , segments()
+          , keyIntegrals()
+          , segmentsValid(0)
+          , segmentsMutex()
+          , clampedKeyIntegrals()
+          , clampedIntegralsMin(0.)
+          , clampedIntegralsMax(0.)
+          , clampedIntegralsValid(false)
     {
         *this = other;
     }
@@ -82,6 +130,7 @@ struct CurvePrivate
         yMin = other.yMin;
         yMax = other.yMax;
         hasYRange = other.hasYRange;
+        segmentsValid = 0;
     }
 };
 
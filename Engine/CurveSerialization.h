@@ -35,6 +35,9 @@ Curve::serialize(Archive & ar,
 {
     QReadLocker l(&_imp->_lock);
     ar & boost::serialization::make_nvp("KeyFrameSet",_imp->keyFrames);
+    if (Archive::is_loading::value) {
+        invalidateSegments();
+    }
 }
 
 #endif // NATRON_ENGINE_CURVESERIALIZATION_H_
@@ -24,6 +24,7 @@
 #include "Engine/AppManager.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/Node.h"
+#include "Engine/NUMA.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/Log.h"
 #include "Engine/Image.h"
@@ -42,6 +43,10 @@
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/Transform.h"
 #include "Engine/DiskCacheNode.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/RenderTrace.h"
+#include "Engine/RenderStats.h"
+#include "Engine/RenderThreadsController.h"
 
 using namespace Natron;
 
@@ -671,6 +676,9 @@ EffectInstance::EffectInstance(boost::shared_ptr<Node> node)
 EffectInstance::~EffectInstance()
 {
     clearPluginMemoryChunks();
+    if (appPTR) {
+        appPTR->getRenderStats()->onNodeDeleted(this);
+    }
 }
 
 
@@ -737,10 +745,32 @@ EffectInstance::setParallelRenderArgs(int time,
     
     args.canAbort = canAbort;
     
+    args.sequenceRenderBegunByCaller = false;
+    
+    args.isStreamingBands = false;
+    
     ++args.validArgs;
     
 }
 
+void
+EffectInstance::setSequenceRenderBegunByCaller(bool begun)
+{
+    ParallelRenderArgs& args = _imp->frameRenderArgs.localData();
+    
+    assert(args.validArgs);
+    args.sequenceRenderBegunByCaller = begun;
+}
+
+void
+EffectInstance::setStreamingBands(bool streaming)
+{
+    ParallelRenderArgs& args = _imp->frameRenderArgs.localData();
+    
+    assert(args.validArgs);
+    args.isStreamingBands = streaming;
+}
+
 bool
 EffectInstance::invalidateParallelRenderArgs()
 {
@@ -1488,6 +1518,7 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool useCache,
 {
     ImageList cachedImages;
     bool isCached = false;
+    bool isConverted = false; //< true if the image returned is a downscaled copy of a cached image
     
     ///Find first something in the input images list
     if (!inputImages.empty()) {
@@ -1591,6 +1622,7 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool useCache,
                                                                                oldParams->getFramesNeeded());
                 
                 if (!imageParams->getBounds().contains(renderWindow)) {
+                    appPTR->getRenderStats()->addNodeCacheLookup(this, RenderStatsRegistry::eCacheLookupResultMiss);
                     return;
                 }
                 
@@ -1607,6 +1639,8 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool useCache,
                     assert(img);
                     if (!cached) {
                         img->allocateMemory();
+                        appPTR->getRenderStats()->addNodeBytesAllocated( this,
+                                                                         imageParams->getElementsCount() * sizeof(Image::data_t) );
                     } else {
                         ///lock the image because it might not be allocated yet
                         imageLock.lock(img);
@@ -1624,6 +1658,7 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool useCache,
             }
             
             *image = imageToConvert;
+            isConverted = true;
             
         } else if (*image) { //  else if (imageToConvert && !*image)
             
@@ -1637,7 +1672,12 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool useCache,
         }
         
     }
-
+    
+    RenderStatsRegistry::CacheLookupResultEnum lookupResult = RenderStatsRegistry::eCacheLookupResultMiss;
+    if (*image) {
+        lookupResult = isConverted ? RenderStatsRegistry::eCacheLookupResultConvertedHit : RenderStatsRegistry::eCacheLookupResultExactHit;
+    }
+    appPTR->getRenderStats()->addNodeCacheLookup(this, lookupResult);
 }
 
 bool
@@ -1792,6 +1832,8 @@ public:
 boost::shared_ptr<Natron::Image>
 EffectInstance::renderRoI(const RenderRoIArgs & args)
 {
+    RenderTraceSpan traceSpan(RenderTraceEvent::eSpanKindRenderRoI, this, args.time, args.mipMapLevel);
+    appPTR->getRenderStats()->addRenderRoICall(this);
    
     ParallelRenderArgs& frameRenderArgs = _imp->frameRenderArgs.localData();
     if (!frameRenderArgs.validArgs) {
@@ -2005,6 +2047,12 @@ EffectInstance::renderRoI(const RenderRoIArgs & args)
     Natron::ImageKey key = Natron::Image::makeKey(nodeHash, isFrameVaryingOrAnimated, args.time, args.view);
     
     bool useDiskCacheNode = dynamic_cast<DiskCacheNode*>(this) != NULL;
+    
+    ///When streaming bands to a writer, a cached image would cover the whole region of definition: only allocate the
+    ///region of interest of the band instead. The DiskCache node still caches, that is what it is for.
+    if (createInCache && frameRenderArgs.isStreamingBands && !useDiskCacheNode) {
+        createInCache = false;
+    }
 
     {
         ///If the last rendered image had a different hash key (i.e a parameter changed or an input changed)
@@ -2323,6 +2371,8 @@ EffectInstance::renderRoI(const RenderRoIArgs & args)
                 
                 if (!cached) {
                     newImage->allocateMemory();
+                    appPTR->getRenderStats()->addNodeBytesAllocated( this,
+                                                                     cachedImgParams->getElementsCount() * sizeof(Image::data_t) );
                 } else {
                     ///lock the image because it might not be allocated yet
                     imageLock.lock(newImage);
@@ -2369,6 +2419,8 @@ EffectInstance::renderRoI(const RenderRoIArgs & args)
                     
                     if (!cached) {
                         image->allocateMemory();
+                        appPTR->getRenderStats()->addNodeBytesAllocated( this,
+                                                                         upscaledImageParams->getElementsCount() * sizeof(Image::data_t) );
                     } else {
                         ///lock the image because it might not be allocated yet
                         upscaledImageLock.lock(image);
@@ -2725,6 +2777,8 @@ EffectInstance::renderRoIInternal(SequenceTime time,
 #endif
                                   )
 {
+    RenderTraceSpan traceSpan(RenderTraceEvent::eSpanKindRenderRoIInternal, this, time, mipMapLevel);
+    
     EffectInstance::RenderRoIStatusEnum retCode;
 
     
@@ -2899,7 +2953,8 @@ EffectInstance::renderRoIInternal(SequenceTime time,
         ///neer call beginsequenceRender here if the render is sequential
         
         Natron::SequentialPreferenceEnum pref = getSequentialPreference();
-        if (!isWriter() || pref == eSequentialPreferenceNotSequential) {
+        if ( (!isWriter() || pref == eSequentialPreferenceNotSequential) &&
+             !_imp->frameRenderArgs.localData().sequenceRenderBegunByCaller ) {
             callBegin = true;
         }
 
@@ -2920,6 +2975,11 @@ EffectInstance::renderRoIInternal(SequenceTime time,
         ///as it would lead to a deadlock when the project is loading.
         ///Just fall back to Fully_safe
         int nbThreads = appPTR->getCurrentSettings()->getNumberOfThreads();
+        ///When frames are rendered in parallel, the cores are shared between them
+        int tilesThreads = RenderThreadsController::getCurrentThreadTilesThreads();
+        if ( (nbThreads == 0) && (tilesThreads > 0) ) {
+            nbThreads = tilesThreads;
+        }
         if (safety == eRenderSafetyFullySafeFrame) {
             ///If the plug-in is eRenderSafetyFullySafeFrame that means it wants the host to perform SMP aka slice up the RoI into chunks
             ///but if the effect doesn't support tiles it won't work.
@@ -2954,6 +3014,8 @@ EffectInstance::renderRoIInternal(SequenceTime time,
             tiledArgs.inputImages = inputImages;
             tiledArgs.renderUseScaleOneInputs = useScaleOneInputImages;
             tiledArgs.isRenderResponseToUserInteraction = isRenderMadeInResponseToUserInteraction;
+            tiledArgs.priority = RenderQueue::getCurrentThreadPriority();
+            tiledArgs.numaNode = Natron::NUMA::getCurrentThreadNode();
             tiledArgs.downscaledImage = downscaledImage;
             tiledArgs.fullScaleImage = image;
             tiledArgs.renderMappedImage = renderMappedImage;
@@ -3074,6 +3136,11 @@ EffectInstance::tiledRenderingFunctor(const TiledRenderingFunctorArgs& args,
                                      bool setThreadLocalStorage,
                                      const RectI & downscaledRectToRender )
 {
+    ///This is a thread of the global thread pool: make it run with the priority of the render that launched it
+    RenderPrioritySetter prioritySetter(args.priority);
+    ///Likewise, render the tile on the NUMA node of that render so that the image stays local to it
+    Natron::NUMA::moveCurrentThreadToNode(args.numaNode);
+    
     return tiledRenderingFunctor(*args.args,
                                  frameArgs,
                                  args.inputImages,
@@ -3116,6 +3183,8 @@ EffectInstance::tiledRenderingFunctor(const RenderArgs & args,
     const SequenceTime time = args._time;
     int mipMapLevel = downscaledImage->getMipMapLevel();
     const int view = args._view;
+    
+    RenderTraceSpan traceSpan(RenderTraceEvent::eSpanKindTile, this, time, mipMapLevel);
 
     // at this point, it may be unnecessary to call render because it was done a long time ago => check the bitmap here!
 # ifndef NDEBUG
@@ -3133,6 +3202,8 @@ EffectInstance::tiledRenderingFunctor(const RenderArgs & args,
     renderMappedScale.x = renderMappedScale.y = Image::getScaleFromMipMapLevel( renderMappedImage->getMipMapLevel() );
     assert( !( (supportsRenderScaleMaybe() == eSupportsNo) && !(renderMappedScale.x == 1. && renderMappedScale.y == 1.) ) );
     
+    ///Tile boundary: let the more urgent renders (e.g: the user interacting with the viewer) go first
+    appPTR->getRenderQueue()->yieldToHigherPriority();
     
     ///Make the thread-storage live as long as the render action is called if we're in a newly launched thread in eRenderSafetyFullySafeFrame mode
     boost::shared_ptr<Implementation::ScopedRenderArgs> scopedArgs;
@@ -3230,14 +3301,23 @@ EffectInstance::tiledRenderingFunctor(const RenderArgs & args,
     RenderScale originalScale;
     originalScale.x = downscaledImage->getScale();
     originalScale.y = originalScale.x;
+    
+    U64 renderedBytes = renderRectToRender.area() * renderMappedImage->getComponentsCount() *
+                        getSizeOfForBitDepth( renderMappedImage->getBitDepth() );
+    traceSpan.setBytes(renderedBytes);
 
-    Natron::StatusEnum st = render_public(time,
-                                          originalScale,
-                                          renderMappedScale,
-                                          renderRectToRender, view,
-                                          isSequentialRender,
-                                          isRenderResponseToUserInteraction,
-                                          renderMappedImage);
+    Natron::StatusEnum st;
+    {
+        RenderTraceSpan pluginTraceSpan(RenderTraceEvent::eSpanKindPluginRender, renderedBytes);
+        NodeRenderTimer renderTimer(this, time);
+        st = render_public(time,
+                           originalScale,
+                           renderMappedScale,
+                           renderRectToRender, view,
+                           isSequentialRender,
+                           isRenderResponseToUserInteraction,
+                           renderMappedImage);
+    }
     
     bool renderAborted = aborted();
     
@@ -96,6 +96,14 @@ struct ParallelRenderArgs
     ///Can the plug-in call setValue while the action is active
     bool canSetValue;
     
+    ///True if the caller of renderRoI already called beginSequenceRender for this frame, e.g: to stream it in bands
+    ///to a writer, so that renderRoI does not call begin/endSequenceRender around each band
+    bool sequenceRenderBegunByCaller;
+    
+    ///True while the frame is streamed in bands to a writer: the images rendered for it are not cached, so that they only
+    ///cover the region of interest of the band instead of the whole region of definition
+    bool isStreamingBands;
+    
     ParallelRenderArgs()
     : time(0)
     , timeline(0)
@@ -107,6 +115,8 @@ struct ParallelRenderArgs
     , isSequentialRender(false)
     , canAbort(false)
     , canSetValue(false)
+    , sequenceRenderBegunByCaller(false)
+    , isStreamingBands(false)
     {
         
     }
@@ -526,6 +536,18 @@ public:
      **/
     bool invalidateParallelRenderArgs();
 
+    /**
+     * @brief To be called after setParallelRenderArgs by a caller that calls begin/endSequenceRender itself once
+     * for the frame rendered by the current thread, around several renderRoI calls.
+     **/
+    void setSequenceRenderBegunByCaller(bool begun);
+
+    /**
+     * @brief To be called after setParallelRenderArgs, @see ParallelRenderArgs::isStreamingBands.
+     * Use Node::setStreamingBands to set it on the whole tree.
+     **/
+    void setStreamingBands(bool streaming);
+
     /**
      * @breif Don't override this one, override onKnobValueChanged instead.
      **/
@@ -1382,6 +1404,8 @@ private:
         bool renderUseScaleOneInputs;
         bool isSequentialRender;
         bool isRenderResponseToUserInteraction;
+        Natron::RenderPriorityEnum priority; //< priority class of the thread that launched the tiled render
+        int numaNode; //< NUMA node the thread that launched the tiled render is pinned to, or -1
         double par;
         boost::shared_ptr<Natron::Image>  downscaledImage;
         boost::shared_ptr<Natron::Image>  fullScaleImage;
@@ -83,20 +83,29 @@ SOURCES += \
     NonKeyParamsSerialization.cpp \
     NodeSerialization.cpp \
     NoOp.cpp \
+    NUMA.cpp \
     OfxClipInstance.cpp \
+    OfxDescriptorsCache.cpp \
     OfxHost.cpp \
     OfxImageEffectInstance.cpp \
     OfxEffectInstance.cpp \
     OfxMemory.cpp \
     OfxOverlayInteract.cpp \
     OfxParamInstance.cpp \
+    OfxWorkerPool.cpp \
     OutputSchedulerThread.cpp \
     Plugin.cpp \
     PluginMemory.cpp \
+    PreviewScheduler.cpp \
     ProcessHandler.cpp \
     Project.cpp \
     ProjectPrivate.cpp \
     ProjectSerialization.cpp \
+    RenderFarm.cpp \
+    RenderQueue.cpp \
+    RenderStats.cpp \
+    RenderThreadsController.cpp \
+    RenderTrace.cpp \
     RotoContext.cpp \
     RotoSerialization.cpp  \
     Settings.cpp \
@@ -112,6 +121,7 @@ HEADERS += \
     AppInstance.h \
     AppManager.h \
     BlockingBackgroundRender.h \
+    BoundedMPMCQueue.h \
     Cache.h \
     CacheEntry.h \
     Curve.h \
@@ -156,23 +166,32 @@ HEADERS += \
     NonKeyParamsSerialization.h \
     NodeSerialization.h \
     NoOp.h \
+    NUMA.h \
     OfxClipInstance.h \
+    OfxDescriptorsCache.h \
     OfxHost.h \
     OfxImageEffectInstance.h \
     OfxEffectInstance.h \
     OfxOverlayInteract.h \
     OfxMemory.h \
     OfxParamInstance.h \
+    OfxWorkerPool.h \
     OpenGLViewerI.h \
     OutputSchedulerThread.h \
     OverlaySupport.h \
     Plugin.h \
     PluginMemory.h \
+    PreviewScheduler.h \
     ProcessHandler.h \
     Project.h \
     ProjectPrivate.h \
     ProjectSerialization.h \
     Rect.h \
+    RenderFarm.h \
+    RenderQueue.h \
+    RenderStats.h \
+    RenderThreadsController.h \
+    RenderTrace.h \
     RotoContext.h \
     RotoContextPrivate.h \
     RotoSerialization.h \
@@ -10,20 +10,54 @@
 
 #include "FileSystemModel.h"
 
+#include <set>
 #include <vector>
+#include <fstream>
+#include <algorithm>
 
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QFileSystemWatcher>
+#include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QDateTime>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
 #include <QtCore/QUrl>
 #include <QtCore/QMimeData>
+#include <QtCore/QHash>
+#include <QtConcurrentMap>
+
+#ifndef Q_MOC_RUN
+#include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#endif
 
 #include <SequenceParsing.h>
 
+#include "Engine/Hash64.h"
+#include "Engine/StandardPaths.h"
+
+///Directories with less entries than this are listed quickly enough to not be worth an index on disk
+#define NATRON_DIRECTORY_INDEX_MIN_ENTRIES 1000
+
+///Bump when the content of the directory indexes changes
+#define NATRON_DIRECTORY_INDEX_VERSION 3
+
+///Only the indexes of the directories listed most recently are kept
+#define NATRON_DIRECTORY_INDEX_MAX_FILES 100
+
+///The directories modified less than this many seconds ago are not indexed: their modification date may not change
+///when more files are added within the same second
+#define NATRON_DIRECTORY_INDEX_MIN_AGE 2
+
+///Number of entries whose information is fetched concurrently before checking whether the gathering was aborted
+#define NATRON_DIRECTORY_STAT_BATCH 1024
+
 
 
 static QStringList getSplitPath(const QString& path)
@@ -80,6 +114,7 @@ struct FileSystemItemPrivate
     
     FileSystemItem* parent;
     std::vector< boost::shared_ptr<FileSystemItem> > children; ///vector for random access
+    QHash<QString,int> childrenIndexes; ///< to find out in constant time whether a child exists already
     QMutex childrenMutex;
 
     bool isDir;
@@ -88,6 +123,7 @@ struct FileSystemItemPrivate
     ///This will be set when the file system model is in sequence mode and this is a file
     boost::shared_ptr<SequenceParsing::SequenceFromFiles> sequence;
     
+    mutable QMutex infoMutex; //< protects dateModified and size, which the gatherer fills in once the item is shown
     QDateTime dateModified;
     quint64 size;
     QString fileExtension;
@@ -97,10 +133,12 @@ struct FileSystemItemPrivate
                           const QDateTime& dateModified,quint64 size,FileSystemItem* parent)
     : parent(parent)
     , children()
+    , childrenIndexes()
     , childrenMutex()
     , isDir(isDir)
     , filename(filename)
     , sequence(sequence)
+    , infoMutex()
     , dateModified(dateModified)
     , size(size)
     , fileExtension()
@@ -208,63 +246,73 @@ FileSystemItem::fileExtension() const
     return _imp->fileExtension;
 }
 
-const QDateTime&
+QDateTime
 FileSystemItem::getLastModified() const
 {
+    QMutexLocker l(&_imp->infoMutex);
     return _imp->dateModified;
 }
 
 quint64
 FileSystemItem::getSize() const
 {
+    QMutexLocker l(&_imp->infoMutex);
     return _imp->size;
 }
 
+void
+FileSystemItem::setInfo(quint64 size,
+                        const QDateTime& lastModified)
+{
+    QMutexLocker l(&_imp->infoMutex);
+    _imp->size = _imp->isDir ? 0 : size;
+    _imp->dateModified = lastModified;
+}
+
 void
 FileSystemItem::addChild(const boost::shared_ptr<FileSystemItem>& child)
 {
     QMutexLocker l(&_imp->childrenMutex);
+    _imp->childrenIndexes.insert( child->fileName(), (int)_imp->children.size() );
     _imp->children.push_back(child);
     
 }
 
-void
+boost::shared_ptr<FileSystemItem>
 FileSystemItem::addChild(const boost::shared_ptr<SequenceParsing::SequenceFromFiles>& sequence,
-              const QFileInfo& info)
+                         const QString& fileName,
+                         bool isDir,
+                         quint64 size,
+                         const QDateTime& lastModified)
 {
     QMutexLocker l(&_imp->childrenMutex);
     ///Does the child exist already ?
-    QString filename = sequence ? sequence->generateUserFriendlySequencePattern().c_str() : info.fileName();
+    QString filename = sequence ? sequence->generateUserFriendlySequencePattern().c_str() : fileName;
     
-    bool found = false;
-    for (int j = 0; j < (int)_imp->children.size(); ++j) {
-        if (_imp->children[j]->fileName() == filename) {
-            found = true;
-            break;
-        }
+    QHash<QString,int>::const_iterator found = _imp->childrenIndexes.constFind(filename);
+    if ( found != _imp->childrenIndexes.constEnd() ) {
+        return _imp->children[found.value()];
     }
     
-    if (!found) {
-        
-        bool isDir = sequence ? false : info.isDir();
-        qint64 size;
-        if (sequence) {
-            size = sequence->getEstimatedTotalSize();
-        } else {
-            size = isDir ? 0 : info.size();
-        }
-        
-        
-        ///Create the child
-        boost::shared_ptr<FileSystemItem> child( new FileSystemItem(isDir,
-                                                                    filename,
-                                                                    sequence,
-                                                                    info.lastModified(),
-                                                                    size,
-                                                                    this) );
-        _imp->children.push_back(child);
-        
+    if (sequence) {
+        isDir = false;
+        size = sequence->getEstimatedTotalSize();
+    } else if (isDir) {
+        size = 0;
     }
+    
+    
+    ///Create the child
+    boost::shared_ptr<FileSystemItem> child( new FileSystemItem(isDir,
+                                                                filename,
+                                                                sequence,
+                                                                lastModified,
+                                                                size,
+                                                                this) );
+    _imp->childrenIndexes.insert( filename, (int)_imp->children.size() );
+    _imp->children.push_back(child);
+    
+    return child;
 }
 
 void
@@ -272,6 +320,7 @@ FileSystemItem::clearChildren()
 {
     QMutexLocker l(&_imp->childrenMutex);
     _imp->children.clear();
+    _imp->childrenIndexes.clear();
 }
 
 // This is a recursive method which tries to match a path to a specifiq
@@ -354,7 +403,7 @@ struct FileSystemModelPrivate
     
     boost::shared_ptr<FileSystemItem> getItemFromPath(const QString &path) const;
     
-    void populateItem(const boost::shared_ptr<FileSystemItem>& item);
+    void populateItem(const boost::shared_ptr<FileSystemItem>& item,bool useIndex = true);
     
     FileSystemItem *getItem(const QModelIndex &index) const;
     
@@ -367,6 +416,7 @@ FileSystemModel::FileSystemModel(SortableViewI* view)
 , _imp(new FileSystemModelPrivate(this,view))
 {
     QObject::connect(&_imp->gatherer, SIGNAL(directoryLoaded(QString)), this, SLOT(onDirectoryLoadedByGatherer(QString)));
+    QObject::connect(&_imp->gatherer, SIGNAL(directoryInfoUpdated(QString)), this, SLOT(onDirectoryInfoUpdatedByGatherer(QString)));
     
     
     _imp->headers << tr("Name") << tr("Size") << tr("Type") << tr("Date Modified");
@@ -934,11 +984,12 @@ FileSystemModel::setRootPath(const QString& path)
 
 
 void
-FileSystemModelPrivate::populateItem(const boost::shared_ptr<FileSystemItem> &item)
+FileSystemModelPrivate::populateItem(const boost::shared_ptr<FileSystemItem> &item,
+                                     bool useIndex)
 {
     ///We do it in a separate thread because it might be expensive,
     ///the directoryLoaded signal will be emitted when it is finished
-    gatherer.fetchDirectory(item);
+    gatherer.fetchDirectory(item,useIndex);
 }
 
 void
@@ -991,13 +1042,29 @@ FileSystemModel::onDirectoryLoadedByGatherer(const QString& directory)
     emit directoryLoaded(directory);
 }
 
+void
+FileSystemModel::onDirectoryInfoUpdatedByGatherer(const QString& directory)
+{
+    boost::shared_ptr<FileSystemItem> item = _imp->getItemFromPath(directory);
+    if (!item) {
+        return;
+    }
+    
+    ///The size and modification date of the children were fetched
+    QModelIndex idx = index(item.get(),0);
+    int count = item->childCount();
+    if ( idx.isValid() && (count > 0) ) {
+        emit dataChanged( index(0, Size, idx), index(count - 1, DateModified, idx) );
+    }
+}
+
 void
 FileSystemModel::onWatchedDirectoryChanged(const QString& directory)
 {
     boost::shared_ptr<FileSystemItem> item = _imp->getItemFromPath(directory);
     if (item) {
         if (directory == _imp->currentRootPath) {
-            cleanAndRefreshItem(item);
+            cleanAndRefreshItem(item,false);
         } else {
             ///This is a sub-directory
             ///Clear the parent of the corresponding item
@@ -1032,11 +1099,13 @@ FileSystemModel::onWatchedFileChanged(const QString& file)
     
     boost::shared_ptr<FileSystemItem> parent = _imp->getItemFromPath( info.absolutePath() );
     assert(parent);
-    cleanAndRefreshItem(parent);
+    ///Rewriting a file does not change the modification date of its directory, the index must not be used
+    cleanAndRefreshItem(parent,false);
 }
 
 void
-FileSystemModel::cleanAndRefreshItem(const boost::shared_ptr<FileSystemItem>& item)
+FileSystemModel::cleanAndRefreshItem(const boost::shared_ptr<FileSystemItem>& item,
+                                     bool useIndex)
 {
     QModelIndex idx = index(item.get(),0);
     if (idx.isValid()) {
@@ -1047,7 +1116,7 @@ FileSystemModel::cleanAndRefreshItem(const boost::shared_ptr<FileSystemItem>& it
             endRemoveRows();
         }
         
-        _imp->populateItem(item);
+        _imp->populateItem(item,useIndex);
     }
 }
 
@@ -1088,6 +1157,7 @@ struct FileGathererThreadPrivate
     QWaitCondition startCountCond;
     
     boost::shared_ptr<FileSystemItem> requestedItem,itemBeingFetched;
+    bool requestedUseIndex; //< whether requestedItem may be read from its index
     QMutex requestedDirMutex;
     
     FileGathererThreadPrivate(FileSystemModel* model)
@@ -1105,6 +1175,7 @@ struct FileGathererThreadPrivate
     , startCountCond()
     , requestedItem()
     , itemBeingFetched()
+    , requestedUseIndex(true)
     , requestedDirMutex()
     {
         
@@ -1223,13 +1294,15 @@ FileGathererThread::run()
                 return;
             }
             
+            bool useIndex;
             {
                 QMutexLocker k(&_imp->requestedDirMutex);
                 _imp->itemBeingFetched = _imp->requestedItem;
+                useIndex = _imp->requestedUseIndex;
             }
             
             ///Doesn't need to be protected under requestedDirMutex since it is written to only by this thread
-            gatheringKernel(_imp->itemBeingFetched);
+            gatheringKernel(_imp->itemBeingFetched,useIndex);
             _imp->itemBeingFetched.reset();
             
         } //WorkingSetter
@@ -1248,7 +1321,265 @@ FileGathererThread::run()
 }
 
 
-typedef std::list< std::pair< boost::shared_ptr<SequenceParsing::SequenceFromFiles> ,QFileInfo > > FileSequences;
+namespace {
+///What the gatherer needs to know about an entry of a directory
+struct DirectoryEntry
+{
+    std::string fileName;
+    bool isDir;
+    qint64 size;
+    qint64 lastModified; //< in milliseconds since epoch, 0 until the information of the entry is fetched
+
+    DirectoryEntry()
+    : fileName()
+    , isDir(false)
+    , size(0)
+    , lastModified(0)
+    {
+    }
+
+    bool hasSameInfo(const DirectoryEntry & other) const
+    {
+        return isDir == other.isDir && size == other.size && lastModified == other.lastModified;
+    }
+
+    template<class Archive>
+    void serialize(Archive & ar,
+                   const unsigned int /*version*/)
+    {
+        ar & fileName;
+        ar & isDir;
+        ar & size;
+        ar & lastModified;
+    }
+};
+
+///The entries of a directory sorted by name as listed last time, stored on disk so that large directories
+///(e.g: the frames of long sequences) are shown right away as long as their modification date did not change.
+///The size and modification date of the files change without the directory being modified: the ones of the index
+///are shown first, then fetched again in the background. The index is only used when sorting by name.
+struct DirectoryIndex
+{
+    int indexVersion;
+    std::string path;
+    qint64 dirLastModified; //< in milliseconds since epoch
+    int filters;
+    std::vector<DirectoryEntry> entries; //< sorted by name
+
+    DirectoryIndex()
+    : indexVersion(NATRON_DIRECTORY_INDEX_VERSION)
+    , path()
+    , dirLastModified(0)
+    , filters(0)
+    , entries()
+    {
+    }
+
+    template<class Archive>
+    void serialize(Archive & ar,
+                   const unsigned int /*version*/)
+    {
+        ar & indexVersion;
+        ar & path;
+        ar & dirLastModified;
+        ar & filters;
+        ar & entries;
+    }
+};
+
+static QString
+getDirectoriesIndexPath()
+{
+    return Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache) + QDir::separator() + "DirectoriesIndex";
+}
+
+static QString
+getDirectoryIndexFilePath(const QString & dirPath)
+{
+    Hash64 hash;
+
+    Hash64_appendQString(&hash, dirPath);
+    hash.computeHash();
+
+    return getDirectoriesIndexPath() + QDir::separator() + QString::number(hash.value(), 16) + ".idx";
+}
+
+///Removes the least recently written indexes so that at most NATRON_DIRECTORY_INDEX_MAX_FILES are kept
+static void
+pruneDirectoriesIndex()
+{
+    QDir indexDir( getDirectoriesIndexPath() );
+    QStringList indexes = indexDir.entryList(QStringList("*.idx"), QDir::Files, QDir::Time);
+
+    for (int i = NATRON_DIRECTORY_INDEX_MAX_FILES; i < indexes.size(); ++i) {
+        indexDir.remove(indexes[i]);
+    }
+}
+
+///Returns true if the index of the directory was read and still lists its content
+static bool
+readDirectoryIndex(const QString & dirPath,
+                   qint64 dirLastModified,
+                   QDir::Filters filters,
+                   std::vector<DirectoryEntry>* entries)
+{
+    std::ifstream ifile(getDirectoryIndexFilePath(dirPath).toStdString().c_str(), std::ios::in | std::ios::binary);
+
+    if ( !ifile.is_open() ) {
+        return false;
+    }
+    DirectoryIndex index;
+    try {
+        boost::archive::binary_iarchive iArchive(ifile);
+        iArchive >> index;
+    } catch (...) {
+        ///Written by another version of boost or corrupted
+        return false;
+    }
+
+    ///The path is checked too in case of a hash collision
+    if ( (index.indexVersion != NATRON_DIRECTORY_INDEX_VERSION) || (index.path != dirPath.toStdString()) ||
+         (index.dirLastModified != dirLastModified) || (index.filters != (int)filters) ) {
+        return false;
+    }
+    entries->swap(index.entries);
+
+    return true;
+}
+
+static void
+writeDirectoryIndex(const DirectoryIndex & index)
+{
+    QString filePath = getDirectoryIndexFilePath( QString( index.path.c_str() ) );
+
+    QDir().mkpath( QFileInfo(filePath).absolutePath() );
+
+    ///Written to a temporary file first so that another file dialog never reads a partially written index
+    QString tmpFilePath = filePath + '.' + QString::number( (quintptr)QThread::currentThreadId() );
+    {
+        std::ofstream ofile(tmpFilePath.toStdString().c_str(), std::ios::out | std::ios::binary);
+        if ( !ofile.is_open() ) {
+            return;
+        }
+        try {
+            boost::archive::binary_oarchive oArchive(ofile);
+            oArchive << index;
+        } catch (...) {
+            ofile.close();
+            QFile::remove(tmpFilePath);
+
+            return;
+        }
+    }
+    QFile::remove(filePath);
+    if ( !QFile::rename(tmpFilePath, filePath) ) {
+        QFile::remove(tmpFilePath);
+    }
+    pruneDirectoriesIndex();
+}
+
+///Lists the entries of dir sorted by name and whether they are directories, without fetching the information
+///of each of them which is what takes time on network drives
+static void
+listDirectoryNames(const QDir & dir,
+                   QDir::Filters filters,
+                   std::vector<DirectoryEntry>* entries)
+{
+    if ( !(filters & QDir::TypeMask) ) {
+        filters |= QDir::AllEntries;
+    }
+    QStringList dirNames,fileNames;
+    if ( filters & (QDir::Dirs | QDir::AllDirs) ) {
+        dirNames = dir.entryList(filters & ~QDir::Files, QDir::Name);
+    }
+    if (filters & QDir::Files) {
+        fileNames = dir.entryList(filters & ~(QDir::Dirs | QDir::AllDirs), QDir::Name);
+    }
+
+    ///Both lists are sorted by name, merge them the way QDir sorts by name
+    entries->resize( dirNames.size() + fileNames.size() );
+    int d = 0;
+    int f = 0;
+    for (std::size_t i = 0; i < entries->size(); ++i) {
+        DirectoryEntry & entry = (*entries)[i];
+        entry.isDir = f == fileNames.size() || ( d < dirNames.size() && dirNames[d].compare(fileNames[f]) < 0 );
+        entry.fileName = entry.isDir ? dirNames[d++].toStdString() : fileNames[f++].toStdString();
+    }
+}
+
+///Called concurrently on the entries of a directory, this is where most of the time goes on network drives
+static void
+statDirectoryEntry(DirectoryEntry & entry,
+                   const QString & dirPath)
+{
+    QFileInfo info( dirPath + '/' + QString( entry.fileName.c_str() ) );
+
+    entry.isDir = info.isDir();
+    entry.size = info.size();
+    entry.lastModified = info.lastModified().toMSecsSinceEpoch();
+}
+
+///Sets the size and modification date of the children from the entries they were made of: a sequence is as large
+///as all its files together and as recent as its most recent file
+static void
+updateChildrenInfo(const std::vector<DirectoryEntry> & entries,
+                   const std::vector< std::vector<int> > & childrenEntries,
+                   const std::vector< boost::shared_ptr<FileSystemItem> > & children,
+                   const std::set<int> & childrenToUpdate)
+{
+    for (std::set<int>::const_iterator it = childrenToUpdate.begin(); it != childrenToUpdate.end(); ++it) {
+        if (!children[*it]) {
+            continue;
+        }
+        const std::vector<int> & childEntries = childrenEntries[*it];
+        qint64 size = 0;
+        qint64 lastModified = 0;
+        for (std::size_t i = 0; i < childEntries.size(); ++i) {
+            const DirectoryEntry & entry = entries[childEntries[i]];
+            size += entry.size;
+            lastModified = std::max(lastModified, entry.lastModified);
+        }
+        children[*it]->setInfo( size, lastModified == 0 ? QDateTime() : QDateTime::fromMSecsSinceEpoch(lastModified) );
+    }
+}
+}
+
+std::string
+FileSystemModel::getSequenceSkeleton(const std::string & fileName)
+{
+    std::string ret;
+
+    ret.reserve( fileName.size() );
+    for (std::size_t i = 0; i < fileName.size(); ++i) {
+        if ( (fileName[i] >= '0') && (fileName[i] <= '9') ) {
+            if ( (i == 0) || (fileName[i - 1] < '0') || (fileName[i - 1] > '9') ) {
+                ret.push_back('#');
+            }
+        } else {
+            ret.push_back(fileName[i]);
+        }
+    }
+
+    return ret;
+}
+
+void
+FileSystemModel::clearDirectoriesIndex()
+{
+    QDir indexDir( getDirectoriesIndexPath() );
+    QStringList indexes = indexDir.entryList(QDir::Files | QDir::Hidden);
+
+    for (int i = 0; i < indexes.size(); ++i) {
+        indexDir.remove(indexes[i]);
+    }
+}
+
+///A child of the directory: a sequence, or a directory or single file in which case the sequence is NULL, and the
+///index in the directory entries of its first entry
+typedef std::vector< std::pair< boost::shared_ptr<SequenceParsing::SequenceFromFiles> ,int > > FileSequences;
+
+///The indexes in the FileSequences of the sequences whose files have the same skeleton, @see getSequenceSkeleton
+typedef boost::unordered_map< std::string, std::vector<int> > SequencesBySkeleton;
 
 #define KERNEL_INCR() \
     switch (viewOrder) \
@@ -1262,45 +1593,79 @@ typedef std::list< std::pair< boost::shared_ptr<SequenceParsing::SequenceFromFil
     }
 
 void
-FileGathererThread::gatheringKernel(const boost::shared_ptr<FileSystemItem>& item)
+FileGathererThread::gatheringKernel(const boost::shared_ptr<FileSystemItem>& item,
+                                    bool useIndex)
 {
 
     QDir dir( item->absoluteFilePath() );
     
     Qt::SortOrder viewOrder = _imp->model->sortIndicatorOrder();
     FileSystemModel::Sections sortSection = (FileSystemModel::Sections)_imp->model->sortIndicatorSection();
+    QDir::SortFlags sorting = dir.sorting();
     switch (sortSection) {
         case FileSystemModel::Name:
-            dir.setSorting(QDir::Name);
+            sorting = QDir::Name;
             break;
         case FileSystemModel::Size:
-            dir.setSorting(QDir::Size);
+            sorting = QDir::Size;
             break;
         case FileSystemModel::Type:
-            dir.setSorting(QDir::Type);
+            sorting = QDir::Type;
             break;
         case FileSystemModel::DateModified:
-            dir.setSorting(QDir::Time);
+            sorting = QDir::Time;
             break;
         default:
             break;
     }
     
-    ///All entries in the directory
-    QFileInfoList all = dir.entryInfoList(_imp->model->filter());
+    QDir::Filters filters = _imp->model->filter();
+    QString dirPath = dir.absolutePath();
+    QDateTime dirLastModified = QFileInfo(dirPath).lastModified();
+    
+    ///All entries in the directory. When sorting by name, the rows are made from the names only and shown right away:
+    ///the size and modification date of the entries are fetched afterwards. Sorting by size or date needs them first.
+    std::vector<DirectoryEntry> all;
+    bool indexed = false;
+    bool hasInfo = false;
+    if (sorting == QDir::Name) {
+        ///Sorting by size or date depends on the entries, which may change without the directory being modified
+        indexed = useIndex && readDirectoryIndex(dirPath, dirLastModified.toMSecsSinceEpoch(), filters, &all);
+        if (!indexed) {
+            listDirectoryNames(dir, filters, &all);
+        }
+    } else {
+        QStringList names = dir.entryList(filters, sorting);
+        all.resize( names.size() );
+        for (int i = 0; i < names.size(); ++i) {
+            all[i].fileName = names[i].toStdString();
+        }
+        for (std::size_t i = 0; i < all.size(); i += NATRON_DIRECTORY_STAT_BATCH) {
+            if ( _imp->checkForAbort() ) {
+                return;
+            }
+            std::vector<DirectoryEntry>::iterator batchEnd = all.begin() + std::min(i + NATRON_DIRECTORY_STAT_BATCH, all.size());
+            QtConcurrent::blockingMap( all.begin() + i, batchEnd, boost::bind(&statDirectoryEntry, _1, dirPath) );
+        }
+        hasInfo = true;
+    }
     
     ///List of all possible file sequences in the directory or directories
     FileSequences sequences;
+    SequencesBySkeleton sequencesBySkeleton;
+    
+    ///The index in sequences of the child each entry belongs to, -1 if it was filtered out
+    std::vector<int> entriesChild(all.size(), -1);
     
     int start;
     int end;
     switch (viewOrder) {
         case Qt::AscendingOrder:
             start = 0;
-            end = all.size();
+            end = (int)all.size();
             break;
         case Qt::DescendingOrder:
-            start = all.size() - 1;
+            start = (int)all.size() - 1;
             end = -1;
             break;
     }
@@ -1313,13 +1678,14 @@ FileGathererThread::gatheringKernel(const boost::shared_ptr<FileSystemItem>& ite
             return;
         }
         
-        if ( all[i].isDir() ) {
+        if (all[i].isDir) {
             ///This is a directory
-            sequences.push_back(std::make_pair(boost::shared_ptr<SequenceParsing::SequenceFromFiles>(), all[i]));
+            entriesChild[i] = (int)sequences.size();
+            sequences.push_back(std::make_pair(boost::shared_ptr<SequenceParsing::SequenceFromFiles>(), i));
         } else {
             
 
-            QString filename = all[i].fileName();
+            QString filename( all[i].fileName.c_str() );
 
             /// If the item does not match the filter regexp set by the user, discard it
             if ( !_imp->model->isAcceptedByRegexps(filename) ) {
@@ -1329,7 +1695,8 @@ FileGathererThread::gatheringKernel(const boost::shared_ptr<FileSystemItem>& ite
             
             /// If file sequence fetching is disabled, accept it
             if ( !_imp->model->isSequenceModeEnabled() ) {
-                sequences.push_back(std::make_pair(boost::shared_ptr<SequenceParsing::SequenceFromFiles>(), all[i]));
+                entriesChild[i] = (int)sequences.size();
+                sequences.push_back(std::make_pair(boost::shared_ptr<SequenceParsing::SequenceFromFiles>(), i));
                 KERNEL_INCR();
                 continue;
             }
@@ -1343,11 +1710,15 @@ FileGathererThread::gatheringKernel(const boost::shared_ptr<FileSystemItem>& ite
             /// to create a new one
             SequenceParsing::FileNameContent fileContent(absoluteFilePath);
             
+            ///Only the sequences with the same skeleton may accept the file
+            std::vector<int>& candidates = sequencesBySkeleton[FileSystemModel::getSequenceSkeleton(all[i].fileName)];
+            
             ///Note that we use a reverse iterator because we have more chance to find a match in the last recently added entries
-            for (FileSequences::reverse_iterator it = sequences.rbegin(); it != sequences.rend(); ++it) {
+            for (std::vector<int>::reverse_iterator it = candidates.rbegin(); it != candidates.rend(); ++it) {
                 
-                if ( it->first && it->first->tryInsertFile(fileContent,false) ) {
+                if ( sequences[*it].first->tryInsertFile(fileContent,false) ) {
                     
+                    entriesChild[i] = *it;
                     foundMatchingSequence = true;
                     break;
                 }
@@ -1356,8 +1727,11 @@ FileGathererThread::gatheringKernel(const boost::shared_ptr<FileSystemItem>& ite
             
             if (!foundMatchingSequence) {
                 
-                boost::shared_ptr<SequenceParsing::SequenceFromFiles> newSequence( new SequenceParsing::SequenceFromFiles(fileContent,true) );
-                sequences.push_back(std::make_pair(newSequence, all[i]));
+                ///The size of the sequence is computed from the information of its files, not estimated
+                boost::shared_ptr<SequenceParsing::SequenceFromFiles> newSequence( new SequenceParsing::SequenceFromFiles(fileContent,false) );
+                entriesChild[i] = (int)sequences.size();
+                candidates.push_back( (int)sequences.size() );
+                sequences.push_back(std::make_pair(newSequence, i));
 
             }
             
@@ -1365,21 +1739,79 @@ FileGathererThread::gatheringKernel(const boost::shared_ptr<FileSystemItem>& ite
         KERNEL_INCR();
     }
     
+    std::vector< std::vector<int> > childrenEntries( sequences.size() );
+    for (std::size_t e = 0; e < all.size(); ++e) {
+        if (entriesChild[e] != -1) {
+            childrenEntries[entriesChild[e]].push_back( (int)e );
+        }
+    }
+    
     ///Now iterate through the sequences and create the children as necessary
-    for (FileSequences::iterator it = sequences.begin(); it != sequences.end(); ++it) {
-        item->addChild(it->first, it->second);
+    std::vector< boost::shared_ptr<FileSystemItem> > children( sequences.size() );
+    for (std::size_t c = 0; c < sequences.size(); ++c) {
+        const DirectoryEntry& entry = all[sequences[c].second];
+        children[c] = item->addChild( sequences[c].first, QString( entry.fileName.c_str() ), entry.isDir, entry.size, QDateTime() );
+    }
+    std::set<int> allChildren;
+    for (std::size_t c = 0; c < children.size(); ++c) {
+        allChildren.insert( (int)c );
+    }
+    if (hasInfo || indexed) {
+        updateChildrenInfo(all, childrenEntries, children, allChildren);
     }
     
     emit directoryLoaded( item->absoluteFilePath() );
+    
+    if (hasInfo) {
+        return;
+    }
+    
+    ///The rows are shown: fetch the information of the entries concurrently in batches, between which the gathering
+    ///may be aborted, and update the rows after each batch
+    bool changed = !indexed;
+    for (std::size_t b = 0; b < all.size(); b += NATRON_DIRECTORY_STAT_BATCH) {
+        if ( _imp->checkForAbort() ) {
+            return;
+        }
+        std::size_t batchEnd = std::min(b + NATRON_DIRECTORY_STAT_BATCH, all.size());
+        std::vector<DirectoryEntry> previous( all.begin() + b, all.begin() + batchEnd );
+        QtConcurrent::blockingMap( all.begin() + b, all.begin() + batchEnd, boost::bind(&statDirectoryEntry, _1, dirPath) );
+        
+        std::set<int> childrenToUpdate;
+        for (std::size_t e = b; e < batchEnd; ++e) {
+            if ( !all[e].hasSameInfo(previous[e - b]) ) {
+                changed = true;
+                if (entriesChild[e] != -1) {
+                    childrenToUpdate.insert(entriesChild[e]);
+                }
+            }
+        }
+        if ( !childrenToUpdate.empty() ) {
+            updateChildrenInfo(all, childrenEntries, children, childrenToUpdate);
+            emit directoryInfoUpdated( item->absoluteFilePath() );
+        }
+    }
+    
+    if ( changed && ( all.size() >= NATRON_DIRECTORY_INDEX_MIN_ENTRIES ) &&
+         ( dirLastModified.secsTo( QDateTime::currentDateTime() ) >= NATRON_DIRECTORY_INDEX_MIN_AGE ) ) {
+        DirectoryIndex index;
+        index.path = dirPath.toStdString();
+        index.dirLastModified = dirLastModified.toMSecsSinceEpoch();
+        index.filters = (int)filters;
+        index.entries = all;
+        writeDirectoryIndex(index);
+    }
 }
 
 void
-FileGathererThread::fetchDirectory(const boost::shared_ptr<FileSystemItem>& item)
+FileGathererThread::fetchDirectory(const boost::shared_ptr<FileSystemItem>& item,
+                                   bool useIndex)
 {
     abortGathering();
     {
         QMutexLocker l(&_imp->requestedDirMutex);
         _imp->requestedItem = item;
+        _imp->requestedUseIndex = useIndex;
     }
     
     if ( isRunning() ) {
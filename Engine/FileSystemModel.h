@@ -10,6 +10,7 @@
 
 #ifndef FILESYSTEMMODEL_H
 #define FILESYSTEMMODEL_H
+#include <string>
 #ifndef Q_MOC_RUN
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -70,17 +71,29 @@ public:
     
     const QString& fileExtension() const;
     
-    const QDateTime& getLastModified() const;
+    QDateTime getLastModified() const;
     
     quint64 getSize() const;
     
+    /**
+     * @brief Sets the size and the modification date, which may be fetched after the item was added. MT-safe
+     **/
+    void setInfo(quint64 size,const QDateTime& lastModified);
+    
     /**
      * @brief Add a new child, MT-safe
      **/
     void addChild(const boost::shared_ptr<FileSystemItem>& child);
     
-    void addChild(const boost::shared_ptr<SequenceParsing::SequenceFromFiles>& sequence,
-                  const QFileInfo& info);
+    /**
+     * @brief Add a new child for the given sequence, or for the given file or directory if sequence is NULL,
+     * unless a child with the same name exists already. Returns the child. MT-safe
+     **/
+    boost::shared_ptr<FileSystemItem> addChild(const boost::shared_ptr<SequenceParsing::SequenceFromFiles>& sequence,
+                  const QString& fileName,
+                  bool isDir,
+                  quint64 size,
+                  const QDateTime& lastModified);
     
     /**
      * @brief Remove all children, MT-safe
@@ -117,19 +130,29 @@ public:
     
     void quitGatherer();
     
-    void fetchDirectory(const boost::shared_ptr<FileSystemItem>& item);
+    /**
+     * @brief Gathers the content of the directory of item in this thread, directoryLoaded is emitted as soon as the
+     * children of item are created. When sorting by name they are created from the names of the entries only, their size
+     * and modification date are fetched afterwards and directoryInfoUpdated is emitted each time some of them changed.
+     * @param useIndex If true and the directory did not change since it was last listed, its content is read from
+     * the index on disk instead of being listed again from the file-system. Pass false when something in the
+     * directory changed that does not change its modification date, e.g: a file was rewritten.
+     **/
+    void fetchDirectory(const boost::shared_ptr<FileSystemItem>& item,bool useIndex = true);
     
     bool isWorking() const;
 signals:
     
     void directoryLoaded(QString);
     
+    void directoryInfoUpdated(QString);
+    
 
 private:
     
     virtual void run() OVERRIDE FINAL;
     
-    void gatheringKernel(const boost::shared_ptr<FileSystemItem>& item);
+    void gatheringKernel(const boost::shared_ptr<FileSystemItem>& item,bool useIndex);
     
     boost::scoped_ptr<FileGathererThreadPrivate> _imp;
     
@@ -189,6 +212,17 @@ public:
     virtual ~FileSystemModel();
 
 	static bool isDriveName(const QString& name);
+
+    /**
+     * @brief Removes the indexes of the large directories listed by the file dialogs from the cache directory.
+     **/
+    static void clearDirectoriesIndex();
+    
+    /**
+     * @brief Returns the file name with each group of digits replaced by a '#'. All the files of a sequence share it,
+     * so that a file need only be tried against the sequences with the same skeleton.
+     **/
+    static std::string getSequenceSkeleton(const std::string & fileName) WARN_UNUSED_RETURN;
     
     virtual QVariant headerData(int section, Qt::Orientation orientation,int role) const OVERRIDE FINAL WARN_UNUSED_RETURN;
     
@@ -282,6 +316,8 @@ public slots:
     
     void onDirectoryLoadedByGatherer(const QString& directory);
     
+    void onDirectoryInfoUpdatedByGatherer(const QString& directory);
+    
     void onWatchedDirectoryChanged(const QString& directory);
     
     void onWatchedFileChanged(const QString& file);
@@ -294,7 +330,7 @@ signals:
     
 private:
     
-    void cleanAndRefreshItem(const boost::shared_ptr<FileSystemItem>& item);
+    void cleanAndRefreshItem(const boost::shared_ptr<FileSystemItem>& item,bool useIndex = true);
     
     void resetCompletly();
     
@@ -9,6 +9,10 @@
 #include <algorithm>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QtConcurrentMap>
+#ifndef Q_MOC_RUN
+#include <boost/bind.hpp>
+#endif
 
 #include "Engine/Image.h"
 
@@ -194,71 +198,145 @@ HistogramCPU::getMostRecentlyProducedHistogram(std::vector<float>* histogram1,
     return true;
 }
 
-///putting these in an anonymous namespace will yield this error on gcc 4.2:
-///"function has not external linkage"
-struct pix_red
+///The histograms are computed in upscale times more bins, smoothed and then downsampled
+#define NATRON_HISTOGRAM_UPSCALE 5
+
+///Below this many rows per thread, it is not worth splitting the image among threads
+#define NATRON_HISTOGRAM_MIN_ROWS_PER_TASK 16
+
+/// keep the modes in sync with Histogram::DisplayModeEnum
+static inline float
+getPixelValue(int mode,
+              const float *pix)
 {
-    static float val(float *pix)
-    {
+    switch (mode) {
+    case 1:     //< A
+        return pix[3];
+    case 2:     //< Y
+        return 0.299 * pix[0] + 0.587 * pix[1] + 0.114 * pix[2];
+    case 3:     //< R
         return pix[0];
+    case 4:     //< G
+        return pix[1];
+    case 5:     //< B
+    default:
+        return pix[2];
     }
-};
+}
 
-struct pix_green
+namespace {
+///The integer bin counts of up to 3 histograms over a band of rows of the request
+struct HistogramBins
 {
-    static float val(float *pix)
-    {
-        return pix[1];
-    }
+    std::vector<unsigned int> bins[3];
 };
 
-struct pix_blue
+///The modes of the histograms to compute in a single pass over the image, see getPixelValue
+struct HistogramPass
 {
-    static float val(float *pix)
-    {
-        return pix[2];
-    }
+    int nHistograms;
+    int modes[3];
+    int size; //< number of bins of each histogram, upscaled
 };
 
-struct pix_alpha
+static HistogramPass
+getHistogramPass(const HistogramRequest & request)
 {
-    static float val(float *pix)
-    {
-        return pix[3];
+    HistogramPass pass;
+
+    pass.size = request.binsCount * NATRON_HISTOGRAM_UPSCALE;
+    if (request.mode == 0) {
+        ///RGB: R, G and B are binned together
+        pass.nHistograms = 3;
+        pass.modes[0] = 3;
+        pass.modes[1] = 4;
+        pass.modes[2] = 5;
+    } else {
+        pass.nHistograms = 1;
+        pass.modes[0] = pass.modes[1] = pass.modes[2] = request.mode;
     }
-};
 
-struct pix_lum
+    return pass;
+}
+
+static HistogramBins
+binRows(const HistogramRequest & request,
+        const HistogramPass & pass,
+        int y1,
+        int y2)
 {
-    static float val(float *pix)
-    {
-        return 0.299 * pix[0] + 0.587 * pix[1] + 0.114 * pix[2];
+    HistogramBins ret;
+
+    for (int i = 0; i < pass.nHistograms; ++i) {
+        ret.bins[i].resize(pass.size, 0);
     }
-};
 
+    const double scale = pass.size / (request.vmax - request.vmin);
+    const int nComps = (int)request.image->getComponentsCount();
+    const int width = request.rect.width();
+    for (int y = y1; y < y2; ++y) {
+        const float *pix = (const float*)request.image->pixelAt(request.rect.left(), y);
+        for (int x = 0; x < width; ++x, pix += nComps) {
+            for (int i = 0; i < pass.nHistograms; ++i) {
+                float v = getPixelValue(pass.modes[i], pix);
+                if ( (request.vmin <= v) && (v < request.vmax) ) {
+                    ///the min() guards against rounding up to the upper bound
+                    int index = std::min( (int)( (v - request.vmin) * scale ), pass.size - 1 );
+                    assert(0 <= index);
+                    ++ret.bins[i][index];
+                }
+            }
+        }
+    }
 
-template <float pix_func(float*)>
-void
-computeHisto(const HistogramRequest & request,
-             int upscale,
-             std::vector<float> *histo)
+    return ret;
+}
+
+static HistogramBins
+binRowsFunctor(const HistogramRequest & request,
+               const HistogramPass & pass,
+               const std::pair<int,int> & rows)
 {
-    assert(histo);
-    histo->resize(request.binsCount * upscale);
-    std::fill(histo->begin(), histo->end(), 0.f);
-    double binSize = (request.vmax - request.vmin) / histo->size();
+    return binRows(request, pass, rows.first, rows.second);
+}
+}
 
+/**
+ * @brief Bins the pixels of the request for all the histograms of the mode in a single pass over the image.
+ * The rows are split among threads, each of which counts in its own integer histograms, merged at the end.
+ **/
+static void
+computeBins(const HistogramRequest & request,
+            const HistogramPass & pass,
+            HistogramBins* bins)
+{
     ///Images come from the viewer which is in float.
     assert(request.image->getBitDepth() == Natron::eImageBitDepthFloat);
 
-    for (int y = request.rect.bottom(); y < request.rect.top(); ++y) {
-        for (int x = request.rect.left(); x < request.rect.right(); ++x) {
-            float *pix = (float*)request.image->pixelAt(x, y);
-            float v = pix_func(pix);
-            if ( (request.vmin <= v) && (v < request.vmax) ) {
-                int index = (int)( (v - request.vmin) / binSize );
-                assert( 0 <= index && index < (int)histo->size() );
-                (*histo)[index] += 1.f;
+    int y1 = request.rect.bottom();
+    int y2 = request.rect.top();
+    int nTasks = std::max( 1, std::min(QThread::idealThreadCount(), (y2 - y1) / NATRON_HISTOGRAM_MIN_ROWS_PER_TASK) );
+    if (nTasks == 1) {
+        *bins = binRows(request, pass, y1, y2);
+
+        return;
+    }
+
+    std::vector<std::pair<int,int> > bands;
+    for (int i = 0; i < nTasks; ++i) {
+        bands.push_back( std::make_pair( y1 + (int)( (long long)(y2 - y1) * i / nTasks ),
+                                         y1 + (int)( (long long)(y2 - y1) * (i + 1) / nTasks ) ) );
+    }
+    QFuture<HistogramBins> ret = QtConcurrent::mapped( bands, boost::bind(&binRowsFunctor, boost::cref(request), boost::cref(pass), _1) );
+    ret.waitForFinished();
+
+    for (int i = 0; i < pass.nHistograms; ++i) {
+        bins->bins[i].assign(pass.size, 0);
+    }
+    for (QFuture<HistogramBins>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
+        for (int i = 0; i < pass.nHistograms; ++i) {
+            for (int b = 0; b < pass.size; ++b) {
+                bins->bins[i][b] += it->bins[i][b];
             }
         }
     }
@@ -400,62 +478,18 @@ iir_1d_filter(SrcIterator src,
     }
 } // iir_1d_filter
 
+/**
+ * @brief Smoothes the upscaled bin counts and downsamples them to request.binsCount bins in histo.
+ **/
 static void
-computeHistogramStatic(const HistogramRequest & request,
-                       boost::shared_ptr<FinishedHistogram> ret,
-                       int histogramIndex)
+smoothHistogram(const HistogramRequest & request,
+                const std::vector<unsigned int> & bins,
+                std::vector<float> *histo)
 {
-    const int upscale = 5;
-    std::vector<float> *histo = 0;
-
-    switch (histogramIndex) {
-    case 1:
-        histo = &ret->histogram1;
-        break;
-    case 2:
-        histo = &ret->histogram2;
-        break;
-    case 3:
-        histo = &ret->histogram3;
-        break;
-    default:
-        break;
-    }
-    assert(histo);
-
-    /// keep the mode parameter in sync with Histogram::DisplayModeEnum
-
-    int mode = request.mode;
-
-    ///if the mode is RGB, adjust the mode to either R,G or B depending on the histogram index
-    if (mode == 0) {
-        mode = histogramIndex + 2;
-    }
-
-    ret->pixelsCount = request.rect.area();
+    const int upscale = NATRON_HISTOGRAM_UPSCALE;
     // a histogram with upscale more bins
-    std::vector<float> histo_upscaled;
-    switch (mode) {
-    case 1:     //< A
-        computeHisto<&pix_alpha::val>(request, upscale, &histo_upscaled);
-        break;
-    case 2:     //<Y
-        computeHisto<&pix_lum::val>(request, upscale, &histo_upscaled);
-        break;
-    case 3:     //< R
-        computeHisto<&pix_red::val>(request, upscale, &histo_upscaled);
-        break;
-    case 4:     //< G
-        computeHisto<&pix_green::val>(request, upscale, &histo_upscaled);
-        break;
-    case 5:     //< B
-        computeHisto<&pix_blue::val>(request, upscale, &histo_upscaled);
-        break;
+    std::vector<float> histo_upscaled( bins.begin(), bins.end() );
 
-    default:
-        assert(false);
-        break;
-    }
     double sigma = upscale;
     if (request.smoothingKernelSize > 1) {
         sigma *= request.smoothingKernelSize;
@@ -480,7 +514,7 @@ computeHistogramStatic(const HistogramRequest & request,
             std::advance (it_in,upscale);
         }
     }
-} // computeHistogramStatic
+} // smoothHistogram
 
 void
 HistogramCPU::run()
@@ -518,22 +552,16 @@ HistogramCPU::run()
         ret->mipMapLevel = request.image->getMipMapLevel();
 
 
-        switch (request.mode) {
-        case 0:     //< RGB
-            computeHistogramStatic(request, ret, 1);
-            computeHistogramStatic(request, ret, 2);
-            computeHistogramStatic(request, ret, 3);
-            break;
-        case 1:
-        case 2:
-        case 3:
-        case 4:
-        case 5:
-            computeHistogramStatic(request, ret, 1);
-            break;
-        default:
-            assert(false);     //< unknown case.
-            break;
+        assert(request.mode >= 0 && request.mode <= 5);
+        ret->pixelsCount = request.rect.area();
+
+        HistogramPass pass = getHistogramPass(request);
+        HistogramBins bins;
+        computeBins(request, pass, &bins);
+
+        std::vector<float>* histograms[3] = { &ret->histogram1, &ret->histogram2, &ret->histogram3 };
+        for (int i = 0; i < pass.nHistograms; ++i) {
+            smoothHistogram(request, bins.bins[i], histograms[i]);
         }
 
 
@@ -17,6 +17,7 @@
 #endif
 #include "Engine/AppManager.h"
 #include "Engine/Lut.h"
+#include "Engine/RenderTrace.h"
 
 using namespace Natron;
 
@@ -469,6 +470,9 @@ Image::Image(const ImageKey & key,
              const std::string & path)
     : CacheEntryHelper<unsigned char, ImageKey,ImageParams>(key, params, cache,storage,path)
     , _useBitmap(true)
+    , _tilesMinMaxLock()
+    , _tilesMinMax()
+    , _tilesMinMaxAge(0)
 {
     _components = params->getComponents();
     _bitDepth = params->getBitDepth();
@@ -481,6 +485,9 @@ Image::Image(const ImageKey & key,
              const boost::shared_ptr<Natron::ImageParams>& params)
 : CacheEntryHelper<unsigned char, ImageKey,ImageParams>(key, params, NULL,Natron::eStorageModeRAM,std::string())
 , _useBitmap(false)
+, _tilesMinMaxLock()
+, _tilesMinMax()
+, _tilesMinMaxAge(0)
 {
     _components = params->getComponents();
     _bitDepth = params->getBitDepth();
@@ -503,6 +510,9 @@ Image::Image(ImageComponentsEnum components,
              bool useBitmap)
     : CacheEntryHelper<unsigned char,ImageKey,ImageParams>()
     , _useBitmap(useBitmap)
+    , _tilesMinMaxLock()
+    , _tilesMinMax()
+    , _tilesMinMaxAge(0)
 {
     setCacheEntry(makeKey(0,false,0,0),
                   boost::shared_ptr<ImageParams>( new ImageParams( 0,
@@ -537,6 +547,7 @@ Image::onMemoryAllocated(bool diskRestoration)
     if (diskRestoration) {
         _bitmap.setTo1();
     }
+    invalidateTilesMinMax(_bounds);
     
 #ifdef DEBUG
     if (!diskRestoration) {
@@ -676,6 +687,7 @@ Image::pasteFrom(const Natron::Image & src,
     case eImageBitDepthNone:
         break;
     }
+    invalidateTilesMinMax(srcRoi);
 }
 
 // code proofread and fixed by @devernay on 8/8/2014
@@ -739,6 +751,7 @@ Image::fill(const RectI & roi,
     case eImageBitDepthNone:
         break;
     }
+    invalidateTilesMinMax(roi);
 }
 
 unsigned char*
@@ -1150,6 +1163,9 @@ Image::downscaleMipMap(const RectI & roi,
     ///You should not call this function with a level equal to 0.
     assert(toLevel >  fromLevel);
 
+    RenderTraceSpan traceSpan( RenderTraceEvent::eSpanKindMipMap,
+                               roi.area() * getComponentsCount() * getSizeOfForBitDepth( getBitDepth() ) );
+
     assert(_bounds.x1 <= roi.x1 && roi.x2 <= _bounds.x2 &&
            _bounds.y1 <= roi.y1 && roi.y2 <= _bounds.y2);
     double par = getPixelAspectRatio();
@@ -1202,10 +1218,106 @@ Image::checkForNaNs(const RectI& roi)
             }
         }
     }
+    if (hasnan) {
+        invalidateTilesMinMax(roi);
+    }
 
     return hasnan;
 }
 
+bool
+Image::getTileMinMax(int key,
+                     int tileX,
+                     int tileY,
+                     float* vmin,
+                     float* vmax) const
+{
+    QMutexLocker l(&_tilesMinMaxLock);
+    std::map<int,std::vector<TileMinMax> >::const_iterator found = _tilesMinMax.find(key);
+
+    if ( found == _tilesMinMax.end() ) {
+        return false;
+    }
+    int nTilesX = ( _bounds.width() + NATRON_IMAGE_MINMAX_TILE_SIZE - 1 ) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    std::size_t index = tileY * nTilesX + tileX;
+    if ( (tileX < 0) || (tileY < 0) || (tileX >= nTilesX) || ( index >= found->second.size() ) ) {
+        return false;
+    }
+    const TileMinMax & tile = found->second[index];
+    if (!tile.valid) {
+        return false;
+    }
+    *vmin = tile.vmin;
+    *vmax = tile.vmax;
+
+    return true;
+}
+
+U64
+Image::getTilesMinMaxAge() const
+{
+    QMutexLocker l(&_tilesMinMaxLock);
+
+    return _tilesMinMaxAge;
+}
+
+void
+Image::setTileMinMax(int key,
+                     int tileX,
+                     int tileY,
+                     float vmin,
+                     float vmax,
+                     U64 age) const
+{
+    ///The pixels of the images without bitmap may change without the tiles being invalidated
+    if (!_useBitmap) {
+        return;
+    }
+    QMutexLocker l(&_tilesMinMaxLock);
+    if (age != _tilesMinMaxAge) {
+        return;
+    }
+    int nTilesX = ( _bounds.width() + NATRON_IMAGE_MINMAX_TILE_SIZE - 1 ) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    int nTilesY = ( _bounds.height() + NATRON_IMAGE_MINMAX_TILE_SIZE - 1 ) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    if ( (tileX < 0) || (tileY < 0) || (tileX >= nTilesX) || (tileY >= nTilesY) ) {
+        return;
+    }
+    std::vector<TileMinMax> & tiles = _tilesMinMax[key];
+    if (tiles.empty()) {
+        tiles.resize(nTilesX * nTilesY);
+    }
+    TileMinMax & tile = tiles[tileY * nTilesX + tileX];
+    tile.vmin = vmin;
+    tile.vmax = vmax;
+    tile.valid = true;
+}
+
+void
+Image::invalidateTilesMinMax(const RectI & roi)
+{
+    RectI rect;
+    if ( !roi.intersect(_bounds, &rect) ) {
+        return;
+    }
+    QMutexLocker l(&_tilesMinMaxLock);
+    ++_tilesMinMaxAge;
+    if ( _tilesMinMax.empty() ) {
+        return;
+    }
+    int nTilesX = ( _bounds.width() + NATRON_IMAGE_MINMAX_TILE_SIZE - 1 ) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    int tx1 = (rect.x1 - _bounds.x1) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    int tx2 = (rect.x2 - 1 - _bounds.x1) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    int ty1 = (rect.y1 - _bounds.y1) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    int ty2 = (rect.y2 - 1 - _bounds.y1) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    for (std::map<int,std::vector<TileMinMax> >::iterator it = _tilesMinMax.begin(); it != _tilesMinMax.end(); ++it) {
+        for (int ty = ty1; ty <= ty2; ++ty) {
+            for (int tx = tx1; tx <= tx2; ++tx) {
+                it->second[ty * nTilesX + tx].valid = false;
+            }
+        }
+    }
+}
+
 // code proofread and fixed by @devernay on 8/8/2014
 template <typename PIX, int maxValue>
 void
@@ -2210,6 +2322,9 @@ Image::convertToFormat(const RectI & renderWindow,
 {
     assert( getBounds() == dstImg->getBounds() );
 
+    RenderTraceSpan traceSpan( RenderTraceEvent::eSpanKindConversion,
+                               renderWindow.area() * getComponentsCount() * getSizeOfForBitDepth( getBitDepth() ) );
+
     if ( dstImg->getComponents() == getComponents() ) {
         switch ( dstImg->getBitDepth() ) {
         case eImageBitDepthByte: {
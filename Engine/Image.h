@@ -14,6 +14,7 @@
 
 #include <list>
 #include <map>
+#include <vector>
 
 #include "Global/GlobalDefines.h"
 
@@ -21,6 +22,7 @@ CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QHash>
 CLANG_DIAG_ON(deprecated)
 #include <QtCore/QReadWriteLock>
+#include <QtCore/QMutex>
 
 #include "Engine/ImageKey.h"
 #include "Engine/ImageParams.h"
@@ -28,6 +30,8 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/Rect.h"
 #include "Engine/OutputSchedulerThread.h"
 
+///Size in pixels of the tiles for which the images cache the minimum and maximum of their pixels
+#define NATRON_IMAGE_MINMAX_TILE_SIZE 64
 
 namespace Natron {
 
@@ -322,9 +326,12 @@ namespace Natron {
             if (!_useBitmap) {
                 return;
             }
-            QWriteLocker locker(&_lock);
+            {
+                QWriteLocker locker(&_lock);
 
-            _bitmap.markForRendered(roi);
+                _bitmap.markForRendered(roi);
+            }
+            invalidateTilesMinMax(roi);
         }
         
 #if NATRON_ENABLE_TRIMAP
@@ -345,9 +352,12 @@ namespace Natron {
             if (!_useBitmap) {
                 return;
             }
-            QWriteLocker locker(&_lock);
-            
-            _bitmap.clear(roi);
+            {
+                QWriteLocker locker(&_lock);
+
+                _bitmap.clear(roi);
+            }
+            invalidateTilesMinMax(roi);
         }
         
         /**
@@ -462,9 +472,33 @@ namespace Natron {
         void copyBitmapRowPortion(int x1, int x2,int y, const Image& other);
 
         void copyBitmapPortion(const RectI& roi, const Image& other);
-        
+
+        /**
+         * @brief The images using a bitmap cache the minimum and maximum of their pixels for each tile of
+         * NATRON_IMAGE_MINMAX_TILE_SIZE pixels (the tiles start at the bottom-left corner of the bounds),
+         * so that e.g the auto-contrast of the viewer does not scan the pixels of a cached image again.
+         * What was measured is identified by key (e.g the channels displayed by the viewer). The tiles are
+         * invalidated when they are marked rendered, cleared, filled or pasted to.
+         * Returns false if the tile was not measured since it was last invalidated.
+         **/
+        bool getTileMinMax(int key,int tileX,int tileY,float* vmin,float* vmax) const WARN_UNUSED_RETURN;
+
+        /**
+         * @brief Returns a number that changes whenever tiles are invalidated, to be passed to setTileMinMax().
+         **/
+        U64 getTilesMinMaxAge() const WARN_UNUSED_RETURN;
+
+        /**
+         * @brief Stores the minimum and maximum measured for a tile. It is discarded if tiles were invalidated
+         * since age was returned by getTilesMinMaxAge(), as the pixels may have changed while they were measured.
+         **/
+        void setTileMinMax(int key,int tileX,int tileY,float vmin,float vmax,U64 age) const;
+
     private:
 
+        void invalidateTilesMinMax(const RectI & roi);
+
+
         
         /**
      * @brief Given the output buffer,the region of interest and the mip map level, this
@@ -517,6 +551,23 @@ namespace Natron {
         RectI _bounds;
         double _par;
         bool _useBitmap;
+
+        struct TileMinMax
+        {
+            float vmin,vmax;
+            bool valid;
+
+            TileMinMax()
+            : vmin(0.)
+            , vmax(0.)
+            , valid(false)
+            {
+            }
+        };
+
+        mutable QMutex _tilesMinMaxLock; //< protects the 2 fields below
+        mutable std::map<int,std::vector<TileMinMax> > _tilesMinMax; //< the tiles of each key, row by row
+        U64 _tilesMinMaxAge;
     };
 
     template <typename SRCPIX,typename DSTPIX>
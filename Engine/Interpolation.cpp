@@ -379,6 +379,43 @@ Natron::interpolate(double tcur,
     return ret;
 }
 
+void
+Natron::cubicCoefficients(double *tcur,
+                          const double vcur,                     //start control point
+                          const double vcurDerivRight,        //being the derivative dv/dt at tcur
+                          const double vnextDerivLeft,        //being the derivative dv/dt at tnext
+                          double *tnext,
+                          const double vnext,                      //end control point
+                          Natron::KeyframeTypeEnum interp,
+                          Natron::KeyframeTypeEnum interpNext,
+                          double c[4])
+{
+    double P0 = vcur;
+    double P3 = vnext;
+    // Hermite coefficients P0' and P3' are the derivatives with respect to x \in [0,1]
+    double P0pr = vcurDerivRight * (*tnext - *tcur); // normalize for x \in [0,1]
+    double P3pl = vnextDerivLeft * (*tnext - *tcur); // normalize for x \in [0,1]
+
+    // after the last / before the first keyframe, derivatives are wrt currentTime (i.e. non-normalized)
+    if (interp == eKeyframeTypeNone) {
+        // virtual previous frame at t-1
+        P0 = P3 - P3pl;
+        P0pr = P3pl;
+        *tcur = *tnext - 1.;
+    } else if (interp == eKeyframeTypeConstant) {
+        P0pr = 0.;
+        P3pl = 0.;
+        P3 = P0;
+    }
+    if (interpNext == eKeyframeTypeNone) {
+        // virtual next frame at t+1
+        P3pl = P0pr;
+        P3 = P0 + P0pr;
+        *tnext = *tcur + 1;
+    }
+    hermiteToCubicCoeffs(P0, P0pr, P3pl, P3, &c[0], &c[1], &c[2], &c[3]);
+}
+
 /// derive at currentTime. The derivative is with respect to currentTime
 double
 Natron::derive(double tcur,
@@ -618,48 +655,18 @@ statusUpdate(FuncTypeEnum status,
     return status;
 }
 
-// integrate from time1 to time2 with clamping of the function values in [vmin,vmax]
+// integrate the cubic from t1 to t2 with clamping of the function values in [vmin,vmax]
 double
-Natron::integrate_clamp(double tcur,
-                        const double vcur,                     //start control point
-                        const double vcurDerivRight,        //being the derivative dv/dt at tcur
-                        const double vnextDerivLeft,        //being the derivative dv/dt at tnext
-                        double tnext,
-                        const double vnext,                      //end control point
-                        double time1,
-                        double time2,
-                        double vmin,
-                        double vmax,
-                        Natron::KeyframeTypeEnum interp,
-                        Natron::KeyframeTypeEnum interpNext)
+Natron::integrateCubic_clamp(const double c[4],
+                             double t1,
+                             double t2,
+                             double vmin,
+                             double vmax)
 {
-    double P0 = vcur;
-    double P3 = vnext;
-    // Hermite coefficients P0' and P3' are the derivatives with respect to x \in [0,1]
-    double P0pr = vcurDerivRight * (tnext - tcur); // normalize for x \in [0,1]
-    double P3pl = vnextDerivLeft * (tnext - tcur); // normalize for x \in [0,1]
-
-    // in the next expression, the correct test is t2 <= tnext (not <), in order to integrate from tcur to tnext
-    assert( ( (interp == eKeyframeTypeNone) || (tcur <= time1) ) && (time1 <= time2) && ( (time2 <= tnext) || (interpNext == eKeyframeTypeNone) ) );
-    // after the last / before the first keyframe, derivatives are wrt currentTime (i.e. non-normalized)
-    if (interp == eKeyframeTypeNone) {
-        // virtual previous frame at t-1
-        P0 = P3 - P3pl;
-        P0pr = P3pl;
-        tcur = tnext - 1.;
-    } else if (interp == eKeyframeTypeConstant) {
-        P0pr = 0.;
-        P3pl = 0.;
-        P3 = P0;
-    }
-    if (interpNext == eKeyframeTypeNone) {
-        // virtual next frame at t+1
-        P3pl = P0pr;
-        P3 = P0 + P0pr;
-        tnext = tcur + 1;
-    }
-    double c0, c1, c2, c3;
-    hermiteToCubicCoeffs(P0, P0pr, P3pl, P3, &c0, &c1, &c2, &c3);
+    const double c0 = c[0];
+    const double c1 = c[1];
+    const double c2 = c[2];
+    const double c3 = c[3];
 
     // solve cubic = vmax
     double tmax[3];
@@ -681,9 +688,6 @@ Natron::integrate_clamp(double tcur,
         sols.push_back( Sol( eSolTypeMin,tmin[i],omin[i],cubicDerive(c0, c1, c2, c3, tmin[i]) ) );
     }
 
-    const double t2 = (time2 - tcur) / (tnext - tcur);
-    const double t1 = (time1 - tcur) / (tnext - tcur);
-
     // special case: no solution
     if ( sols.empty() ) {
         // no solution.
@@ -698,7 +702,7 @@ Natron::integrate_clamp(double tcur,
             val = vmax;
         }
 
-        return val * (time2 - time1);
+        return val * (t2 - t1);
     }
 
     // sort the solutions wrt time
@@ -754,10 +758,69 @@ Natron::integrate_clamp(double tcur,
         break;
     }
 
+    return ret;
+} // integrateCubic_clamp
+
+// integrate the cubic from t1 to t2
+double
+Natron::integrateCubic(const double c[4],
+                       double t1,
+                       double t2)
+{
+    return cubicIntegrate(c[0], c[1], c[2], c[3], t2) - cubicIntegrate(c[0], c[1], c[2], c[3], t1);
+}
+
+// integrate from time1 to time2 with clamping of the function values in [vmin,vmax]
+double
+Natron::integrate_clamp(double tcur,
+                        const double vcur,                     //start control point
+                        const double vcurDerivRight,        //being the derivative dv/dt at tcur
+                        const double vnextDerivLeft,        //being the derivative dv/dt at tnext
+                        double tnext,
+                        const double vnext,                      //end control point
+                        double time1,
+                        double time2,
+                        double vmin,
+                        double vmax,
+                        Natron::KeyframeTypeEnum interp,
+                        Natron::KeyframeTypeEnum interpNext)
+{
+    double P0 = vcur;
+    double P3 = vnext;
+    // Hermite coefficients P0' and P3' are the derivatives with respect to x \in [0,1]
+    double P0pr = vcurDerivRight * (tnext - tcur); // normalize for x \in [0,1]
+    double P3pl = vnextDerivLeft * (tnext - tcur); // normalize for x \in [0,1]
+
+    // in the next expression, the correct test is t2 <= tnext (not <), in order to integrate from tcur to tnext
+    assert( ( (interp == eKeyframeTypeNone) || (tcur <= time1) ) && (time1 <= time2) && ( (time2 <= tnext) || (interpNext == eKeyframeTypeNone) ) );
+    // after the last / before the first keyframe, derivatives are wrt currentTime (i.e. non-normalized)
+    if (interp == eKeyframeTypeNone) {
+        // virtual previous frame at t-1
+        P0 = P3 - P3pl;
+        P0pr = P3pl;
+        tcur = tnext - 1.;
+    } else if (interp == eKeyframeTypeConstant) {
+        P0pr = 0.;
+        P3pl = 0.;
+        P3 = P0;
+    }
+    if (interpNext == eKeyframeTypeNone) {
+        // virtual next frame at t+1
+        P3pl = P0pr;
+        P3 = P0 + P0pr;
+        tnext = tcur + 1;
+    }
+    double c[4];
+    hermiteToCubicCoeffs(P0, P0pr, P3pl, P3, &c[0], &c[1], &c[2], &c[3]);
+
+    const double t2 = (time2 - tcur) / (tnext - tcur);
+    const double t1 = (time1 - tcur) / (tnext - tcur);
+
     // cubicIntegrate: multiply the result by (tnext-tcur)
-    return ret * (tnext - tcur);
+    return integrateCubic_clamp(c, t1, t2, vmin, vmax) * (tnext - tcur);
 } // integrate_clamp
 
+
 /**
  * @brief This function will set the left and right derivative of 'cur', depending on the interpolation method 'interp' and the
  * previous and next key frames.
@@ -30,6 +30,20 @@ double interpolate(double tcur, const double vcur, //start control point
                    KeyframeTypeEnum interp,
                    KeyframeTypeEnum interpNext) WARN_UNUSED_RETURN;
 
+/**
+ * @brief Computes the coefficients of the cubic c0 + c1*x + c2*x^2 + c3*x^3 which is evaluated by interpolate(),
+ * where x = (currentTime - tcur) / (tnext - tcur).
+ * Before the first / after the last keyframe (interp or interpNext is eKeyframeTypeNone), tcur and tnext
+ * are replaced by the bounds of the virtual segment, so that x must be computed with the returned values.
+ **/
+void cubicCoefficients(double *tcur, const double vcur, //start control point
+                       const double vcurDerivRight, //being the derivative dv/dt at tcur
+                       const double vnextDerivLeft, //being the derivative dv/dt at tnext
+                       double *tnext, const double vnext, //end control point
+                       KeyframeTypeEnum interp,
+                       KeyframeTypeEnum interpNext,
+                       double c[4]);
+
 /// derive at currentTime. The derivative is with respect to currentTime
 double derive(double tcur, const double vcur, //start control point
               const double vcurDerivRight, //being the derivative dv/dt at tcur
@@ -68,6 +82,13 @@ double integrate_clamp(double tcur, const double vcur, //start control point
                        Natron::KeyframeTypeEnum interp,
                        Natron::KeyframeTypeEnum interpNext) WARN_UNUSED_RETURN;
 
+/// integrate the cubic c0 + c1*x + c2*x^2 + c3*x^3 (see cubicCoefficients()) from x1 to x2.
+/// The result is with respect to x: multiply it by (tnext - tcur) to get the integral with respect to time.
+double integrateCubic(const double c[4], double x1, double x2) WARN_UNUSED_RETURN;
+
+/// same as integrateCubic(), but the cubic is clamped between vmin and vmax.
+double integrateCubic_clamp(const double c[4], double x1, double x2, double vmin, double vmax) WARN_UNUSED_RETURN;
+
 /**
  * @brief This function will set the left and right derivative of 'cur', depending on the interpolation method 'interp' and the
  * previous and next key frames.
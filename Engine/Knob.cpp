@@ -17,6 +17,8 @@
 #include <QtCore/QThread>
 #include <QtCore/QDebug>
 
+#include <boost/unordered_map.hpp>
+
 #include "Global/GlobalDefines.h"
 #include "Engine/Node.h"
 #include "Engine/ViewerInstance.h"
@@ -1086,7 +1088,12 @@ KnobHelper::isAnimationEnabled() const
 void
 KnobHelper::setName(const std::string & name)
 {
+    std::string oldName = _imp->name;
+
     _imp->name = name;
+    if (_imp->holder) {
+        _imp->holder->onKnobNameChanged(this, oldName);
+    }
 }
 
 const std::string &
@@ -1665,6 +1672,10 @@ struct KnobHolder::KnobHolderPrivate
 {
     AppInstance* app;
     std::vector< boost::shared_ptr<KnobI> > knobs;
+
+    ///Positions in knobs by name for getKnobByName. Like knobs, it is only modified while the knobs are created,
+    ///removed or renamed, not while they are looked up.
+    boost::unordered_multimap<std::string, U32> knobsByName;
     bool knobsInitialized;
     bool isSlave;
 
@@ -1722,6 +1733,7 @@ struct KnobHolder::KnobHolderPrivate
     KnobHolderPrivate(AppInstance* appInstance_)
     : app(appInstance_)
     , knobs()
+    , knobsByName()
     , knobsInitialized(false)
     , isSlave(false)
     , actionsRecursionLevel()
@@ -1744,6 +1756,14 @@ struct KnobHolder::KnobHolderPrivate
             actionsRecursionLevel.localData() = 0;
         }
     }
+
+    void indexKnobs()
+    {
+        knobsByName.clear();
+        for (U32 i = 0; i < knobs.size(); ++i) {
+            knobsByName.insert( std::make_pair(knobs[i]->getName(), i) );
+        }
+    }
 };
 
 KnobHolder::KnobHolder(AppInstance* appInstance)
@@ -1919,6 +1939,7 @@ void
 KnobHolder::addKnob(boost::shared_ptr<KnobI> k)
 {
     _imp->knobs.push_back(k);
+    _imp->knobsByName.insert( std::make_pair(k->getName(), (U32)_imp->knobs.size() - 1) );
 }
 
 void
@@ -1930,6 +1951,31 @@ KnobHolder::removeKnob(KnobI* knob)
             break;
         }
     }
+    ///The knobs after it moved
+    _imp->indexKnobs();
+}
+
+void
+KnobHolder::onKnobNameChanged(KnobI* knob,
+                              const std::string & oldName)
+{
+    ///Knobs are named right after being created, so look from the end
+    for (int i = (int)_imp->knobs.size() - 1; i >= 0; --i) {
+        if (_imp->knobs[i].get() != knob) {
+            continue;
+        }
+        typedef boost::unordered_multimap<std::string, U32>::iterator KnobsByNameIt;
+        std::pair<KnobsByNameIt, KnobsByNameIt> range = _imp->knobsByName.equal_range(oldName);
+        for (KnobsByNameIt it = range.first; it != range.second; ++it) {
+            if ( it->second == (U32)i ) {
+                _imp->knobsByName.erase(it);
+                break;
+            }
+        }
+        _imp->knobsByName.insert( std::make_pair(knob->getName(), (U32)i) );
+
+        return;
+    }
 }
 
 void
@@ -1967,15 +2013,21 @@ KnobHolder::refreshInstanceSpecificKnobsOnly(SequenceTime time)
 
 boost::shared_ptr<KnobI> KnobHolder::getKnobByName(const std::string & name) const
 {
-    const std::vector<boost::shared_ptr<KnobI> > & knobs = getKnobs();
+    typedef boost::unordered_multimap<std::string, U32>::const_iterator KnobsByNameIt;
+    std::pair<KnobsByNameIt, KnobsByNameIt> range = _imp->knobsByName.equal_range(name);
 
-    for (U32 i = 0; i < knobs.size(); ++i) {
-        if (knobs[i]->getName() == name) {
-            return knobs[i];
+    if (range.first == range.second) {
+        return boost::shared_ptr<KnobI>();
+    }
+    ///If several knobs have the same name, return the first one
+    U32 first = range.first->second;
+    for (KnobsByNameIt it = range.first; it != range.second; ++it) {
+        if (it->second < first) {
+            first = it->second;
         }
     }
 
-    return boost::shared_ptr<KnobI>();
+    return _imp->knobs[first];
 }
 
 const std::vector< boost::shared_ptr<KnobI> > &
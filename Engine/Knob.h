@@ -1633,6 +1633,10 @@ public:
        Knob class. Don't call this*/
     void removeKnob(KnobI* k);
 
+    /*Called by the Knob class when its name changes
+       so that getKnobByName finds it. Don't call this*/
+    void onKnobNameChanged(KnobI* knob,const std::string & oldName);
+
     void initializeKnobsPublic();
 
     bool isSlave() const;
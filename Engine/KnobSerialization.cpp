@@ -20,6 +20,7 @@
 #include "Engine/EffectInstance.h"
 #include "Engine/AppInstance.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/Project.h"
 
 
 ValueSerialization::ValueSerialization(const boost::shared_ptr<KnobI> & knob,
@@ -79,22 +80,25 @@ boost::shared_ptr<KnobI> KnobSerialization::createKnob(const std::string & typeN
     return ret;
 }
 
+void
+KnobSerialization::indexByName(const std::list< boost::shared_ptr<KnobSerialization> > & knobs,
+                               KnobsByName* index)
+{
+    for (std::list< boost::shared_ptr<KnobSerialization> >::const_iterator it = knobs.begin(); it != knobs.end(); ++it) {
+        index->insert( std::make_pair( (*it)->getName(), *it ) );
+    }
+}
+
 void
 KnobSerialization::restoreKnobLinks(const boost::shared_ptr<KnobI> & knob,
-                                    const std::vector<boost::shared_ptr<Natron::Node> > & allNodes)
+                                    const Natron::Project & project)
 {
     int i = 0;
 
     for (std::list<MasterSerialization>::iterator it = _masters.begin(); it != _masters.end(); ++it) {
         if (it->masterDimension != -1) {
-            ///we need to cycle through all the nodes of the project to find the real master
-            boost::shared_ptr<Natron::Node> masterNode;
-            for (U32 k = 0; k < allNodes.size(); ++k) {
-                if (allNodes[k]->getName() == it->masterNodeName) {
-                    masterNode = allNodes[k];
-                    break;
-                }
-            }
+            ///we need to find the real master in the nodes of the project
+            boost::shared_ptr<Natron::Node> masterNode = project.getNodeByName(it->masterNodeName);
             if (!masterNode) {
                 qDebug() << "Link slave/master for " << knob->getName().c_str() <<   " failed to restore the following linkage: " << it->masterNodeName.c_str();
                 ++i;
@@ -102,16 +106,10 @@ KnobSerialization::restoreKnobLinks(const boost::shared_ptr<KnobI> & knob,
             }
 
             ///now that we have the master node, find the corresponding knob
-            const std::vector< boost::shared_ptr<KnobI> > & otherKnobs = masterNode->getKnobs();
-            bool found = false;
-            for (U32 j = 0; j < otherKnobs.size(); ++j) {
-                if ( (otherKnobs[j]->getName() == it->masterKnobName) && otherKnobs[j]->getIsPersistant() ) {
-                    knob->slaveTo(i, otherKnobs[j], it->masterDimension);
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
+            boost::shared_ptr<KnobI> masterKnob = masterNode->getKnobByName(it->masterKnobName);
+            if ( masterKnob && masterKnob->getIsPersistant() ) {
+                knob->slaveTo(i, masterKnob, it->masterDimension);
+            } else {
                 qDebug() << "Link slave/master for " << knob->getName().c_str() <<   " failed to restore the following linkage: " << it->masterNodeName.c_str();
             }
         }
@@ -121,12 +119,11 @@ KnobSerialization::restoreKnobLinks(const boost::shared_ptr<KnobI> & knob,
 
 void
 KnobSerialization::restoreTracks(const boost::shared_ptr<KnobI> & knob,
-                                 const std::vector<boost::shared_ptr<Natron::Node> > & allNodes)
+                                 const Natron::Project & project)
 {
     Double_Knob* isDouble = dynamic_cast<Double_Knob*>( knob.get() );
 
     if ( isDouble && (isDouble->getName() == "center") && (isDouble->getDimension() == 2) ) {
-        isDouble->restoreTracks(slavedTracks,allNodes);
+        isDouble->restoreTracks(slavedTracks,project);
     }
 }
-
@@ -26,6 +26,7 @@ GCC_DIAG_OFF(sign-compare)
 GCC_DIAG_ON(sign-compare)
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/version.hpp>
+#include <boost/unordered_map.hpp>
 #endif
 
 #include "Engine/Variant.h"
@@ -43,6 +44,10 @@ GCC_DIAG_ON(sign-compare)
 #define VALUE_SERIALIZATION_INTRODUCES_CHOICE_LABEL 2
 #define VALUE_SERIALIZATION_VERSION VALUE_SERIALIZATION_INTRODUCES_CHOICE_LABEL
 
+namespace Natron {
+class Project;
+}
+
 struct MasterSerialization
 {
     int masterDimension;
@@ -458,10 +463,19 @@ public:
 
     ~KnobSerialization() { delete _extraData; }
     
+    typedef boost::unordered_map<std::string, boost::shared_ptr<KnobSerialization> > KnobsByName;
+
+    /**
+     * @brief Indexes the given serialized knobs by name, so that matching them with the knobs of a holder is linear
+     * instead of quadratic. If several have the same name, the first one is kept.
+     **/
+    static void indexByName(const std::list< boost::shared_ptr<KnobSerialization> > & knobs,KnobsByName* index);
+
     /**
      * @brief This function cannot be called until all knobs of the project have been created.
+     * The master nodes are looked up by name in the project.
      **/
-    void restoreKnobLinks(const boost::shared_ptr<KnobI> & knob,const std::vector<boost::shared_ptr<Natron::Node> > & allNodes);
+    void restoreKnobLinks(const boost::shared_ptr<KnobI> & knob,const Natron::Project & project);
 
     boost::shared_ptr<KnobI> getKnob() const
     {
@@ -475,7 +489,7 @@ public:
 
     static boost::shared_ptr<KnobI> createKnob(const std::string & typeName,int dimension);
 
-    void restoreTracks(const boost::shared_ptr<KnobI> & knob,const std::vector<boost::shared_ptr<Natron::Node> > & allNodes);
+    void restoreTracks(const boost::shared_ptr<KnobI> & knob,const Natron::Project & project);
 
     const TypeExtraData* getExtraData() const { return _extraData; }
     
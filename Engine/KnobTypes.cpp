@@ -28,6 +28,8 @@
 #include "Engine/Image.h"
 #include "Engine/KnobSerialization.h"
 #include "Engine/Format.h"
+#include "Engine/Project.h"
+
 using namespace Natron;
 using std::make_pair;
 using std::pair;
@@ -318,7 +320,7 @@ Double_Knob::serializeTracks(std::list<SerializedTrack>* tracks)
 
 void
 Double_Knob::restoreTracks(const std::list <SerializedTrack> & tracks,
-                           const std::vector<boost::shared_ptr<Node> > & activeNodes)
+                           const Natron::Project & project)
 {
     ///get a shared_ptr to this
     assert( getHolder() );
@@ -340,15 +342,13 @@ Double_Knob::restoreTracks(const std::list <SerializedTrack> & tracks,
         if (it->rotoNodeName == lastNodeName) {
             roto = lastRoto;
         } else {
-            for (U32 i = 0; i < activeNodes.size(); ++i) {
-                if (activeNodes[i]->getName() == it->rotoNodeName) {
-                    lastNodeName = activeNodes[i]->getName();
-                    boost::shared_ptr<RotoContext> rotoCtx = activeNodes[i]->getRotoContext();
-                    assert(rotoCtx);
-                    lastRoto = rotoCtx.get();
-                    roto = rotoCtx.get();
-                    break;
-                }
+            boost::shared_ptr<Node> rotoNode = project.getNodeByName(it->rotoNodeName);
+            if (rotoNode) {
+                lastNodeName = it->rotoNodeName;
+                boost::shared_ptr<RotoContext> rotoCtx = rotoNode->getRotoContext();
+                assert(rotoCtx);
+                lastRoto = rotoCtx.get();
+                roto = rotoCtx.get();
             }
         }
         if (roto) {
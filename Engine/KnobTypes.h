@@ -34,6 +34,7 @@ class StringAnimationManager;
 class BezierCP;
 namespace Natron {
 class Node;
+class Project;
 }
 /******************************INT_KNOB**************************************/
 
@@ -281,7 +282,7 @@ public:
 
     void serializeTracks(std::list<SerializedTrack>* tracks);
 
-    void restoreTracks(const std::list <SerializedTrack> & tracks,const std::vector<boost::shared_ptr<Natron::Node> > & activeNodes);
+    void restoreTracks(const std::list <SerializedTrack> & tracks,const Natron::Project & project);
 
 public slots:
 
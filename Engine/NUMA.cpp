@@ -0,0 +1,241 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "NUMA.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QThreadStorage>
+
+#if defined(__NATRON_LINUX__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+///From linux/mempolicy.h, not included to avoid depending on libnuma headers
+#define NATRON_MPOL_PREFERRED 1
+#define NATRON_MPOL_MF_MOVE (1 << 1)
+#endif
+
+using namespace Natron;
+
+namespace {
+static QAtomicInt numaEnabled(0);
+static QAtomicInt nextRenderThreadNode(0);
+
+///Where the current thread is pinned, not set means it never was
+struct ThreadPlacement
+{
+    int node; //< -1 if not pinned
+#if defined(__NATRON_LINUX__)
+    cpu_set_t originalMask; //< the affinity of the thread before it was first pinned, restored when it is unpinned
+#endif
+
+    ThreadPlacement()
+    : node(-1)
+    {
+#if defined(__NATRON_LINUX__)
+        CPU_ZERO(&originalMask);
+#endif
+    }
+};
+static QThreadStorage<ThreadPlacement> currentThreadPlacement;
+
+///The cores of each node, read once
+struct NodesTopology
+{
+    std::vector<std::vector<int> > cpus;
+
+    NodesTopology()
+    : cpus()
+    {
+#if defined(__NATRON_LINUX__)
+        for (int node = 0;; ++node) {
+            std::stringstream ss;
+            ss << "/sys/devices/system/node/node" << node << "/cpulist";
+            std::ifstream f( ss.str().c_str() );
+            if ( !f.is_open() ) {
+                break;
+            }
+            std::string line;
+            std::getline(f, line);
+
+            ///The list is in the form 0-7,16-23
+            std::vector<int> nodeCpus;
+            std::stringstream ls(line);
+            std::string range;
+            while ( std::getline(ls, range, ',') ) {
+                int first,last;
+                char dash;
+                std::stringstream rs(range);
+                if ( !(rs >> first) ) {
+                    continue;
+                }
+                if ( !(rs >> dash >> last) ) {
+                    last = first;
+                }
+                for (int c = first; c <= last; ++c) {
+                    nodeCpus.push_back(c);
+                }
+            }
+            cpus.push_back(nodeCpus);
+        }
+#endif
+    }
+};
+
+static const NodesTopology&
+getTopology()
+{
+    static const NodesTopology topology;
+
+    return topology;
+}
+}
+
+void
+NUMA::setEnabled(bool enabled)
+{
+    numaEnabled.fetchAndStoreRelaxed(enabled ? 1 : 0);
+}
+
+bool
+NUMA::isEnabled()
+{
+    return (int)numaEnabled != 0;
+}
+
+int
+NUMA::getNodesCount()
+{
+    int n = (int)getTopology().cpus.size();
+
+    return n > 0 ? n : 1;
+}
+
+int
+NUMA::getCurrentThreadNode()
+{
+    if ( !currentThreadPlacement.hasLocalData() ) {
+        return -1;
+    }
+
+    return currentThreadPlacement.localData().node;
+}
+
+int
+NUMA::getNextRenderThreadNode()
+{
+    int nNodes = getNodesCount();
+    if ( !isEnabled() || (nNodes < 2) ) {
+        return -1;
+    }
+
+    return nextRenderThreadNode.fetchAndAddRelaxed(1) % nNodes;
+}
+
+bool
+NUMA::pinCurrentThreadToNode(int node)
+{
+#if defined(__NATRON_LINUX__)
+    const NodesTopology& topology = getTopology();
+    if ( node >= (int)topology.cpus.size() ) {
+        return false;
+    }
+
+    ThreadPlacement& placement = currentThreadPlacement.localData();
+    if (node == placement.node) {
+        return true;
+    }
+    if (node == -1) {
+        if ( sched_setaffinity(0, sizeof(cpu_set_t), &placement.originalMask) != 0 ) {
+            return false;
+        }
+        placement.node = -1;
+
+        return true;
+    }
+
+    if ( (placement.node == -1) && (sched_getaffinity(0, sizeof(cpu_set_t), &placement.originalMask) != 0) ) {
+        return false;
+    }
+    ///Only the cores of the node the thread was allowed to run on, e.g: by taskset
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (std::size_t c = 0; c < topology.cpus[node].size(); ++c) {
+        if ( CPU_ISSET(topology.cpus[node][c], &placement.originalMask) ) {
+            CPU_SET(topology.cpus[node][c], &set);
+        }
+    }
+    if ( (CPU_COUNT(&set) == 0) || (sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0) ) {
+        return false;
+    }
+    placement.node = node;
+
+    return true;
+#else
+    (void)node;
+
+    return false;
+#endif
+}
+
+void
+NUMA::moveMemoryToCurrentThreadNode(void* ptr,
+                                    std::size_t size)
+{
+#if defined(__NATRON_LINUX__)
+    int node = getCurrentThreadNode();
+    if ( (node < 0) || !ptr || (size == 0) ) {
+        return;
+    }
+
+    ///mbind needs a page-aligned start, only the pages entirely in the range are moved
+    std::size_t pageSize = (std::size_t)sysconf(_SC_PAGESIZE);
+    std::size_t start = ( (std::size_t)ptr + pageSize - 1 ) & ~(pageSize - 1);
+    std::size_t end = ( (std::size_t)ptr + size ) & ~(pageSize - 1);
+    if (end <= start) {
+        return;
+    }
+
+    const int bitsPerLong = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> nodeMask(node / bitsPerLong + 1, 0);
+    nodeMask[node / bitsPerLong] = 1UL << (node % bitsPerLong);
+
+    ///The kernel reads maxnode - 1 bits of the mask, hence node + 2
+    ///This is only a hint: a failure (e.g: not enough free memory on the node) leaves the pages where they are
+    (void)syscall(SYS_mbind, (void*)start, end - start, NATRON_MPOL_PREFERRED, &nodeMask.front(),
+                  (unsigned long)(node + 2), NATRON_MPOL_MF_MOVE);
+#else
+    (void)ptr;
+    (void)size;
+#endif
+}
+
+void
+NUMA::moveCurrentThreadToNode(int node)
+{
+    if ( node != getCurrentThreadNode() ) {
+        pinCurrentThreadToNode(node);
+    }
+}
+
+NUMA::ThreadNodeSetter::ThreadNodeSetter(int node)
+: _previous( getCurrentThreadNode() )
+{
+    if (node != _previous) {
+        pinCurrentThreadToNode(node);
+    }
+}
+
+NUMA::ThreadNodeSetter::~ThreadNodeSetter()
+{
+    if ( getCurrentThreadNode() != _previous ) {
+        pinCurrentThreadToNode(_previous);
+    }
+}
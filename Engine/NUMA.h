@@ -0,0 +1,80 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_NUMA_H_
+#define NATRON_ENGINE_NUMA_H_
+
+#include <cstddef>
+
+#include "Global/Macros.h"
+
+/**
+ * @brief Thread and memory placement on machines with several NUMA nodes (typically multi-socket workstations).
+ * When enabled, each render thread is pinned to a node in a round-robin fashion, the tiles it spawns on the global
+ * thread-pool run on the same node and the cache entries it allocates are placed in the memory of that node, so that
+ * an image is mostly produced and consumed by cores that are close to it.
+ * This is opt-in (see the "numaAwareRendering" setting): on single-node machines or on systems where the placement
+ * is not supported all the functions below are no-ops.
+ **/
+namespace Natron {
+namespace NUMA {
+void setEnabled(bool enabled);
+
+bool isEnabled() WARN_UNUSED_RETURN;
+
+/**
+ * @brief Returns the number of NUMA nodes of the machine, 1 if it cannot be determined.
+ **/
+int getNodesCount() WARN_UNUSED_RETURN;
+
+/**
+ * @brief Returns the node the calling thread is pinned to, or -1 if it is not pinned.
+ **/
+int getCurrentThreadNode() WARN_UNUSED_RETURN;
+
+/**
+ * @brief Returns the node the next render thread should be pinned to, or -1 if the placement is disabled.
+ **/
+int getNextRenderThreadNode() WARN_UNUSED_RETURN;
+
+/**
+ * @brief Restricts the calling thread to the cores of the given node it was allowed to run on. If node is -1, gives the thread
+ * back the affinity it had before it was first pinned. Does nothing if the thread is already there.
+ * Returns false if the affinity could not be changed.
+ **/
+bool pinCurrentThreadToNode(int node);
+
+/**
+ * @brief Moves a thread of the global thread pool to the node of the tile it renders and leaves it there, so that the tiles
+ * of a render only change the affinity of the threads which last rendered for another node.
+ **/
+void moveCurrentThreadToNode(int node);
+
+/**
+ * @brief If the calling thread is pinned, asks the kernel to back the given range with the memory of its node,
+ * moving the pages already allocated somewhere else (memory re-used by the allocator was possibly first touched
+ * by a thread of another node).
+ **/
+void moveMemoryToCurrentThreadNode(void* ptr,std::size_t size);
+
+/**
+ * @brief Pins the calling thread to the given node for the lifetime of the object. Does nothing if node is -1
+ * and the thread is not pinned.
+ **/
+class ThreadNodeSetter
+{
+    int _previous;
+
+public:
+
+    ThreadNodeSetter(int node);
+
+    ~ThreadNodeSetter();
+};
+} // namespace NUMA
+} // namespace Natron
+
+#endif // NATRON_ENGINE_NUMA_H_
@@ -46,6 +46,9 @@
 #include "Engine/Timer.h"
 #include "Engine/Settings.h"
 #include "Engine/NodeGuiI.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/RenderStats.h"
+#include "Engine/DiskCacheNode.h"
 
 ///The flickering of edges/nodes in the nodegraph will be refreshed
 ///at most every...
@@ -459,16 +462,13 @@ Node::load(const std::string & pluginID,
 void
 Node::fetchParentMultiInstancePointer()
 {
-    std::vector<boost::shared_ptr<Node> > nodes = getApp()->getProject()->getCurrentNodes();
+    boost::shared_ptr<Node> parent = getApp()->getProject()->getNodeByName(_imp->multiInstanceParentName);
     
-    for (U32 i = 0; i < nodes.size(); ++i) {
-        if (nodes[i]->getName() == _imp->multiInstanceParentName) {
-            ///no need to store the boost pointer because the main instance lives the same time
-            ///as the child
-            _imp->multiInstanceParent = nodes[i].get();
-            QObject::connect(nodes[i].get(), SIGNAL(inputChanged(int)), this, SLOT(onParentMultiInstanceInputChanged(int)));
-            break;
-        }
+    if (parent) {
+        ///no need to store the boost pointer because the main instance lives the same time
+        ///as the child
+        _imp->multiInstanceParent = parent.get();
+        QObject::connect(parent.get(), SIGNAL(inputChanged(int)), this, SLOT(onParentMultiInstanceInputChanged(int)));
     }
 }
 
@@ -570,16 +570,17 @@ Node::setValuesFromSerialization(const std::list<boost::shared_ptr<KnobSerializa
     assert( QThread::currentThread() == qApp->thread() );
     assert(_imp->knobsInitialized);
     
+    KnobSerialization::KnobsByName valuesByName;
+    KnobSerialization::indexByName(paramValues, &valuesByName);
+    
     const std::vector< boost::shared_ptr<KnobI> > & nodeKnobs = getKnobs();
     ///for all knobs of the node
     for (U32 j = 0; j < nodeKnobs.size(); ++j) {
         ///try to find a serialized value for this knob
-        for (std::list<boost::shared_ptr<KnobSerialization> >::const_iterator it = paramValues.begin(); it != paramValues.end(); ++it) {
-            if ( (*it)->getName() == nodeKnobs[j]->getName() ) {
-                boost::shared_ptr<KnobI> serializedKnob = (*it)->getKnob();
-                nodeKnobs[j]->clone(serializedKnob);
-                break;
-            }
+        KnobSerialization::KnobsByName::const_iterator found = valuesByName.find( nodeKnobs[j]->getName() );
+        if ( found != valuesByName.end() ) {
+            boost::shared_ptr<KnobI> serializedKnob = found->second->getKnob();
+            nodeKnobs[j]->clone(serializedKnob);
         }
         
     }
@@ -592,10 +593,16 @@ Node::loadKnobs(const NodeSerialization & serialization,bool updateKnobGui)
     assert( QThread::currentThread() == qApp->thread() );
     assert(_imp->knobsInitialized);
     
+    KnobSerialization::KnobsByName valuesByName;
+    KnobSerialization::indexByName(serialization.getKnobsValues(), &valuesByName);
+    
     const std::vector< boost::shared_ptr<KnobI> > & nodeKnobs = getKnobs();
     ///for all knobs of the node
     for (U32 j = 0; j < nodeKnobs.size(); ++j) {
-        loadKnob(nodeKnobs[j], serialization,updateKnobGui);
+        KnobSerialization::KnobsByName::const_iterator found = valuesByName.find( nodeKnobs[j]->getName() );
+        if ( found != valuesByName.end() ) {
+            loadKnob(nodeKnobs[j], *found->second, updateKnobGui);
+        }
     }
     ///now restore the roto context if the node has a roto context
     if (serialization.hasRotoContext() && _imp->rotoContext) {
@@ -614,52 +621,58 @@ Node::loadKnob(const boost::shared_ptr<KnobI> & knob,
     ///try to find a serialized value for this knob
     for (NodeSerialization::KnobValues::const_iterator it = knobsValues.begin(); it != knobsValues.end(); ++it) {
         if ( (*it)->getName() == knob->getName() ) {
-            
-            // don't load the value if the Knob is not persistant! (it is just the default value in this case)
-            ///EDIT: Allow non persistent params to be loaded if we found a valid serialization for them
-            //if ( knob->getIsPersistant() ) {
-            boost::shared_ptr<KnobI> serializedKnob = (*it)->getKnob();
-            
-            Choice_Knob* isChoice = dynamic_cast<Choice_Knob*>(knob.get());
-            if (isChoice) {
-                const TypeExtraData* extraData = (*it)->getExtraData();
-                const ChoiceExtraData* choiceData = dynamic_cast<const ChoiceExtraData*>(extraData);
-                assert(choiceData);
-                
-                Choice_Knob* choiceSerialized = dynamic_cast<Choice_Knob*>(serializedKnob.get());
-                assert(choiceSerialized);
-                isChoice->choiceRestoration(choiceSerialized, choiceData);
-            } else {
-                if (updateKnobGui) {
-                    knob->cloneAndUpdateGui(serializedKnob.get());
-                } else {
-                    knob->clone(serializedKnob);
-                }
-                knob->setSecret( serializedKnob->getIsSecret() );
-                if ( knob->getDimension() == serializedKnob->getDimension() ) {
-                    for (int i = 0; i < knob->getDimension(); ++i) {
-                        knob->setEnabled( i, serializedKnob->isEnabled(i) );
-                    }
-                }
-            }
-            
-            if (knob->getName() == kOfxImageEffectFileParamName) {
-                computeFrameRangeForReader(knob.get());
-            }
-            
-            //}
+            loadKnob(knob, **it, updateKnobGui);
             break;
         }
     }
 }
 
 void
-Node::restoreKnobsLinks(const NodeSerialization & serialization,
-                        const std::vector<boost::shared_ptr<Natron::Node> > & allNodes)
+Node::loadKnob(const boost::shared_ptr<KnobI> & knob,
+               const KnobSerialization & serialization,bool updateKnobGui)
+{
+    // don't load the value if the Knob is not persistant! (it is just the default value in this case)
+    ///EDIT: Allow non persistent params to be loaded if we found a valid serialization for them
+    //if ( knob->getIsPersistant() ) {
+    boost::shared_ptr<KnobI> serializedKnob = serialization.getKnob();
+    
+    Choice_Knob* isChoice = dynamic_cast<Choice_Knob*>(knob.get());
+    if (isChoice) {
+        const TypeExtraData* extraData = serialization.getExtraData();
+        const ChoiceExtraData* choiceData = dynamic_cast<const ChoiceExtraData*>(extraData);
+        assert(choiceData);
+        
+        Choice_Knob* choiceSerialized = dynamic_cast<Choice_Knob*>(serializedKnob.get());
+        assert(choiceSerialized);
+        isChoice->choiceRestoration(choiceSerialized, choiceData);
+    } else {
+        if (updateKnobGui) {
+            knob->cloneAndUpdateGui(serializedKnob.get());
+        } else {
+            knob->clone(serializedKnob);
+        }
+        knob->setSecret( serializedKnob->getIsSecret() );
+        if ( knob->getDimension() == serializedKnob->getDimension() ) {
+            for (int i = 0; i < knob->getDimension(); ++i) {
+                knob->setEnabled( i, serializedKnob->isEnabled(i) );
+            }
+        }
+    }
+    
+    if (knob->getName() == kOfxImageEffectFileParamName) {
+        computeFrameRangeForReader(knob.get());
+    }
+    
+    //}
+}
+
+void
+Node::restoreKnobsLinks(const NodeSerialization & serialization)
 {
     ////Only called by the main-thread
     assert( QThread::currentThread() == qApp->thread() );
     
+    const Natron::Project & project = *getApp()->getProject();
     const NodeSerialization::KnobValues & knobsValues = serialization.getKnobsValues();
     ///try to find a serialized value for this knob
     for (NodeSerialization::KnobValues::const_iterator it = knobsValues.begin(); it != knobsValues.end(); ++it) {
@@ -668,8 +681,8 @@ Node::restoreKnobsLinks(const NodeSerialization & serialization,
             appPTR->writeToOfxLog_mt_safe("Couldn't find a parameter named " + QString((*it)->getName().c_str()));
             continue;
         }
-        (*it)->restoreKnobLinks(knob,allNodes);
-        (*it)->restoreTracks(knob,allNodes);
+        (*it)->restoreKnobLinks(knob,project);
+        (*it)->restoreTracks(knob,project);
     }
 }
 
@@ -987,10 +1000,17 @@ Node::getName_mt_safe() const
 void
 Node::setName(const QString & name)
 {
+    std::string oldName;
     {
         QMutexLocker l(&_imp->nameMutex);
+        oldName = _imp->name;
         _imp->name = name.toStdString();
     }
+    ///Keep the index of the project up to date
+    boost::shared_ptr<Natron::Project> project = _imp->app ? _imp->app->getProject() : boost::shared_ptr<Natron::Project>();
+    if (project) {
+        project->onNodeNameChanged(this, oldName);
+    }
     emit nameChanged(name);
 }
 
@@ -2217,7 +2237,7 @@ namespace {
                     // bilinear interpolation is pointless when downscaling a lot, and this is a preview anyway.
                     // just use nearest neighbor
                     double x = (j - *dstWidth / 2.) / zoomFactor + (srcBounds.x1 + srcBounds.x2) / 2.;
-                    int xi = std::floor(x + 0.5); // round to nearest
+                    int xi = std::floor(x + 0.5) - srcBounds.x1; // round to nearest, relative to src_pixels
                     if ( (xi < 0) || ( xi >= (srcBounds.x2 - srcBounds.x1) ) ) {
 #ifndef __NATRON_WIN32__
                         dst_pixels[j] = toBGRA(0, 0, 0, 0);
@@ -2260,6 +2280,46 @@ public:
     }
 };
 
+boost::shared_ptr<Natron::Image>
+Node::getCachedPreviewSource(SequenceTime time,
+                             U64 nodeHash,
+                             unsigned int mipMapLevel) const
+{
+    if ( !_imp->liveInstance->shouldCacheOutput() || dynamic_cast<DiskCacheNode*>( _imp->liveInstance ) ) {
+        return boost::shared_ptr<Image>();
+    }
+    
+    ///The viewer or a previous preview may have rendered the whole image of this node already
+    ImageKey key = Image::makeKey(nodeHash, _imp->liveInstance->isFrameVaryingOrAnimated_Recursive(), time, 0);
+    std::list<boost::shared_ptr<Image> > cachedImages;
+    if ( !Natron::getImageFromCache(key, &cachedImages) ) {
+        return boost::shared_ptr<Image>();
+    }
+    
+    ///Any resolution up to one level below the one the preview would be rendered at is good enough for a thumbnail,
+    ///prefer the smallest image as the preview samples it anyway
+    boost::shared_ptr<Image> ret;
+    for (std::list<boost::shared_ptr<Image> >::iterator it = cachedImages.begin(); it != cachedImages.end(); ++it) {
+        const boost::shared_ptr<Image> & img = *it;
+        if ( (img->getMipMapLevel() > mipMapLevel + 1) || (getElementsCountForComponents( img->getComponents() ) < 3) ) {
+            continue;
+        }
+        ///The project format may have changed since the image was cached
+        if ( img->getParams()->isRodProjectFormat() ) {
+            continue;
+        }
+        ///Only part of the image may have been rendered, e.g: the viewer was zoomed in
+        if ( !img->getMinimalRect( img->getBounds() ).isNull() ) {
+            continue;
+        }
+        if ( !ret || (img->getMipMapLevel() > ret->getMipMapLevel()) ) {
+            ret = img;
+        }
+    }
+    
+    return ret;
+}
+
 bool
 Node::makePreviewImage(SequenceTime time,
                        int *width,
@@ -2278,6 +2338,9 @@ Node::makePreviewImage(SequenceTime time,
     /// prevent 2 previews to occur at the same time since there's only 1 preview instance
     ComputingPreviewSetter_RAII computingPreviewRAII(_imp.get());
     
+    ///Previews are never what the user is waiting for, whichever thread computes them
+    RenderPrioritySetter prioritySetter(Natron::eRenderPriorityBackground);
+    
     RectD rod;
     bool isProjectFormat;
     RenderScale scale;
@@ -2300,35 +2363,37 @@ Node::makePreviewImage(SequenceTime time,
     
     const double par = _imp->liveInstance->getPreferredAspectRatio();
     
-    boost::shared_ptr<Image> img;
+    boost::shared_ptr<Image> img = getCachedPreviewSource(time, nodeHash, mipMapLevel);
     RectI renderWindow;
     rod.toPixelEnclosing(mipMapLevel, par, &renderWindow);
     
-    ParallelRenderArgsSetter frameRenderArgs(this,
-                                             time,
-                                             0, //< preview only renders view 0 (left)
-                                             true,
-                                             false,
-                                             false,
-                                             nodeHash,
-                                             false,
-                                             getApp()->getTimeLine().get());
-    
-    // Exceptions are caught because the program can run without a preview,
-    // but any exception in renderROI is probably fatal.
-    try {
-        img = _imp->liveInstance->renderRoI( EffectInstance::RenderRoIArgs( time,
-                                                                           scale,
-                                                                           mipMapLevel,
-                                                                           0, //< preview only renders view 0 (left)
-                                                                           false,
-                                                                           renderWindow,
-                                                                           rod,
-                                                                           Natron::eImageComponentRGB, //< preview is always rgb...
-                                                                           getBitDepth() ) );
-    } catch (...) {
-        qDebug() << "Error: Cannot render preview";
-        return false;
+    if (!img) {
+        ParallelRenderArgsSetter frameRenderArgs(this,
+                                                 time,
+                                                 0, //< preview only renders view 0 (left)
+                                                 true,
+                                                 false,
+                                                 false,
+                                                 nodeHash,
+                                                 false,
+                                                 getApp()->getTimeLine().get());
+    
+        // Exceptions are caught because the program can run without a preview,
+        // but any exception in renderROI is probably fatal.
+        try {
+            img = _imp->liveInstance->renderRoI( EffectInstance::RenderRoIArgs( time,
+                                                                               scale,
+                                                                               mipMapLevel,
+                                                                               0, //< preview only renders view 0 (left)
+                                                                               false,
+                                                                               renderWindow,
+                                                                               rod,
+                                                                               Natron::eImageComponentRGB, //< preview is always rgb...
+                                                                               getBitDepth() ) );
+        } catch (...) {
+            qDebug() << "Error: Cannot render preview";
+            return false;
+        }
     }
     
     if (!img) {
@@ -2735,6 +2800,7 @@ Node::registerPluginMemory(size_t nBytes)
         QMutexLocker l(&_imp->memoryUsedMutex);
         _imp->pluginInstanceMemoryUsed += nBytes;
     }
+    appPTR->getRenderStats()->addPluginMemory( _imp->liveInstance, (long long)nBytes );
     emit pluginMemoryUsageChanged(nBytes);
 }
 
@@ -2745,6 +2811,7 @@ Node::unregisterPluginMemory(size_t nBytes)
         QMutexLocker l(&_imp->memoryUsedMutex);
         _imp->pluginInstanceMemoryUsed -= nBytes;
     }
+    appPTR->getRenderStats()->addPluginMemory( _imp->liveInstance, -(long long)nBytes );
     emit pluginMemoryUsageChanged(-nBytes);
 }
 
@@ -3453,6 +3520,34 @@ Node::invalidateParallelRenderArgs()
     invalidateParallelRenderArgsInternal(marked);
 }
 
+void
+Node::setStreamingBands(bool streaming)
+{
+    std::list<Natron::Node*> marked;
+    setStreamingBandsInternal(streaming, marked);
+}
+
+void
+Node::setStreamingBandsInternal(bool streaming,
+                                std::list<Natron::Node*>& markedNodes)
+{
+    ///If marked, we already set it
+    std::list<Natron::Node*>::iterator found = std::find(markedNodes.begin(), markedNodes.end(), this);
+    if (found != markedNodes.end()) {
+        return;
+    }
+    _imp->liveInstance->setStreamingBands(streaming);
+    markedNodes.push_back(this);
+    
+    int maxInpu = _imp->liveInstance->getMaxInputCount();
+    for (int i = 0; i < maxInpu; ++i) {
+        boost::shared_ptr<Node> input = getInput(i);
+        if (input) {
+            input->setStreamingBandsInternal(streaming, markedNodes);
+        }
+    }
+}
+
 void
 Node::invalidateParallelRenderArgsInternal(std::list<Natron::Node*>& markedNodes)
 {
@@ -3699,6 +3794,14 @@ Node::isSettingsPanelOpened() const
     
 }
 
+void
+Node::renderPreviewNow(int time)
+{
+    if (_imp->guiPointer) {
+        _imp->guiPointer->computePreviewImage(time);
+    }
+}
+
 void
 Node::restoreClipPreferencesRecursive(std::list<Natron::Node*>& markedNodes)
 {
@@ -121,8 +121,8 @@ public:
     }
 
     ///This cannot be done in loadKnobs as to call this all the nodes in the project must have
-    ///been loaded first.
-    void restoreKnobsLinks(const NodeSerialization & serialization,const std::vector<boost::shared_ptr<Natron::Node> > & allNodes);
+    ///been loaded first. The masters are looked up by name in the project.
+    void restoreKnobsLinks(const NodeSerialization & serialization);
 
     /*@brief Quit all processing done by all render instances of this node
        This is called when the effect is about to be deleted pluginsly
@@ -387,6 +387,12 @@ private:
      **/
     void connectOutput(Node* output);
 
+    /**
+     * @brief Returns an image of this node found in the cache that the preview at the given time can be made from,
+     * or NULL if the preview must be rendered.
+     **/
+    boost::shared_ptr<Natron::Image> getCachedPreviewSource(SequenceTime time,U64 nodeHash,unsigned int mipMapLevel) const;
+
     /** @brief Removes the node output of the
      * node outputs. Returns the outputNumber if it could remove it,
        otherwise returns -1.*/
@@ -497,6 +503,12 @@ public:
      **/
     bool makePreviewImage(SequenceTime time,int *width,int *height,unsigned int* buf);
 
+    /**
+     * @brief Computes the preview in the calling thread and hands it to the GUI of the node, if any.
+     * Called by the PreviewScheduler, use computePreviewImage() or refreshPreviewImage() instead.
+     **/
+    void renderPreviewNow(int time);
+
     /**
      * @brief Returns true if the node is currently rendering a preview image.
      **/
@@ -717,6 +729,12 @@ public:
     
     void invalidateParallelRenderArgs();
     
+    /**
+     * @brief Calls EffectInstance::setStreamingBands on this node and all its inputs (recursively), for the current thread.
+     * The parallel render args must have been set.
+     **/
+    void setStreamingBands(bool streaming);
+    
     /**
      * @brief Returns true if the parallel render args thread-storage is set
      **/
@@ -852,6 +870,8 @@ private:
 
     void invalidateParallelRenderArgsInternal(std::list<Natron::Node*>& markedNodes);
     
+    void setStreamingBandsInternal(bool streaming,std::list<Natron::Node*>& markedNodes);
+    
     void setParallelRenderArgsInternal(int time,
                                        int view,
                                        bool isRenderUserInteraction,
@@ -866,6 +886,8 @@ private:
 
     void loadKnob(const boost::shared_ptr<KnobI> & knob,const NodeSerialization & serialization,bool updateKnobGui = false);
 
+    void loadKnob(const boost::shared_ptr<KnobI> & knob,const KnobSerialization & serialization,bool updateKnobGui);
+
 
     /**
      * @brief If the node is an input of this node, set ok to true, otherwise
@@ -30,6 +30,11 @@ public :
      * @brief Set the position of the node in the nodegraph.
      **/
     virtual void setPosition(double x,double y) = 0;
+
+    /**
+     * @brief Computes the preview of the node at the given time and displays it. Called by the PreviewScheduler thread.
+     **/
+    virtual void computePreviewImage(int time) = 0;
 };
 
 #endif // NODEGUII_H
@@ -0,0 +1,163 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "OfxDescriptorsCache.h"
+
+#include <fstream>
+#include <istream>
+#include <streambuf>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QStringList>
+#include <QtCore/QCoreApplication>
+
+#ifndef Q_MOC_RUN
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#endif
+
+namespace {
+///A read-only stream buffer over a memory-mapped file, so that the archive reads the mapping without copying it first
+class MappedFileBuffer
+    : public std::streambuf
+{
+public:
+
+    MappedFileBuffer(uchar* data,
+                     qint64 size)
+    {
+        char* begin = reinterpret_cast<char*>(data);
+
+        setg(begin, begin, begin + size);
+    }
+};
+
+///Finds the plug-in bundles under dir
+static void
+findBundles(const QString & dirPath,
+            std::set<std::string>* bundles)
+{
+    QDir dir(dirPath);
+    QStringList entries = dir.entryList(QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot);
+
+    for (int i = 0; i < entries.size(); ++i) {
+        QString path = dir.absoluteFilePath( entries[i] );
+        if ( entries[i].endsWith(".ofx.bundle") ) {
+            bundles->insert( path.toStdString() );
+        } else {
+            findBundles(path, bundles);
+        }
+    }
+}
+}
+
+OfxBundleStamp::OfxBundleStamp(const std::string & bundlePath,
+                               const std::string & binary)
+: binaryPath(binary)
+, bundleModificationTime(0)
+, contentsModificationTime(0)
+, archModificationTime(0)
+, binaryModificationTime(0)
+, binarySize(0)
+{
+    QFileInfo bundleInfo( bundlePath.c_str() );
+    bundleModificationTime = bundleInfo.lastModified().toMSecsSinceEpoch();
+    QFileInfo contentsInfo( QString( bundlePath.c_str() ) + "/Contents" );
+    contentsModificationTime = contentsInfo.lastModified().toMSecsSinceEpoch();
+    if ( !binaryPath.empty() ) {
+        QFileInfo binaryInfo( binaryPath.c_str() );
+        binaryModificationTime = binaryInfo.lastModified().toMSecsSinceEpoch();
+        binarySize = binaryInfo.size();
+        QFileInfo archInfo( binaryInfo.absolutePath() );
+        archModificationTime = archInfo.lastModified().toMSecsSinceEpoch();
+    }
+}
+
+void
+OfxDescriptorsCache::findBundles(const std::list<std::string> & searchPath,
+                                 std::set<std::string>* bundles)
+{
+    for (std::list<std::string>::const_iterator it = searchPath.begin(); it != searchPath.end(); ++it) {
+        ::findBundles(QString( it->c_str() ), bundles);
+    }
+}
+
+bool
+OfxDescriptorsCache::read(const QString & filePath,
+                          const std::list<std::string> & searchPath)
+{
+    QFile file(filePath);
+
+    if ( !file.open(QIODevice::ReadOnly) || (file.size() == 0) ) {
+        return false;
+    }
+    uchar* data = file.map( 0, file.size() );
+    if (!data) {
+        return false;
+    }
+    bool ok = true;
+    try {
+        MappedFileBuffer buffer( data, file.size() );
+        std::istream is(&buffer);
+        boost::archive::binary_iarchive iArchive(is);
+        iArchive >> *this;
+    } catch (...) {
+        ///Written by another version of boost or corrupted
+        ok = false;
+    }
+    file.unmap(data);
+
+    if ( !ok || (cacheVersion != NATRON_OFX_DESCRIPTORS_CACHE_VERSION) || (natronVersion != NATRON_VERSION_ENCODED) ||
+         (this->searchPath != searchPath) ) {
+        return false;
+    }
+
+    std::set<std::string> found;
+    findBundles(searchPath, &found);
+    if ( found.size() != bundles.size() ) {
+        return false;
+    }
+    for (std::set<std::string>::iterator it = found.begin(); it != found.end(); ++it) {
+        std::map<std::string,OfxBundleStamp>::iterator stamp = bundles.find(*it);
+        if ( stamp == bundles.end() ) {
+            return false;
+        }
+        if ( !( OfxBundleStamp(stamp->first, stamp->second.binaryPath) == stamp->second ) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+OfxDescriptorsCache::write(const QString & filePath) const
+{
+    QDir().mkpath( QFileInfo(filePath).absolutePath() );
+
+    QString tmpFilePath = filePath + '.' + QString::number( QCoreApplication::applicationPid() );
+    {
+        std::ofstream ofile(tmpFilePath.toStdString().c_str(), std::ios::out | std::ios::binary);
+        if ( !ofile.is_open() ) {
+            return;
+        }
+        try {
+            boost::archive::binary_oarchive oArchive(ofile);
+            oArchive << *this;
+        } catch (...) {
+            ofile.close();
+            QFile::remove(tmpFilePath);
+
+            return;
+        }
+    }
+    QFile::remove(filePath);
+    if ( !QFile::rename(tmpFilePath, filePath) ) {
+        QFile::remove(tmpFilePath);
+    }
+}
@@ -0,0 +1,162 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_OFXDESCRIPTORSCACHE_H_
+#define NATRON_ENGINE_OFXDESCRIPTORSCACHE_H_
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifndef Q_MOC_RUN
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/list.hpp>
+#include <boost/serialization/map.hpp>
+#endif
+
+#include <QtCore/QString>
+
+#include "Global/Macros.h"
+
+///Bump when the content of the descriptors cache changes
+#define NATRON_OFX_DESCRIPTORS_CACHE_VERSION 2
+
+///The registration data of an OFX plug-in, everything loadOFXPlugins needs without loading its binary
+struct OfxPluginDescription
+{
+    std::string openfxId;
+    std::string pluginLabel;
+    std::vector<std::string> groups;
+    std::string iconFilename;
+    std::string groupIconFilename;
+    bool isReader;
+    bool isWriter;
+    bool isRenderUnsafe;
+    int majorVersion;
+    int minorVersion;
+    std::vector<std::string> formats; //< lower case, from kTuttleOfxImageEffectPropSupportedExtensions
+    double evaluation;
+
+    OfxPluginDescription()
+    : openfxId()
+    , pluginLabel()
+    , groups()
+    , iconFilename()
+    , groupIconFilename()
+    , isReader(false)
+    , isWriter(false)
+    , isRenderUnsafe(false)
+    , majorVersion(0)
+    , minorVersion(0)
+    , formats()
+    , evaluation(0.)
+    {
+    }
+
+    template<class Archive>
+    void serialize(Archive & ar,
+                   const unsigned int /*version*/)
+    {
+        ar & openfxId & pluginLabel & groups & iconFilename & groupIconFilename;
+        ar & isReader & isWriter & isRenderUnsafe & majorVersion & minorVersion;
+        ar & formats & evaluation;
+    }
+};
+
+///Identifies the state on disk of a plug-in bundle: if any of these changes, the bundle must be described again.
+///Installing a binary for another architecture changes the Contents directory, replacing the binary by
+///renaming a new one over it changes the Contents/<arch> directory.
+struct OfxBundleStamp
+{
+    std::string binaryPath; //< empty if no plug-in of the bundle could be loaded
+    qint64 bundleModificationTime;
+    qint64 contentsModificationTime;
+    qint64 archModificationTime; //< of the directory of the binary
+    qint64 binaryModificationTime;
+    qint64 binarySize;
+
+    OfxBundleStamp()
+    : binaryPath()
+    , bundleModificationTime(0)
+    , contentsModificationTime(0)
+    , archModificationTime(0)
+    , binaryModificationTime(0)
+    , binarySize(0)
+    {
+    }
+
+    ///Stamps the bundle as it currently is on disk
+    OfxBundleStamp(const std::string & bundlePath,
+                   const std::string & binary);
+
+    bool operator==(const OfxBundleStamp & other) const
+    {
+        return binaryPath == other.binaryPath && bundleModificationTime == other.bundleModificationTime &&
+               contentsModificationTime == other.contentsModificationTime && archModificationTime == other.archModificationTime &&
+               binaryModificationTime == other.binaryModificationTime && binarySize == other.binarySize;
+    }
+
+    template<class Archive>
+    void serialize(Archive & ar,
+                   const unsigned int /*version*/)
+    {
+        ar & binaryPath & bundleModificationTime & contentsModificationTime & archModificationTime;
+        ar & binaryModificationTime & binarySize;
+    }
+};
+
+/**
+ * @brief The content of OFXDescriptorsCache.bin: the plug-ins found in the search path, so that they can be registered
+ * at startup without going through the HostSupport XML cache nor opening their binaries.
+ **/
+struct OfxDescriptorsCache
+{
+    int cacheVersion;
+    int natronVersion;
+    std::list<std::string> searchPath; //< the plug-ins search path the bundles were found in, in order
+    std::map<std::string,OfxBundleStamp> bundles; //< every bundle found in the search path
+    std::vector<OfxPluginDescription> plugins; //< in the order they are registered
+
+    OfxDescriptorsCache()
+    : cacheVersion(NATRON_OFX_DESCRIPTORS_CACHE_VERSION)
+    , natronVersion(NATRON_VERSION_ENCODED)
+    , searchPath()
+    , bundles()
+    , plugins()
+    {
+    }
+
+    template<class Archive>
+    void serialize(Archive & ar,
+                   const unsigned int /*version*/)
+    {
+        ar & cacheVersion & natronVersion & searchPath & bundles & plugins;
+    }
+
+    /**
+     * @brief Memory-maps the cache file and reads it. Returns true if it was read and still describes the bundles
+     * found in searchPath, i.e: it was written by this version of Natron for this search path and none of the bundles
+     * was added, removed or changed on disk since.
+     **/
+    bool read(const QString & filePath,const std::list<std::string> & searchPath);
+
+    /**
+     * @brief Writes the cache to a temporary file renamed over filePath, so that another process starting meanwhile
+     * never reads a partially written cache.
+     **/
+    void write(const QString & filePath) const;
+
+    /**
+     * @brief Finds the plug-in bundles of the search path the way HostSupport scans the plug-ins directories, without
+     * opening them.
+     **/
+    static void findBundles(const std::list<std::string> & searchPath,std::set<std::string>* bundles);
+};
+
+#endif // NATRON_ENGINE_OFXDESCRIPTORSCACHE_H_
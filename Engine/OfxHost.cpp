@@ -16,18 +16,22 @@
 #include <cctype> // tolower
 #include <algorithm> // transform
 #include <string>
+#include <vector>
 CLANG_DIAG_OFF(deprecated-register) //'register' storage class specifier is deprecated
 #include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
 #include <QtCore/QMutex>
 #include <QtCore/QThreadPool>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
 CLANG_DIAG_ON(deprecated-register)
+#include <QtConcurrentMap>
+#include <boost/bind.hpp>
 #ifdef OFX_SUPPORTS_MULTITHREAD
 #include <QtCore/QThread>
 #include <QtCore/QThreadStorage>
-#include <QtConcurrentMap>
-#include <boost/bind.hpp>
 #endif
 
 //ofx
@@ -52,9 +56,11 @@ CLANG_DIAG_ON(deprecated-register)
 
 #include "Engine/AppManager.h"
 #include "Engine/OfxMemory.h"
+#include "Engine/OfxDescriptorsCache.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/OfxImageEffectInstance.h"
+#include "Engine/OfxWorkerPool.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/Plugin.h"
 #include "Engine/StandardPaths.h"
@@ -63,22 +69,129 @@ CLANG_DIAG_ON(deprecated-register)
 
 using namespace Natron;
 
+namespace {
+static QString
+getDescriptorsCacheFilePath()
+{
+    return Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache) + QDir::separator() + "OFXDescriptorsCache.bin";
+}
+
+///Describes the plug-in from what HostSupport read in the XML cache or from its binary
+static OfxPluginDescription
+describePlugin(OFX::Host::ImageEffect::ImageEffectPlugin* p)
+{
+    OfxPluginDescription d;
+
+    d.openfxId = p->getIdentifier();
+    const std::string & grouping = p->getDescriptor().getPluginGrouping();
+    assert( p->getBinary() );
+    const std::string & bundlePath = p->getBinary()->getBundlePath();
+    d.pluginLabel = OfxEffectInstance::makePluginLabel( p->getDescriptor().getShortLabel(),
+                                                        p->getDescriptor().getLabel(),
+                                                        p->getDescriptor().getLongLabel() );
+
+    QStringList groups = OfxEffectInstance::makePluginGrouping(p->getIdentifier(),
+                                                               p->getVersionMajor(), p->getVersionMinor(),
+                                                               d.pluginLabel, grouping);
+
+    QString iconFilename = QString( bundlePath.c_str() ) + "/Contents/Resources/";
+    std::string pngIcon;
+    try {
+        // kOfxPropIcon is normally only defined for parameter desctriptors
+        // (see <http://openfx.sourceforge.net/Documentation/1.3/ofxProgrammingReference.html#ParameterProperties>)
+        // but let's assume it may also be defained on the plugin descriptor.
+        pngIcon = p->getDescriptor().getProps().getStringProperty(kOfxPropIcon, 1); // dimension 1 is PNG icon
+    } catch (OFX::Host::Property::Exception) {
+    }
+    if (pngIcon.empty()) {
+        // no icon defined by kOfxPropIcon, use the default value
+        pngIcon = d.openfxId + ".png";
+    }
+    iconFilename.append( pngIcon.c_str() );
+    d.iconFilename = iconFilename.toStdString();
+    if (groups.size() > 0) {
+        QString groupIconFilename = QString( bundlePath.c_str() ) + "/Contents/Resources/";
+        // the plugin grouping has no descriptor, just try the default filename.
+        groupIconFilename.append(groups[0]);
+        groupIconFilename.append(".png");
+        d.groupIconFilename = groupIconFilename.toStdString();
+    } else {
+        //Use default Misc group when the plug-in doesn't belong to a group
+        groups.push_back(PLUGIN_GROUP_DEFAULT);
+    }
+    for (int i = 0; i < groups.size(); ++i) {
+        d.groups.push_back( groups[i].toStdString() );
+    }
+
+    const std::set<std::string> & contexts = p->getContexts();
+    d.isReader = contexts.find(kOfxImageEffectContextReader) != contexts.end();
+    d.isWriter = contexts.find(kOfxImageEffectContextWriter) != contexts.end();
+    d.isRenderUnsafe = p->getDescriptor().getRenderThreadSafety() == kOfxImageEffectRenderUnsafe;
+    d.majorVersion = p->getVersionMajor();
+    d.minorVersion = p->getVersionMinor();
+
+    ///if this plugin's descriptor has the kTuttleOfxImageEffectPropSupportedExtensions property,
+    ///use it to fill the readersMap and writersMap
+    int formatsCount = p->getDescriptor().getProps().getDimension(kTuttleOfxImageEffectPropSupportedExtensions);
+    d.formats.resize(formatsCount);
+    for (int k = 0; k < formatsCount; ++k) {
+        d.formats[k] = p->getDescriptor().getProps().getStringProperty(kTuttleOfxImageEffectPropSupportedExtensions,k);
+        std::transform(d.formats[k].begin(), d.formats[k].end(), d.formats[k].begin(), ::tolower);
+    }
+
+    d.evaluation = p->getDescriptor().getProps().getDoubleProperty(kTuttleOfxImageEffectPropEvaluation);
+
+    return d;
+}
+
+static void
+addFormats(const OfxPluginDescription & d,
+           std::map<std::string,std::vector< std::pair<std::string,double> > >* formatsMap)
+{
+    for (U32 k = 0; k < d.formats.size(); ++k) {
+        std::map<std::string,std::vector< std::pair<std::string,double> > >::iterator it;
+        it = formatsMap->find(d.formats[k]);
+
+        if ( it != formatsMap->end() ) {
+            it->second.push_back( std::make_pair(d.openfxId, d.evaluation) );
+        } else {
+            std::vector<std::pair<std::string,double> > newVec(1);
+            newVec[0] = std::make_pair(d.openfxId,d.evaluation);
+            formatsMap->insert( std::make_pair(d.formats[k], newVec) );
+        }
+    }
+}
+}
+
 
 Natron::OfxHost::OfxHost()
     : _imageEffectPluginCache( new OFX::Host::ImageEffect::PluginCache(*this) )
+    , _hostSupportCacheLoaded(false)
+    , _hostSupportCacheLock(new QMutex)
 #ifdef MULTI_THREAD_SUITE_USES_THREAD_SAFE_MUTEX_ALLOCATION
     , _pluginsMutexes()
     , _pluginsMutexesLock(new QMutex)
 #endif
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    , _multiThreadPools()
+    , _multiThreadPoolsLock(new QMutex)
+#endif
 {
 }
 
 Natron::OfxHost::~OfxHost()
 {
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    ///Join the multiThread workers before unloading the plug-ins they belong to
+    _multiThreadPools.clear();
+    delete _multiThreadPoolsLock;
+#endif
+    
     //Clean up, to be polite.
     OFX::Host::PluginCache::clearPluginCache();
 
     delete _imageEffectPluginCache;
+    delete _hostSupportCacheLock;
 #ifdef MULTI_THREAD_SUITE_USES_THREAD_SAFE_MUTEX_ALLOCATION
     delete _pluginsMutexesLock;
 #endif
@@ -259,7 +372,9 @@ Natron::OfxHost::getPluginAndContextByID(const std::string & pluginID,
                                          OFX::Host::ImageEffect::ImageEffectPlugin** plugin,
                                          std::string & context)
 {
-    _imageEffectPluginCache->getPluginsByIDMajor();
+    ///The plug-ins may have been registered from the descriptors cache only
+    loadHostSupportCache(false);
+
     // throws out_of_range if the plugin does not exist
     // Note: std::map.at() is C++11
     const std::map<OFX::Host::ImageEffect::MajorPlugin,OFX::Host::ImageEffect::ImageEffectPlugin *> & ofxPlugins =
@@ -361,6 +476,55 @@ Natron::OfxHost::getPluginAndContextByID(const std::string & pluginID,
     }
 } // getPluginAndContextByID
 
+void
+Natron::OfxHost::loadBinaryPlugins(const std::list<OFX::Host::ImageEffect::ImageEffectPlugin*> & plugins)
+{
+    for (std::list<OFX::Host::ImageEffect::ImageEffectPlugin*>::const_iterator it = plugins.begin(); it != plugins.end(); ++it) {
+        try {
+            OFX::Host::ImageEffect::ImageEffectPlugin* plugin = 0;
+            std::string context;
+            ///Loads the binary and runs kOfxActionLoad and the describe action
+            getPluginAndContextByID( (*it)->getIdentifier(), (*it)->getVersionMajor(), (*it)->getVersionMinor(), &plugin, context );
+            ///Runs the describe in context action, this is what createOfxImageEffectInstance will ask for
+            (void)plugin->getContext(context);
+        } catch (...) {
+            ///Reported when the instance is created
+        }
+    }
+}
+
+void
+Natron::OfxHost::loadPluginsConcurrently(const std::set< std::pair<std::string,int> > & plugins)
+{
+    ///Before spawning the threads, so that they do not wait for each other in getPluginAndContextByID
+    loadHostSupportCache(false);
+
+    ///The plug-ins of a bundle share their binary which is not thread-safe, they are loaded by the same thread
+    std::map<std::string, std::list<OFX::Host::ImageEffect::ImageEffectPlugin*> > pluginsByBinary;
+    const std::map<OFX::Host::ImageEffect::MajorPlugin,OFX::Host::ImageEffect::ImageEffectPlugin *> & ofxPlugins =
+    _imageEffectPluginCache->getPluginsByIDMajor();
+
+    for (std::map<OFX::Host::ImageEffect::MajorPlugin,OFX::Host::ImageEffect::ImageEffectPlugin *>::const_iterator it = ofxPlugins.begin();
+         it != ofxPlugins.end(); ++it) {
+        if ( plugins.find( std::make_pair( it->first.getId(), it->first.getMajor() ) ) != plugins.end() ) {
+            pluginsByBinary[it->second->getBinary()->getFilePath()].push_back(it->second);
+        }
+    }
+    if ( pluginsByBinary.empty() ) {
+        return;
+    }
+
+    std::vector< std::list<OFX::Host::ImageEffect::ImageEffectPlugin*> > binaries;
+    for (std::map<std::string, std::list<OFX::Host::ImageEffect::ImageEffectPlugin*> >::iterator it = pluginsByBinary.begin();
+         it != pluginsByBinary.end(); ++it) {
+        binaries.push_back(it->second);
+    }
+    QtConcurrent::map( binaries,
+                       boost::bind(&Natron::OfxHost::loadBinaryPlugins,
+                                   this,
+                                   _1) ).waitForFinished();
+}
+
 AbstractOfxEffectInstance*
 Natron::OfxHost::createOfxEffect(const std::string & name,
                                  boost::shared_ptr<Natron::Node> node,
@@ -439,138 +603,103 @@ Natron::OfxHost::loadOFXPlugins(std::map<std::string,std::vector< std::pair<std:
         }
     }
 
-    /// now read an old cache
-    // The cache location depends on the OS.
-    // On OSX, it will be ~/Library/Caches/<organization>/<application>/OFXCache.xml
-    //on Linux ~/.cache/<organization>/<application>/OFXCache.xml
-    //on windows:
-    QString ofxcachename = Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache) + QDir::separator() + "OFXCache.xml";
-    std::ifstream ifs( ofxcachename.toStdString().c_str() );
-    if ( ifs.is_open() ) {
-        OFX::Host::PluginCache::getPluginCache()->readCache(ifs);
-        ifs.close();
-    }
-    OFX::Host::PluginCache::getPluginCache()->scanPluginFiles();
-
-    // write the cache NOW (it won't change anyway)
-    /// flush out the current cache
-    writeOFXCache();
-
-    /*Filling node name list and plugin grouping*/
-    typedef std::map<OFX::Host::ImageEffect::MajorPlugin,OFX::Host::ImageEffect::ImageEffectPlugin *> PMap;
-    const PMap& ofxPlugins =
-    _imageEffectPluginCache->getPluginsByIDMajor();
-    
-    
-    for (PMap::const_iterator it = ofxPlugins.begin();
-         it != ofxPlugins.end(); ++it) {
-        OFX::Host::ImageEffect::ImageEffectPlugin* p = it->second;
-        assert(p);
-        if (p->getContexts().size() == 0) {
-            continue;
+    ///Register the plug-ins from the descriptors cache if nothing changed on disk since it was written: HostSupport
+    ///and the binaries are left alone until a plug-in is instantiated
+    const std::list<std::string> & searchPath = OFX::Host::PluginCache::getPluginCache()->getPluginPath();
+    OfxDescriptorsCache cache;
+    if ( !cache.read(getDescriptorsCacheFilePath(), searchPath) ) {
+        cache = OfxDescriptorsCache();
+        cache.searchPath = searchPath;
+
+        loadHostSupportCache(true);
+
+        /*Filling node name list and plugin grouping*/
+        typedef std::map<OFX::Host::ImageEffect::MajorPlugin,OFX::Host::ImageEffect::ImageEffectPlugin *> PMap;
+        const PMap& ofxPlugins =
+        _imageEffectPluginCache->getPluginsByIDMajor();
+
+        std::set<std::string> bundles;
+        OfxDescriptorsCache::findBundles(searchPath, &bundles);
+        for (std::set<std::string>::iterator it = bundles.begin(); it != bundles.end(); ++it) {
+            cache.bundles[*it] = OfxBundleStamp( *it, std::string() );
         }
 
-        std::string openfxId = p->getIdentifier();
-        const std::string & grouping = p->getDescriptor().getPluginGrouping();
-        const std::string & bundlePath = p->getBinary()->getBundlePath();
-        std::string pluginLabel = OfxEffectInstance::makePluginLabel( p->getDescriptor().getShortLabel(),
-                                                                      p->getDescriptor().getLabel(),
-                                                                      p->getDescriptor().getLongLabel() );
-        
-        QStringList groups = OfxEffectInstance::makePluginGrouping(p->getIdentifier(),
-                                                                   p->getVersionMajor(), p->getVersionMinor(),
-                                                                   pluginLabel, grouping);
+        for (PMap::const_iterator it = ofxPlugins.begin();
+             it != ofxPlugins.end(); ++it) {
+            OFX::Host::ImageEffect::ImageEffectPlugin* p = it->second;
+            assert(p);
+            if (p->getContexts().size() == 0) {
+                continue;
+            }
+            cache.plugins.push_back( describePlugin(p) );
 
-        assert( p->getBinary() );
-        QString iconFilename = QString( bundlePath.c_str() ) + "/Contents/Resources/";
-        std::string pngIcon;
-        try {
-            // kOfxPropIcon is normally only defined for parameter desctriptors
-            // (see <http://openfx.sourceforge.net/Documentation/1.3/ofxProgrammingReference.html#ParameterProperties>)
-            // but let's assume it may also be defained on the plugin descriptor.
-            pngIcon = p->getDescriptor().getProps().getStringProperty(kOfxPropIcon, 1); // dimension 1 is PNG icon
-        } catch (OFX::Host::Property::Exception) {
+            const std::string & bundlePath = p->getBinary()->getBundlePath();
+            cache.bundles[bundlePath] = OfxBundleStamp( bundlePath, p->getBinary()->getFilePath() );
         }
-        if (pngIcon.empty()) {
-            // no icon defined by kOfxPropIcon, use the default value
-            pngIcon = openfxId + ".png";
-        }
-        iconFilename.append( pngIcon.c_str() );
-        QString groupIconFilename;
-        if (groups.size() > 0) {
-            groupIconFilename = QString( p->getBinary()->getBundlePath().c_str() ) + "/Contents/Resources/";
-            // the plugin grouping has no descriptor, just try the default filename.
-            groupIconFilename.append(groups[0]);
-            groupIconFilename.append(".png");
-        } else {
-            //Use default Misc group when the plug-in doesn't belong to a group
-            groups.push_back(PLUGIN_GROUP_DEFAULT);
+        cache.write( getDescriptorsCacheFilePath() );
+    }
+
+    for (U32 i = 0; i < cache.plugins.size(); ++i) {
+        const OfxPluginDescription & d = cache.plugins[i];
+        QStringList groups;
+        for (U32 g = 0; g < d.groups.size(); ++g) {
+            groups.push_back( d.groups[g].c_str() );
         }
 
-        
-        const std::set<std::string> & contexts = p->getContexts();
-        std::set<std::string>::const_iterator foundReader = contexts.find(kOfxImageEffectContextReader);
-        std::set<std::string>::const_iterator foundWriter = contexts.find(kOfxImageEffectContextWriter);
-        
         appPTR->registerPlugin( groups,
-                                openfxId.c_str(),
-                                pluginLabel.c_str(),
-                                iconFilename,
-                                groupIconFilename,
-                                p->getIdentifier().c_str(),
-                                foundReader != contexts.end(),
-                                foundWriter != contexts.end(),
+                                d.openfxId.c_str(),
+                                d.pluginLabel.c_str(),
+                                d.iconFilename.c_str(),
+                                d.groupIconFilename.c_str(),
+                                d.openfxId.c_str(),
+                                d.isReader,
+                                d.isWriter,
                                 new Natron::LibraryBinary(Natron::LibraryBinary::eLibraryTypeBuiltin),
-                                p->getDescriptor().getRenderThreadSafety() == kOfxImageEffectRenderUnsafe,
-                                p->getVersionMajor(), p->getVersionMinor() );
-
+                                d.isRenderUnsafe,
+                                d.majorVersion, d.minorVersion );
 
-        ///if this plugin's descriptor has the kTuttleOfxImageEffectPropSupportedExtensions property,
-        ///use it to fill the readersMap and writersMap
-        int formatsCount = p->getDescriptor().getProps().getDimension(kTuttleOfxImageEffectPropSupportedExtensions);
-        std::vector<std::string> formats(formatsCount);
-        for (int k = 0; k < formatsCount; ++k) {
-            formats[k] = p->getDescriptor().getProps().getStringProperty(kTuttleOfxImageEffectPropSupportedExtensions,k);
-            std::transform(formats[k].begin(), formats[k].end(), formats[k].begin(), ::tolower);
-        }
-
-        double evaluation = p->getDescriptor().getProps().getDoubleProperty(kTuttleOfxImageEffectPropEvaluation);
-        
-        
-
-
-        if ( ( foundReader != contexts.end() ) && (formatsCount > 0) && readersMap ) {
+        if ( d.isReader && !d.formats.empty() && readersMap ) {
             ///we're safe to assume that this plugin is a reader
-            for (U32 k = 0; k < formats.size(); ++k) {
-                std::map<std::string,std::vector< std::pair<std::string,double> > >::iterator it;
-                it = readersMap->find(formats[k]);
-
-                if ( it != readersMap->end() ) {
-                    it->second.push_back(std::make_pair(openfxId, evaluation));
-                } else {
-                    std::vector<std::pair<std::string,double> > newVec(1);
-                    newVec[0] = std::make_pair(openfxId,evaluation);
-                    readersMap->insert( std::make_pair(formats[k], newVec) );
-                }
-            }
-        } else if ( ( foundWriter != contexts.end() ) && (formatsCount > 0) && writersMap ) {
+            addFormats(d, readersMap);
+        } else if ( d.isWriter && !d.formats.empty() && writersMap ) {
             ///we're safe to assume that this plugin is a writer.
-            for (U32 k = 0; k < formats.size(); ++k) {
-                std::map<std::string,std::vector< std::pair<std::string,double> > >::iterator it;
-                it = writersMap->find(formats[k]);
-
-                if ( it != writersMap->end() ) {
-                    it->second.push_back(std::make_pair(openfxId, evaluation));
-                } else {
-                    std::vector<std::pair<std::string,double> > newVec(1);
-                    newVec[0] = std::make_pair(openfxId,evaluation);
-                    writersMap->insert( std::make_pair(formats[k], newVec) );
-                }
-            }
+            addFormats(d, writersMap);
         }
     }
 } // loadOFXPlugins
 
+void
+Natron::OfxHost::loadHostSupportCache(bool writeCache)
+{
+    QMutexLocker l(_hostSupportCacheLock);
+
+    if (_hostSupportCacheLoaded) {
+        return;
+    }
+    _hostSupportCacheLoaded = true;
+
+    /// now read an old cache
+    // The cache location depends on the OS.
+    // On OSX, it will be ~/Library/Caches/<organization>/<application>/OFXCache.xml
+    //on Linux ~/.cache/<organization>/<application>/OFXCache.xml
+    //on windows:
+    QString ofxcachename = Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache) + QDir::separator() + "OFXCache.xml";
+    std::ifstream ifs( ofxcachename.toStdString().c_str() );
+    if ( ifs.is_open() ) {
+        OFX::Host::PluginCache::getPluginCache()->readCache(ifs);
+        ifs.close();
+    } else {
+        ///Every plug-in was just described from its binary
+        writeCache = true;
+    }
+    OFX::Host::PluginCache::getPluginCache()->scanPluginFiles();
+
+    if (writeCache) {
+        /// flush out the current cache
+        writeOFXCache();
+    }
+}
+
 void
 Natron::OfxHost::writeOFXCache()
 {
@@ -599,6 +728,9 @@ Natron::OfxHost::clearPluginsLoadedCache()
     if ( QFile::exists(ofxcachename) ) {
         QFile::remove(ofxcachename);
     }
+    if ( QFile::exists( getDescriptorsCacheFilePath() ) ) {
+        QFile::remove( getDescriptorsCacheFilePath() );
+    }
 }
 
 void
@@ -661,16 +793,24 @@ Natron::OfxHost::newMemoryInstance(size_t nBytes)
 ///Stored as int, because we need -1; list because we need it recursive for the multiThread func
 static QThreadStorage<std::list<int> > gThreadIndex;
 
+///The plug-ins whose actions are being called by the current thread, the back is the one calling multiThread
+static QThreadStorage<std::list<OFX::Host::ImageEffect::ImageEffectPlugin*> > gActionCallerPlugin;
+
 
 void
-Natron::OfxHost::setThreadAsActionCaller(bool actionCaller)
+Natron::OfxHost::setThreadAsActionCaller(OFX::Host::ImageEffect::ImageEffectPlugin* plugin,
+                                         bool actionCaller)
 {
     if (actionCaller) {
         gThreadIndex.localData().push_back(-1);
+        gActionCallerPlugin.localData().push_back(plugin);
     } else {
         std::list<int>& local = gThreadIndex.localData();
         assert(!local.empty());
         local.pop_back();
+        std::list<OFX::Host::ImageEffect::ImageEffectPlugin*>& localPlugin = gActionCallerPlugin.localData();
+        assert(!localPlugin.empty());
+        localPlugin.pop_back();
     }
 }
 
@@ -706,52 +846,21 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
     return ret;
 }
 
-    
 
-    
-class OfxThread
-    : public QThread
+///Used by the OfxWorkerPool: same as threadFunctionWrapper but the worker is also accounted in the running threads,
+///as a freshly spawned thread would be.
+static OfxStatus
+workerFunctionWrapper(OfxThreadFunctionV1 func,
+                      unsigned int threadIndex,
+                      unsigned int threadMax,
+                      void *customArg)
 {
-public:
-    OfxThread(OfxThreadFunctionV1 func,
-              unsigned int threadIndex,
-              unsigned int threadMax,
-              void *customArg,
-              OfxStatus *stat)
-        : _func(func)
-          , _threadIndex(threadIndex)
-          , _threadMax(threadMax)
-          , _customArg(customArg)
-          , _stat(stat)
-    {
-    }
+    appPTR->fetchAndAddNRunningThreads(1);
+    OfxStatus ret = threadFunctionWrapper(func, threadIndex, threadMax, customArg);
+    appPTR->fetchAndAddNRunningThreads(-1);
 
-    void run() OVERRIDE
-    {
-        assert(_threadIndex < _threadMax);
-        std::list<int>& localData = gThreadIndex.localData();
-        localData.push_back((int)_threadIndex);
-        
-        assert(*_stat == kOfxStatFailed);
-        try {
-            _func(_threadIndex, _threadMax, _customArg);
-            *_stat = kOfxStatOK;
-        } catch (const std::bad_alloc & ba) {
-            *_stat = kOfxStatErrMemory;
-        } catch (...) {
-        }
-
-        ///reset back the index otherwise it could mess up the indexes if the same thread is re-used
-        localData.pop_back();
-    }
-
-private:
-    OfxThreadFunctionV1 *_func;
-    unsigned int _threadIndex;
-    unsigned int _threadMax;
-    void *_customArg;
-    OfxStatus *_stat;
-};
+    return ret;
+}
 
 }
 
@@ -819,50 +928,37 @@ Natron::OfxHost::multiThread(OfxThreadFunctionV1 func,
         }
 
     } else {
-        QVector<OfxStatus> status(nThreads); // vector for the return status of each thread
-        status.fill(kOfxStatFailed); // by default, a thread fails
-        {
-            // at most maxConcurrentThread should be running at the same time
-            QVector<OfxThread*> threads(nThreads);
+        
+        ///This function cannot be called recursively: if it is anyway from one of the workers, running on the
+        ///workers of the same pool could dead-lock, just run the function in this thread.
+        if ( multiThreadIsSpawnedThread() ) {
             for (unsigned int i = 0; i < nThreads; ++i) {
-                threads[i] = new OfxThread(func, i, nThreads, customArg, &status[i]);
-            }
-            unsigned int i = 0; // index of next thread to launch
-            unsigned int running = 0; // number of running threads
-            unsigned int j = 0; // index of first running thread. all threads before this one are finished running
-            while (j < nThreads) {
-                // have no more than maxConcurrentThread threads launched at the same time
-                int threadsStarted = 0;
-                while (i < nThreads && running < maxConcurrentThread) {
-                    threads[i]->start();
-                    ++i;
-                    ++running;
-                    ++threadsStarted;
+                OfxStatus stat = threadFunctionWrapper(func, i, nThreads, customArg);
+                if (stat != kOfxStatOK) {
+                    return stat;
                 }
-                
-                ///We just started threadsStarted threads
-                appPTR->fetchAndAddNRunningThreads(threadsStarted);
-                
-                // now we've got at most maxConcurrentThread running. wait for each thread and launch a new one
-                threads[j]->wait();
-                assert( !threads[j]->isRunning() );
-                assert( threads[j]->isFinished() );
-                delete threads[j];
-                ++j;
-                --running;
-                
-                ///We just stopped 1 thread
-                appPTR->fetchAndAddNRunningThreads(-1);
             }
-            assert(running == 0);
+            return kOfxStatOK;
         }
-        // check the return status of each thread, return the first error found
-        for (QVector<OfxStatus>::const_iterator it = status.begin(); it != status.end(); ++it) {
-            OfxStatus stat = *it;
-            if (stat != kOfxStatOK) {
-                return stat;
+        
+        OFX::Host::ImageEffect::ImageEffectPlugin* plugin = 0;
+        if ( gActionCallerPlugin.hasLocalData() && !gActionCallerPlugin.localData().empty() ) {
+            plugin = gActionCallerPlugin.localData().back();
+        }
+        
+        ///Threads of a pool are never shared with another plug-in, @see OfxWorkerPool
+        boost::shared_ptr<OfxWorkerPool> pool;
+        {
+            QMutexLocker l(_multiThreadPoolsLock);
+            boost::shared_ptr<OfxWorkerPool>& found = _multiThreadPools[plugin];
+            if (!found) {
+                found.reset( new OfxWorkerPool( workerFunctionWrapper, std::max(1, appPTR->getHardwareIdealThreadCount()) ) );
             }
+            pool = found;
         }
+        
+        // at most maxConcurrentThread should be running at the same time
+        return pool->dispatch(func, nThreads, maxConcurrentThread, customArg);
     } // useThreadPool
 
     return kOfxStatOK;
@@ -12,6 +12,9 @@
 #define NATRON_ENGINE_OFXHOST_H_
 
 #include <list>
+#include <map>
+#include <set>
+#include <string>
 #ifndef Q_MOC_RUN
 #include <boost/shared_ptr.hpp>
 #endif
@@ -34,6 +37,7 @@ class KnobSerialization;
 namespace Natron {
 class Node;
 class Plugin;
+class OfxWorkerPool;
 class OfxHost
     : public OFX::Host::ImageEffect::Host
 {
@@ -111,24 +115,53 @@ public:
 
     void addPathToLoadOFXPlugins(const std::string path);
 
-    /*Reads OFX plugin cache and scan plugins directories
-       to load them all.*/
+    /**
+     * @brief Registers the OFX plug-ins found in the search paths.
+     * The registration data of the plug-ins is kept in a binary cache, memory-mapped at startup and validated against the
+     * path, modification time and size of the bundles found in the search paths. While it is valid, neither the
+     * HostSupport XML cache is parsed nor any plug-in binary is opened: this is deferred until a plug-in is first
+     * instantiated. Otherwise the plug-ins are scanned through HostSupport and both caches are rewritten.
+     **/
     void loadOFXPlugins(std::map<std::string,std::vector< std::pair<std::string,double> > >* readersMap,
                         std::map<std::string,std::vector< std::pair<std::string,double> > >* writersMap);
 
     void clearPluginsLoadedCache();
 
-    void setThreadAsActionCaller(bool actionCaller);
+    /**
+     * @brief Loads the binaries of the given plug-ins (identifier and major version) and runs their describe actions
+     * concurrently, one binary per thread of the global thread pool, so that creating their first instance afterwards
+     * does not pay for it. Returns once they are all loaded. Plug-ins that fail to load are skipped: the error is
+     * reported when an instance is created.
+     **/
+    void loadPluginsConcurrently(const std::set< std::pair<std::string,int> > & plugins);
+
+    /**
+     * @brief Flags the current thread as calling an action of the given plug-in, so that multiThread knows on behalf
+     * of which plug-in it is called.
+     **/
+    void setThreadAsActionCaller(OFX::Host::ImageEffect::ImageEffectPlugin* plugin,bool actionCaller);
 private:
 
     void getPluginAndContextByID(const std::string & pluginID, int major, int minor,
                                  OFX::Host::ImageEffect::ImageEffectPlugin** plugin,std::string & context);
 
+    /**
+     * @brief Reads the HostSupport XML cache and scans the plug-ins directories if not done yet, which loads the
+     * binaries of the plug-ins missing from the XML cache. Thread-safe.
+     * @param writeCache If true the XML cache is rewritten, it is otherwise only written if it did not exist.
+     **/
+    void loadHostSupportCache(bool writeCache);
+
+    ///Loads and describes in their context the plug-ins of a single binary, in order
+    void loadBinaryPlugins(const std::list<OFX::Host::ImageEffect::ImageEffectPlugin*> & plugins);
+
     /*Writes all plugins loaded and their descriptors to
        the OFX plugin cache. (called by the destructor) */
     void writeOFXCache();
 
     OFX::Host::ImageEffect::PluginCache* _imageEffectPluginCache;
+    bool _hostSupportCacheLoaded; //< true once loadHostSupportCache ran
+    QMutex* _hostSupportCacheLock; //< protects _hostSupportCacheLoaded
 
 
     /*plugin name -> pair< plugin id , plugin grouping >
@@ -157,6 +190,12 @@ private:
     std::list<QMutex*> _pluginsMutexes;
     QMutex* _pluginsMutexesLock; //<protects _pluginsMutexes
 #endif
+    
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    ///The worker threads of multiThread when not using the global thread pool, one pool per plug-in
+    std::map<OFX::Host::ImageEffect::ImageEffectPlugin*,boost::shared_ptr<OfxWorkerPool> > _multiThreadPools;
+    QMutex* _multiThreadPoolsLock; //< protects _multiThreadPools
+#endif
 };
 } // namespace Natron
 
@@ -58,16 +58,19 @@ OfxImageEffectInstance::~OfxImageEffectInstance()
 
 class ThreadIsActionCaller_RAII
 {
+    OFX::Host::ImageEffect::ImageEffectPlugin* _plugin;
+    
 public:
     
-    ThreadIsActionCaller_RAII()
+    ThreadIsActionCaller_RAII(OFX::Host::ImageEffect::ImageEffectPlugin* plugin)
+    : _plugin(plugin)
     {
-        appPTR->setThreadAsActionCaller(true);
+        appPTR->setThreadAsActionCaller(_plugin, true);
     }
     
     ~ThreadIsActionCaller_RAII()
     {
-        appPTR->setThreadAsActionCaller(false);
+        appPTR->setThreadAsActionCaller(_plugin, false);
     }
 };
 
@@ -77,7 +80,7 @@ OfxImageEffectInstance::mainEntry(const char *action,
                                   OFX::Host::Property::Set *inArgs,
                                   OFX::Host::Property::Set *outArgs)
 {
-    ThreadIsActionCaller_RAII t;
+    ThreadIsActionCaller_RAII t( getPlugin() );
     return OFX::Host::ImageEffect::Instance::mainEntry(action, handle, inArgs, outArgs);
 }
 
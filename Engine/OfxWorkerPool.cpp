@@ -0,0 +1,345 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "OfxWorkerPool.h"
+
+#include <cassert>
+#include <list>
+#include <vector>
+#include <algorithm>
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QThread>
+
+using namespace Natron;
+
+namespace {
+///A multiThread call being served by the pool
+struct OfxWorkerPoolJob
+{
+    OfxThreadFunctionV1* func;
+    unsigned int nThreads;
+    unsigned int maxConcurrentThreads;
+    void* customArg;
+    unsigned int nextIndex; //< the next thread index to hand out to a worker
+    unsigned int nRunning; //< number of thread indexes being run by the workers
+    unsigned int nFinished; //< number of thread indexes done
+    OfxStatus status; //< the first error encountered
+    QWaitCondition doneCond; //< woken up when nFinished == nThreads
+
+    OfxWorkerPoolJob(OfxThreadFunctionV1 func,
+                     unsigned int nThreads,
+                     unsigned int maxConcurrentThreads,
+                     void* customArg)
+    : func(func)
+    , nThreads(nThreads)
+    , maxConcurrentThreads(maxConcurrentThreads)
+    , customArg(customArg)
+    , nextIndex(0)
+    , nRunning(0)
+    , nFinished(0)
+    , status(kOfxStatOK)
+    , doneCond()
+    {
+    }
+};
+
+///A thread of the pool
+struct OfxWorker
+{
+    QThread* thread;
+    OfxWorkerPoolJob* assignedJob; //< if not NULL, the worker runs the thread indexes of this job before any other
+    bool idle; //< true while in OfxWorkerPoolPrivate::idleWorkers
+    bool woken; //< true once started or woken up by wakeIdleWorker, until it looks for a thread index
+    QWaitCondition wakeCond;
+
+    OfxWorker()
+    : thread(0)
+    , assignedJob(0)
+    , idle(false)
+    , woken(false)
+    , wakeCond()
+    {
+    }
+};
+}
+
+struct Natron::OfxWorkerPoolPrivate
+{
+    OfxWorkerPool::ThreadFunctionWrapper wrapper;
+    int maxThreads;
+    mutable QMutex lock; //< protects all the fields below and those of the jobs and workers
+    std::list<OfxWorkerPoolJob*> jobs; //< jobs which still have thread indexes to hand out
+    std::vector<OfxWorker*> workers;
+    std::list<OfxWorker*> idleWorkers; //< waiting for a job
+    bool mustQuit;
+
+    OfxWorkerPoolPrivate(OfxWorkerPool::ThreadFunctionWrapper wrapper,
+                         int maxThreads)
+    : wrapper(wrapper)
+    , maxThreads( std::max(1, maxThreads) )
+    , lock()
+    , jobs()
+    , workers()
+    , idleWorkers()
+    , mustQuit(false)
+    {
+    }
+
+    ///Hands out the next thread index of job, within its concurrency limit
+    bool takeJobThreadIndex(OfxWorkerPoolJob* job,
+                            unsigned int* index)
+    {
+        ///Private, shouldn't lock
+        assert( !lock.tryLock() );
+        if ( (job->nextIndex == job->nThreads) || (job->nRunning >= job->maxConcurrentThreads) ) {
+            return false;
+        }
+        *index = job->nextIndex;
+        ++job->nextIndex;
+        ++job->nRunning;
+        if (job->nextIndex == job->nThreads) {
+            jobs.remove(job);
+        }
+
+        return true;
+    }
+
+    ///Hands out the next thread index of the first job that can run one more
+    OfxWorkerPoolJob* takeThreadIndex(unsigned int* index)
+    {
+        ///Private, shouldn't lock
+        assert( !lock.tryLock() );
+        for (std::list<OfxWorkerPoolJob*>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+            OfxWorkerPoolJob* job = *it;
+            if ( takeJobThreadIndex(job, index) ) {
+                return job;
+            }
+        }
+
+        return 0;
+    }
+
+    void finishThreadIndex(OfxWorkerPoolJob* job,
+                           OfxStatus stat)
+    {
+        ///Private, shouldn't lock
+        assert( !lock.tryLock() );
+        if ( (stat != kOfxStatOK) && (job->status == kOfxStatOK) ) {
+            job->status = stat;
+        }
+        --job->nRunning;
+        ++job->nFinished;
+        if (job->nFinished == job->nThreads) {
+            job->doneCond.wakeAll();
+        }
+    }
+
+    ///Starts a new worker, which runs the thread indexes of assignedJob first if not NULL
+    void startWorker(OfxWorkerPoolJob* assignedJob);
+
+    ///Wakes up an idle worker, assigning it job if not NULL. Returns false if no worker is idle.
+    bool wakeIdleWorker(OfxWorkerPoolJob* job)
+    {
+        ///Private, shouldn't lock
+        assert( !lock.tryLock() );
+        if ( idleWorkers.empty() ) {
+            return false;
+        }
+        OfxWorker* worker = idleWorkers.front();
+        idleWorkers.pop_front();
+        worker->idle = false;
+        worker->woken = true;
+        worker->assignedJob = job;
+        worker->wakeCond.wakeOne();
+
+        return true;
+    }
+
+    ///Assigns job to a worker which was started or woken up without a job and did not look for a thread index yet.
+    ///Returns false if there is no such worker.
+    bool assignWokenWorker(OfxWorkerPoolJob* job)
+    {
+        ///Private, shouldn't lock
+        assert( !lock.tryLock() );
+        for (std::vector<OfxWorker*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+            if ( (*it)->woken && !(*it)->assignedJob ) {
+                (*it)->assignedJob = job;
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void workerLoop(OfxWorker* self)
+    {
+        QMutexLocker l(&lock);
+        for (;;) {
+            unsigned int index;
+            OfxWorkerPoolJob* job = 0;
+            self->woken = false;
+            if (self->assignedJob) {
+                if ( takeJobThreadIndex(self->assignedJob, &index) ) {
+                    job = self->assignedJob;
+                } else {
+                    self->assignedJob = 0;
+                }
+            }
+            if (!job) {
+                job = takeThreadIndex(&index);
+            }
+            if (!job) {
+                if (mustQuit) {
+                    return;
+                }
+                self->idle = true;
+                idleWorkers.push_back(self);
+                self->wakeCond.wait(&lock);
+                if (self->idle) {
+                    ///Not woken up by wakeIdleWorker
+                    idleWorkers.remove(self);
+                    self->idle = false;
+                }
+                continue;
+            }
+
+            l.unlock();
+            OfxStatus stat = wrapper(job->func, index, job->nThreads, job->customArg);
+            l.relock();
+
+            finishThreadIndex(job, stat);
+        }
+    }
+};
+
+namespace {
+class OfxWorkerThread
+    : public QThread
+{
+    OfxWorkerPoolPrivate* _pool;
+    OfxWorker* _worker;
+
+public:
+
+    OfxWorkerThread(OfxWorkerPoolPrivate* pool,
+                    OfxWorker* worker)
+    : QThread()
+    , _pool(pool)
+    , _worker(worker)
+    {
+        setObjectName("OfxWorkerThread");
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        _pool->workerLoop(_worker);
+    }
+};
+}
+
+void
+OfxWorkerPoolPrivate::startWorker(OfxWorkerPoolJob* assignedJob)
+{
+    ///Private, shouldn't lock
+    assert( !lock.tryLock() );
+
+    OfxWorker* worker = new OfxWorker;
+    worker->assignedJob = assignedJob;
+    worker->woken = true;
+    worker->thread = new OfxWorkerThread(this, worker);
+    workers.push_back(worker);
+    worker->thread->start();
+}
+
+OfxWorkerPool::OfxWorkerPool(ThreadFunctionWrapper wrapper,
+                             int maxThreads)
+: _imp( new OfxWorkerPoolPrivate(wrapper, maxThreads) )
+{
+}
+
+OfxWorkerPool::~OfxWorkerPool()
+{
+    std::vector<OfxWorker*> workers;
+    {
+        QMutexLocker l(&_imp->lock);
+        assert( _imp->jobs.empty() );
+        _imp->mustQuit = true;
+        for (std::vector<OfxWorker*>::iterator it = _imp->workers.begin(); it != _imp->workers.end(); ++it) {
+            (*it)->wakeCond.wakeOne();
+        }
+        workers = _imp->workers;
+    }
+    for (std::vector<OfxWorker*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+        (*it)->thread->wait();
+        delete (*it)->thread;
+        delete *it;
+    }
+}
+
+OfxStatus
+OfxWorkerPool::dispatch(OfxThreadFunctionV1 func,
+                        unsigned int nThreads,
+                        unsigned int maxConcurrentThreads,
+                        void *customArg)
+{
+    if (nThreads == 0) {
+        return kOfxStatOK;
+    }
+    maxConcurrentThreads = std::max(1u, maxConcurrentThreads);
+
+    OfxWorkerPoolJob job(func, nThreads, maxConcurrentThreads, customArg);
+
+    QMutexLocker l(&_imp->lock);
+    _imp->jobs.push_back(&job);
+
+    ///The first worker is assigned the job so that it does not take the thread indexes of the jobs queued before.
+    ///If no worker is idle nor about to look for a job, they may all be blocked in the jobs of other callers on a resource
+    ///that this caller holds (e.g: a mutex of the plug-in): start one more worker for this job even if the pool already
+    ///has maxThreads workers, otherwise the job could never start.
+    if ( !_imp->wakeIdleWorker(&job) && !_imp->assignWokenWorker(&job) ) {
+        _imp->startWorker(&job);
+    }
+
+    ///Then make sure there are enough idle workers to run the job at its concurrency, within the limit of the pool
+    ///Workers started or woken up without a job will look for one anyway.
+    int nWanted = (int)std::min(nThreads, maxConcurrentThreads) - 1;
+    for (std::vector<OfxWorker*>::iterator it = _imp->workers.begin(); it != _imp->workers.end(); ++it) {
+        if ( (*it)->woken && !(*it)->assignedJob ) {
+            --nWanted;
+        }
+    }
+    while ( nWanted > 0 && _imp->wakeIdleWorker(0) ) {
+        --nWanted;
+    }
+    int nToStart = std::min( nWanted, _imp->maxThreads - (int)_imp->workers.size() );
+    for (int i = 0; i < nToStart; ++i) {
+        _imp->startWorker(0);
+    }
+
+    while (job.nFinished < job.nThreads) {
+        job.doneCond.wait(&_imp->lock);
+    }
+    assert( std::find(_imp->jobs.begin(), _imp->jobs.end(), &job) == _imp->jobs.end() );
+
+    ///A worker woken up for the job may not have run yet
+    for (std::vector<OfxWorker*>::iterator it = _imp->workers.begin(); it != _imp->workers.end(); ++it) {
+        if ( (*it)->assignedJob == &job ) {
+            (*it)->assignedJob = 0;
+        }
+    }
+
+    return job.status;
+}
+
+int
+OfxWorkerPool::getNWorkers() const
+{
+    QMutexLocker l(&_imp->lock);
+
+    return (int)_imp->workers.size();
+}
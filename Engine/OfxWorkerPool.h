@@ -0,0 +1,73 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_OFXWORKERPOOL_H_
+#define NATRON_ENGINE_OFXWORKERPOOL_H_
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#endif
+
+#include "Global/Macros.h"
+CLANG_DIAG_OFF(unknown-pragmas)
+#include <ofxCore.h>
+#include <ofxMultiThread.h>
+CLANG_DIAG_ON(unknown-pragmas)
+
+namespace Natron {
+/**
+ * @brief A set of long-lived worker threads serving the multiThread function of the OpenFX multi-thread suite
+ * on behalf of a single plug-in.
+ * Using QtConcurrent doesn't work with The Foundry Furnace plug-ins because they keep an internal thread-local state
+ * that becomes dirty if a thread of the global thread-pool is re-used by another plug-in. Instead of creating fresh threads
+ * for each multiThread call, each plug-in gets its own pool whose threads are never shared with any other plug-in, which
+ * keeps their thread-local state isolated while avoiding a thread creation per call.
+ * The pool grows on demand up to maxThreads workers which live until the pool is destroyed, plus the workers started for
+ * the calls that found all the workers busy, @see dispatch.
+ **/
+struct OfxWorkerPoolPrivate;
+class OfxWorkerPool
+    : public boost::noncopyable
+{
+public:
+
+    /**
+     * @brief The function called by the workers to run one thread index of a multiThread call, typically it sets up
+     * the thread-local index returned by multiThreadIndex and calls func.
+     **/
+    typedef OfxStatus (*ThreadFunctionWrapper)(OfxThreadFunctionV1 func,unsigned int threadIndex,unsigned int threadMax,void *customArg);
+
+    OfxWorkerPool(ThreadFunctionWrapper wrapper,int maxThreads);
+
+    /**
+     * @brief Waits for all the workers to finish and joins them. No dispatch() must be running.
+     **/
+    ~OfxWorkerPool();
+
+    /**
+     * @brief Runs func for the thread indexes 0 to nThreads-1 on the workers, with at most maxConcurrentThreads of them
+     * running at the same time, and returns once they are all done. The calling thread only waits: thread indexes
+     * are only ever run by the threads of the pool.
+     * Several threads may call dispatch() concurrently, the workers are then shared between the calls. Each call has a
+     * worker assigned which runs its thread indexes first: if no worker is idle, one more is started for the call even
+     * beyond maxThreads, so that the call completes even if all the workers are blocked, e.g: on a lock held by the caller.
+     * Returns the first error status returned by the wrapper, or kOfxStatOK.
+     **/
+    OfxStatus dispatch(OfxThreadFunctionV1 func,unsigned int nThreads,unsigned int maxConcurrentThreads,void *customArg);
+
+    /**
+     * @brief Returns the number of worker threads started so far.
+     **/
+    int getNWorkers() const WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<OfxWorkerPoolPrivate> _imp;
+};
+} // namespace Natron
+
+#endif // NATRON_ENGINE_OFXWORKERPOOL_H_
@@ -12,8 +12,14 @@
 #include "OutputSchedulerThread.h"
 
 #include <iostream>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <map>
 #include <set>
 #include <list>
+#include <vector>
+#include <limits>
 #include <QMetaType>
 #include <QMutex>
 #include <QWaitCondition>
@@ -21,20 +27,27 @@
 #include <QString>
 #include <QThreadPool>
 #include <QDebug>
-#include <QtConcurrentRun>
+#include <QtConcurrentMap>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QRunnable>
 
+#include <boost/bind.hpp>
+
 #include "Global/MemoryInfo.h"
 
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
+#include "Engine/BoundedMPMCQueue.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
+#include "Engine/Log.h"
 #include "Engine/Node.h"
+#include "Engine/NUMA.h"
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/Project.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/RenderThreadsController.h"
 #include "Engine/Settings.h"
 #include "Engine/Timer.h"
 #include "Engine/TimeLine.h"
@@ -79,7 +92,8 @@ struct BufferedFrameCompare_less
     }
 };
 
-typedef std::set< BufferedFrame , BufferedFrameCompare_less > FrameBuffer;
+///The frames mapped to their size accounted in bufSizeInRAM when they were buffered: sizeInRAM() may change meanwhile
+typedef std::map< BufferedFrame, std::size_t, BufferedFrameCompare_less > FrameBuffer;
 
 
 namespace {
@@ -125,12 +139,29 @@ struct ProducedFrame
     RequestedFrame* request;
 };
 
+///Priority of the prefetch tasks in the global thread pool: they are queued behind the tiled renders and other concurrent tasks
+#define NATRON_PREFETCH_THREAD_POOL_PRIORITY -1
+
+///How many frames of the work queue can be prefetched ahead of the render threads
+#define NATRON_PREFETCH_MAX_LOOKAHEAD 8
+
+///Cap on the number of frames walked per range returned by getFramesNeeded, to bound effects that ask for their whole input range
+#define NATRON_PREFETCH_MAX_FRAMES_PER_RANGE 16
+
+///Capacity of the work queue of the render threads, frames pushed beyond are kept aside until there is room
+#define NATRON_FRAMES_TO_RENDER_QUEUE_CAPACITY 1024
+
 struct OutputSchedulerThreadPrivate
 {
     
     FrameBuffer buf; //the frames rendered by the worker threads that needs to be rendered in order by the output device
+    std::size_t bufSizeInRAM; //< the sum of the sizes accounted for the frames in buf
+    std::size_t bufMaximumSize; //< in bytes, above this the render threads furthest ahead of the playhead stall
     QWaitCondition bufCondition;
-    mutable QMutex bufMutex;
+    mutable QMutex bufMutex; //< protects buf, bufSizeInRAM & bufMaximumSize
+    QAtomicInt bufOverBudget; //< 1 if bufSizeInRAM >= bufMaximumSize, so that the render threads check it without locking bufMutex
+    std::set<int> droppedFrames; //< frames skipped by real-time playback, discarded if their render completes. Protected by bufMutex
+    QAtomicInt nDroppedFrames; //< droppedFrames.size(), so that frames are pushed to render without locking bufMutex when none was dropped
     
     bool working; // true when the scheduler is currently having render threads doing work
     mutable QMutex workingMutex;
@@ -166,6 +197,10 @@ struct OutputSchedulerThreadPrivate
     
     boost::scoped_ptr<Timer> timer; // Timer regulating the engine execution. It is controlled by the GUI and MT-safe.
     
+    ///Only accessed by the scheduler thread
+    int renderAhead; //< number of frames to render ahead of the playhead during playback, 0 if not set in the preferences
+    int prerollFrames; //< playback starts once that many frames are buffered
+    
     
     ///The idea here is that the render() function will set the requestedRunArgs, and once the scheduler has finished
     ///the previous render it will copy them to the livingRunArgs to fullfil the new render request
@@ -184,10 +219,18 @@ struct OutputSchedulerThreadPrivate
     RenderThreads renderThreads;
     QWaitCondition allRenderThreadsInactiveCond; // wait condition to make sure all render threads are asleep
     QWaitCondition allRenderThreadsQuitCond; //to make sure all render threads have quit
+    RenderThreadsController threadsController; //< decides the number of render threads when it is automatic
     
-    ///Work queue filled by the scheduler thread when in playback/render on disk
-    QMutex framesToRenderMutex; // protects framesToRender & currentFrameRequests
-    std::list<int> framesToRender;
+    ///Work queue filled by the scheduler thread when in playback/render on disk.
+    ///The render threads pop from it without locking as long as the output device keeps up with them,
+    ///framesToRenderMutex serializes the pushes and is where the render threads sleep when there is nothing to render.
+    QMutex framesToRenderMutex; // protects framesToRenderOverflow & lastFramePushedIndex
+    BoundedMPMCQueue<int> framesToRender;
+    
+    ///Frames pushed while framesToRender was full (e.g: the whole frame range of a long render), in order.
+    ///They are moved to framesToRender as the render threads pop frames.
+    std::list<int> framesToRenderOverflow;
+    QAtomicInt nOverflowFrames; //< framesToRenderOverflow.size(), readable without locking
     
     ///index of the last frame pushed (framesToRender.back())
     ///we store this because when we call pushFramesToRender we need to know what was the last frame that was queued
@@ -198,14 +241,25 @@ struct OutputSchedulerThreadPrivate
     QWaitCondition framesToRenderNotEmptyCond;
 
     
+    ///Frames of the work queue whose reads were handed to the prefetcher, erased once a render thread picks them
+    std::set<int> prefetchedFrames;
+    int nPrefetchRunning; //< number of FramePrefetchRunnable queued or running in the global thread pool
+    QWaitCondition prefetchDoneCond;
+    QMutex prefetchMutex; //< protects prefetchedFrames & nPrefetchRunning
+    
     Natron::OutputEffectInstance* outputEffect; //< The effect used as output device
     RenderEngine* engine;
 
     
     OutputSchedulerThreadPrivate(RenderEngine* engine,Natron::OutputEffectInstance* effect,OutputSchedulerThread::ProcessFrameModeEnum mode)
     : buf()
+    , bufSizeInRAM(0)
+    , bufMaximumSize(0)
     , bufCondition()
     , bufMutex()
+    , bufOverBudget(0)
+    , droppedFrames()
+    , nDroppedFrames(0)
     , working(false)
     , workingMutex()
     , hasQuit(false)
@@ -226,6 +280,8 @@ struct OutputSchedulerThreadPrivate
     , processMutex()
     , mode(mode)
     , timer(new Timer)
+    , renderAhead(0)
+    , prerollFrames(0)
     , requestedRunArgs()
     , livingRunArgs()
     , nFramesRendered(0)
@@ -235,10 +291,17 @@ struct OutputSchedulerThreadPrivate
     , renderThreads()
     , allRenderThreadsInactiveCond()
     , allRenderThreadsQuitCond()
+    , threadsController()
     , framesToRenderMutex()
-    , framesToRender()
+    , framesToRender(NATRON_FRAMES_TO_RENDER_QUEUE_CAPACITY)
+    , framesToRenderOverflow()
+    , nOverflowFrames(0)
     , lastFramePushedIndex(0)
     , framesToRenderNotEmptyCond()
+    , prefetchedFrames()
+    , nPrefetchRunning(0)
+    , prefetchDoneCond()
+    , prefetchMutex()
     , outputEffect(effect)
     , engine(engine)
     {
@@ -250,11 +313,21 @@ struct OutputSchedulerThreadPrivate
         ///Private, shouldn't lock
         assert(!bufMutex.tryLock());
         
+        ///The frame was dropped by real-time playback while it was rendering
+        if ( image && droppedFrames.count( (int)time ) ) {
+            return false;
+        }
+        
         BufferedFrame k;
         k.time = time;
         k.view = view;
         k.frame = image;
-        std::pair<FrameBuffer::iterator,bool> ret = buf.insert(k);
+        std::size_t sizeInRAM = image ? image->sizeInRAM() : 0;
+        std::pair<FrameBuffer::iterator,bool> ret = buf.insert( std::make_pair(k, sizeInRAM) );
+        if (ret.second) {
+            bufSizeInRAM += sizeInRAM;
+        }
+        updateBufferOverBudget();
         return ret.second;
     }
     
@@ -264,18 +337,20 @@ struct OutputSchedulerThreadPrivate
         ///Private, shouldn't lock
         assert(!bufMutex.tryLock());
         
-        FrameBuffer newBuf;
-        for (FrameBuffer::iterator it = buf.begin(); it != buf.end(); ++it) {
-            
-            if (it->time == time) {
-                if (it->frame) {
-                    frames.push_back(*it);
-                }
-            } else {
-                newBuf.insert(*it);
+        ///The buffer is sorted by time first: the frames at this time are contiguous, starting from the lowest view
+        BufferedFrame first;
+        first.time = time;
+        first.view = std::numeric_limits<int>::min();
+        FrameBuffer::iterator it = buf.lower_bound(first);
+        while (it != buf.end() && it->first.time == time) {
+            if (it->first.frame) {
+                frames.push_back(it->first);
             }
+            assert(bufSizeInRAM >= it->second);
+            bufSizeInRAM -= it->second;
+            buf.erase(it++);
         }
-        buf = newBuf;
+        updateBufferOverBudget();
     }
     
     void clearBuffer()
@@ -284,6 +359,178 @@ struct OutputSchedulerThreadPrivate
         assert(!bufMutex.tryLock());
         
         buf.clear();
+        droppedFrames.clear();
+        nDroppedFrames.fetchAndStoreRelaxed(0);
+        bufSizeInRAM = 0;
+        updateBufferOverBudget();
+    }
+    
+    bool isFrameBuffered(int time) const
+    {
+        ///Private, shouldn't lock
+        assert(!bufMutex.tryLock());
+        
+        BufferedFrame first;
+        first.time = time;
+        first.view = std::numeric_limits<int>::min();
+        FrameBuffer::const_iterator it = buf.lower_bound(first);
+        for (; it != buf.end() && it->first.time == time; ++it) {
+            if (it->first.frame) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * @brief Returns the number of distinct frames in the buffer, all views counting for one.
+     **/
+    int getNBufferedFrames() const
+    {
+        ///Private, shouldn't lock
+        assert(!bufMutex.tryLock());
+        
+        int n = 0;
+        bool hasLast = false;
+        double lastTime = 0.;
+        for (FrameBuffer::const_iterator it = buf.begin(); it != buf.end(); ++it) {
+            if ( it->first.frame && (!hasLast || it->first.time != lastTime) ) {
+                ++n;
+                hasLast = true;
+                lastTime = it->first.time;
+            }
+        }
+        return n;
+    }
+    
+    /**
+     * @brief Removes the frame from the buffer and discards it if it is still being rendered.
+     **/
+    void dropFrame(int time)
+    {
+        ///Private, shouldn't lock
+        assert(!bufMutex.tryLock());
+        
+        BufferedFrames frames;
+        getFromBufferAndErase(time, frames);
+        droppedFrames.insert(time);
+        nDroppedFrames.fetchAndStoreRelaxed( (int)droppedFrames.size() );
+    }
+    
+    void updateBufferOverBudget()
+    {
+        ///Private, shouldn't lock
+        assert(!bufMutex.tryLock());
+        
+        bufOverBudget.fetchAndStoreRelaxed( (!buf.empty() && bufSizeInRAM >= bufMaximumSize) ? 1 : 0 );
+    }
+    
+    bool isBufferOverBudget() const
+    {
+        return (int)bufOverBudget != 0;
+    }
+    
+    /**
+     * @brief Appends a frame to the work queue, or to the overflow list if the queue is full.
+     **/
+    void pushFrameToRender(int frame)
+    {
+        ///Private, shouldn't lock
+        assert(!framesToRenderMutex.tryLock());
+        
+        ///A frame dropped earlier is needed again, e.g: when looping. Only real-time playback drops frames.
+        if ( (int)nDroppedFrames > 0 ) {
+            QMutexLocker l(&bufMutex);
+            if ( droppedFrames.erase(frame) ) {
+                nDroppedFrames.fetchAndStoreRelaxed( (int)droppedFrames.size() );
+            }
+        }
+        
+        ///Once frames overflowed, the next ones go after them to keep the order
+        if ( framesToRenderOverflow.empty() && framesToRender.tryPush(frame) ) {
+            return;
+        }
+        framesToRenderOverflow.push_back(frame);
+        nOverflowFrames.fetchAndAddRelaxed(1);
+    }
+    
+    /**
+     * @brief Moves as many frames as possible from the overflow list to the work queue.
+     **/
+    void refillFramesToRender()
+    {
+        ///Private, shouldn't lock
+        assert(!framesToRenderMutex.tryLock());
+        
+        while ( !framesToRenderOverflow.empty() && framesToRender.tryPush( framesToRenderOverflow.front() ) ) {
+            framesToRenderOverflow.pop_front();
+            nOverflowFrames.fetchAndAddRelaxed(-1);
+        }
+    }
+    
+    int getNFramesToRender() const
+    {
+        ///Private, shouldn't lock
+        assert(!framesToRenderMutex.tryLock());
+        
+        return framesToRender.size() + (int)framesToRenderOverflow.size();
+    }
+    
+    void clearFramesToRender()
+    {
+        ///Private, shouldn't lock
+        assert(!framesToRenderMutex.tryLock());
+        
+        framesToRender.clear();
+        framesToRenderOverflow.clear();
+        nOverflowFrames = 0;
+    }
+    
+    /**
+     * @brief Returns true if a render thread about to render the given frame should wait for the output device
+     * to catch up: that is when the buffered frames exceed bufMaximumSize and the frame is further ahead of the
+     * playhead than all the frames already buffered, so that the frames the output device needs next are never held back.
+     **/
+    bool isBufferFullForFrame(int frame,int playhead,OutputSchedulerThread::RenderDirectionEnum direction,
+                              int firstFrame,int lastFrame) const WARN_UNUSED_RETURN
+    {
+        ///Private, shouldn't lock
+        assert(!bufMutex.tryLock());
+        
+        if (buf.empty() || bufSizeInRAM < bufMaximumSize) {
+            return false;
+        }
+        int distance = getDistanceAheadOfPlayhead(frame, playhead, direction, firstFrame, lastFrame);
+        for (FrameBuffer::const_iterator it = buf.begin(); it != buf.end(); ++it) {
+            if (it->first.frame && getDistanceAheadOfPlayhead((int)it->first.time, playhead, direction, firstFrame, lastFrame) > distance) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    /**
+     * @brief How many frames the output device has to process, starting at playhead, before processing frame.
+     * When looping, frames behind the playhead are reached after wrapping around the range.
+     **/
+    static int getDistanceAheadOfPlayhead(int frame,int playhead,OutputSchedulerThread::RenderDirectionEnum direction,
+                                          int firstFrame,int lastFrame)
+    {
+        int distance = direction == OutputSchedulerThread::eRenderDirectionForward ? frame - playhead : playhead - frame;
+        if (distance < 0) {
+            distance += std::max(1, lastFrame - firstFrame + 1);
+        }
+        return distance;
+    }
+    
+    /**
+     * @brief The budget of the buffer is the part of the RAM cache dedicated to playback in the preferences.
+     **/
+    static std::size_t getBufferMaximumSizeFromSettings()
+    {
+        boost::shared_ptr<Settings> settings = appPTR->getCurrentSettings();
+        double maxCacheRAM = settings->getRamMaximumPercent() * getSystemTotalRAM_conditionnally();
+        return (std::size_t)(maxCacheRAM * settings->getRamPlaybackMaximumPercent());
     }
     
     void appendRunnable(RenderThreadTask* runnable)
@@ -392,6 +639,29 @@ struct OutputSchedulerThreadPrivate
         allRenderThreadsQuitCond.wakeOne();
     }
     
+    bool isAbortRequested()
+    {
+        QMutexLocker l(&abortedRequestedMutex);
+        return abortRequested > 0;
+    }
+    
+    void notifyPrefetchFinished()
+    {
+        QMutexLocker l(&prefetchMutex);
+        --nPrefetchRunning;
+        assert(nPrefetchRunning >= 0);
+        prefetchDoneCond.wakeAll();
+    }
+    
+    void waitForPrefetchesToBeDone()
+    {
+        QMutexLocker l(&prefetchMutex);
+        while (nPrefetchRunning > 0) {
+            prefetchDoneCond.wait(&prefetchMutex);
+        }
+        prefetchedFrames.clear();
+    }
+    
     void waitForRenderThreadsToQuit() {
     
         RenderThreads threads;
@@ -423,6 +693,7 @@ OutputSchedulerThread::OutputSchedulerThread(RenderEngine* engine,Natron::Output
                      SLOT(doProcessFrameMainThread(BufferedFrames,bool,int)));
     
     QObject::connect(_imp->timer.get(), SIGNAL(fpsChanged(double,double)), _imp->engine, SIGNAL(fpsChanged(double,double)));
+    QObject::connect(_imp->timer.get(), SIGNAL(droppedFramesChanged(int)), _imp->engine, SIGNAL(droppedFramesChanged(int)));
     
     QObject::connect(this, SIGNAL(s_abortRenderingOnMainThread(bool)), this, SLOT(abortRendering(bool)));
     
@@ -437,6 +708,8 @@ OutputSchedulerThread::~OutputSchedulerThread()
 
     ///Make sure they are all gone, there will be a deadlock here if that's not the case.
     _imp->waitForRenderThreadsToQuit();
+    
+    _imp->waitForPrefetchesToBeDone();
 }
 
 
@@ -577,12 +850,12 @@ OutputSchedulerThread::pushFramesToRenderInternal(int startingFrame,int nThreads
     
     
     if (firstFrame == lastFrame) {
-        _imp->framesToRender.push_back(startingFrame);
+        _imp->pushFrameToRender(startingFrame);
         _imp->lastFramePushedIndex = startingFrame;
     } else {
         ///Push 2x the count of threads to be sure no one will be waiting
-        while ((int)_imp->framesToRender.size() < nThreads * 2) {
-            _imp->framesToRender.push_back(startingFrame);
+        while (_imp->getNFramesToRender() < nThreads * 2) {
+            _imp->pushFrameToRender(startingFrame);
             
             _imp->lastFramePushedIndex = startingFrame;
             
@@ -613,17 +886,79 @@ OutputSchedulerThread::pushAllFrameRange()
     
     if (direction == eRenderDirectionForward) {
         for (int i = firstFrame; i <= lastFrame; ++i) {
-            _imp->framesToRender.push_back(i);
+            _imp->pushFrameToRender(i);
         }
     } else {
         for (int i = lastFrame; i >= firstFrame; --i) {
-            _imp->framesToRender.push_back(i);
+            _imp->pushFrameToRender(i);
         }
     }
     ///Wake up render threads to notify them theres work to do
     _imp->framesToRenderNotEmptyCond.wakeAll();
 }
 
+int
+OutputSchedulerThread::skipLateFrames(int expectedTime,
+                                      int framesLate,
+                                      int* nSkipped)
+{
+    *nSkipped = 0;
+    
+    RenderDirectionEnum direction;
+    int firstFrame,lastFrame;
+    {
+        QMutexLocker l(&_imp->runArgsMutex);
+        direction = _imp->livingRunArgs.timelineDirection;
+        firstFrame = _imp->livingRunArgs.firstFrame;
+        lastFrame = _imp->livingRunArgs.lastFrame;
+    }
+    
+    ///Don't wrap around the range more than once
+    framesLate = std::min(framesLate, lastFrame - firstFrame);
+    
+    PlaybackModeEnum pMode = _imp->engine->getPlaybackMode();
+    
+    ///The frames that should have been displayed after expectedTime by now, in display order
+    std::vector<std::pair<int,RenderDirectionEnum> > lateFrames;
+    int frame = expectedTime;
+    RenderDirectionEnum frameDirection = direction;
+    for (int i = 0; i < framesLate; ++i) {
+        if ( !OutputSchedulerThreadPrivate::getNextFrameInSequence(pMode, frameDirection, frame, firstFrame, lastFrame,
+                                                                   &frame, &frameDirection) ) {
+            break;
+        }
+        lateFrames.push_back( std::make_pair(frame, frameDirection) );
+    }
+    
+    int chosen = -1;
+    {
+        QMutexLocker l(&_imp->bufMutex);
+        for (int i = (int)lateFrames.size() - 1; i >= 0; --i) {
+            if ( _imp->isFrameBuffered(lateFrames[i].first) ) {
+                chosen = i;
+                break;
+            }
+        }
+        if (chosen < 0) {
+            return expectedTime;
+        }
+        _imp->dropFrame(expectedTime);
+        for (int i = 0; i < chosen; ++i) {
+            _imp->dropFrame(lateFrames[i].first);
+        }
+    }
+    
+    ///We may have bounced at the end of the range
+    if (lateFrames[chosen].second != direction) {
+        QMutexLocker l(&_imp->runArgsMutex);
+        _imp->livingRunArgs.timelineDirection = lateFrames[chosen].second;
+        _imp->requestedRunArgs.timelineDirection = lateFrames[chosen].second;
+    }
+    
+    *nSkipped = chosen + 1;
+    return lateFrames[chosen].first;
+}
+
 void
 OutputSchedulerThread::pushFramesToRender(int nThreads)
 {
@@ -660,6 +995,20 @@ OutputSchedulerThread::pushFramesToRender(int nThreads)
 int
 OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread)
 {
+    ///Fast path: as long as the output device keeps up with the render threads, pop the next frame without locking anything.
+    ///The thread was rendering the previous frame and stays flagged active.
+    int frame;
+    if ( !thread->mustQuit() && !_imp->isBufferOverBudget() && _imp->framesToRender.tryPop(&frame) ) {
+        ///Refill by batches so that the fast path rarely locks, even when rendering a long range in FFA
+        if ( ( (int)_imp->nOverflowFrames > 0 ) && ( _imp->framesToRender.size() < _imp->framesToRender.capacity() / 2 ) ) {
+            QMutexLocker l(&_imp->framesToRenderMutex);
+            _imp->refillFramesToRender();
+        }
+        thread->notifyIsRunning(true);
+        
+        return frame;
+    }
+    
     ///Flag the thread as inactive
     {
         QMutexLocker l(&_imp->renderThreadsMutex);
@@ -671,43 +1020,75 @@ OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread)
         _imp->allRenderThreadsInactiveCond.wakeOne();
     }
     
-    ///Simple heuristic to limit the size of the internal buffer.
+    ///Limit the size in RAM of the internal buffer.
     ///If the buffer grows too much, we will keep shared ptr to images, hence keep them in RAM which
     ///can lead to RAM issue for the end user.
     ///We can end up in this situation for very simple graphs where the rendering of the output node (the writer or viewer)
     ///is much slower than things upstream, hence the buffer grows quickly, and fills up the RAM.
-    int nbThreadsHardware = appPTR->getHardwareIdealThreadCount();
-    bool bufferFull;
+    ///Only the threads that would render frames further ahead than what is buffered wait, they are woken up
+    ///by pushFramesToRender once the output device has processed a frame.
+    int firstFrame,lastFrame;
+    RenderDirectionEnum direction;
     {
-        QMutexLocker k(&_imp->bufMutex);
-        bufferFull = (int)_imp->buf.size() >= nbThreadsHardware * 3;
+        QMutexLocker k(&_imp->runArgsMutex);
+        firstFrame = _imp->livingRunArgs.firstFrame;
+        lastFrame = _imp->livingRunArgs.lastFrame;
+        direction = _imp->livingRunArgs.timelineDirection;
     }
     
+    ///The pushes are done under framesToRenderMutex: while we hold it the queue can only shrink,
+    ///because of threads taking the fast path.
     QMutexLocker l(&_imp->framesToRenderMutex);
-    while ((bufferFull || _imp->framesToRender.empty()) && !thread->mustQuit() ) {
+    bool hasFrame = false;
+    for (;;) {
+        if ( thread->mustQuit() ) {
+            break;
+        }
+        _imp->refillFramesToRender();
+        
+        if ( !_imp->isBufferOverBudget() ) {
+            if ( _imp->framesToRender.tryPop(&frame) ) {
+                hasFrame = true;
+                break;
+            }
+        } else {
+            std::list<int> front;
+            _imp->framesToRender.peek(1, &front);
+            if ( front.empty() ) {
+                if ( !_imp->framesToRender.isEmpty() ) {
+                    ///The front frame was being popped by another thread, look again
+                    continue;
+                }
+            } else {
+                bool bufferFull;
+                {
+                    int playhead = timelineGetTime();
+                    QMutexLocker k(&_imp->bufMutex);
+                    bufferFull = _imp->isBufferFullForFrame(front.front(), playhead, direction, firstFrame, lastFrame);
+                }
+                if (!bufferFull) {
+                    if ( _imp->framesToRender.tryPop(&frame) ) {
+                        hasFrame = true;
+                        break;
+                    }
+                    continue;
+                }
+            }
+        }
         
         ///Notify that we're no longer doing work
         thread->notifyIsRunning(false);
         
         
         _imp->framesToRenderNotEmptyCond.wait(&_imp->framesToRenderMutex);
-        
-        {
-            QMutexLocker k(&_imp->bufMutex);
-            bufferFull = (int)_imp->buf.size() >= nbThreadsHardware * 3;
-        }
     }
     
    
-    if (!_imp->framesToRender.empty()) {
+    if (hasFrame) {
         
         ///Notify that we're running for good, will do nothing if flagged already running
         thread->notifyIsRunning(true);
         
-        
-        int ret = _imp->framesToRender.front();
-        _imp->framesToRender.pop_front();
-        
         ///Flag the thread as active
         {
             QMutexLocker l(&_imp->renderThreadsMutex);
@@ -716,7 +1097,7 @@ OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread)
             found->active = true;
         }
         
-        return ret;
+        return frame;
     } else {
         // thread is quitting, make sure we notified the application it is no longer running
         thread->notifyIsRunning(false);
@@ -726,6 +1107,199 @@ OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread)
 }
 
 
+/**
+ * @brief Walks the graph upstream of effect at the given time with getFramesNeeded and appends to reads
+ * the readers (and the times) that will be needed to render it.
+ **/
+static void
+collectReadsNeeded(Natron::EffectInstance* effect,
+                   int time,
+                   std::set<std::pair<Natron::EffectInstance*,int> >* visited,
+                   std::list<std::pair<Natron::EffectInstance*,int> >* reads)
+{
+    if ( !visited->insert( std::make_pair(effect, time) ).second ) {
+        return;
+    }
+    if ( effect->isReader() ) {
+        reads->push_back( std::make_pair(effect, time) );
+        return;
+    }
+    
+    EffectInstance::FramesNeededMap framesNeeded = effect->getFramesNeeded_public(time);
+    for (EffectInstance::FramesNeededMap::iterator it = framesNeeded.begin(); it != framesNeeded.end(); ++it) {
+        EffectInstance* input = effect->getInput(it->first);
+        if (!input) {
+            continue;
+        }
+        for (std::vector<RangeD>::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
+            int first = (int)std::ceil(it2->min);
+            int last = std::min( (int)std::floor(it2->max), first + NATRON_PREFETCH_MAX_FRAMES_PER_RANGE - 1 );
+            for (int f = first; f <= last; ++f) {
+                collectReadsNeeded(input, f, visited, reads);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Renders at low priority the reads needed by a frame that is about to be rendered. The images are not kept:
+ * they land in the cache where the render threads will find them.
+ **/
+class FramePrefetchRunnable : public QRunnable
+{
+    OutputSchedulerThread* _scheduler;
+    std::list<Natron::EffectInstance*> _roots;
+    int _time;
+    int _view;
+    unsigned int _mipMapLevel;
+    
+public:
+    
+    FramePrefetchRunnable(OutputSchedulerThread* scheduler,
+                          const std::list<Natron::EffectInstance*>& roots,
+                          int time,
+                          int view,
+                          unsigned int mipMapLevel)
+    : QRunnable()
+    , _scheduler(scheduler)
+    , _roots(roots)
+    , _time(time)
+    , _view(view)
+    , _mipMapLevel(mipMapLevel)
+    {
+    }
+    
+    virtual ~FramePrefetchRunnable()
+    {
+    }
+    
+private:
+    
+    virtual void run() OVERRIDE FINAL
+    {
+        RenderPrioritySetter prioritySetter( _scheduler->getRenderPriority() );
+        try {
+            prefetch();
+        } catch (const std::exception& e) {
+            ///The render thread will hit the same error and report it, prefetching is best effort only
+            std::stringstream ss;
+            ss << "Prefetch of frame " << _time << " failed: " << e.what();
+            Natron::Log::print( ss.str() );
+        }
+        _scheduler->_imp->notifyPrefetchFinished();
+    }
+    
+    void prefetch()
+    {
+        if ( _scheduler->_imp->isAbortRequested() ) {
+            return;
+        }
+        
+        ///Set the render args on the tree for this thread, as the render thread will do for this frame
+        const TimeLine* timeline = _scheduler->_imp->outputEffect->getApp()->getTimeLine().get();
+        std::list<boost::shared_ptr<ParallelRenderArgsSetter> > frameRenderArgs;
+        for (std::list<Natron::EffectInstance*>::iterator it = _roots.begin(); it != _roots.end(); ++it) {
+            frameRenderArgs.push_back( boost::shared_ptr<ParallelRenderArgsSetter>( new ParallelRenderArgsSetter( (*it)->getNode().get(),
+                                                                                                                 _time,
+                                                                                                                 _view,
+                                                                                                                 false, // is this render due to user interaction ?
+                                                                                                                 false, // is this sequential ?
+                                                                                                                 true, // can abort ?
+                                                                                                                 (*it)->getHash(),
+                                                                                                                 false,
+                                                                                                                 timeline) ) );
+        }
+        
+        std::set<std::pair<Natron::EffectInstance*,int> > visited;
+        std::list<std::pair<Natron::EffectInstance*,int> > reads;
+        for (std::list<Natron::EffectInstance*>::iterator it = _roots.begin(); it != _roots.end(); ++it) {
+            collectReadsNeeded(*it, _time, &visited, &reads);
+        }
+        
+        RenderScale scaleOne;
+        scaleOne.x = scaleOne.y = 1.;
+        RenderScale scale;
+        scale.x = scale.y = Natron::Image::getScaleFromMipMapLevel(_mipMapLevel);
+        
+        for (std::list<std::pair<Natron::EffectInstance*,int> >::iterator it = reads.begin(); it != reads.end(); ++it) {
+            if ( _scheduler->_imp->isAbortRequested() ) {
+                return;
+            }
+            Natron::EffectInstance* reader = it->first;
+            U64 readerHash = reader->getHash();
+            RectD rod;
+            bool isProjectFormat;
+            const RenderScale& rodScale = reader->supportsRenderScaleMaybe() == EffectInstance::eSupportsNo ? scaleOne : scale;
+            if (reader->getRegionOfDefinition_public(readerHash, it->second, rodScale, _view, &rod, &isProjectFormat) == eStatusFailed) {
+                continue;
+            }
+            ImageComponentsEnum components;
+            ImageBitDepthEnum imageDepth;
+            reader->getPreferredDepthAndComponents(-1, &components, &imageDepth);
+            RectI renderWindow;
+            rod.toPixelEnclosing(_mipMapLevel, reader->getPreferredAspectRatio(), &renderWindow);
+            
+            ignore_result( reader->renderRoI( EffectInstance::RenderRoIArgs(it->second,
+                                                                            scale,
+                                                                            _mipMapLevel,
+                                                                            _view,
+                                                                            false,
+                                                                            renderWindow,
+                                                                            rod,
+                                                                            components,
+                                                                            imageDepth) ) );
+        }
+    }
+};
+
+void
+OutputSchedulerThread::prefetchUpcomingFrames(int time)
+{
+    std::list<Natron::EffectInstance*> roots;
+    int view;
+    unsigned int mipMapLevel;
+    if ( !getPrefetchArgs(&roots, &view, &mipMapLevel) || roots.empty() ) {
+        return;
+    }
+    
+    ///Look as far ahead in the work queue as there are render threads: those are the frames that will be picked next
+    int lookahead = std::max( 1, std::min(getNRenderThreads(), NATRON_PREFETCH_MAX_LOOKAHEAD) );
+    std::list<int> upcomingFrames;
+    _imp->framesToRender.peek(lookahead, &upcomingFrames);
+    
+    QMutexLocker l(&_imp->prefetchMutex);
+    
+    ///The frame is being rendered now, allow it to be prefetched again if it comes back in the queue (e.g: looping playback)
+    _imp->prefetchedFrames.erase(time);
+    
+    for (std::list<int>::iterator it = upcomingFrames.begin(); it != upcomingFrames.end(); ++it) {
+        if (_imp->nPrefetchRunning >= lookahead) {
+            break;
+        }
+        if ( !_imp->prefetchedFrames.insert(*it).second ) {
+            continue;
+        }
+        ++_imp->nPrefetchRunning;
+        QThreadPool::globalInstance()->start(new FramePrefetchRunnable(this, roots, *it, view, mipMapLevel),
+                                             NATRON_PREFETCH_THREAD_POOL_PRIORITY);
+    }
+}
+
+void
+OutputSchedulerThread::notifyRenderThreadFrameDone(double frameRenderTime)
+{
+    _imp->threadsController.notifyFrameRendered(frameRenderTime);
+}
+
+int
+OutputSchedulerThread::getTilesThreadsPerFrame() const
+{
+    if (appPTR->getCurrentSettings()->getNumberOfParallelRenders() != 0) {
+        return 0;
+    }
+    return _imp->threadsController.getTilesThreadsPerFrame();
+}
+
 void
 OutputSchedulerThread::notifyThreadAboutToQuit(RenderThreadTask* thread)
 {
@@ -742,9 +1316,14 @@ void
 OutputSchedulerThread::startRender()
 {
     
+    bool realTime = false;
+    _imp->renderAhead = 0;
     if ( isFPSRegulationNeeded() ) {
         _imp->timer->playState = ePlayStateRunning;
+        realTime = appPTR->getCurrentSettings()->isRealTimePlaybackEnabled();
+        _imp->renderAhead = appPTR->getCurrentSettings()->getPlaybackRenderAhead();
     }
+    _imp->timer->setRealTime(realTime);
     
     ///We will push frame to renders starting at startingFrame.
     ///They will be in the range determined by firstFrame-lastFrame
@@ -760,6 +1339,16 @@ OutputSchedulerThread::startRender()
         startingFrame = timelineGetTime();
     }
     
+    ///Buffer the render-ahead target before displaying the first frame, but never more than the range
+    _imp->prerollFrames = std::min(_imp->renderAhead, lastFrame - firstFrame + 1);
+    
+    ///The cache settings may have changed since the last render
+    {
+        QMutexLocker l(&_imp->bufMutex);
+        _imp->bufMaximumSize = OutputSchedulerThreadPrivate::getBufferMaximumSizeFromSettings();
+        _imp->updateBufferOverBudget();
+    }
+    
     aboutToStartRender();
     
     ///Flag that we're now doing work
@@ -775,6 +1364,9 @@ OutputSchedulerThread::startRender()
         nThreads = (int)_imp->renderThreads.size();
     }
     
+    ///The throughput of the previous render says nothing about this one
+    _imp->threadsController.reset( nThreads, appPTR->getHardwareIdealThreadCount() );
+    
     ///Start with one thread if it doesn't exist
     if (nThreads == 0) {
         adjustNumberOfThreads(&nThreads);
@@ -810,8 +1402,8 @@ OutputSchedulerThread::startRender()
             }
         }
         
-        ///Push as many frames as there are threads
-        pushFramesToRender(startingFrame,nThreads);
+        ///Push as many frames as there are threads, or enough to reach the render-ahead target
+        pushFramesToRender( startingFrame,std::max(nThreads, (_imp->renderAhead + 1) / 2) );
     }
     
     
@@ -831,6 +1423,9 @@ OutputSchedulerThread::stopRender()
         _imp->waitForRenderThreadsToBeDone();
     }
     
+    ///Prefetches reference the nodes of the tree and may still be running
+    _imp->waitForPrefetchesToBeDone();
+    
     
     ///If the output effect is sequential (only WriteFFMPEG for now)
     Natron::SequentialPreferenceEnum pref = _imp->outputEffect->getSequentialPreference();
@@ -905,6 +1500,9 @@ OutputSchedulerThread::stopRender()
 void
 OutputSchedulerThread::run()
 {
+    ///The frames processed here (e.g: by sequential writers) are rendered with the priority of the scheduler
+    RenderPrioritySetter prioritySetter( getRenderPriority() );
+    
     for (;;) { ///infinite loop
         
         if ( _imp->checkForExit() ) {
@@ -950,6 +1548,29 @@ OutputSchedulerThread::run()
                 
                 int expectedTimeToRender = timelineGetTime();
                 
+                ///Wait for the render-ahead target before starting playback, unless the buffer cannot hold that many frames
+                if (_imp->prerollFrames > 0) {
+                    QMutexLocker l(&_imp->bufMutex);
+                    if ( (_imp->getNBufferedFrames() < _imp->prerollFrames) && !_imp->isBufferOverBudget() ) {
+                        break;
+                    }
+                    _imp->prerollFrames = 0;
+                }
+                
+                ///In real-time playback, if the expected frame is late, catch up with the most recent frame that is ready
+                if ( (_imp->timer->playState == ePlayStateRunning) && _imp->timer->isRealTime() ) {
+                    int framesLate = _imp->timer->getFramesLate();
+                    if (framesLate > 0) {
+                        int nSkipped;
+                        int frame = skipLateFrames(expectedTimeToRender, framesLate, &nSkipped);
+                        if (nSkipped > 0) {
+                            timelineGoTo(frame);
+                            expectedTimeToRender = frame;
+                            _imp->timer->notifyFramesDropped(nSkipped);
+                        }
+                    }
+                }
+                
                 BufferedFrames framesToRender;
                 {
                     QMutexLocker l(&_imp->bufMutex);
@@ -1012,8 +1633,8 @@ OutputSchedulerThread::run()
                         adjustNumberOfThreads(&newNThreads);
                         
                         ///////////
-                        /////Append render requests for the render threads
-                        pushFramesToRender(newNThreads);
+                        /////Append render requests for the render threads, enough to keep the render-ahead target
+                        pushFramesToRender( std::max(newNThreads, (_imp->renderAhead + 1) / 2) );
                     }
                 }
                 
@@ -1101,7 +1722,12 @@ OutputSchedulerThread::run()
                 
                     QMutexLocker bufLocker (&_imp->bufMutex);
                     ///Wait here for more frames to be rendered, we will be woken up once appendToBuffer(...) is called
-                    _imp->bufCondition.wait(&_imp->bufMutex);
+                    if ( (_imp->timer->playState == ePlayStateRunning) && _imp->timer->isRealTime() && (_imp->prerollFrames == 0) ) {
+                        ///Also wake up when the next frame is due, to skip the expected frame if it is still not rendered
+                        _imp->bufCondition.wait( &_imp->bufMutex, std::max(1UL, (unsigned long)(1000. / _imp->timer->getDesiredFrameRate())) );
+                    } else {
+                        _imp->bufCondition.wait(&_imp->bufMutex);
+                    }
             } else {
                 if (blocking) {
                     //Move the timeline to the last rendered frame to keep it in sync with what is displayed
@@ -1132,9 +1758,9 @@ OutputSchedulerThread::adjustNumberOfThreads(int* newNThreads)
     int currentParallelRenders = getNRenderThreads();
     
     if (userSettingParallelThreads == 0) {
-        ///User wants it to be automatically computed, do a simple heuristic: launch as many parallel renders
-        ///as there are cores
-        optimalNThreads = appPTR->getHardwareIdealThreadCount();
+        ///User wants it to be automatically computed: start with as many parallel renders as there are cores
+        ///and back off when the measured throughput shows that the last threads made rendering slower
+        optimalNThreads = _imp->threadsController.getOptimalNThreads(currentParallelRenders);
     } else {
         optimalNThreads = userSettingParallelThreads;
     }
@@ -1326,7 +1952,7 @@ OutputSchedulerThread::abortRendering(bool blocking)
             ///Clear the work queue
             {
                 QMutexLocker framesLocker (&_imp->framesToRenderMutex);
-                _imp->framesToRender.clear();
+                _imp->clearFramesToRender();
             }
             
             
@@ -1640,6 +2266,9 @@ RenderThreadTask::run()
     
     notifyIsRunning(true);
     
+    ///When NUMA-aware rendering is on, spread the render threads across the nodes
+    Natron::NUMA::ThreadNodeSetter numaNodeSetter( Natron::NUMA::getNextRenderThreadNode() );
+    
     for (;;) {
         
         int time = _imp->scheduler->pickFrameToRender(this);
@@ -1648,7 +2277,20 @@ RenderThreadTask::run()
             break;
         }
         
-        renderFrame(time);
+        _imp->scheduler->prefetchUpcomingFrames(time);
+        
+        RenderThreadsController::setCurrentThreadTilesThreads( _imp->scheduler->getTilesThreadsPerFrame() );
+        double frameRenderTime;
+        {
+            RenderQueueTask task( _imp->scheduler->getRenderPriority() );
+            ///Frame boundary: let the more urgent renders (e.g: the user interacting with the viewer) go first
+            appPTR->getRenderQueue()->yieldToHigherPriority();
+            ///The time spent waiting for more urgent renders is not accounted
+            TimeLapse frameTimer;
+            renderFrame(time);
+            frameRenderTime = frameTimer.getTimeSinceCreation();
+        }
+        _imp->scheduler->notifyRenderThreadFrameDone(frameRenderTime);
         
         if ( mustQuit() ) {
             break;
@@ -1741,13 +2383,6 @@ private:
     renderFrame(int time) {
         
         try {
-            ////Writers always render at scale 1.
-            int mipMapLevel = 0;
-            RenderScale scale;
-            scale.x = scale.y = 1.;
-            
-            RectD rod;
-            bool isProjectFormat;
             int viewsCount = _imp->output->getApp()->getProject()->getProjectViewsCount();
             
             
@@ -1792,50 +2427,57 @@ private:
             
             const double par = activeInputToRender->getPreferredAspectRatio();
             
+            std::vector<int> viewsToRender;
             for (int i = 0; i < viewsCount; ++i) {
                 if ( canOnlyHandleOneView && (i != mainView) ) {
                     ///@see the warning in EffectInstance::evaluate
                     continue;
                 }
+                viewsToRender.push_back(i);
+            }
+            
+            ///Views of the same frame are independent: render them concurrently, each in its own task. Upstream results that
+            ///do not depend on the view share the same hash and are thus computed once and shared through the cache.
+            ///If the plug-in is eRenderSafetyFullySafeFrame it already slices up the render window among the threads of the global pool,
+            ///and if it is eRenderSafetyUnsafe all renders are serialized by the plug-in mutex anyway: in both cases render serially.
+            EffectInstance::RenderSafetyEnum safety = activeInputToRender->renderThreadSafety();
+            bool renderViewsInParallel = viewsToRender.size() > 1 &&
+                                         safety != EffectInstance::eRenderSafetyFullySafeFrame &&
+                                         safety != EffectInstance::eRenderSafetyUnsafe &&
+                                         QThreadPool::globalInstance()->activeThreadCount() < QThreadPool::globalInstance()->maxThreadCount();
+            
+            if (!renderViewsInParallel) {
+                for (std::vector<int>::iterator it = viewsToRender.begin(); it != viewsToRender.end(); ++it) {
+                    boost::shared_ptr<Natron::Image> img;
+                    if (renderView(activeInputToRender, activeInputToRenderHash, time, *it, par, canOnlyHandleOneView, &img) == eStatusFailed) {
+                        break;
+                    }
+                    notifyViewRendered(time, *it, viewsCount, renderDirectly, img);
+                }
+            } else {
+                QFuture<ViewRenderResult> ret = QtConcurrent::mapped(viewsToRender,
+                                                                     boost::bind(&DefaultRenderFrameRunnable::renderViewFunctor,
+                                                                                 this,
+                                                                                 activeInputToRender,
+                                                                                 activeInputToRenderHash,
+                                                                                 time,
+                                                                                 par,
+                                                                                 canOnlyHandleOneView,
+                                                                                 RenderQueue::getCurrentThreadPriority(),
+                                                                                 _1));
+                ret.waitForFinished();
                 
-                StatusEnum stat = activeInputToRender->getRegionOfDefinition_public(activeInputToRenderHash,time, scale, i, &rod, &isProjectFormat);
-                if (stat != eStatusFailed) {
-                    ImageComponentsEnum components;
-                    ImageBitDepthEnum imageDepth;
-                    activeInputToRender->getPreferredDepthAndComponents(-1, &components, &imageDepth);
-                    RectI renderWindow;
-                    rod.toPixelEnclosing(scale, par, &renderWindow);
-                    
-                    ParallelRenderArgsSetter frameRenderARgs(activeInputToRender->getNode().get(),
-                                                                   time,
-                                                                   i,
-                                                                   false,  // is this render due to user interaction ?
-                                                                   canOnlyHandleOneView, // is this sequential ?
-                                                                   true,
-                                                                   activeInputToRenderHash,
-                                                                   false,
-                                                                   _imp->output->getApp()->getTimeLine().get());
-                    
-                    boost::shared_ptr<Natron::Image> img =
-                    activeInputToRender->renderRoI( EffectInstance::RenderRoIArgs(time, //< the time at which to render
-                                                                                  scale, //< the scale at which to render
-                                                                                  mipMapLevel, //< the mipmap level (redundant with the scale)
-                                                                                  i, //< the view to render
-                                                                                  false,
-                                                                                  renderWindow, //< the region of interest (in pixel coordinates)
-                                                                                  rod, // < any precomputed rod ? in canonical coordinates
-                                                                                  components,
-                                                                                  imageDepth));
-                    
-                    ///If we need sequential rendering, pass the image to the output scheduler that will ensure the sequential ordering
-                    if (!renderDirectly) {
-                        _imp->scheduler->appendToBuffer(time, i, boost::dynamic_pointer_cast<BufferableObject>(img));
-                    } else {
-                        _imp->scheduler->notifyFrameRendered(time,i,viewsCount,eSchedulingPolicyFFA);
+                ///Notify in view order so that the scheduler sees the same sequence as with the serial loop above:
+                ///the frame only counts as rendered once its last view is done.
+                for (QFuture<ViewRenderResult>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
+                    if (!it->errorMessage.empty()) {
+                        _imp->scheduler->notifyRenderFailure(it->errorMessage);
+                        break;
                     }
-                    
-                } else {
-                    break;
+                    if (it->stat == eStatusFailed) {
+                        break;
+                    }
+                    notifyViewRendered(time, it->view, viewsCount, renderDirectly, it->image);
                 }
             }
             
@@ -1843,6 +2485,166 @@ private:
             _imp->scheduler->notifyRenderFailure(std::string("Error while rendering: ") + e.what());
         }
     }
+    
+    struct ViewRenderResult
+    {
+        int view;
+        Natron::StatusEnum stat;
+        boost::shared_ptr<Natron::Image> image;
+        std::string errorMessage;
+        
+        ViewRenderResult()
+        : view(0)
+        , stat(Natron::eStatusOK)
+        , image()
+        , errorMessage()
+        {
+        }
+    };
+    
+    /**
+     * @brief Renders the given view of the frame at the given time with activeInputToRender. This may be called concurrently
+     * for different views of the same frame, the render args being set per thread.
+     **/
+    Natron::StatusEnum
+    renderView(EffectInstance* activeInputToRender,
+               U64 activeInputToRenderHash,
+               int time,
+               int view,
+               double par,
+               bool canOnlyHandleOneView,
+               boost::shared_ptr<Natron::Image>* img)
+    {
+        ////Writers always render at scale 1.
+        int mipMapLevel = 0;
+        RenderScale scale;
+        scale.x = scale.y = 1.;
+        
+        RectD rod;
+        bool isProjectFormat;
+        
+        StatusEnum stat = activeInputToRender->getRegionOfDefinition_public(activeInputToRenderHash,time, scale, view, &rod, &isProjectFormat);
+        if (stat == eStatusFailed) {
+            return stat;
+        }
+        ImageComponentsEnum components;
+        ImageBitDepthEnum imageDepth;
+        activeInputToRender->getPreferredDepthAndComponents(-1, &components, &imageDepth);
+        RectI renderWindow;
+        rod.toPixelEnclosing(scale, par, &renderWindow);
+        
+        ParallelRenderArgsSetter frameRenderARgs(activeInputToRender->getNode().get(),
+                                                 time,
+                                                 view,
+                                                 false,  // is this render due to user interaction ?
+                                                 canOnlyHandleOneView, // is this sequential ?
+                                                 true,
+                                                 activeInputToRenderHash,
+                                                 false,
+                                                 _imp->output->getApp()->getTimeLine().get());
+        
+        ///A writer that renders directly and supports tiles writes the scanlines of the render window it is given:
+        ///stream the frame to it in bands so that only one band (and what upstream needs for it) is in memory at a time
+        int bandHeight = 0;
+        if ( (activeInputToRender == _imp->output) && activeInputToRender->supportsTiles() ) {
+            bandHeight = appPTR->getCurrentSettings()->getWritersBandHeight();
+        }
+        ///Start from the top of the image, which is the order in which most file formats store their scanlines
+        std::vector<RectI> bands = RectI::splitRectIntoBands(renderWindow, bandHeight);
+        if (bands.size() <= 1) {
+            *img = activeInputToRender->renderRoI( EffectInstance::RenderRoIArgs(time, //< the time at which to render
+                                                                                 scale, //< the scale at which to render
+                                                                                 mipMapLevel, //< the mipmap level (redundant with the scale)
+                                                                                 view, //< the view to render
+                                                                                 false,
+                                                                                 renderWindow, //< the region of interest (in pixel coordinates)
+                                                                                 rod, // < any precomputed rod ? in canonical coordinates
+                                                                                 components,
+                                                                                 imageDepth));
+            return stat;
+        }
+        
+        ///All the bands belong to the same frame: a writer that is not sequential must open it once before the first band and
+        ///close it once after the last one, otherwise each band would be written to a new file overwriting the previous one.
+        ///Sequential writers were already begun for the whole sequence by the scheduler.
+        bool beginFrame = activeInputToRender->getSequentialPreference() == eSequentialPreferenceNotSequential;
+        if (beginFrame) {
+            if (activeInputToRender->beginSequenceRender_public(time, time, 1, !appPTR->isBackground(), scale, false, false, view) == eStatusFailed) {
+                return eStatusFailed;
+            }
+            activeInputToRender->setSequenceRenderBegunByCaller(true);
+        }
+        ///Do not let the upstream nodes allocate their whole region of definition in the cache for each band
+        activeInputToRender->getNode()->setStreamingBands(true);
+        for (std::vector<RectI>::iterator it = bands.begin(); it != bands.end(); ++it) {
+            ///The band is released as soon as the writer is done with it
+            boost::shared_ptr<Natron::Image> bandImage =
+                activeInputToRender->renderRoI( EffectInstance::RenderRoIArgs(time,
+                                                                              scale,
+                                                                              mipMapLevel,
+                                                                              view,
+                                                                              false,
+                                                                              *it,
+                                                                              rod,
+                                                                              components,
+                                                                              imageDepth) );
+            if (!bandImage) {
+                ///The frame was only partially written
+                if ( !activeInputToRender->aborted() ) {
+                    stat = eStatusFailed;
+                }
+                break;
+            }
+        }
+        activeInputToRender->getNode()->setStreamingBands(false);
+        if (beginFrame) {
+            activeInputToRender->setSequenceRenderBegunByCaller(false);
+            if (activeInputToRender->endSequenceRender_public(time, time, time, false, scale, false, false, view) == eStatusFailed) {
+                stat = eStatusFailed;
+            }
+        }
+        ///The writer already consumed the frame, there is no image to hand over
+        img->reset();
+        return stat;
+    }
+    
+    ///Called by QtConcurrent::mapped: exceptions cannot be propagated through QFuture so they are reported in the result.
+    ViewRenderResult
+    renderViewFunctor(EffectInstance* activeInputToRender,
+                      U64 activeInputToRenderHash,
+                      int time,
+                      double par,
+                      bool canOnlyHandleOneView,
+                      Natron::RenderPriorityEnum priority,
+                      int view)
+    {
+        ///The pool thread renders on behalf of the frame's thread, it must step aside for the same renders
+        RenderPrioritySetter prioritySetter(priority);
+        ViewRenderResult ret;
+        ret.view = view;
+        try {
+            ret.stat = renderView(activeInputToRender, activeInputToRenderHash, time, view, par, canOnlyHandleOneView, &ret.image);
+        } catch (const std::exception& e) {
+            ret.stat = eStatusFailed;
+            ret.errorMessage = std::string("Error while rendering: ") + e.what();
+        }
+        return ret;
+    }
+    
+    void
+    notifyViewRendered(int time,
+                       int view,
+                       int viewsCount,
+                       bool renderDirectly,
+                       const boost::shared_ptr<Natron::Image>& img)
+    {
+        ///If we need sequential rendering, pass the image to the output scheduler that will ensure the sequential ordering
+        if (!renderDirectly) {
+            _imp->scheduler->appendToBuffer(time, view, boost::dynamic_pointer_cast<BufferableObject>(img));
+        } else {
+            _imp->scheduler->notifyFrameRendered(time,view,viewsCount,eSchedulingPolicyFFA);
+        }
+    }
 };
 
 RenderThreadTask*
@@ -2006,6 +2808,16 @@ DefaultScheduler::onRenderStopped()
     }
 }
 
+bool
+DefaultScheduler::getPrefetchArgs(std::list<Natron::EffectInstance*>* roots,int* view,unsigned int* mipMapLevel) const
+{
+    ///Writers always render at scale 1.
+    *mipMapLevel = 0;
+    *view = _effect->getApp()->getMainView();
+    roots->push_back(_effect);
+    return true;
+}
+
 ////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
 //////////////////////// ViewerDisplayScheduler ////////////
@@ -2193,6 +3005,30 @@ ViewerDisplayScheduler::getLastRenderedTime() const
     return _viewer->getLastRenderedTime();
 }
 
+bool
+ViewerDisplayScheduler::getPrefetchArgs(std::list<Natron::EffectInstance*>* roots,int* view,unsigned int* mipMapLevel) const
+{
+    ///Same mipmap level as the one computed in ViewerInstance::getRenderViewerArgsAndCheckCache
+    *mipMapLevel = (unsigned int)std::max( _viewer->getMipMapLevel(), _viewer->getMipMapLevelFromZoomFactor() );
+    *view = _viewer->getCurrentView();
+    
+    int activeInputs[2];
+    _viewer->getActiveInputs(activeInputs[0], activeInputs[1]);
+    for (int i = 0; i < 2; ++i) {
+        if (activeInputs[i] == -1 || (i == 1 && activeInputs[1] == activeInputs[0])) {
+            continue;
+        }
+        EffectInstance* input = _viewer->getInput(activeInputs[i]);
+        if (input) {
+            input = input->getNearestNonDisabled();
+        }
+        if (input) {
+            roots->push_back(input);
+        }
+    }
+    return true;
+}
+
 
 ////////////////////////// RenderEngine
 
@@ -2489,10 +3325,12 @@ struct CurrentFrameFunctorArgs
     RequestedFrame* request;
     ViewerCurrentFrameRequestSchedulerPrivate* scheduler;
     boost::shared_ptr<ViewerInstance::ViewerArgs> args[2];
+    boost::shared_ptr<TimeLapse> requestTimer; //< started when the render was requested, to account for the time spent queued
 };
 
 static void renderCurrentFrameFunctor(CurrentFrameFunctorArgs& args)
 {
+    RenderQueueTask task(eRenderPriorityInteractive, args.requestTimer ? args.requestTimer->getTimeSinceCreation() : 0.);
     
     ///The viewer always uses the scheduler thread to regulate the output rate, @see ViewerInstance::renderViewer_internal
     ///it calls appendToBuffer by itself
@@ -2529,6 +3367,34 @@ static void renderCurrentFrameFunctor(CurrentFrameFunctorArgs& args)
     
 }
 
+/**
+ * @brief Same as QtConcurrent::run(renderCurrentFrameFunctor,args) except that the task is queued ahead of the
+ * playback and background renders in the global thread pool.
+ **/
+class RenderCurrentFrameRunnable : public QRunnable
+{
+    CurrentFrameFunctorArgs _args;
+    
+public:
+    
+    RenderCurrentFrameRunnable(const CurrentFrameFunctorArgs& args)
+    : QRunnable()
+    , _args(args)
+    {
+    }
+    
+    virtual ~RenderCurrentFrameRunnable()
+    {
+    }
+    
+private:
+    
+    virtual void run() OVERRIDE FINAL
+    {
+        renderCurrentFrameFunctor(_args);
+    }
+};
+
 ViewerCurrentFrameRequestScheduler::ViewerCurrentFrameRequestScheduler(ViewerInstance* viewer)
 : QThread()
 , _imp(new ViewerCurrentFrameRequestSchedulerPrivate(viewer))
@@ -2769,6 +3635,7 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool canAbort)
         functorArgs.viewerHash = viewerHash;
         functorArgs.scheduler = _imp.get();
         functorArgs.request = 0;
+        functorArgs.requestTimer.reset(new TimeLapse);
         if (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) {
             renderCurrentFrameFunctor(functorArgs);
         } else {
@@ -2785,7 +3652,8 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool canAbort)
                 }
             }
             functorArgs.request = request;
-            QtConcurrent::run(renderCurrentFrameFunctor,functorArgs);
+            QThreadPool::globalInstance()->start(new RenderCurrentFrameRunnable(functorArgs),
+                                                 RenderQueue::getThreadPoolPriority(eRenderPriorityInteractive));
         }
     }
 }
@@ -15,6 +15,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #endif
+#include <list>
 #include <QThread>
 
 #include "Global/GlobalDefines.h"
@@ -360,10 +361,42 @@ protected:
      **/
     virtual void onRenderStopped() {}
     
+    /**
+     * @brief Must return the nodes from which the graph is walked (with getFramesNeeded) to prefetch the reads needed by the frames
+     * about to be rendered, as well as the view and mipmap level at which they will be rendered.
+     * Returns false if the output device does not want its inputs to be prefetched.
+     **/
+    virtual bool getPrefetchArgs(std::list<Natron::EffectInstance*>* /*roots*/,int* /*view*/,unsigned int* /*mipMapLevel*/) const { return false; }
+    
+    /**
+     * @brief Must return the priority class of the renders launched by this scheduler, @see RenderQueue
+     **/
+    virtual Natron::RenderPriorityEnum getRenderPriority() const = 0;
+    
     RenderEngine* getEngine() const;
     
 private:
     
+    friend class FramePrefetchRunnable;
+    
+    /**
+     * @brief Called by render-threads once they picked a frame: launches at low priority on the global thread pool the reads
+     * needed by the next frames in the work queue, so that their I/O overlaps with the render of the current frames.
+     **/
+    void prefetchUpcomingFrames(int time);
+    
+    /**
+     * @brief Called by render-threads when they are done with a frame, to measure the throughput of the render.
+     * @param frameRenderTime The wall time spent rendering the frame, in seconds
+     **/
+    void notifyRenderThreadFrameDone(double frameRenderTime);
+    
+    /**
+     * @brief Returns the number of threads each frame may use to render its tiles, 0 if unconstrained.
+     * @see RenderThreadsController::getTilesThreadsPerFrame
+     **/
+    int getTilesThreadsPerFrame() const WARN_UNUSED_RETURN;
+    
     virtual void run() OVERRIDE FINAL;
     
     /**
@@ -383,7 +416,16 @@ private:
     void pushAllFrameRange();
     
     /**
-     * @brief Starts/stops more threads according to CPU activity and user preferences 
+     * @brief Called in real-time playback when the frame expected at the playhead is late by framesLate frames:
+     * returns the most recent frame among the following framesLate ones that is already rendered, the frames
+     * before it (including expectedTime) are dropped. Returns expectedTime if none of them is ready.
+     * @param nSkipped[out] Will be set to the number of frames dropped
+     **/
+    int skipLateFrames(int expectedTime,int framesLate,int* nSkipped);
+    
+    /**
+     * @brief Starts/stops more threads according to the user preferences, or to the throughput measured
+     * by the RenderThreadsController if the number of parallel renders is automatic.
      * @param optimalNThreads[out] Will be set to the new number of threads
      **/
     void adjustNumberOfThreads(int* newNThreads);
@@ -436,6 +478,10 @@ private:
     
     virtual void onRenderStopped() OVERRIDE FINAL;
     
+    virtual bool getPrefetchArgs(std::list<Natron::EffectInstance*>* roots,int* view,unsigned int* mipMapLevel) const OVERRIDE FINAL;
+    
+    virtual Natron::RenderPriorityEnum getRenderPriority() const OVERRIDE FINAL { return Natron::eRenderPriorityBackground; }
+    
     Natron::OutputEffectInstance* _effect;
 };
 
@@ -475,6 +521,10 @@ private:
     
     virtual void onRenderStopped() OVERRIDE FINAL;
     
+    virtual bool getPrefetchArgs(std::list<Natron::EffectInstance*>* roots,int* view,unsigned int* mipMapLevel) const OVERRIDE FINAL;
+    
+    virtual Natron::RenderPriorityEnum getRenderPriority() const OVERRIDE FINAL { return Natron::eRenderPriorityPlayback; }
+    
     ViewerInstance* _viewer;
 };
 
@@ -619,6 +669,11 @@ signals:
      **/
     void fpsChanged(double actualFps,double desiredFps);
     
+    /**
+     * @brief Emitted along with fpsChanged when real-time playback dropped frames, nDropped is the count since playback started
+     **/
+    void droppedFramesChanged(int nDropped);
+    
     /**
      * @brief Emitted after a frame is rendered.
      * This will not be emitted after calling renderCurrentFrame
@@ -0,0 +1,175 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "PreviewScheduler.h"
+
+#include <list>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#ifndef Q_MOC_RUN
+#include <boost/weak_ptr.hpp>
+#endif
+
+#include "Engine/AppManager.h"
+#include "Engine/Node.h"
+#include "Engine/RenderQueue.h"
+#include "Engine/Timer.h"
+
+///A batch of preview requests is computed once no request came for that long, in milliseconds
+#define NATRON_PREVIEW_DEBOUNCE_MS 150
+
+using namespace Natron;
+
+namespace {
+struct PreviewRequest
+{
+    const Node* key; //< to find the requests of a node without locking the weak pointer
+    boost::weak_ptr<Node> node;
+    int time;
+};
+}
+
+struct PreviewSchedulerPrivate
+{
+    mutable QMutex lock; //< protects all the fields below
+    QWaitCondition requestsCond; //< woken up when a request is queued or the thread must quit
+    std::list<PreviewRequest> requests; //< the oldest request first
+    double lastRequestTime; //< in seconds since clock was created
+    bool mustQuit;
+    TimeLapse clock;
+
+    PreviewSchedulerPrivate()
+    : lock()
+    , requestsCond()
+    , requests()
+    , lastRequestTime(0.)
+    , mustQuit(false)
+    , clock()
+    {
+    }
+
+    void removeRequests(const Node* node)
+    {
+        ///Private, shouldn't lock
+        assert( !lock.tryLock() );
+
+        for (std::list<PreviewRequest>::iterator it = requests.begin(); it != requests.end();) {
+            if (it->key == node) {
+                it = requests.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
+PreviewScheduler::PreviewScheduler()
+: QThread()
+, _imp( new PreviewSchedulerPrivate() )
+{
+    setObjectName("PreviewScheduler");
+}
+
+PreviewScheduler::~PreviewScheduler()
+{
+    quitThread();
+}
+
+void
+PreviewScheduler::schedulePreview(const boost::shared_ptr<Natron::Node> & node,
+                                  int time)
+{
+    if (!node) {
+        return;
+    }
+    {
+        QMutexLocker l(&_imp->lock);
+        if (_imp->mustQuit) {
+            return;
+        }
+
+        ///Only the last request of a node is kept, it moves to the end of the batch
+        _imp->removeRequests( node.get() );
+
+        PreviewRequest r;
+        r.key = node.get();
+        r.node = node;
+        r.time = time;
+        _imp->requests.push_back(r);
+        _imp->lastRequestTime = _imp->clock.getTimeSinceCreation();
+        _imp->requestsCond.wakeOne();
+    }
+    if ( !isRunning() ) {
+        start(QThread::LowPriority);
+    }
+}
+
+void
+PreviewScheduler::cancelPreviews(const Natron::Node* node)
+{
+    QMutexLocker l(&_imp->lock);
+
+    _imp->removeRequests(node);
+}
+
+int
+PreviewScheduler::getNPendingPreviews() const
+{
+    QMutexLocker l(&_imp->lock);
+
+    return (int)_imp->requests.size();
+}
+
+void
+PreviewScheduler::quitThread()
+{
+    {
+        QMutexLocker l(&_imp->lock);
+        _imp->mustQuit = true;
+        _imp->requests.clear();
+        _imp->requestsCond.wakeAll();
+    }
+    wait();
+}
+
+void
+PreviewScheduler::run()
+{
+    ///The previews must not slow down what the user is waiting for
+    RenderPrioritySetter prioritySetter(Natron::eRenderPriorityBackground);
+
+    for (;;) {
+        PreviewRequest request;
+        {
+            QMutexLocker l(&_imp->lock);
+            for (;;) {
+                if (_imp->mustQuit) {
+                    return;
+                }
+                if ( _imp->requests.empty() ) {
+                    _imp->requestsCond.wait(&_imp->lock);
+                    continue;
+                }
+                double quietTime = ( _imp->clock.getTimeSinceCreation() - _imp->lastRequestTime ) * 1000.;
+                if (quietTime < NATRON_PREVIEW_DEBOUNCE_MS) {
+                    _imp->requestsCond.wait( &_imp->lock, (unsigned long)(NATRON_PREVIEW_DEBOUNCE_MS - quietTime) + 1 );
+                    continue;
+                }
+                break;
+            }
+
+            ///The most recent request first: its render caches the images its inputs' previews are made from
+            request = _imp->requests.back();
+            _imp->requests.pop_back();
+        }
+
+        boost::shared_ptr<Node> node = request.node.lock();
+        if ( node && node->isActivated() ) {
+            appPTR->getRenderQueue()->yieldToHigherPriority();
+            node->renderPreviewNow(request.time);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_PREVIEWSCHEDULER_H_
+#define NATRON_ENGINE_PREVIEWSCHEDULER_H_
+
+#include <QtCore/QThread>
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/Macros.h"
+
+namespace Natron {
+class Node;
+}
+
+/**
+ * @brief Computes the previews of the nodes in a single low-priority thread instead of launching a render per node and per
+ * request in the global thread pool. The requests are debounced: the thread waits until no request came for
+ * NATRON_PREVIEW_DEBOUNCE_MS, so that e.g dragging a slider with auto-preview only computes the previews of the last value.
+ * A node requested several times in a batch is computed once, for the last time requested.
+ * The batch is processed from the most recently requested node (the most downstream one when the previews are refreshed
+ * downstream of a change), whose render leaves the images of its inputs in the cache for their own previews.
+ * The renders are tagged with the background priority of the RenderQueue so that they step aside for the viewer.
+ * There is a single instance owned by the AppManager.
+ **/
+struct PreviewSchedulerPrivate;
+class PreviewScheduler
+    : public QThread
+{
+public:
+
+    PreviewScheduler();
+
+    virtual ~PreviewScheduler();
+
+    /**
+     * @brief Queues the computation of the preview of node at the given time. Thread-safe.
+     **/
+    void schedulePreview(const boost::shared_ptr<Natron::Node> & node,int time);
+
+    /**
+     * @brief Removes the pending requests of node, e.g: because it is being deleted. Thread-safe.
+     **/
+    void cancelPreviews(const Natron::Node* node);
+
+    /**
+     * @brief Stops the thread and waits for the preview being computed, if any.
+     **/
+    void quitThread();
+
+    /**
+     * @brief Returns the number of requests waiting to be computed.
+     **/
+    int getNPendingPreviews() const WARN_UNUSED_RETURN;
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    boost::scoped_ptr<PreviewSchedulerPrivate> _imp;
+};
+
+#endif // NATRON_ENGINE_PREVIEWSCHEDULER_H_
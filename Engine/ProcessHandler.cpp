@@ -220,6 +220,13 @@ ProcessInputChannel::ProcessInputChannel(const QString & mainProcessServerName)
       , _mustQuit(false)
       , _mustQuitCond(new QWaitCondition)
       , _mustQuitMutex(new QMutex)
+      , _chunkReplied(false)
+      , _hasChunk(false)
+      , _chunkWriterName()
+      , _chunkFirstFrame(0)
+      , _chunkLastFrame(0)
+      , _chunkRepliedCond(new QWaitCondition)
+      , _chunkMutex(new QMutex)
 {
     initialize();
     _backgroundIPCServer->moveToThread(this);
@@ -240,6 +247,8 @@ ProcessInputChannel::~ProcessInputChannel()
     delete _backgroundOutputPipe;
     delete _mustQuitCond;
     delete _mustQuitMutex;
+    delete _chunkRepliedCond;
+    delete _chunkMutex;
 }
 
 void
@@ -252,6 +261,26 @@ ProcessInputChannel::writeToOutputChannel(const QString & message)
     }
 }
 
+bool
+ProcessInputChannel::requestRenderChunk(QString* writerName,
+                                        int* firstFrame,
+                                        int* lastFrame)
+{
+    QMutexLocker l(_chunkMutex);
+    _chunkReplied = false;
+    writeToOutputChannel(kRenderChunkRequestShort);
+    while (!_chunkReplied) {
+        _chunkRepliedCond->wait(_chunkMutex);
+    }
+    if (!_hasChunk) {
+        return false;
+    }
+    *writerName = _chunkWriterName;
+    *firstFrame = _chunkFirstFrame;
+    *lastFrame = _chunkLastFrame;
+    return true;
+}
+
 void
 ProcessInputChannel::onNewConnectionPending()
 {
@@ -274,7 +303,42 @@ ProcessInputChannel::onInputChannelMessageReceived()
     if ( str.startsWith(kAbortRenderingStringShort) ) {
         qDebug() << "Aborting render!";
         appPTR->abortAnyProcessing();
+        
+        ///Do not leave a render farm worker waiting for frames
+        QMutexLocker l(_chunkMutex);
+        _chunkReplied = true;
+        _hasChunk = false;
+        _chunkRepliedCond->wakeOne();
 
+        return true;
+    } else if ( str.startsWith(kRenderChunkStringShort) ) {
+        str.remove(0, QString(kRenderChunkStringShort).size());
+        ///The writer name may contain spaces, it is the last field
+        int firstSep = str.indexOf(' ');
+        int secondSep = firstSep == -1 ? -1 : str.indexOf(' ', firstSep + 1);
+        bool firstOk = false,lastOk = false;
+        QMutexLocker l(_chunkMutex);
+        if (secondSep != -1) {
+            _chunkFirstFrame = str.left(firstSep).toInt(&firstOk);
+            _chunkLastFrame = str.mid(firstSep + 1, secondSep - firstSep - 1).toInt(&lastOk);
+            _chunkWriterName = str.mid(secondSep + 1);
+        }
+        if (!firstOk || !lastOk) {
+            std::cerr << "Error: Unable to interpret message: " << str.toStdString() << std::endl;
+            _hasChunk = false;
+        } else {
+            _hasChunk = true;
+        }
+        _chunkReplied = true;
+        _chunkRepliedCond->wakeOne();
+        
+        return !_hasChunk;
+    } else if ( str.startsWith(kNoMoreRenderChunksStringShort) ) {
+        QMutexLocker l(_chunkMutex);
+        _chunkReplied = true;
+        _hasChunk = false;
+        _chunkRepliedCond->wakeOne();
+        
         return true;
     } else {
         std::cerr << "Error: Unable to interpret message: " << str.toStdString() << std::endl;
@@ -200,6 +200,12 @@ public:
      * @brief Call it if you want to write something to the background process output channel.
      **/
     void writeToOutputChannel(const QString & message);
+    
+    /**
+     * @brief For a worker of a render farm: asks the main process (the coordinator) for the next frames to render
+     * and blocks until it replies. Returns false if there is nothing left to render or if the render was aborted.
+     **/
+    bool requestRenderChunk(QString* writerName,int* firstFrame,int* lastFrame);
 
 public slots:
 
@@ -244,6 +250,14 @@ private:
     bool _mustQuit;
     QWaitCondition* _mustQuitCond;
     QMutex* _mustQuitMutex;
+    
+    ///The reply of the coordinator to the last requestRenderChunk() call
+    bool _chunkReplied; //< true once the reply arrived
+    bool _hasChunk; //< false if the coordinator has nothing left to render
+    QString _chunkWriterName;
+    int _chunkFirstFrame,_chunkLastFrame;
+    QWaitCondition* _chunkRepliedCond;
+    QMutex* _chunkMutex; //< protects the fields above
 };
 
 #endif // PROCESSHANDLER_H
@@ -11,6 +11,7 @@
 #include "Project.h"
 
 #include <fstream>
+#include <sstream>
 #include <algorithm>
 #include <ios>
 #include <cstdlib> // strtoul
@@ -34,6 +35,8 @@
 #include <QHostInfo>
 #include <QFileInfo>
 
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
@@ -66,6 +69,34 @@ static std::string getUserName()
 #endif
 }
 
+///Returns true if the file starts with NATRON_PROJECT_BINARY_HEADER
+static bool isBinaryProjectFile(const QString & filePath)
+{
+    QFile f(filePath);
+    if ( !f.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    QByteArray header = f.read( sizeof(NATRON_PROJECT_BINARY_HEADER) - 1 );
+
+    return header == NATRON_PROJECT_BINARY_HEADER;
+}
+
+///Reads the header line of a binary project, the stream is left at the beginning of the archive
+static void readBinaryProjectHeader(std::istream & ifile)
+{
+    std::string header;
+    unsigned int version = 0;
+    ifile >> header >> version;
+    if ( (header != NATRON_PROJECT_BINARY_HEADER) || (version == 0) ) {
+        throw std::runtime_error("Invalid binary project header");
+    }
+    if (version > NATRON_PROJECT_BINARY_VERSION) {
+        throw std::invalid_argument("The given project was produced with a more recent and incompatible version of " NATRON_APPLICATION_NAME ".");
+    }
+    ///Skip the end of the line
+    ifile.get();
+}
+
 static std::string generateGUIUserName()
 {
     return getUserName() + '@' + QHostInfo::localHostName().toStdString();
@@ -99,9 +130,7 @@ Project::Project(AppInstance* appInstance)
 Project::~Project()
 {
     ///wait for all autosaves to finish
-    for (std::list<boost::shared_ptr<QFutureWatcher<void> > >::iterator it = _imp->autoSaveFutures.begin(); it != _imp->autoSaveFutures.end(); ++it) {
-        (*it)->waitForFinished();
-    }
+    waitForAutoSaves();
     
     ///Don't clear autosaves if the program is shutting down by user request.
     ///Even if the user replied she/he didn't want to save the current work, we keep an autosave of it.
@@ -177,11 +206,39 @@ Project::loadProject(const QString & path,
     refreshViewersAndPreviews();
 
     ///We successfully loaded the project, remove auto-saves of previous projects.
+    waitForAutoSaves();
     removeAutoSaves();
 
     return true;
 } // loadProject
 
+template <typename ARCHIVE>
+bool
+Project::loadProjectArchive(ARCHIVE & iArchive,
+                            const QString & name,
+                            const QString & path,
+                            bool isAutoSave,
+                            const QString & realFilePath)
+{
+    bool bgProject;
+    iArchive >> boost::serialization::make_nvp("Background_project", bgProject);
+    ProjectSerialization projectSerializationObj( getApp() );
+    iArchive >> boost::serialization::make_nvp("Project", projectSerializationObj);
+
+    bool ret = load(projectSerializationObj,name,path,isAutoSave,realFilePath);
+
+    {
+        QMutexLocker k(&_imp->isLoadingProjectMutex);
+        _imp->isLoadingProjectInternal = false;
+    }
+
+    if (!bgProject) {
+        getApp()->loadProjectGui(iArchive);
+    }
+
+    return ret;
+}
+
 bool
 Project::loadProjectInternal(const QString & path,
                              const QString & name,bool isAutoSave,const QString& realFilePath)
@@ -193,10 +250,11 @@ Project::loadProjectInternal(const QString & path,
     }
     
     bool ret = false;
+    bool binaryProject = isBinaryProjectFile(filePath);
     std::ifstream ifile;
     try {
         ifile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        ifile.open(filePath.toStdString().c_str(),std::ifstream::in);
+        ifile.open(filePath.toStdString().c_str(),binaryProject ? std::ifstream::in | std::ifstream::binary : std::ifstream::in);
     } catch (const std::ifstream::failure & e) {
         throw std::runtime_error( std::string("Exception occured when opening file ") + filePath.toStdString() + ": " + e.what() );
     }
@@ -206,7 +264,8 @@ Project::loadProjectInternal(const QString & path,
         getApp()->startProgress(this, loadMessage, false);
     }
     
-    if (NATRON_VERSION_MAJOR == 1 && NATRON_VERSION_MINOR == 0 && NATRON_VERSION_REVISION == 0) {
+    ///Binary projects did not exist at that time
+    if (!binaryProject && NATRON_VERSION_MAJOR == 1 && NATRON_VERSION_MINOR == 0 && NATRON_VERSION_REVISION == 0) {
         
         ///Try to determine if the project was made during Natron v1.0.0 - RC2 or RC3 to detect a bug we introduced at that time
         ///in the BezierCP class serialisation
@@ -234,21 +293,13 @@ Project::loadProjectInternal(const QString & path,
             QMutexLocker k(&_imp->isLoadingProjectMutex);
             _imp->isLoadingProjectInternal = true;
         }
-        boost::archive::xml_iarchive iArchive(ifile);
-        bool bgProject;
-        iArchive >> boost::serialization::make_nvp("Background_project", bgProject);
-        ProjectSerialization projectSerializationObj( getApp() );
-        iArchive >> boost::serialization::make_nvp("Project", projectSerializationObj);
-        
-        ret = load(projectSerializationObj,name,path,isAutoSave,realFilePath);
-        
-        {
-            QMutexLocker k(&_imp->isLoadingProjectMutex);
-            _imp->isLoadingProjectInternal = false;
-        }
-        
-        if (!bgProject) {
-            getApp()->loadProjectGui(iArchive);
+        if (binaryProject) {
+            readBinaryProjectHeader(ifile);
+            boost::archive::binary_iarchive iArchive(ifile);
+            ret = loadProjectArchive(iArchive,name,path,isAutoSave,realFilePath);
+        } else {
+            boost::archive::xml_iarchive iArchive(ifile);
+            ret = loadProjectArchive(iArchive,name,path,isAutoSave,realFilePath);
         }
     } catch (const boost::archive::archive_exception & e) {
         ifile.close();
@@ -331,6 +382,9 @@ Project::saveProject(const QString & path,
         }
     }
 
+    ///An auto-save still being written would be left behind by removeAutoSaves() below
+    waitForAutoSaves();
+
     QString ret;
     try {
         if (!autoS) {
@@ -385,58 +439,83 @@ fileCopy(const QString & source,
     return success;
 }
 
-QString
-Project::saveProjectInternal(const QString & path,
-                             const QString & name,
-                             bool autoSave)
+template <typename ARCHIVE>
+void
+Project::saveProjectArchive(ARCHIVE & oArchive)
 {
-    QDateTime time = QDateTime::currentDateTime();
-    QString timeStr = time.toString();
-    Hash64 timeHash;
+    bool bgProject = appPTR->isBackground();
+    oArchive << boost::serialization::make_nvp("Background_project",bgProject);
+    ProjectSerialization projectSerializationObj( getApp() );
+    save(&projectSerializationObj);
+    oArchive << boost::serialization::make_nvp("Project",projectSerializationObj);
+    if (!bgProject) {
+        getApp()->saveProjectGui(oArchive);
+    }
+}
 
+///Returns the name of the auto-save of the project file path + name saved at the time timeStr
+static QString
+makeAutoSaveFileName(const QString & path,
+                     const QString & name,
+                     const QString & timeStr)
+{
+    QString actualFileName = name;
+
+    ///For render save don't encode a hash into it
+    if ( name.contains("RENDER_SAVE") ) {
+        return actualFileName;
+    }
+
+    Hash64 timeHash;
     for (int i = 0; i < timeStr.size(); ++i) {
         timeHash.append<unsigned short>( timeStr.at(i).unicode() );
     }
     timeHash.computeHash();
     QString timeHashStr = QString::number( timeHash.value() );
-    QString actualFileName = name;
-    
-    bool isRenderSave = name.contains("RENDER_SAVE");
-    
-    if (autoSave) {
-        
-        ///For render save don't encode a hash into it
-        if (!isRenderSave) {
-            ///We encode the filename of the actual project file
-            ///into the autosave filename so that the "Do you want to restore this autosave?" dialog
-            ///knows to which project is linked the autosave.
-            QString pathCpy = path;
-            
+
+    ///We encode the filename of the actual project file
+    ///into the autosave filename so that the "Do you want to restore this autosave?" dialog
+    ///knows to which project is linked the autosave.
+    QString pathCpy = path;
+
 #ifdef __NATRON_WIN32__
-            ///on windows, we must also modifiy the root name otherwise it would fail to save with a filename containing for example C:/
-            QFileInfoList roots = QDir::drives();
-            QString root;
-            for (int i = 0; i < roots.size(); ++i) {
-                QString rootPath = roots[i].absolutePath();
-                rootPath = rootPath.remove( QChar('\\') );
-                rootPath = rootPath.remove( QChar('/') );
-                if ( pathCpy.startsWith(rootPath) ) {
-                    root = rootPath;
-                    QString rootToPrepend("_ROOT_");
-                    rootToPrepend.append( root.at(0) ); //< append the root character, e.g the 'C' of C:
-                    rootToPrepend.append("_N_ROOT_");
-                    pathCpy.replace(rootPath, rootToPrepend);
-                    break;
-                }
-            }
-            
-#endif
-            pathCpy = pathCpy.replace("/", "_SEP_");
-            pathCpy = pathCpy.replace("\\", "_SEP_");
-            actualFileName.prepend(pathCpy);
-            actualFileName.append("." + timeHashStr);
+    ///on windows, we must also modifiy the root name otherwise it would fail to save with a filename containing for example C:/
+    QFileInfoList roots = QDir::drives();
+    QString root;
+    for (int i = 0; i < roots.size(); ++i) {
+        QString rootPath = roots[i].absolutePath();
+        rootPath = rootPath.remove( QChar('\\') );
+        rootPath = rootPath.remove( QChar('/') );
+        if ( pathCpy.startsWith(rootPath) ) {
+            root = rootPath;
+            QString rootToPrepend("_ROOT_");
+            rootToPrepend.append( root.at(0) ); //< append the root character, e.g the 'C' of C:
+            rootToPrepend.append("_N_ROOT_");
+            pathCpy.replace(rootPath, rootToPrepend);
+            break;
         }
     }
+
+#endif
+    pathCpy = pathCpy.replace("/", "_SEP_");
+    pathCpy = pathCpy.replace("\\", "_SEP_");
+    actualFileName.prepend(pathCpy);
+    actualFileName.append("." + timeHashStr);
+
+    return actualFileName;
+}
+
+QString
+Project::saveProjectInternal(const QString & path,
+                             const QString & name,
+                             bool autoSave)
+{
+    QDateTime time = QDateTime::currentDateTime();
+    QString timeStr = time.toString();
+    QString actualFileName = autoSave ? makeAutoSaveFileName(path, name, timeStr) : name;
+    
+    bool isRenderSave = name.contains("RENDER_SAVE");
+    
     QString filePath;
     if (autoSave) {
         filePath = Project::autoSavesDir() + QDir::separator() + actualFileName;
@@ -450,10 +529,11 @@ Project::saveProjectInternal(const QString & path,
     tmpFilename.append( QDir::separator() );
     tmpFilename.append( QString::number( time.toMSecsSinceEpoch() ) );
 
+    bool binaryProject = appPTR->getCurrentSettings()->isSaveProjectsAsBinaryEnabled();
     std::ofstream ofile;
     try {
         ofile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        ofile.open(tmpFilename.toStdString().c_str(),std::ofstream::out);
+        ofile.open(tmpFilename.toStdString().c_str(),binaryProject ? std::ofstream::out | std::ofstream::binary : std::ofstream::out);
     } catch (const std::ofstream::failure & e) {
         throw std::runtime_error( std::string("Exception occured when opening file ") + tmpFilename.toStdString() + ": " + e.what() );
     }
@@ -478,14 +558,13 @@ Project::saveProjectInternal(const QString & path,
     }
     
     try {
-        boost::archive::xml_oarchive oArchive(ofile);
-        bool bgProject = appPTR->isBackground();
-        oArchive << boost::serialization::make_nvp("Background_project",bgProject);
-        ProjectSerialization projectSerializationObj( getApp() );
-        save(&projectSerializationObj);
-        oArchive << boost::serialization::make_nvp("Project",projectSerializationObj);
-        if (!bgProject) {
-            getApp()->saveProjectGui(oArchive);
+        if (binaryProject) {
+            ofile << NATRON_PROJECT_BINARY_HEADER " " << NATRON_PROJECT_BINARY_VERSION << '\n';
+            boost::archive::binary_oarchive oArchive(ofile);
+            saveProjectArchive(oArchive);
+        } else {
+            boost::archive::xml_oarchive oArchive(ofile);
+            saveProjectArchive(oArchive);
         }
     } catch (...) {
         ofile.close();
@@ -557,40 +636,107 @@ void
 Project::onAutoSaveTimerTriggered()
 {
     assert( !appPTR->isBackground() );
+    assert( QThread::currentThread() == qApp->thread() );
 
     if (!getApp()) {
         return;
     }
     
-    ///check that all schedulers are not working.
-    ///If so launch an auto-save, otherwise, restart the timer.
-    bool canAutoSave = true;
+    ///If the previous auto-save is still being written, try every 2 seconds to auto-save so that they do not overwrite each other.
+    ///We don't use the user-provided timeout interval here because it could be an inapropriate value.
+    if ( !_imp->autoSaveFutures.empty() ) {
+        _imp->autoSaveTimer->start(2000);
+        
+        return;
+    }
     {
-        QMutexLocker l(&_imp->nodesLock);
-        for (std::vector< boost::shared_ptr<Natron::Node> >::iterator it = _imp->currentNodes.begin(); it != _imp->currentNodes.end(); ++it) {
-            if ( (*it)->isOutputNode() ) {
-                Natron::OutputEffectInstance* effect = dynamic_cast<Natron::OutputEffectInstance*>( (*it)->getLiveInstance() );
-                assert(effect);
-                if ( effect->getRenderEngine()->hasThreadsWorking() ) {
-                    canAutoSave = false;
-                    break;
-                }
+        QMutexLocker l(&_imp->isLoadingProjectMutex);
+        if (_imp->isLoadingProject) {
+            return;
+        }
+    }
+
+    ///Take a snapshot of the project in memory: on the main thread the project cannot change while it is serialized,
+    ///and the renders only read it so they do not have to be finished. The values of the knobs are copied so that
+    ///encoding the snapshot and writing the file can be left to the global thread pool.
+    QDateTime time = QDateTime::currentDateTime();
+    QString filePath = Project::autoSavesDir() + QDir::separator() + makeAutoSaveFileName( _imp->projectPath, _imp->projectName, time.toString() );
+    boost::shared_ptr<ProjectSerialization> project( new ProjectSerialization( getApp() ) );
+    save(project.get(), true);
+    boost::shared_ptr<ProjectGuiSnapshot> gui = getApp()->snapshotProjectGui();
+
+    _imp->lastAutoSaveFilePath = filePath;
+    _imp->lastAutoSave = time;
+    emit projectNameChanged(_imp->projectName + " (*)");
+
+    boost::shared_ptr<QFutureWatcher<void> > watcher(new QFutureWatcher<void>);
+    QObject::connect(watcher.get(), SIGNAL(finished()), this, SLOT(onAutoSaveFutureFinished()));
+    watcher->setFuture( QtConcurrent::run(this, &Project::writeAutoSave, filePath, project, gui) );
+    _imp->autoSaveFutures.push_back(watcher);
+}
+
+void
+Project::writeAutoSave(const QString & filePath,
+                       const boost::shared_ptr<ProjectSerialization> & project,
+                       const boost::shared_ptr<ProjectGuiSnapshot> & gui)
+{
+    ///Clean auto-saves before saving a new one
+    removeAutoSaves();
+
+    ///Use a temporary file to save, so if Natron crashes it doesn't corrupt the previous auto-save.
+    QString tmpFilename = StandardPaths::writableLocation(StandardPaths::eStandardLocationTemp);
+    tmpFilename.append( QDir::separator() );
+    tmpFilename.append( QString::number( QDateTime::currentDateTime().toMSecsSinceEpoch() ) );
+    tmpFilename.append(".autosave");
+
+    ///Auto-saves are always binary, whatever the user preference: they are only read back by this version of Natron.
+    ///The layout is the one of saveProjectArchive()
+    try {
+        std::ofstream ofile;
+        ofile.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+        ofile.open(tmpFilename.toStdString().c_str(), std::ofstream::out | std::ofstream::binary);
+        ofile << NATRON_PROJECT_BINARY_HEADER " " << NATRON_PROJECT_BINARY_VERSION << '\n';
+        {
+            boost::archive::binary_oarchive oArchive(ofile);
+            bool bgProject = !gui;
+            oArchive << boost::serialization::make_nvp("Background_project",bgProject);
+            oArchive << boost::serialization::make_nvp("Project",*project);
+            if (gui) {
+                gui->encode(oArchive);
             }
         }
+        ofile.close();
+    } catch (const std::exception & e) {
+        qDebug() << "Save failure: " << e.what();
+        QFile::remove(tmpFilename);
+
+        return;
     }
 
-    if (canAutoSave) {
-        boost::shared_ptr<QFutureWatcher<void> > watcher(new QFutureWatcher<void>);
-        QObject::connect(watcher.get(), SIGNAL(finished()), this, SLOT(onAutoSaveFutureFinished()));
-        watcher->setFuture(QtConcurrent::run(this,&Project::autoSave));
-        _imp->autoSaveFutures.push_back(watcher);
-    } else {
-        ///If the auto-save failed because a render is in progress, try every 2 seconds to auto-save.
-        ///We don't use the user-provided timeout interval here because it could be an inapropriate value.
-        _imp->autoSaveTimer->start(2000);
+    QFile::remove(filePath);
+    int nAttemps = 0;
+
+    while ( nAttemps < 10 && !fileCopy(tmpFilename, filePath) ) {
+        ++nAttemps;
     }
+
+    QFile::remove(tmpFilename);
+
+    ///Save caches ToC
+    appPTR->saveCaches();
 }
     
+void
+Project::waitForAutoSaves()
+{
+    ///autoSaveFutures is only modified on the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    for (std::list<boost::shared_ptr<QFutureWatcher<void> > >::iterator it = _imp->autoSaveFutures.begin(); it != _imp->autoSaveFutures.end(); ++it) {
+        (*it)->waitForFinished();
+    }
+}
+
 void Project::onAutoSaveFutureFinished()
 {
     QFutureWatcherBase* future = qobject_cast<QFutureWatcherBase*>(sender());
@@ -994,6 +1140,14 @@ Project::initNodeCountersAndSetName(Node* n)
         baseName[baseName.size() - 3] == 'O') {
         baseName = baseName.substr(0,baseName.size() - 3);
     }
+    {
+        ///Skip the numbers already known to be taken
+        QMutexLocker l(&_imp->nodesLock);
+        std::map<std::string,int>::const_iterator found = _imp->nodeCounters.find(baseName);
+        if ( found != _imp->nodeCounters.end() ) {
+            no = found->second;
+        }
+    }
     bool foundNodeWithName = false;
     
     std::string name;
@@ -1003,13 +1157,9 @@ Project::initNodeCountersAndSetName(Node* n)
         name = ss.str();
     }
     do {
-        foundNodeWithName = false;
-        QMutexLocker l(&_imp->nodesLock);
-        for (U32 i = 0; i < _imp->currentNodes.size(); ++i) {
-            if (_imp->currentNodes[i]->getName_mt_safe() == name) {
-                foundNodeWithName = true;
-                break;
-            }
+        {
+            QMutexLocker l(&_imp->nodesLock);
+            foundNodeWithName = _imp->nodesByName.find(name) != _imp->nodesByName.end();
         }
         if (foundNodeWithName) {
             ++no;
@@ -1021,6 +1171,9 @@ Project::initNodeCountersAndSetName(Node* n)
         }
     } while (foundNodeWithName);
     n->setName(name.c_str());
+
+    QMutexLocker l(&_imp->nodesLock);
+    _imp->nodeCounters[baseName] = no + 1;
 }
 
 
@@ -1030,6 +1183,7 @@ Project::addNodeToProject(boost::shared_ptr<Natron::Node> n)
     QMutexLocker l(&_imp->nodesLock);
 
     _imp->currentNodes.push_back(n);
+    _imp->indexNode( n, n->getName_mt_safe(), _imp->nodesAdded++ );
 }
 
 void
@@ -1044,9 +1198,33 @@ Project::removeNodeFromProject(const boost::shared_ptr<Natron::Node> & n)
                 break;
             }
         }
+        _imp->unindexNode( n.get(), n->getName_mt_safe() );
+        ///The name of the node is available again
+        _imp->nodeCounters.clear();
     }
     n->removeReferences(true);
 }
+
+void
+Project::onNodeNameChanged(const Natron::Node* n,
+                           const std::string & oldName)
+{
+    QMutexLocker l(&_imp->nodesLock);
+    boost::unordered_map<const Natron::Node*, ProjectPrivate::IndexedNode>::iterator found = _imp->nodesByPointer.find(n);
+
+    ///The node is named before being added to the project
+    if ( found == _imp->nodesByPointer.end() ) {
+        return;
+    }
+    ///Keep its order so that getNodeByName still returns the first of the nodes with the same name
+    ProjectPrivate::IndexedNode node = found->second;
+    if ( !oldName.empty() ) {
+        ///The old name is available again
+        _imp->nodeCounters.clear();
+    }
+    _imp->unindexNode(n, oldName);
+    _imp->indexNode( node.node, node.node->getName_mt_safe(), node.order );
+}
     
 void
 Project::ensureAllProcessingThreadsFinished()
@@ -1095,6 +1273,9 @@ Project::clearNodes(bool emitSignal)
     {
         QMutexLocker l(&_imp->nodesLock);
         _imp->currentNodes.clear();
+        _imp->nodesByPointer.clear();
+        _imp->nodesByName.clear();
+        _imp->nodeCounters.clear();
     }
 
     nodesToDelete.clear();
@@ -1278,9 +1459,10 @@ Project::isSaveUpToDate() const
 }
 
 void
-Project::save(ProjectSerialization* serializationObject) const
+Project::save(ProjectSerialization* serializationObject,
+              bool copyKnobs) const
 {
-    serializationObject->initialize(this);
+    serializationObject->initialize(this,copyKnobs);
 }
 
 bool
@@ -1515,16 +1697,13 @@ Project::connectNodes(int inputNumber,
                       const std::string & parentName,
                       Node* output)
 {
-    const std::vector<boost::shared_ptr<Node> > nodes = getCurrentNodes();
+    boost::shared_ptr<Node> input = getNodeByName(parentName);
 
-    for (U32 i = 0; i < nodes.size(); ++i) {
-        assert(nodes[i]);
-        if (nodes[i]->getName() == parentName) {
-            return connectNodes(inputNumber,nodes[i], output);
-        }
+    if (!input) {
+        return false;
     }
 
-    return false;
+    return connectNodes(inputNumber,input, output);
 }
 
 bool
@@ -1719,27 +1898,33 @@ Project::getProjectCreationTime() const
 boost::shared_ptr<Natron::Node> Project::getNodeByName(const std::string & name) const
 {
     QMutexLocker l(&_imp->nodesLock);
+    typedef boost::unordered_multimap<std::string, ProjectPrivate::IndexedNode>::const_iterator NodesByNameIt;
+    std::pair<NodesByNameIt, NodesByNameIt> range = _imp->nodesByName.equal_range(name);
 
-    for (U32 i = 0; i < _imp->currentNodes.size(); ++i) {
-        if (_imp->currentNodes[i]->getName() == name) {
-            return _imp->currentNodes[i];
+    if (range.first == range.second) {
+        return boost::shared_ptr<Natron::Node>();
+    }
+    ///If several nodes have the same name, return the first one in currentNodes
+    NodesByNameIt first = range.first;
+    for (NodesByNameIt it = range.first; it != range.second; ++it) {
+        if (it->second.order < first->second.order) {
+            first = it;
         }
     }
 
-    return boost::shared_ptr<Natron::Node>();
+    return first->second.node;
 }
 
 boost::shared_ptr<Natron::Node> Project::getNodePointer(Natron::Node* n) const
 {
     QMutexLocker l(&_imp->nodesLock);
+    boost::unordered_map<const Natron::Node*, ProjectPrivate::IndexedNode>::const_iterator found = _imp->nodesByPointer.find(n);
 
-    for (U32 i = 0; i < _imp->currentNodes.size(); ++i) {
-        if (_imp->currentNodes[i].get() == n) {
-            return _imp->currentNodes[i];
-        }
+    if ( found == _imp->nodesByPointer.end() ) {
+        return boost::shared_ptr<Natron::Node>();
     }
 
-    return boost::shared_ptr<Natron::Node>();
+    return found->second.node;
 }
 
 Natron::ViewerColorSpaceEnum
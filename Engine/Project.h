@@ -13,6 +13,7 @@
 
 #include <map>
 #include <vector>
+#include <string>
 #ifndef Q_MOC_RUN
 #include <boost/noncopyable.hpp>
 #endif
@@ -34,6 +35,7 @@ class QString;
 class QDateTime;
 class AppInstance;
 class ProjectSerialization;
+class ProjectGuiSnapshot;
 class KnobSerialization;
 class ProjectGui;
 class AddFormatDialog;
@@ -73,7 +75,8 @@ public:
     void autoSave();
 
     /**
-     * @brief Same as autoSave() but the auto-save is run in a separate thread instead.
+     * @brief Same as autoSave() but delayed by the auto-save interval of the preferences. The project is then serialized
+     * in memory on the main thread and the file is written in a separate thread.
      **/
     void triggerAutoSave();
 
@@ -177,6 +180,11 @@ public:
      **/
     void removeNodeFromProject(const boost::shared_ptr<Natron::Node> & n);
 
+    /**
+     * @brief Called by the Node class when its name changes so that getNodeByName finds it under its new name.
+     **/
+    void onNodeNameChanged(const Natron::Node* n,const std::string & oldName);
+
     void clearNodes(bool emitSignal = true);
     
     void ensureAllProcessingThreadsFinished();
@@ -196,6 +204,7 @@ public:
     /**
      * @brief Returns a pointer to a node whose name is the same as the name given in parameter.
      * If no such node could be found, NULL is returned.
+     * The nodes are indexed by name, this is a constant time lookup. If several nodes have the same name, the first one is returned.
      **/
     boost::shared_ptr<Natron::Node> getNodeByName(const std::string & name) const;
 
@@ -209,8 +218,15 @@ public:
 
     /**
      * @brief Remove all the autosave files from the disk.
+     * On the main thread, call waitForAutoSaves() first otherwise an auto-save being written could be left behind.
      **/
     static void removeAutoSaves();
+
+    /**
+     * @brief Waits for the auto-saves being written in the global thread pool to be on disk.
+     * This must be called on the main thread.
+     **/
+    void waitForAutoSaves();
     virtual bool isProject() const
     {
         return true;
@@ -336,6 +352,23 @@ private:
 
     QString saveProjectInternal(const QString & path,const QString & name,bool autosave = false);
 
+    /**
+     * @brief Reads the project and its GUI from an XML or binary archive, called by loadProjectInternal.
+     **/
+    template <typename ARCHIVE>
+    bool loadProjectArchive(ARCHIVE & iArchive,const QString & name,const QString & path,bool isAutoSave,const QString & realFilePath);
+
+    template <typename ARCHIVE>
+    void saveProjectArchive(ARCHIVE & oArchive);
+
+    /**
+     * @brief Encodes the snapshot of the project taken by onAutoSaveTimerTriggered() and replaces the auto-saves with it,
+     * run in the global thread pool.
+     **/
+    void writeAutoSave(const QString & filePath,
+                       const boost::shared_ptr<ProjectSerialization> & project,
+                       const boost::shared_ptr<ProjectGuiSnapshot> & gui);
+
     
     bool fixFilePath(const std::string& projectPathName,const std::string& newProjectPath,
                         std::string& filePath);
@@ -382,7 +415,10 @@ private:
     virtual void onKnobValueChanged(KnobI* k,Natron::ValueChangedReasonEnum reason,SequenceTime time,
                                     bool originatedFromMainThread)  OVERRIDE FINAL;
 
-    void save(ProjectSerialization* serializationObject) const;
+    /**
+     * @param copyKnobs @see ProjectSerialization::initialize
+     **/
+    void save(ProjectSerialization* serializationObject,bool copyKnobs = false) const;
 
     bool load(const ProjectSerialization & obj,const QString& name,const QString& path,bool isAutoSave,const QString& realFilePath);
 
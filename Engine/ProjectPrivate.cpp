@@ -15,6 +15,11 @@
 #include <QDateTime>
 #include <QFile>
 #include <QDir>
+
+#include <set>
+
+#include <boost/unordered_set.hpp>
+
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/NodeSerialization.h"
@@ -55,6 +60,10 @@ ProjectPrivate::ProjectPrivate(Natron::Project* project)
       , timeline( new TimeLine(project) )
       , autoSetProjectFormat(appPTR->getCurrentSettings()->isAutoProjectFormatEnabled())
       , currentNodes()
+      , nodesByPointer()
+      , nodesByName()
+      , nodesAdded(0)
+      , nodeCounters()
       , project(project)
       , isLoadingProjectMutex()
       , isLoadingProject(false)
@@ -100,35 +109,33 @@ ProjectPrivate::restoreFromSerialization(const ProjectSerialization & obj,
     formatKnob->populateChoices(entries);
     autoSetProjectFormat = false;
 
-    const std::list< boost::shared_ptr<KnobSerialization> > & projectSerializedValues = obj.getProjectKnobsValues();
+    KnobSerialization::KnobsByName projectSerializedValues;
+    KnobSerialization::indexByName(obj.getProjectKnobsValues(), &projectSerializedValues);
     const std::vector< boost::shared_ptr<KnobI> > & projectKnobs = project->getKnobs();
 
 
     /// 1) restore project's knobs.
     for (U32 i = 0; i < projectKnobs.size(); ++i) {
         ///try to find a serialized value for this knob
-        for (std::list< boost::shared_ptr<KnobSerialization> >::const_iterator it = projectSerializedValues.begin(); it != projectSerializedValues.end(); ++it) {
+        KnobSerialization::KnobsByName::const_iterator it = projectSerializedValues.find( projectKnobs[i]->getName() );
+        if ( it != projectSerializedValues.end() ) {
             
-            if ( (*it)->getName() == projectKnobs[i]->getName() ) {
-                
-                ///EDIT: Allow non persistent params to be loaded if we found a valid serialization for them
-                //if ( projectKnobs[i]->getIsPersistant() ) {
+            ///EDIT: Allow non persistent params to be loaded if we found a valid serialization for them
+            //if ( projectKnobs[i]->getIsPersistant() ) {
+            
+            Choice_Knob* isChoice = dynamic_cast<Choice_Knob*>(projectKnobs[i].get());
+            if (isChoice) {
+                const TypeExtraData* extraData = it->second->getExtraData();
+                const ChoiceExtraData* choiceData = dynamic_cast<const ChoiceExtraData*>(extraData);
+                assert(choiceData);
                 
-                Choice_Knob* isChoice = dynamic_cast<Choice_Knob*>(projectKnobs[i].get());
-                if (isChoice) {
-                    const TypeExtraData* extraData = (*it)->getExtraData();
-                    const ChoiceExtraData* choiceData = dynamic_cast<const ChoiceExtraData*>(extraData);
-                    assert(choiceData);
-                    
-                    Choice_Knob* serializedKnob = dynamic_cast<Choice_Knob*>((*it)->getKnob().get());
-                    assert(serializedKnob);
-                    isChoice->choiceRestoration(serializedKnob, choiceData);
-                } else {
-                    projectKnobs[i]->clone( (*it)->getKnob() );
-                }
-                //}
-                break;
+                Choice_Knob* serializedKnob = dynamic_cast<Choice_Knob*>(it->second->getKnob().get());
+                assert(serializedKnob);
+                isChoice->choiceRestoration(serializedKnob, choiceData);
+            } else {
+                projectKnobs[i]->clone( it->second->getKnob() );
             }
+            //}
         }
         if (projectKnobs[i] == envVars) {
             
@@ -162,6 +169,33 @@ ProjectPrivate::restoreFromSerialization(const ProjectSerialization & obj,
     ///This map contains all the parents that must be reconnected and an iterator to the child serialization
     std::map<boost::shared_ptr<Natron::Node>, std::list<NodeSerialization>::const_iterator > parentsToReconnect;
 
+    ///Names of the serialized nodes, to find the parents of multi-instance nodes without scanning the whole list for each child
+    boost::unordered_set<std::string> serializedNodesNames;
+    for (std::list< NodeSerialization >::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+        serializedNodesNames.insert( it->getPluginLabel() );
+    }
+
+    if ( appPTR->isBackground() ) {
+        ///Loading the binary of a plug-in and describing it is paid by its first instance. Do it for all the plug-ins
+        ///of the project at once, concurrently, so that the nodes below are created faster.
+        ///This is only done in background mode: the describe actions may pop up dialogs otherwise.
+        std::set< std::pair<std::string,int> > pluginsToLoad;
+        for (std::list< NodeSerialization >::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+            try {
+                Natron::Plugin* plugin = appPTR->getPluginBinary( it->getPluginID().c_str(),
+                                                                  it->getPluginMajorVersion(),
+                                                                  it->getPluginMinorVersion(),
+                                                                  project->getApp()->wasProjectCreatedWithLowerCaseIDs() );
+                if (plugin) {
+                    pluginsToLoad.insert( std::make_pair( plugin->getPluginID().toStdString(), plugin->getMajorVersion() ) );
+                }
+            } catch (const std::exception &) {
+                ///Reported when the node is created
+            }
+        }
+        appPTR->loadOFXPluginsConcurrently(pluginsToLoad);
+    }
+
     /*first create all nodes*/
     int nodesRestored = 0;
     for (std::list< NodeSerialization >::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
@@ -178,21 +212,10 @@ ProjectPrivate::restoreFromSerialization(const ProjectSerialization & obj,
         ///If not, create it
 
         if ( !it->getMultiInstanceParentName().empty() ) {
-            bool foundParent = false;
-            for (std::list< NodeSerialization >::const_iterator it2 = serializedNodes.begin(); it2 != serializedNodes.end(); ++it2) {
-                if ( it2->getPluginLabel() == it->getMultiInstanceParentName() ) {
-                    foundParent = true;
-                    break;
-                }
-            }
+            bool foundParent = serializedNodesNames.find( it->getMultiInstanceParentName() ) != serializedNodesNames.end();
             if (!foundParent) {
                 ///Maybe it was created so far by another child who created it so look into the nodes
-                for (std::vector<boost::shared_ptr<Natron::Node> >::iterator it2 = currentNodes.begin(); it2 != currentNodes.end(); ++it2) {
-                    if ( (*it2)->getName() == it->getMultiInstanceParentName() ) {
-                        foundParent = true;
-                        break;
-                    }
-                }
+                foundParent = project->getNodeByName( it->getMultiInstanceParentName() ).get() != 0;
                 ///Create the parent
                 if (!foundParent) {
                     boost::shared_ptr<Natron::Node> parent = project->getApp()->createNode( CreateNodeArgs( pluginID.c_str(),
@@ -250,13 +273,7 @@ ProjectPrivate::restoreFromSerialization(const ProjectSerialization & obj,
         }
 
 
-        boost::shared_ptr<Natron::Node> thisNode;
-        for (U32 j = 0; j < currentNodes.size(); ++j) {
-            if ( currentNodes[j]->getName() == it->getPluginLabel() ) {
-                thisNode = currentNodes[j];
-                break;
-            }
-        }
+        boost::shared_ptr<Natron::Node> thisNode = project->getNodeByName( it->getPluginLabel() );
         if (!thisNode) {
             continue;
         }
@@ -271,20 +288,14 @@ ProjectPrivate::restoreFromSerialization(const ProjectSerialization & obj,
         const std::string & masterNodeName = it->getMasterNodeName();
         if ( !masterNodeName.empty() ) {
             ///find such a node
-            boost::shared_ptr<Natron::Node> masterNode;
-            for (U32 j = 0; j < currentNodes.size(); ++j) {
-                if (currentNodes[j]->getName() == masterNodeName) {
-                    masterNode = currentNodes[j];
-                    break;
-                }
-            }
+            boost::shared_ptr<Natron::Node> masterNode = project->getNodeByName(masterNodeName);
             if (!masterNode) {
                 appPTR->writeToOfxLog_mt_safe(QString("Cannot restore the link between " + QString(it->getPluginLabel().c_str()) + " and " + masterNodeName.c_str()));
                 mustShowErrorsLog = true;
             }
             thisNode->getLiveInstance()->slaveAllKnobs( masterNode->getLiveInstance() );
         } else {
-            thisNode->restoreKnobsLinks(*it,currentNodes);
+            thisNode->restoreKnobsLinks(*it);
         }
 
         const std::vector<std::string> & inputs = it->getInputs();
@@ -395,6 +406,41 @@ ProjectPrivate::findFormat(int index,
 
     return false;
 }
+
+void
+ProjectPrivate::indexNode(const boost::shared_ptr<Natron::Node> & node,
+                          const std::string & name,
+                          U64 order)
+{
+    ///Private, shouldn't lock
+    assert( !nodesLock.tryLock() );
+
+    IndexedNode indexed;
+    indexed.node = node;
+    indexed.order = order;
+    nodesByPointer[node.get()] = indexed;
+    nodesByName.insert( std::make_pair(name, indexed) );
+}
+
+void
+ProjectPrivate::unindexNode(const Natron::Node* node,
+                            const std::string & name)
+{
+    ///Private, shouldn't lock
+    assert( !nodesLock.tryLock() );
+
+    nodesByPointer.erase(node);
+
+    typedef boost::unordered_multimap<std::string, IndexedNode>::iterator NodesByNameIt;
+    std::pair<NodesByNameIt, NodesByNameIt> range = nodesByName.equal_range(name);
+    for (NodesByNameIt it = range.first; it != range.second; ++it) {
+        if (it->second.node.get() == node) {
+            nodesByName.erase(it);
+
+            return;
+        }
+    }
+}
     
 void
 ProjectPrivate::autoSetProjectDirectory(const QString& path)
@@ -24,6 +24,9 @@ CLANG_DIAG_OFF(uninitialized)
 CLANG_DIAG_ON(deprecated)
 CLANG_DIAG_ON(uninitialized)
 
+#ifndef Q_MOC_RUN
+#include <boost/unordered_map.hpp>
+#endif
 
 #include "Engine/Format.h"
 #include "Engine/KnobTypes.h"
@@ -93,9 +96,21 @@ struct ProjectPrivate
     boost::shared_ptr<String_Knob> saveDate;
     
     boost::shared_ptr<TimeLine> timeline; // global timeline
-    mutable QMutex nodesLock; //< protects nodeCounters & currentNodes
+    mutable QMutex nodesLock; //< protects nodeCounters, currentNodes, nodesByPointer, nodesByName & nodesAdded
     bool autoSetProjectFormat;
     std::vector< boost::shared_ptr<Natron::Node> > currentNodes;
+
+    ///A node of currentNodes with the order in which it was added, which is its order in currentNodes
+    struct IndexedNode
+    {
+        boost::shared_ptr<Natron::Node> node;
+        U64 order;
+    };
+
+    boost::unordered_map<const Natron::Node*, IndexedNode> nodesByPointer; //< index of currentNodes
+    boost::unordered_multimap<std::string, IndexedNode> nodesByName; //< index of currentNodes by name
+    U64 nodesAdded; //< order of the next node added to currentNodes
+    std::map<std::string,int> nodeCounters; //< for each base name, the first number that may be free for a new node
     Natron::Project* project;
     mutable QMutex isLoadingProjectMutex;
     bool isLoadingProject; //< true when the project is loading
@@ -111,6 +126,10 @@ struct ProjectPrivate
     bool restoreFromSerialization(const ProjectSerialization & obj,const QString& name,const QString& path,bool isAutoSave,const QString& realFilePath);
 
     bool findFormat(int index,Format* format) const;
+
+    ///Both must be called with nodesLock taken
+    void indexNode(const boost::shared_ptr<Natron::Node> & node,const std::string & name,U64 order);
+    void unindexNode(const Natron::Node* node,const std::string & name);
     
     /**
      * @brief Auto fills the project directory parameter given the project file path
@@ -16,7 +16,8 @@
 
 
 void
-ProjectSerialization::initialize(const Natron::Project* project)
+ProjectSerialization::initialize(const Natron::Project* project,
+                                 bool copyKnobs)
 {
     ///All the code in this function is MT-safe
 
@@ -31,7 +32,7 @@ ProjectSerialization::initialize(const Natron::Project* project)
 
     _serializedNodes.clear();
     for (U32 i = 0; i < activeNodes.size(); ++i) {
-        NodeSerialization state(activeNodes[i]);
+        NodeSerialization state(activeNodes[i],true,copyKnobs);
         _serializedNodes.push_back(state);
     }
     project->getAdditionalFormats(&_additionalFormats);
@@ -42,7 +43,7 @@ ProjectSerialization::initialize(const Natron::Project* project)
         Page_Knob* isPage = dynamic_cast<Page_Knob*>( knobs[i].get() );
         Button_Knob* isButton = dynamic_cast<Button_Knob*>( knobs[i].get() );
         if (knobs[i]->getIsPersistant() && !isGroup && !isPage && !isButton) {
-            boost::shared_ptr<KnobSerialization> newKnobSer( new KnobSerialization(knobs[i],false) );
+            boost::shared_ptr<KnobSerialization> newKnobSer( new KnobSerialization(knobs[i],copyKnobs) );
             _projectKnobs.push_back(newKnobSer);
         }
     }
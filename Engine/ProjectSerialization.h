@@ -73,7 +73,11 @@ public:
         return _version;
     }
     
-    void initialize(const Natron::Project* project);
+    /**
+     * @param copyKnobs If true, the values of the knobs are copied so that the object can be encoded later, from another thread,
+     * while the project keeps changing.
+     **/
+    void initialize(const Natron::Project* project,bool copyKnobs = false);
 
     SequenceTime getCurrentTime() const
     {
@@ -467,6 +467,30 @@ public:
         return ret;
     }
 
+    /**
+     * @brief Splits the rect into horizontal bands of bandHeight scan-lines, ordered from the top of the rect to its bottom.
+     * The bottom band is clipped to the rect. If bandHeight is not positive or the rect fits in one band, the rect is returned as is.
+     **/
+    static std::vector<RectI> splitRectIntoBands(const RectI & rect,
+                                                 int bandHeight)
+    {
+        std::vector<RectI> ret;
+
+        if ( rect.isNull() ) {
+            return ret;
+        }
+        if ( (bandHeight <= 0) || ( bandHeight >= rect.height() ) ) {
+            ret.push_back(rect);
+
+            return ret;
+        }
+        for (int top = rect.top(); top > rect.bottom(); top -= bandHeight) {
+            ret.push_back( RectI( rect.left(),std::max(rect.bottom(), top - bandHeight),rect.right(),top ) );
+        }
+
+        return ret;
+    }
+
     static RectI fromOfxRectI(const OfxRectI & r)
     {
         RectI ret(r.x1,r.y1,r.x2,r.y2);
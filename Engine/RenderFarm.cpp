@@ -0,0 +1,556 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "RenderFarm.h"
+
+#include <set>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTemporaryFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QEventLoop>
+#include <QTimer>
+#include <QThread>
+#include <QDebug>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/AppManager.h"
+
+///How often the coordinator checks whether the render was aborted
+#define NATRON_RENDER_FARM_ABORT_POLL_MS 100
+
+///Each chunk handed to a worker is at most what is left to render divided by this times the number of workers
+#define NATRON_RENDER_FARM_CHUNKS_PER_WORKER 2
+
+///A frame handed out that many times without being reported rendered is given up
+#define NATRON_RENDER_FARM_MAX_FRAME_ATTEMPTS 3
+
+struct RenderFarmFramesPrivate
+{
+    ///The chunk handed to a worker
+    struct WorkerChunk
+    {
+        bool hasChunk; //< true while the worker renders chunk
+        RenderFarm::WriterRange chunk;
+        std::set<int> renderedFrames; //< frames of chunk reported rendered by the worker
+
+        WorkerChunk()
+        : hasChunk(false)
+        , chunk()
+        , renderedFrames()
+        {
+        }
+    };
+
+    int nWorkers;
+    std::list<RenderFarm::WriterRange> pending; //< frames that were not handed to a worker yet
+    std::vector<WorkerChunk> chunks; //< indexed by worker
+    std::map<std::pair<QString,int>,int> attempts; //< how many times the frames handed out again were handed out
+    int nFramesTotal;
+    int nFramesRendered;
+    bool aborted;
+
+    RenderFarmFramesPrivate(const std::list<RenderFarm::WriterRange>& work,
+                            int nWorkers)
+    : nWorkers( std::max(1, nWorkers) )
+    , pending()
+    , chunks( std::max(1, nWorkers) )
+    , attempts()
+    , nFramesTotal(0)
+    , nFramesRendered(0)
+    , aborted(false)
+    {
+        for (std::list<RenderFarm::WriterRange>::const_iterator it = work.begin(); it != work.end(); ++it) {
+            if (it->lastFrame >= it->firstFrame) {
+                pending.push_back(*it);
+                nFramesTotal += it->lastFrame - it->firstFrame + 1;
+            }
+        }
+    }
+
+    int getNPendingFrames() const
+    {
+        int ret = 0;
+        for (std::list<RenderFarm::WriterRange>::const_iterator it = pending.begin(); it != pending.end(); ++it) {
+            ret += it->lastFrame - it->firstFrame + 1;
+        }
+        return ret;
+    }
+
+    WorkerChunk& getWorker(int worker)
+    {
+        assert( worker >= 0 && worker < (int)chunks.size() );
+        return chunks[worker];
+    }
+
+    /**
+     * @brief Returns true if the frame may be handed out again, false if it was tried too many times already.
+     **/
+    bool canRetry(const QString & writerName,
+                  int frame)
+    {
+        ///The first attempt is not in the map
+        int& nAttempts = attempts[std::make_pair(writerName, frame)];
+        if (nAttempts == 0) {
+            nAttempts = 1;
+        }
+        if (nAttempts >= NATRON_RENDER_FARM_MAX_FRAME_ATTEMPTS) {
+            return false;
+        }
+        ++nAttempts;
+        return true;
+    }
+};
+
+RenderFarmFrames::RenderFarmFrames(const std::list<RenderFarm::WriterRange>& work,
+                                   int nWorkers)
+: _imp( new RenderFarmFramesPrivate(work,nWorkers) )
+{
+}
+
+RenderFarmFrames::~RenderFarmFrames()
+{
+}
+
+int
+RenderFarmFrames::getNFramesTotal() const
+{
+    return _imp->nFramesTotal;
+}
+
+int
+RenderFarmFrames::getNFramesRendered() const
+{
+    return _imp->nFramesRendered;
+}
+
+bool
+RenderFarmFrames::takeChunk(int worker,
+                            RenderFarm::WriterRange* chunk)
+{
+    RenderFarmFramesPrivate::WorkerChunk& w = _imp->getWorker(worker);
+
+    assert(!w.hasChunk);
+    if ( _imp->aborted || _imp->pending.empty() ) {
+        return false;
+    }
+    int chunkSize = std::max( 1, (int)std::ceil( (double)_imp->getNPendingFrames() / (NATRON_RENDER_FARM_CHUNKS_PER_WORKER * _imp->nWorkers) ) );
+    RenderFarm::WriterRange& front = _imp->pending.front();
+    *chunk = front;
+    if (front.sequential) {
+        ///Its frames can only be rendered in order by a single process
+        chunk->lastFrame = front.lastFrame;
+    } else {
+        chunk->lastFrame = std::min(front.lastFrame, front.firstFrame + chunkSize - 1);
+    }
+    if (chunk->lastFrame == front.lastFrame) {
+        _imp->pending.pop_front();
+    } else {
+        front.firstFrame = chunk->lastFrame + 1;
+    }
+    w.hasChunk = true;
+    w.chunk = *chunk;
+    w.renderedFrames.clear();
+
+    return true;
+}
+
+bool
+RenderFarmFrames::notifyFrameRendered(int worker,
+                                      int frame)
+{
+    RenderFarmFramesPrivate::WorkerChunk& w = _imp->getWorker(worker);
+
+    if ( !w.hasChunk || (frame < w.chunk.firstFrame) || (frame > w.chunk.lastFrame) || !w.renderedFrames.insert(frame).second ) {
+        return false;
+    }
+    ++_imp->nFramesRendered;
+
+    return true;
+}
+
+void
+RenderFarmFrames::releaseChunk(int worker)
+{
+    RenderFarmFramesPrivate::WorkerChunk& w = _imp->getWorker(worker);
+
+    if (!w.hasChunk) {
+        return;
+    }
+    std::list<RenderFarm::WriterRange> unrendered;
+    if (!_imp->aborted) {
+        RenderFarm::WriterRange range;
+        range.writerName = w.chunk.writerName;
+        range.sequential = w.chunk.sequential;
+        bool inRange = false;
+        for (int f = w.chunk.firstFrame; f <= w.chunk.lastFrame + 1; ++f) {
+            bool missing = f <= w.chunk.lastFrame && w.renderedFrames.find(f) == w.renderedFrames.end();
+            if ( missing && !_imp->canRetry(w.chunk.writerName, f) ) {
+                std::cerr << QObject::tr("Frame %1 of %2 could not be rendered, giving up.").arg(f).arg(w.chunk.writerName).toStdString() << std::endl;
+                missing = false;
+            }
+            if (missing && !inRange) {
+                range.firstFrame = f;
+                inRange = true;
+            } else if (!missing && inRange) {
+                range.lastFrame = f - 1;
+                unrendered.push_back(range);
+                inRange = false;
+            }
+        }
+    }
+    ///They are the most late frames, render them first
+    _imp->pending.splice(_imp->pending.begin(), unrendered);
+    w.hasChunk = false;
+    w.renderedFrames.clear();
+}
+
+bool
+RenderFarmFrames::hasChunk(int worker) const
+{
+    return _imp->getWorker(worker).hasChunk;
+}
+
+const RenderFarm::WriterRange&
+RenderFarmFrames::getChunk(int worker) const
+{
+    assert( _imp->getWorker(worker).hasChunk );
+
+    return _imp->getWorker(worker).chunk;
+}
+
+bool
+RenderFarmFrames::hasChunksInFlight() const
+{
+    for (std::vector<RenderFarmFramesPrivate::WorkerChunk>::const_iterator it = _imp->chunks.begin(); it != _imp->chunks.end(); ++it) {
+        if (it->hasChunk) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+RenderFarmFrames::abort()
+{
+    _imp->aborted = true;
+    _imp->pending.clear();
+}
+
+namespace {
+struct RenderFarmWorker
+{
+    int index; //< of the worker in the RenderFarmFrames
+    QProcess* process;
+    QLocalServer* server; //< the server where the worker connects its output channel
+    QLocalSocket* outputSocket; //< where the worker writes to
+    QLocalSocket* inputSocket; //< where the worker reads from, created when the worker sends kBgProcessServerCreatedShort
+    bool waitingForChunk; //< true if the worker asked for frames and was not replied yet
+    bool finished; //< true once the process ended
+
+    RenderFarmWorker(int index)
+    : index(index)
+    , process(0)
+    , server(0)
+    , outputSocket(0)
+    , inputSocket(0)
+    , waitingForChunk(false)
+    , finished(false)
+    {
+    }
+};
+}
+
+struct RenderFarmPrivate
+{
+    QString projectPath;
+    QString diskCachePath;
+    int nWorkers;
+    RenderFarmFrames frames;
+    std::list<RenderFarmWorker*> workers;
+    bool aborted;
+    QTimer* abortTimer;
+
+    RenderFarmPrivate(const QString & projectPath,
+                      const std::list<RenderFarm::WriterRange>& work,
+                      int nWorkers,
+                      const QString & diskCachePath)
+    : projectPath(projectPath)
+    , diskCachePath(diskCachePath)
+    , nWorkers( std::max(1, nWorkers) )
+    , frames( work, std::max(1, nWorkers) )
+    , workers()
+    , aborted(false)
+    , abortTimer(0)
+    {
+    }
+
+    RenderFarmWorker* findWorker(QObject* o) const
+    {
+        for (std::list<RenderFarmWorker*>::const_iterator it = workers.begin(); it != workers.end(); ++it) {
+            if ( (o == (*it)->process) || (o == (*it)->server) || (o == (*it)->outputSocket) ) {
+                return *it;
+            }
+        }
+        return 0;
+    }
+
+    bool hasAliveWorkers() const
+    {
+        for (std::list<RenderFarmWorker*>::const_iterator it = workers.begin(); it != workers.end(); ++it) {
+            if ( !(*it)->finished ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void writeToWorker(RenderFarmWorker* worker,
+                       const QString & message)
+    {
+        if ( !worker->inputSocket || worker->finished ) {
+            return;
+        }
+        if ( worker->inputSocket->state() != QLocalSocket::ConnectedState ) {
+            worker->inputSocket->waitForConnected(5000);
+        }
+        worker->inputSocket->write( (message + '\n').toUtf8() );
+        worker->inputSocket->flush();
+    }
+
+    /**
+     * @brief Replies to all the workers waiting for frames: either with a new chunk or, if nothing is left to render and
+     * no other worker may fail and give back frames, by telling them to exit.
+     **/
+    void replyToWaitingWorkers()
+    {
+        for (std::list<RenderFarmWorker*>::iterator it = workers.begin(); it != workers.end(); ++it) {
+            RenderFarmWorker* w = *it;
+            if ( !w->waitingForChunk || w->finished ) {
+                continue;
+            }
+            RenderFarm::WriterRange chunk;
+            if ( frames.takeChunk(w->index, &chunk) ) {
+                w->waitingForChunk = false;
+                writeToWorker( w, QString(kRenderChunkStringShort) + QString::number(chunk.firstFrame) + ' ' +
+                               QString::number(chunk.lastFrame) + ' ' + chunk.writerName );
+            } else if ( aborted || !frames.hasChunksInFlight() ) {
+                w->waitingForChunk = false;
+                writeToWorker(w, kNoMoreRenderChunksStringShort);
+            }
+        }
+    }
+};
+
+RenderFarm::RenderFarm(const QString & projectPath,
+                       const std::list<WriterRange>& work,
+                       int nWorkers,
+                       const QString & diskCachePath)
+    : QObject()
+    , _imp( new RenderFarmPrivate(projectPath,work,nWorkers,diskCachePath) )
+{
+}
+
+RenderFarm::~RenderFarm()
+{
+    for (std::list<RenderFarmWorker*>::iterator it = _imp->workers.begin(); it != _imp->workers.end(); ++it) {
+        RenderFarmWorker* w = *it;
+        QObject::disconnect(w->process, 0, this, 0);
+        if ( w->process->state() != QProcess::NotRunning ) {
+            w->process->kill();
+            w->process->waitForFinished();
+        }
+        delete w->process;
+        delete w->inputSocket;
+        if (w->server) {
+            w->server->close();
+        }
+        delete w->server;
+        delete w;
+    }
+    delete _imp->abortTimer;
+}
+
+bool
+RenderFarm::blockingRender()
+{
+    if (_imp->frames.getNFramesTotal() == 0) {
+        return true;
+    }
+
+    ///Do not launch more workers than frames
+    int nWorkers = std::min( _imp->nWorkers, _imp->frames.getNFramesTotal() );
+    for (int i = 0; i < nWorkers; ++i) {
+        RenderFarmWorker* w = new RenderFarmWorker(i);
+        w->server = new QLocalServer();
+        QObject::connect( w->server,SIGNAL( newConnection() ),this,SLOT( onNewConnectionPending() ) );
+        QString serverName;
+        {
+            QTemporaryFile tmpf( NATRON_APPLICATION_NAME "_FARM_PIPE_" + QString::number(i) + "_" + QString::number( std::rand() ) );
+            tmpf.open();
+            serverName = tmpf.fileName();
+            tmpf.remove();
+        }
+        w->server->listen(serverName);
+
+        QStringList args;
+        args << _imp->projectPath << "-b" << "--farm-worker" << "--workers" << QString::number(nWorkers);
+        args << "--IPCpipe" << w->server->fullServerName();
+        if ( !_imp->diskCachePath.isEmpty() ) {
+            args << "--cache-dir" << _imp->diskCachePath;
+        }
+        ///Each worker writes its own trace next to the one asked for, e.g: trace.json -> trace.worker0.json
+        const QString & traceFilePath = appPTR->getProfilingArgs().traceFilePath;
+        if ( !traceFilePath.isEmpty() ) {
+            QFileInfo traceInfo(traceFilePath);
+            QString workerTrace = traceInfo.dir().filePath( traceInfo.completeBaseName() + ".worker" + QString::number(i) );
+            if ( !traceInfo.suffix().isEmpty() ) {
+                workerTrace += "." + traceInfo.suffix();
+            }
+            args << "--trace" << workerTrace;
+        }
+        if ( appPTR->getProfilingArgs().printStats ) {
+            args << "--stats";
+        }
+
+        w->process = new QProcess;
+        ///Let the workers print directly in our terminal
+        w->process->setProcessChannelMode(QProcess::ForwardedChannels);
+        QObject::connect( w->process,SIGNAL( error(QProcess::ProcessError) ),this,SLOT( onProcessError(QProcess::ProcessError) ) );
+        QObject::connect( w->process,SIGNAL( finished(int,QProcess::ExitStatus) ),this,SLOT( onProcessEnd(int,QProcess::ExitStatus) ) );
+        _imp->workers.push_back(w);
+        w->process->start(QCoreApplication::applicationFilePath(), args);
+    }
+
+    _imp->abortTimer = new QTimer;
+    QObject::connect( _imp->abortTimer,SIGNAL( timeout() ),this,SLOT( onCheckAbortTimerTriggered() ) );
+    _imp->abortTimer->start(NATRON_RENDER_FARM_ABORT_POLL_MS);
+
+    QEventLoop loop;
+    QObject::connect( this,SIGNAL( renderFinished() ),&loop,SLOT( quit() ) );
+    if ( _imp->hasAliveWorkers() ) {
+        loop.exec();
+    }
+    _imp->abortTimer->stop();
+
+    return !_imp->aborted && _imp->frames.getNFramesRendered() >= _imp->frames.getNFramesTotal();
+}
+
+void
+RenderFarm::onNewConnectionPending()
+{
+    RenderFarmWorker* w = _imp->findWorker( sender() );
+    ///accept only 1 connection per worker!
+    if (!w || w->outputSocket) {
+        return;
+    }
+    w->outputSocket = w->server->nextPendingConnection();
+    QObject::connect( w->outputSocket, SIGNAL( readyRead() ), this, SLOT( onDataWrittenToSocket() ) );
+}
+
+void
+RenderFarm::onDataWrittenToSocket()
+{
+    ///always running in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    RenderFarmWorker* w = _imp->findWorker( sender() );
+    if (!w) {
+        return;
+    }
+    while ( w->outputSocket->canReadLine() ) {
+        QString str = w->outputSocket->readLine();
+        while ( str.endsWith('\n') ) {
+            str.chop(1);
+        }
+        if ( str.startsWith(kBgProcessServerCreatedShort) ) {
+            str = str.remove(kBgProcessServerCreatedShort);
+            ///the worker wants us to create the pipe for its input
+            if (!w->inputSocket) {
+                w->inputSocket = new QLocalSocket();
+                w->inputSocket->connectToServer(str,QLocalSocket::ReadWrite);
+            }
+        } else if ( str.startsWith(kRenderChunkRequestShort) ) {
+            ///The worker is done with its previous chunk: the frames it did not report failed or were skipped
+            _imp->frames.releaseChunk(w->index);
+            w->waitingForChunk = true;
+            _imp->replyToWaitingWorkers();
+        } else if ( str.startsWith(kFrameRenderedStringShort) ) {
+            str = str.remove(kFrameRenderedStringShort);
+            bool ok;
+            int frame = str.toInt(&ok);
+            if ( ok && _imp->frames.notifyFrameRendered(w->index, frame) ) {
+                QString frameStr = QString::number(frame);
+                appPTR->writeToOutputPipe(kFrameRenderedStringLong + frameStr + " (" + _imp->frames.getChunk(w->index).writerName + ")",
+                                          kFrameRenderedStringShort + frameStr);
+                QString progressStr = QString::number( (int)( 100. * _imp->frames.getNFramesRendered() / _imp->frames.getNFramesTotal() ) );
+                appPTR->writeToOutputPipe(kProgressChangedStringLong + progressStr + "%",kProgressChangedStringShort + progressStr);
+            }
+        } else if ( str.startsWith(kRenderingStartedShort) || str.startsWith(kRenderingFinishedStringShort) ||
+                    str.startsWith(kProgressChangedStringShort) ) {
+            ///The progress is aggregated by the coordinator
+        } else {
+            qDebug() << "RenderFarm: unable to interpret message from worker:" << str;
+        }
+    }
+}
+
+void
+RenderFarm::onProcessError(QProcess::ProcessError err)
+{
+    if (err == QProcess::FailedToStart) {
+        RenderFarmWorker* w = _imp->findWorker( sender() );
+        if (w && !w->finished) {
+            std::cerr << QObject::tr("A render farm worker failed to start").toStdString() << std::endl;
+            onProcessEnd(1, QProcess::CrashExit);
+        }
+    }
+}
+
+void
+RenderFarm::onProcessEnd(int exitCode,
+                         QProcess::ExitStatus stat)
+{
+    RenderFarmWorker* w = _imp->findWorker( sender() );
+    if (!w || w->finished) {
+        return;
+    }
+    w->finished = true;
+    if ( (stat == QProcess::CrashExit) || (exitCode != 0) ) {
+        std::cerr << QObject::tr("A render farm worker exited unexpectedly, its frames are rendered by the other workers.").toStdString() << std::endl;
+    }
+    ///Give back what the worker did not render to the other workers
+    _imp->frames.releaseChunk(w->index);
+    _imp->replyToWaitingWorkers();
+
+    if ( !_imp->hasAliveWorkers() ) {
+        emit renderFinished();
+    }
+}
+
+void
+RenderFarm::onCheckAbortTimerTriggered()
+{
+    if ( _imp->aborted || !appPTR->hasAbortAnyProcessingBeenCalled() ) {
+        return;
+    }
+    _imp->aborted = true;
+    _imp->frames.abort();
+    for (std::list<RenderFarmWorker*>::iterator it = _imp->workers.begin(); it != _imp->workers.end(); ++it) {
+        (*it)->waitingForChunk = false;
+        _imp->writeToWorker(*it, kAbortRenderingStringShort);
+    }
+}
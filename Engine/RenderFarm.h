@@ -0,0 +1,167 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_RENDERFARM_H_
+#define NATRON_ENGINE_RENDERFARM_H_
+
+#include <list>
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Global/Macros.h"
+CLANG_DIAG_OFF(deprecated)
+#include <QObject>
+#include <QProcess>
+#include <QString>
+CLANG_DIAG_ON(deprecated)
+
+/**
+ * @brief Splits the render of a project in background mode across several worker processes running on this computer.
+ * This is the coordinator, it runs in the process launched with NatronRenderer --workers N.
+ *
+ * Each worker is the same executable launched in background mode with the internal --farm-worker option. It loads the project
+ * once and then asks for frames to render in a loop, using the IPC channels of the ProcessHandler/ProcessInputChannel pair:
+ * - The worker writes kRenderChunkRequestShort to its output channel
+ * - The coordinator replies on the input channel with kRenderChunkStringShort followed by the frame range and the writer,
+ * or kNoMoreRenderChunksStringShort in which case the worker exits.
+ *
+ * The chunks are cut when a worker asks for work (guided scheduling): each chunk is a fraction of what is left, so workers
+ * that finish early keep getting work and the chunks get smaller towards the end of the render to balance the tail.
+ * If a worker dies or asks for more frames without having reported all the frames of its chunk, the missing frames are handed
+ * to the other workers (@see RenderFarmFrames).
+ * The frames rendered by the workers are reported by the coordinator as if it rendered them itself, so the progress of a render
+ * farm launched from the GUI is displayed as usual.
+ **/
+struct RenderFarmPrivate;
+class RenderFarm
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    struct WriterRange
+    {
+        QString writerName;
+        int firstFrame,lastFrame;
+        bool sequential; //< the writer or a node upstream can only render in order: its frames are never split across workers
+
+        WriterRange()
+        : writerName()
+        , firstFrame(0)
+        , lastFrame(0)
+        , sequential(false)
+        {
+        }
+    };
+
+    /**
+     * @param projectPath The absolute file path of the project the workers load
+     * @param diskCachePath If not empty, the disk cache location passed to the workers so they share it
+     **/
+    RenderFarm(const QString & projectPath,
+               const std::list<WriterRange>& work,
+               int nWorkers,
+               const QString & diskCachePath);
+
+    virtual ~RenderFarm();
+
+    /**
+     * @brief Launches the workers and runs an event loop until all the frames are rendered, the render is aborted
+     * or no worker is left. Returns true if all the frames were rendered.
+     **/
+    bool blockingRender();
+
+public slots:
+
+    /**
+     * @brief Called whenever a worker connects its output channel to the server dedicated to it.
+     **/
+    void onNewConnectionPending();
+
+    /**
+     * @brief Called whenever a worker writes something to its output channel.
+     **/
+    void onDataWrittenToSocket();
+
+    void onProcessError(QProcess::ProcessError err);
+
+    void onProcessEnd(int exitCode,QProcess::ExitStatus stat);
+
+    /**
+     * @brief Polled to forward an abort request received by this process to the workers.
+     **/
+    void onCheckAbortTimerTriggered();
+
+signals:
+
+    void renderFinished();
+
+private:
+
+    boost::scoped_ptr<RenderFarmPrivate> _imp;
+};
+
+/**
+ * @brief The bookkeeping of the frames of a RenderFarm: the frames left to hand out, the chunk each worker renders and the
+ * frames it reported rendered. It is kept apart from the management of the worker processes so that it can be tested.
+ * A frame that was handed out NATRON_RENDER_FARM_MAX_FRAME_ATTEMPTS times without being reported rendered is given up:
+ * it is never reported rendered and the render fails.
+ **/
+struct RenderFarmFramesPrivate;
+class RenderFarmFrames
+{
+public:
+
+    RenderFarmFrames(const std::list<RenderFarm::WriterRange>& work,int nWorkers);
+
+    ~RenderFarmFrames();
+
+    int getNFramesTotal() const WARN_UNUSED_RETURN;
+
+    int getNFramesRendered() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Cuts the next chunk for the given worker, a fraction of what is left to render, or all the frames left of a sequential
+     * writer. The worker must not have a chunk, @see releaseChunk. Returns false if nothing is left to hand out.
+     **/
+    bool takeChunk(int worker,RenderFarm::WriterRange* chunk);
+
+    /**
+     * @brief Returns true if the frame belongs to the chunk of the worker and was not reported yet.
+     **/
+    bool notifyFrameRendered(int worker,int frame);
+
+    /**
+     * @brief The worker is done with its chunk, or died: the frames of its chunk it did not report are handed out again.
+     **/
+    void releaseChunk(int worker);
+
+    bool hasChunk(int worker) const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the chunk of the worker, it must have one.
+     **/
+    const RenderFarm::WriterRange& getChunk(int worker) const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns true if a worker has a chunk, whose frames may thus be handed out again.
+     **/
+    bool hasChunksInFlight() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Nothing is handed out anymore.
+     **/
+    void abort();
+
+private:
+
+    boost::scoped_ptr<RenderFarmFramesPrivate> _imp;
+};
+
+#endif // NATRON_ENGINE_RENDERFARM_H_
@@ -0,0 +1,255 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadStorage>
+
+#include "Engine/AppManager.h"
+#include "Engine/Timer.h"
+
+///Maximum time a tile of a less urgent class waits for the more urgent work to be done
+#define NATRON_RENDER_QUEUE_MAX_PREEMPTION_MS 100
+
+///No wait of this class timed out since the tasks of the more urgent classes last completed
+#define NATRON_RENDER_QUEUE_NO_TIMEOUT ( (U64)-1 )
+
+using namespace Natron;
+
+///The priority class of the current thread, not set means eRenderPriorityInteractive
+static QThreadStorage<int> currentThreadPriority;
+
+struct RenderQueuePrivate
+{
+    mutable QMutex lock; //< protects all the fields below
+    QWaitCondition tasksDoneCond; //< woken up whenever a task ends
+    int activeTasks[NATRON_RENDER_PRIORITY_COUNT];
+    QAtomicInt nActiveTasks[NATRON_RENDER_PRIORITY_COUNT]; //< same as activeTasks, read without the lock by yieldToHigherPriority
+    U64 tasksCompleted[NATRON_RENDER_PRIORITY_COUNT];
+    U64 timedOutCompletions[NATRON_RENDER_PRIORITY_COUNT]; //< completions of the more urgent classes when a wait last timed out
+    U64 preemptions[NATRON_RENDER_PRIORITY_COUNT];
+    double totalLatency[NATRON_RENDER_PRIORITY_COUNT];
+    double maxLatency[NATRON_RENDER_PRIORITY_COUNT];
+    double firstTaskStart[NATRON_RENDER_PRIORITY_COUNT]; //< in seconds since clock was created, or -1 if no task started
+    TimeLapse clock;
+
+    RenderQueuePrivate()
+    : lock()
+    , tasksDoneCond()
+    , clock()
+    {
+        resetStats();
+    }
+
+    void resetStats()
+    {
+        for (int i = 0; i < NATRON_RENDER_PRIORITY_COUNT; ++i) {
+            activeTasks[i] = 0;
+            tasksCompleted[i] = 0;
+            timedOutCompletions[i] = NATRON_RENDER_QUEUE_NO_TIMEOUT;
+            preemptions[i] = 0;
+            totalLatency[i] = 0.;
+            maxLatency[i] = 0.;
+            firstTaskStart[i] = -1.;
+        }
+    }
+
+    bool hasHigherPriorityTasks(RenderPriorityEnum priority) const
+    {
+        ///Private, shouldn't lock
+        assert(!lock.tryLock());
+        for (int i = 0; i < (int)priority; ++i) {
+            if (activeTasks[i] > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ///Lock-free, may be slightly out of date
+    bool mayHaveHigherPriorityTasks(RenderPriorityEnum priority) const
+    {
+        for (int i = 0; i < (int)priority; ++i) {
+            if ( (int)nActiveTasks[i] > 0 ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    U64 getHigherPriorityCompletions(RenderPriorityEnum priority) const
+    {
+        ///Private, shouldn't lock
+        assert(!lock.tryLock());
+        U64 ret = 0;
+        for (int i = 0; i < (int)priority; ++i) {
+            ret += tasksCompleted[i];
+        }
+        return ret;
+    }
+};
+
+RenderQueue::RenderQueue()
+: _imp(new RenderQueuePrivate)
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void
+RenderQueue::beginTask(Natron::RenderPriorityEnum priority)
+{
+    QMutexLocker l(&_imp->lock);
+    ++_imp->activeTasks[priority];
+    _imp->nActiveTasks[priority].fetchAndAddOrdered(1);
+    if (_imp->firstTaskStart[priority] < 0.) {
+        _imp->firstTaskStart[priority] = _imp->clock.getTimeSinceCreation();
+    }
+}
+
+void
+RenderQueue::endTask(Natron::RenderPriorityEnum priority,
+                     double latency)
+{
+    QMutexLocker l(&_imp->lock);
+    --_imp->activeTasks[priority];
+    _imp->nActiveTasks[priority].fetchAndAddOrdered(-1);
+    assert(_imp->activeTasks[priority] >= 0);
+    ++_imp->tasksCompleted[priority];
+    _imp->totalLatency[priority] += latency;
+    _imp->maxLatency[priority] = std::max(_imp->maxLatency[priority], latency);
+    _imp->tasksDoneCond.wakeAll();
+}
+
+void
+RenderQueue::yieldToHigherPriority()
+{
+    RenderPriorityEnum priority = getCurrentThreadPriority();
+    if (priority == eRenderPriorityInteractive) {
+        return;
+    }
+
+    ///Called for every tile: don't take the lock unless a more urgent class has work in flight
+    if ( !_imp->mayHaveHigherPriorityTasks(priority) ) {
+        return;
+    }
+
+    QMutexLocker l(&_imp->lock);
+    if ( !_imp->hasHigherPriorityTasks(priority) ) {
+        return;
+    }
+    ///A wait already timed out on the tasks in flight: they may be waiting for an image this render holds,
+    ///don't make every tile wait for them again
+    if ( _imp->getHigherPriorityCompletions(priority) == _imp->timedOutCompletions[priority] ) {
+        return;
+    }
+    ++_imp->preemptions[priority];
+
+    TimeLapse waited;
+    while ( _imp->hasHigherPriorityTasks(priority) ) {
+        unsigned long remaining = (unsigned long)std::max(0., NATRON_RENDER_QUEUE_MAX_PREEMPTION_MS - waited.getTimeSinceCreation() * 1000.);
+        if ( (remaining == 0) || !_imp->tasksDoneCond.wait(&_imp->lock, remaining) ) {
+            if ( _imp->hasHigherPriorityTasks(priority) ) {
+                _imp->timedOutCompletions[priority] = _imp->getHigherPriorityCompletions(priority);
+            }
+            break;
+        }
+    }
+}
+
+RenderQueueStats
+RenderQueue::getStats(Natron::RenderPriorityEnum priority) const
+{
+    RenderQueueStats ret;
+    QMutexLocker l(&_imp->lock);
+
+    ret.activeTasks = _imp->activeTasks[priority];
+    ret.tasksCompleted = _imp->tasksCompleted[priority];
+    ret.preemptions = _imp->preemptions[priority];
+    ret.maxLatency = _imp->maxLatency[priority];
+    if (ret.tasksCompleted > 0) {
+        ret.averageLatency = _imp->totalLatency[priority] / ret.tasksCompleted;
+    }
+    if (_imp->firstTaskStart[priority] >= 0.) {
+        double elapsed = _imp->clock.getTimeSinceCreation() - _imp->firstTaskStart[priority];
+        if (elapsed > 0.) {
+            ret.throughput = ret.tasksCompleted / elapsed;
+        }
+    }
+    return ret;
+}
+
+void
+RenderQueue::resetStats()
+{
+    QMutexLocker l(&_imp->lock);
+    ///Keep the tasks in flight, they will call endTask()
+    int activeTasks[NATRON_RENDER_PRIORITY_COUNT];
+    std::copy(_imp->activeTasks, _imp->activeTasks + NATRON_RENDER_PRIORITY_COUNT, activeTasks);
+    _imp->resetStats();
+    std::copy(activeTasks, activeTasks + NATRON_RENDER_PRIORITY_COUNT, _imp->activeTasks);
+}
+
+Natron::RenderPriorityEnum
+RenderQueue::getCurrentThreadPriority()
+{
+    if ( !currentThreadPriority.hasLocalData() ) {
+        return eRenderPriorityInteractive;
+    }
+    return (RenderPriorityEnum)currentThreadPriority.localData();
+}
+
+void
+RenderQueue::setCurrentThreadPriority(Natron::RenderPriorityEnum priority)
+{
+    currentThreadPriority.setLocalData( (int)priority );
+}
+
+int
+RenderQueue::getThreadPoolPriority(Natron::RenderPriorityEnum priority)
+{
+    ///QtConcurrent queues its tasks with a priority of 0, which is what tiled renders use
+    switch (priority) {
+    case eRenderPriorityInteractive:
+        return 1;
+    case eRenderPriorityPlayback:
+        return 0;
+    case eRenderPriorityBackground:
+    default:
+        return -1;
+    }
+}
+
+RenderPrioritySetter::RenderPrioritySetter(Natron::RenderPriorityEnum priority)
+: _previous( RenderQueue::getCurrentThreadPriority() )
+{
+    RenderQueue::setCurrentThreadPriority(priority);
+}
+
+RenderPrioritySetter::~RenderPrioritySetter()
+{
+    RenderQueue::setCurrentThreadPriority(_previous);
+}
+
+RenderQueueTask::RenderQueueTask(Natron::RenderPriorityEnum priority,
+                                 double queuedTime)
+: _priority(priority)
+, _prioritySetter(priority)
+, _timer(new TimeLapse)
+, _queuedTime(queuedTime)
+{
+    appPTR->getRenderQueue()->beginTask(priority);
+}
+
+RenderQueueTask::~RenderQueueTask()
+{
+    appPTR->getRenderQueue()->endTask(_priority, _queuedTime + _timer->getTimeSinceCreation());
+}
@@ -0,0 +1,147 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_RENDERQUEUE_H_
+#define NATRON_ENGINE_RENDERQUEUE_H_
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#endif
+
+#include "Global/Macros.h"
+#include "Global/Enums.h"
+#include "Global/GlobalDefines.h"
+
+#define NATRON_RENDER_PRIORITY_COUNT 3
+
+/**
+ * @brief Latency and throughput of one priority class, as returned by RenderQueue::getStats()
+ **/
+struct RenderQueueStats
+{
+    int activeTasks; //< tasks of this class currently rendering
+    U64 tasksCompleted; //< tasks of this class finished since the last reset
+    U64 preemptions; //< how many times a tile of this class waited for more urgent work
+    double averageLatency; //< in seconds, from the submission to the end of a task
+    double maxLatency; //< in seconds
+    double throughput; //< tasks completed per second since the first task of this class started
+
+    RenderQueueStats()
+    : activeTasks(0)
+    , tasksCompleted(0)
+    , preemptions(0)
+    , averageLatency(0.)
+    , maxLatency(0.)
+    , throughput(0.)
+    {
+    }
+};
+
+/**
+ * @brief Arbitrates between the renders launched by the different schedulers which all share the global thread pool:
+ * the interactive current frame renders (ViewerCurrentFrameRequestScheduler), the viewer playback (ViewerDisplayScheduler)
+ * and the renders on disk (DefaultScheduler).
+ * Each render thread is tagged with a priority class (@see RenderPrioritySetter). Whenever a more urgent class has work in
+ * flight, renders of a less urgent class step aside at tile boundaries (@see yieldToHigherPriority) so that the CPU goes first
+ * to what the user is waiting for.
+ * There is a single instance owned by the AppManager.
+ **/
+struct RenderQueuePrivate;
+class RenderQueue
+    : public boost::noncopyable
+{
+public:
+
+    RenderQueue();
+
+    ~RenderQueue();
+
+    /**
+     * @brief Flags that a task (a frame for playback and renders on disk, a request for the current frame) of the given class
+     * starts rendering. Must be balanced with a call to endTask(). @see RenderQueueTask
+     **/
+    void beginTask(Natron::RenderPriorityEnum priority);
+
+    /**
+     * @brief Flags that the task has finished. latency is the time in seconds since the task was submitted.
+     **/
+    void endTask(Natron::RenderPriorityEnum priority,double latency);
+
+    /**
+     * @brief Called by the render threads before each frame and each tile: if a more urgent class than the calling thread's
+     * has tasks in flight, this blocks until they are done. It does not lock when nothing more urgent is in flight.
+     * The wait is bounded so that a less urgent render holding an image that the more urgent render is waiting for cannot
+     * dead-lock it. Once a wait timed out, the calling class does not wait again until a more urgent task completes, so that
+     * a frame of many tiles does not wait that long for each of them.
+     **/
+    void yieldToHigherPriority();
+
+    /**
+     * @brief Returns the latency and throughput of the given class. This is MT-safe and cheap enough to be polled.
+     **/
+    RenderQueueStats getStats(Natron::RenderPriorityEnum priority) const WARN_UNUSED_RETURN;
+
+    void resetStats();
+
+    /**
+     * @brief Returns the priority class of the calling thread. Threads that were not tagged are considered interactive
+     * so they are never slowed down.
+     **/
+    static Natron::RenderPriorityEnum getCurrentThreadPriority() WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the priority to pass to QThreadPool::start() for a runnable of the given class.
+     **/
+    static int getThreadPoolPriority(Natron::RenderPriorityEnum priority) WARN_UNUSED_RETURN;
+
+private:
+
+    friend class RenderPrioritySetter;
+
+    static void setCurrentThreadPriority(Natron::RenderPriorityEnum priority);
+
+    boost::scoped_ptr<RenderQueuePrivate> _imp;
+};
+
+/**
+ * @brief Tags the calling thread with the given priority class for the lifetime of the object.
+ **/
+class RenderPrioritySetter
+{
+    Natron::RenderPriorityEnum _previous;
+
+public:
+
+    RenderPrioritySetter(Natron::RenderPriorityEnum priority);
+
+    ~RenderPrioritySetter();
+};
+
+class TimeLapse;
+
+/**
+ * @brief Calls RenderQueue::beginTask on construction and RenderQueue::endTask on destruction. The task also tags the
+ * calling thread with its priority class.
+ **/
+class RenderQueueTask
+{
+    Natron::RenderPriorityEnum _priority;
+    RenderPrioritySetter _prioritySetter;
+    boost::scoped_ptr<TimeLapse> _timer;
+    double _queuedTime;
+
+public:
+
+    /**
+     * @param queuedTime Time in seconds the task spent queued before being started, accounted in the latency.
+     **/
+    RenderQueueTask(Natron::RenderPriorityEnum priority,double queuedTime = 0.);
+
+    ~RenderQueueTask();
+};
+
+#endif // NATRON_ENGINE_RENDERQUEUE_H_
@@ -0,0 +1,449 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "RenderStats.h"
+
+#include <list>
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QThreadStorage>
+
+#include "Engine/AppManager.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Timer.h"
+
+namespace {
+///The innermost NodeRenderTimer of the current thread
+struct CurrentTimer
+{
+    NodeRenderTimer* timer;
+
+    CurrentTimer()
+    : timer(0)
+    {
+    }
+};
+static QThreadStorage<CurrentTimer> currentTimer;
+
+typedef std::pair<std::string,NodeRenderStats> NamedNodeStats;
+
+static bool
+isMoreExpensive(const NamedNodeStats& a,
+                const NamedNodeStats& b)
+{
+    return a.second.cumulativeRenderTime > b.second.cumulativeRenderTime;
+}
+
+static double
+getHitRate(U64 hits,
+           U64 misses)
+{
+    return (hits + misses) == 0 ? 0. : 100. * hits / (hits + misses);
+}
+}
+
+///The statistics recorded by one thread
+struct RenderStatsShard
+{
+    QMutex lock; //< only contended when the statistics are read
+    std::map<const Natron::EffectInstance*,NodeRenderStats> nodes;
+    std::map<const std::string*,CacheRenderStats> caches;
+
+    RenderStatsShard()
+    : lock()
+    , nodes()
+    , caches()
+    {
+    }
+};
+
+namespace {
+struct LocalShard
+{
+    RenderStatsShard* shard; //< owned by the RenderStatsRegistryPrivate
+
+    LocalShard()
+    : shard(0)
+    {
+    }
+};
+
+static void
+mergeNodeStats(const NodeRenderStats& from,
+               NodeRenderStats* to)
+{
+    ///Threads render different frames concurrently, the last frame is the most recent one any thread rendered
+    if ( (from.cumulativeRenderTime > 0.) && ( (to->cumulativeRenderTime == 0.) || (from.lastFrame > to->lastFrame) ) ) {
+        to->lastFrame = from.lastFrame;
+        to->lastFrameRenderTime = from.lastFrameRenderTime;
+    } else if ( (from.cumulativeRenderTime > 0.) && (from.lastFrame == to->lastFrame) ) {
+        to->lastFrameRenderTime += from.lastFrameRenderTime;
+    }
+    to->cumulativeRenderTime += from.cumulativeRenderTime;
+    to->nRenderRoICalls += from.nRenderRoICalls;
+    to->cacheExactHits += from.cacheExactHits;
+    to->cacheConvertedHits += from.cacheConvertedHits;
+    to->cacheMisses += from.cacheMisses;
+    to->bytesAllocated += from.bytesAllocated;
+    ///Memory registered by a thread may be unregistered by another: the sum wraps around, it is only meaningful once summed up
+    to->pluginMemory += from.pluginMemory;
+}
+}
+
+struct RenderStatsRegistryPrivate
+{
+    QAtomicInt enabled;
+    QThreadStorage<LocalShard> localShard;
+    mutable QMutex shardsLock; //< protects shards and deletedNodes
+    std::list<RenderStatsShard*> shards; //< one per thread that recorded something
+    std::map<std::string,NodeRenderStats> deletedNodes; //< the statistics of the nodes deleted since the last reset()
+
+    RenderStatsRegistryPrivate()
+    : enabled(0)
+    , localShard()
+    , shardsLock()
+    , shards()
+    , deletedNodes()
+    {
+    }
+
+    ~RenderStatsRegistryPrivate()
+    {
+        for (std::list<RenderStatsShard*>::iterator it = shards.begin(); it != shards.end(); ++it) {
+            delete *it;
+        }
+    }
+
+    RenderStatsShard* getLocalShard()
+    {
+        LocalShard& local = localShard.localData();
+
+        if (!local.shard) {
+            local.shard = new RenderStatsShard;
+            QMutexLocker l(&shardsLock);
+            shards.push_back(local.shard);
+        }
+
+        return local.shard;
+    }
+};
+
+RenderStatsRegistry::RenderStatsRegistry()
+: _imp( new RenderStatsRegistryPrivate() )
+{
+}
+
+RenderStatsRegistry::~RenderStatsRegistry()
+{
+}
+
+void
+RenderStatsRegistry::setEnabled(bool enabled)
+{
+    _imp->enabled.fetchAndStoreRelaxed(enabled ? 1 : 0);
+}
+
+bool
+RenderStatsRegistry::isEnabled() const
+{
+    return (int)_imp->enabled != 0;
+}
+
+void
+RenderStatsRegistry::addRenderRoICall(const Natron::EffectInstance* node)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderStatsShard* shard = _imp->getLocalShard();
+    QMutexLocker l(&shard->lock);
+
+    ++shard->nodes[node].nRenderRoICalls;
+}
+
+void
+RenderStatsRegistry::addRenderTime(const Natron::EffectInstance* node,
+                                   SequenceTime time,
+                                   double seconds)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderStatsShard* shard = _imp->getLocalShard();
+    QMutexLocker l(&shard->lock);
+    NodeRenderStats& stats = shard->nodes[node];
+
+    stats.cumulativeRenderTime += seconds;
+    if (stats.lastFrame != time) {
+        stats.lastFrame = time;
+        stats.lastFrameRenderTime = 0.;
+    }
+    stats.lastFrameRenderTime += seconds;
+}
+
+void
+RenderStatsRegistry::addNodeCacheLookup(const Natron::EffectInstance* node,
+                                        CacheLookupResultEnum result)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderStatsShard* shard = _imp->getLocalShard();
+    QMutexLocker l(&shard->lock);
+    NodeRenderStats& stats = shard->nodes[node];
+
+    switch (result) {
+    case eCacheLookupResultMiss:
+        ++stats.cacheMisses;
+        break;
+    case eCacheLookupResultExactHit:
+        ++stats.cacheExactHits;
+        break;
+    case eCacheLookupResultConvertedHit:
+        ++stats.cacheConvertedHits;
+        break;
+    }
+}
+
+void
+RenderStatsRegistry::addNodeBytesAllocated(const Natron::EffectInstance* node,
+                                           U64 bytes)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderStatsShard* shard = _imp->getLocalShard();
+    QMutexLocker l(&shard->lock);
+
+    shard->nodes[node].bytesAllocated += bytes;
+}
+
+void
+RenderStatsRegistry::addPluginMemory(const Natron::EffectInstance* node,
+                                     long long nBytes)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderStatsShard* shard = _imp->getLocalShard();
+    QMutexLocker l(&shard->lock);
+
+    shard->nodes[node].pluginMemory += (U64)nBytes;
+}
+
+void
+RenderStatsRegistry::onNodeDeleted(const Natron::EffectInstance* node)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    std::string name = getNodeName(node);
+    NodeRenderStats stats;
+    bool found = false;
+    QMutexLocker l(&_imp->shardsLock);
+    for (std::list<RenderStatsShard*>::iterator it = _imp->shards.begin(); it != _imp->shards.end(); ++it) {
+        QMutexLocker sl(&(*it)->lock);
+        std::map<const Natron::EffectInstance*,NodeRenderStats>::iterator found_node = (*it)->nodes.find(node);
+        if ( found_node != (*it)->nodes.end() ) {
+            mergeNodeStats(found_node->second, &stats);
+            (*it)->nodes.erase(found_node);
+            found = true;
+        }
+    }
+    if (found) {
+        mergeNodeStats(stats, &_imp->deletedNodes[name]);
+    }
+}
+
+void
+RenderStatsRegistry::addCacheLookup(const std::string* cacheName,
+                                    bool hit)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderStatsShard* shard = _imp->getLocalShard();
+    QMutexLocker l(&shard->lock);
+    CacheRenderStats& stats = shard->caches[cacheName];
+
+    if (hit) {
+        ++stats.hits;
+    } else {
+        ++stats.misses;
+    }
+}
+
+void
+RenderStatsRegistry::addCacheEntryCreated(const std::string* cacheName,
+                                          U64 bytes)
+{
+    if ( !isEnabled() ) {
+        return;
+    }
+    RenderStatsShard* shard = _imp->getLocalShard();
+    QMutexLocker l(&shard->lock);
+    CacheRenderStats& stats = shard->caches[cacheName];
+
+    ++stats.entriesCreated;
+    stats.bytesAllocated += bytes;
+}
+
+void
+RenderStatsRegistry::getNodesStats(std::map<std::string,NodeRenderStats>* stats) const
+{
+    std::map<const Natron::EffectInstance*,NodeRenderStats> nodes;
+    {
+        QMutexLocker l(&_imp->shardsLock);
+        *stats = _imp->deletedNodes;
+        for (std::list<RenderStatsShard*>::const_iterator it = _imp->shards.begin(); it != _imp->shards.end(); ++it) {
+            QMutexLocker sl(&(*it)->lock);
+            for (std::map<const Natron::EffectInstance*,NodeRenderStats>::const_iterator it2 = (*it)->nodes.begin();
+                 it2 != (*it)->nodes.end(); ++it2) {
+                mergeNodeStats(it2->second, &nodes[it2->first]);
+            }
+        }
+    }
+
+    ///Resolve the names out of the locks
+    for (std::map<const Natron::EffectInstance*,NodeRenderStats>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        mergeNodeStats( it->second, &(*stats)[getNodeName(it->first)] );
+    }
+    for (std::map<std::string,NodeRenderStats>::iterator it = stats->begin(); it != stats->end(); ++it) {
+        if ( (long long)it->second.pluginMemory < 0 ) {
+            ///Registered before the last reset()
+            it->second.pluginMemory = 0;
+        }
+    }
+}
+
+void
+RenderStatsRegistry::getCachesStats(std::map<std::string,CacheRenderStats>* stats) const
+{
+    QMutexLocker l(&_imp->shardsLock);
+
+    stats->clear();
+    for (std::list<RenderStatsShard*>::const_iterator it = _imp->shards.begin(); it != _imp->shards.end(); ++it) {
+        QMutexLocker sl(&(*it)->lock);
+        for (std::map<const std::string*,CacheRenderStats>::const_iterator it2 = (*it)->caches.begin(); it2 != (*it)->caches.end(); ++it2) {
+            CacheRenderStats& cache = (*stats)[*it2->first];
+            cache.hits += it2->second.hits;
+            cache.misses += it2->second.misses;
+            cache.entriesCreated += it2->second.entriesCreated;
+            cache.bytesAllocated += it2->second.bytesAllocated;
+        }
+    }
+}
+
+void
+RenderStatsRegistry::reset()
+{
+    QMutexLocker l(&_imp->shardsLock);
+
+    _imp->deletedNodes.clear();
+    for (std::list<RenderStatsShard*>::iterator it = _imp->shards.begin(); it != _imp->shards.end(); ++it) {
+        QMutexLocker sl(&(*it)->lock);
+        (*it)->nodes.clear();
+        (*it)->caches.clear();
+    }
+}
+
+std::string
+RenderStatsRegistry::getNodeName(const Natron::EffectInstance* node) const
+{
+    return node->getName_mt_safe();
+}
+
+void
+RenderStatsRegistry::print(std::ostream& os) const
+{
+    std::map<std::string,NodeRenderStats> nodesMap;
+    std::map<std::string,CacheRenderStats> caches;
+
+    getNodesStats(&nodesMap);
+    getCachesStats(&caches);
+
+    std::vector<NamedNodeStats> nodes( nodesMap.begin(), nodesMap.end() );
+    std::stable_sort(nodes.begin(), nodes.end(), isMoreExpensive);
+
+    double totalTime = 0.;
+    for (std::vector<NamedNodeStats>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        totalTime += it->second.cumulativeRenderTime;
+    }
+
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "================================ Render statistics ================================" << std::endl;
+    os << std::left << std::setw(24) << "Node" << std::right
+       << std::setw(11) << "Time (s)" << std::setw(7) << "%"
+       << std::setw(12) << "Last frame" << std::setw(9) << "Calls"
+       << std::setw(9) << "Hits" << std::setw(11) << "Converted" << std::setw(9) << "Misses"
+       << std::setw(12) << "Alloc (MB)" << std::setw(13) << "Plugin (MB)" << std::endl;
+    for (std::vector<NamedNodeStats>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        const NodeRenderStats& s = it->second;
+        os << std::left << std::setw(24) << it->first << std::right
+           << std::setw(11) << s.cumulativeRenderTime
+           << std::setw(7) << std::setprecision(1) << (totalTime > 0. ? 100. * s.cumulativeRenderTime / totalTime : 0.)
+           << std::setprecision(3) << std::setw(12) << s.lastFrameRenderTime << std::setw(9) << s.nRenderRoICalls
+           << std::setw(9) << s.cacheExactHits << std::setw(11) << s.cacheConvertedHits << std::setw(9) << s.cacheMisses
+           << std::setprecision(1) << std::setw(12) << s.bytesAllocated / (1024. * 1024.)
+           << std::setw(13) << s.pluginMemory / (1024. * 1024.) << std::setprecision(3) << std::endl;
+    }
+    os << std::left << std::setw(24) << "Total" << std::right << std::setw(11) << totalTime << std::endl;
+
+    os << std::endl;
+    os << std::left << std::setw(24) << "Cache" << std::right
+       << std::setw(11) << "Hits" << std::setw(11) << "Misses" << std::setw(12) << "Hit rate"
+       << std::setw(11) << "Created" << std::setw(12) << "Alloc (MB)" << std::endl;
+    for (std::map<std::string,CacheRenderStats>::iterator it = caches.begin(); it != caches.end(); ++it) {
+        const CacheRenderStats& s = it->second;
+        os << std::left << std::setw(24) << it->first << std::right
+           << std::setw(11) << s.hits << std::setw(11) << s.misses
+           << std::setprecision(1) << std::setw(11) << getHitRate(s.hits, s.misses) << "%"
+           << std::setw(11) << s.entriesCreated << std::setw(12) << s.bytesAllocated / (1024. * 1024.)
+           << std::setprecision(3) << std::endl;
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+NodeRenderTimer::NodeRenderTimer(const Natron::EffectInstance* node,
+                                 SequenceTime time)
+: _registry(0)
+, _node(node)
+, _time(time)
+, _timer()
+, _nestedTime(0.)
+, _parent(0)
+{
+    RenderStatsRegistry* registry = appPTR ? appPTR->getRenderStats() : 0;
+    if ( !registry || !registry->isEnabled() ) {
+        return;
+    }
+    _registry = registry;
+    _timer.reset(new TimeLapse);
+    CurrentTimer& current = currentTimer.localData();
+
+    _parent = current.timer;
+    current.timer = this;
+}
+
+NodeRenderTimer::~NodeRenderTimer()
+{
+    if (!_registry) {
+        return;
+    }
+    double elapsed = _timer->getTimeSinceCreation();
+
+    currentTimer.localData().timer = _parent;
+    if (_parent) {
+        _parent->_nestedTime += elapsed;
+    }
+    _registry->addRenderTime( _node, _time, std::max(0., elapsed - _nestedTime) );
+}
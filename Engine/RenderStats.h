@@ -0,0 +1,183 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_RENDERSTATS_H_
+#define NATRON_ENGINE_RENDERSTATS_H_
+
+#include <map>
+#include <string>
+#include <ostream>
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#endif
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+class TimeLapse;
+namespace Natron {
+class EffectInstance;
+}
+
+/**
+ * @brief The statistics of a node, as returned by RenderStatsRegistry::getNodesStats()
+ **/
+struct NodeRenderStats
+{
+    double cumulativeRenderTime; //< seconds spent in the render action of the node, summed over all threads
+    double lastFrameRenderTime; //< the same for lastFrame only
+    SequenceTime lastFrame; //< the last frame the render action was called for
+    U64 nRenderRoICalls;
+    U64 cacheExactHits; //< the image was found in the cache as requested
+    U64 cacheConvertedHits; //< an image of a higher resolution was found and downscaled
+    U64 cacheMisses;
+    U64 bytesAllocated; //< image memory allocated in the caches for the node
+    U64 pluginMemory; //< memory currently registered by the plug-in with registerPluginMemory
+
+    NodeRenderStats()
+    : cumulativeRenderTime(0.)
+    , lastFrameRenderTime(0.)
+    , lastFrame(0)
+    , nRenderRoICalls(0)
+    , cacheExactHits(0)
+    , cacheConvertedHits(0)
+    , cacheMisses(0)
+    , bytesAllocated(0)
+    , pluginMemory(0)
+    {
+    }
+};
+
+/**
+ * @brief The statistics of a Natron::Cache, as returned by RenderStatsRegistry::getCachesStats()
+ **/
+struct CacheRenderStats
+{
+    U64 hits;
+    U64 misses;
+    U64 entriesCreated;
+    U64 bytesAllocated; //< memory of the entries created
+
+    CacheRenderStats()
+    : hits(0)
+    , misses(0)
+    , entriesCreated(0)
+    , bytesAllocated(0)
+    {
+    }
+};
+
+/**
+ * @brief Accumulates the statistics fed by the nodes (through their EffectInstance) and the caches since the last reset(),
+ * so that a production script can be profiled without a profiler: NatronRenderer --stats prints them when the render ends.
+ * Nothing is recorded unless the registry is enabled, which the AppManager only does for --stats.
+ * The nodes are identified by their EffectInstance and the caches by the address of their name: names are only resolved
+ * when the statistics are read. Each thread records into its own table so that the render threads do not contend,
+ * the tables are summed up when the statistics are read.
+ * There is a single instance owned by the AppManager. All functions are thread-safe.
+ **/
+struct RenderStatsRegistryPrivate;
+class RenderStatsRegistry
+    : public boost::noncopyable
+{
+public:
+
+    enum CacheLookupResultEnum
+    {
+        eCacheLookupResultMiss = 0,
+        eCacheLookupResultExactHit,
+        eCacheLookupResultConvertedHit
+    };
+
+    RenderStatsRegistry();
+
+    virtual ~RenderStatsRegistry();
+
+    /**
+     * @brief When disabled, which is the default, the functions below return immediately.
+     **/
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const WARN_UNUSED_RETURN;
+
+    void addRenderRoICall(const Natron::EffectInstance* node);
+
+    void addRenderTime(const Natron::EffectInstance* node,SequenceTime time,double seconds);
+
+    void addNodeCacheLookup(const Natron::EffectInstance* node,CacheLookupResultEnum result);
+
+    void addNodeBytesAllocated(const Natron::EffectInstance* node,U64 bytes);
+
+    /**
+     * @brief Called when the plug-in (un)registers memory, nBytes is negative when memory is unregistered.
+     **/
+    void addPluginMemory(const Natron::EffectInstance* node,long long nBytes);
+
+    /**
+     * @brief Called by the EffectInstance destructor: its statistics are kept under its name since the pointer
+     * can no longer be resolved nor told apart from a new node allocated at the same address.
+     **/
+    void onNodeDeleted(const Natron::EffectInstance* node);
+
+    /**
+     * @param cacheName The name of the cache, which must stay valid as long as the statistics are used.
+     **/
+    void addCacheLookup(const std::string* cacheName,bool hit);
+
+    void addCacheEntryCreated(const std::string* cacheName,U64 bytes);
+
+    /**
+     * @brief Returns the statistics of the nodes by name. The statistics of the nodes with the same name are summed up.
+     **/
+    void getNodesStats(std::map<std::string,NodeRenderStats>* stats) const;
+
+    void getCachesStats(std::map<std::string,CacheRenderStats>* stats) const;
+
+    void reset();
+
+    /**
+     * @brief Prints a table of the nodes, the most expensive first, followed by the caches.
+     * The stream formatting is left as it was.
+     **/
+    void print(std::ostream& os) const;
+
+protected:
+
+    /**
+     * @brief Returns the name printed for the node, this is the name of the node.
+     **/
+    virtual std::string getNodeName(const Natron::EffectInstance* node) const;
+
+private:
+
+    boost::scoped_ptr<RenderStatsRegistryPrivate> _imp;
+};
+
+/**
+ * @brief Measures the time spent by the calling thread in the render action of a node and adds it to the registry of the
+ * AppManager when destroyed. The time spent by nested timers of the same thread (e.g: the plug-in fetching an input image
+ * which renders an upstream node) is not accounted for the outer node, so that the times of the nodes sum up to the
+ * total render time. Does nothing if the registry is disabled.
+ **/
+class NodeRenderTimer
+{
+    RenderStatsRegistry* _registry; //< NULL if not recording
+    const Natron::EffectInstance* _node;
+    SequenceTime _time;
+    boost::scoped_ptr<TimeLapse> _timer;
+    double _nestedTime; //< seconds spent in timers nested in this one
+    NodeRenderTimer* _parent;
+
+public:
+
+    NodeRenderTimer(const Natron::EffectInstance* node,SequenceTime time);
+
+    ~NodeRenderTimer();
+};
+
+#endif // NATRON_ENGINE_RENDERSTATS_H_
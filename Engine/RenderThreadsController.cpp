@@ -0,0 +1,259 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "RenderThreadsController.h"
+
+#include <map>
+#include <cassert>
+#include <sstream>
+#include <algorithm>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QThreadStorage>
+
+#include "Engine/Log.h"
+#include "Engine/Timer.h"
+
+///Length of a measurement interval, in seconds
+#define NATRON_THREADS_CONTROLLER_INTERVAL 1.
+
+///An interval must contain at least that many frames to be significant
+#define NATRON_THREADS_CONTROLLER_MIN_FRAMES 2
+
+///A thread is only removed if the throughput with it is lower by at least this ratio, so that the noise of the
+///measures does not make the count drift away from the cores count
+#define NATRON_THREADS_CONTROLLER_MIN_DROP 0.05
+
+///Number of intervals after which a settled count is probed again
+#define NATRON_THREADS_CONTROLLER_REPROBE_INTERVALS 10
+
+namespace {
+///The tiles threads of the current thread, 0 if not set
+struct TilesThreads
+{
+    int nThreads;
+
+    TilesThreads()
+    : nThreads(0)
+    {
+    }
+};
+static QThreadStorage<TilesThreads> currentTilesThreads;
+}
+
+struct RenderThreadsControllerPrivate
+{
+    QAtomicInt targetNThreads;
+    QAtomicInt maxThreads;
+
+    mutable QMutex lock; //< protects all the fields below
+    TimeLapse clock;
+    double intervalStart; //< clock time at which the interval started
+    int intervalNThreads; //< number of threads running when the interval started
+    int intervalNFrames; //< frames rendered since the interval started
+    double intervalFramesTime; //< sum of the wall time spent rendering these frames
+    std::map<int,double> throughput; //< smoothed frames per second measured for each count of threads
+    bool settled; //< false while probing for fewer threads after reset()
+    int intervalsSinceProbe;
+    std::string lastDecision;
+
+    RenderThreadsControllerPrivate()
+    : targetNThreads(1)
+    , maxThreads(1)
+    , lock()
+    , clock()
+    , intervalStart(0.)
+    , intervalNThreads(0)
+    , intervalNFrames(0)
+    , intervalFramesTime(0.)
+    , throughput()
+    , settled(false)
+    , intervalsSinceProbe(0)
+    , lastDecision()
+    {
+    }
+
+    double getThroughput(int nThreads) const
+    {
+        std::map<int,double>::const_iterator found = throughput.find(nThreads);
+
+        return found == throughput.end() ? 0. : found->second;
+    }
+
+    ///Returns true if the throughput measured with more threads is lower than the one measured with fewer threads
+    static bool isDrop(double moreThreads,
+                       double fewerThreads)
+    {
+        return moreThreads < fewerThreads * (1. - NATRON_THREADS_CONTROLLER_MIN_DROP);
+    }
+
+    int decide(int nThreads,
+               double framesPerSecond)
+    {
+        ///Private, shouldn't lock
+        assert( !lock.tryLock() );
+
+        int nMaxThreads = (int)maxThreads;
+        double& measured = throughput[nThreads];
+
+        measured = measured == 0. ? framesPerSecond : (measured + framesPerSecond) / 2.;
+
+        double above = getThroughput(nThreads + 1);
+        double below = getThroughput(nThreads - 1);
+        int target = nThreads;
+        const char* reason;
+        if ( (above > 0.) && !isDrop(above, measured) ) {
+            ///Going below the cores count is only worth it if the extra threads made rendering slower
+            target = nThreads + 1;
+            settled = true;
+            intervalsSinceProbe = 0;
+            reason = "more threads were not slower";
+        } else if ( (below > 0.) && isDrop(measured, below) ) {
+            target = nThreads - 1;
+            reason = "the last thread made rendering slower";
+        } else if ( !settled && (nThreads > 1) && (below == 0.) ) {
+            target = nThreads - 1;
+            reason = "probing with one thread less";
+        } else if (!settled) {
+            settled = true;
+            reason = "settled";
+        } else if (++intervalsSinceProbe >= NATRON_THREADS_CONTROLLER_REPROBE_INTERVALS) {
+            ///The graph or the load of the machine may have changed since the neighbours were measured.
+            ///Only the neighbour is measured again, this count keeps its own sample to compare with.
+            intervalsSinceProbe = 0;
+            if (nThreads < nMaxThreads) {
+                target = nThreads + 1;
+            } else if (nThreads > 1) {
+                target = nThreads - 1;
+            }
+            if (target != nThreads) {
+                throughput.erase(target);
+            }
+            reason = "probing again";
+        } else {
+            reason = "settled";
+        }
+        target = std::max( 1, std::min(target, nMaxThreads) );
+        targetNThreads.fetchAndStoreRelaxed(target);
+
+        std::stringstream ss;
+        ss << nThreads << " threads: " << framesPerSecond << " fps -> " << target << " threads (" << reason << ")";
+        lastDecision = ss.str();
+        Natron::Log::print(lastDecision);
+
+        return target;
+    }
+
+    void startInterval(int nThreads)
+    {
+        ///Private, shouldn't lock
+        assert( !lock.tryLock() );
+
+        intervalStart = clock.getTimeSinceCreation();
+        intervalNThreads = nThreads;
+        intervalNFrames = 0;
+        intervalFramesTime = 0.;
+    }
+};
+
+RenderThreadsController::RenderThreadsController()
+: _imp( new RenderThreadsControllerPrivate() )
+{
+}
+
+RenderThreadsController::~RenderThreadsController()
+{
+}
+
+void
+RenderThreadsController::reset(int nThreads,
+                               int maxThreads)
+{
+    QMutexLocker l(&_imp->lock);
+
+    _imp->maxThreads.fetchAndStoreRelaxed( std::max(1, maxThreads) );
+    ///Start from the cores count, the threads are removed only once they are measured to make rendering slower
+    _imp->targetNThreads.fetchAndStoreRelaxed( (int)_imp->maxThreads );
+    _imp->throughput.clear();
+    _imp->settled = false;
+    _imp->intervalsSinceProbe = 0;
+    _imp->startInterval(nThreads);
+}
+
+void
+RenderThreadsController::notifyFrameRendered(double frameRenderTime)
+{
+    QMutexLocker l(&_imp->lock);
+
+    ++_imp->intervalNFrames;
+    _imp->intervalFramesTime += frameRenderTime;
+}
+
+int
+RenderThreadsController::getOptimalNThreads(int nThreads)
+{
+    QMutexLocker l(&_imp->lock);
+
+    if (nThreads != _imp->intervalNThreads) {
+        ///The count changed during the interval, the measure would be meaningless
+        _imp->startInterval(nThreads);
+
+        return (int)_imp->targetNThreads;
+    }
+
+    double elapsed = _imp->clock.getTimeSinceCreation() - _imp->intervalStart;
+    int nFrames = _imp->intervalNFrames;
+    if ( (elapsed < NATRON_THREADS_CONTROLLER_INTERVAL) || (nFrames < NATRON_THREADS_CONTROLLER_MIN_FRAMES) ||
+         (_imp->intervalFramesTime <= 0.) ) {
+        return (int)_imp->targetNThreads;
+    }
+
+    ///Each of the threads renders a frame in the average frame time. This does not depend on how many threads were
+    ///idle at the start of the interval, e.g: while the scheduler was still ramping up to the count.
+    double framesPerSecond = nThreads * nFrames / _imp->intervalFramesTime;
+    _imp->startInterval(nThreads);
+
+    return _imp->decide(nThreads, framesPerSecond);
+}
+
+int
+RenderThreadsController::onIntervalMeasured(int nThreads,
+                                            double framesPerSecond)
+{
+    QMutexLocker l(&_imp->lock);
+
+    return _imp->decide(nThreads, framesPerSecond);
+}
+
+int
+RenderThreadsController::getTilesThreadsPerFrame() const
+{
+    return std::max( 1, (int)_imp->maxThreads / std::max(1, (int)_imp->targetNThreads) );
+}
+
+std::string
+RenderThreadsController::getLastDecision() const
+{
+    QMutexLocker l(&_imp->lock);
+
+    return _imp->lastDecision;
+}
+
+void
+RenderThreadsController::setCurrentThreadTilesThreads(int nThreads)
+{
+    currentTilesThreads.localData().nThreads = nThreads;
+}
+
+int
+RenderThreadsController::getCurrentThreadTilesThreads()
+{
+    if ( !currentTilesThreads.hasLocalData() ) {
+        return 0;
+    }
+
+    return currentTilesThreads.localData().nThreads;
+}
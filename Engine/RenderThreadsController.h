@@ -0,0 +1,90 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_RENDERTHREADSCONTROLLER_H_
+#define NATRON_ENGINE_RENDERTHREADSCONTROLLER_H_
+
+#include <string>
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#endif
+
+#include "Global/Macros.h"
+
+/**
+ * @brief Decides how many frames an OutputSchedulerThread renders in parallel when the number of parallel renders
+ * is automatic in the preferences. It starts from one render thread per core, then measures the wall time of each
+ * frame over intervals of about a second and removes a thread only when the throughput measured with one thread less
+ * is higher (e.g: the graph is bound by the memory bandwidth or the disk).
+ * Every few intervals the neighbouring count is probed again, as the graph or the load of the machine may have changed.
+ * The decisions are written to the Natron::Log.
+ *
+ * The count of parallel frames is traded against the threads each frame uses to render its tiles:
+ * @see getTilesThreadsPerFrame
+ **/
+struct RenderThreadsControllerPrivate;
+class RenderThreadsController
+    : public boost::noncopyable
+{
+public:
+
+    RenderThreadsController();
+
+    ~RenderThreadsController();
+
+    /**
+     * @brief Forgets the measurements, called when a render starts. The count starts at maxThreads.
+     * @param nThreads The number of render threads currently running
+     * @param maxThreads The count never goes above this, e.g: the number of cores
+     **/
+    void reset(int nThreads,int maxThreads);
+
+    /**
+     * @brief Called by the render threads when they finished a frame. Thread-safe.
+     * @param frameRenderTime The wall time spent rendering the frame, in seconds
+     **/
+    void notifyFrameRendered(double frameRenderTime);
+
+    /**
+     * @brief Returns the number of render threads the scheduler should converge to. If the current interval is over,
+     * it is measured and a new decision is taken.
+     * @param nThreads The number of render threads currently running, the intervals during which it changed are discarded.
+     **/
+    int getOptimalNThreads(int nThreads);
+
+    /**
+     * @brief Takes a decision from the frames per second measured while nThreads were rendering. Returns the new count.
+     * This is what getOptimalNThreads() calls once an interval is over, exposed for testing.
+     **/
+    int onIntervalMeasured(int nThreads,double framesPerSecond);
+
+    /**
+     * @brief Returns the number of threads each frame should use to render its tiles: the cores are shared between the
+     * frames rendered in parallel. Thread-safe.
+     **/
+    int getTilesThreadsPerFrame() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns a short explanation of the last decision taken.
+     **/
+    std::string getLastDecision() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Sets the number of threads that renderRoI may use to render the tiles of the frames rendered by the calling thread.
+     * 0 means no constraint. This is set by the render threads of the schedulers before rendering each frame.
+     **/
+    static void setCurrentThreadTilesThreads(int nThreads);
+
+    static int getCurrentThreadTilesThreads() WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<RenderThreadsControllerPrivate> _imp;
+};
+
+#endif // NATRON_ENGINE_RENDERTHREADSCONTROLLER_H_
@@ -0,0 +1,484 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "RenderTrace.h"
+
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <map>
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QCoreApplication>
+
+#include "Engine/AppManager.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Timer.h"
+
+namespace {
+///The innermost span of the current thread
+struct CurrentSpan
+{
+    const RenderTraceSpan* span;
+
+    CurrentSpan()
+    : span(0)
+    {
+    }
+};
+static QThreadStorage<CurrentSpan> currentSpan;
+
+static const char*
+getSpanKindName(RenderTraceEvent::SpanKindEnum kind)
+{
+    switch (kind) {
+    case RenderTraceEvent::eSpanKindRenderRoI:
+        return "renderRoI";
+    case RenderTraceEvent::eSpanKindRenderRoIInternal:
+        return "renderRoIInternal";
+    case RenderTraceEvent::eSpanKindTile:
+        return "tile";
+    case RenderTraceEvent::eSpanKindCacheLookup:
+        return "cacheLookup";
+    case RenderTraceEvent::eSpanKindConversion:
+        return "conversion";
+    case RenderTraceEvent::eSpanKindMipMap:
+        return "mipmap";
+    case RenderTraceEvent::eSpanKindPluginRender:
+        return "pluginRender";
+    }
+
+    return "unknown";
+}
+
+static std::string
+escapeJSON(const std::string& str)
+{
+    std::string ret;
+
+    ret.reserve( str.size() );
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        char c = str[i];
+        if ( (c == '"') || (c == '\\') ) {
+            ret.push_back('\\');
+            ret.push_back(c);
+        } else if ( (unsigned char)c < 0x20 ) {
+            std::stringstream ss;
+            ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c;
+            ret.append( ss.str() );
+        } else {
+            ret.push_back(c);
+        }
+    }
+
+    return ret;
+}
+}
+
+///Maximum number of threads recording in a trace: threads of the global pool that expired give their buffer to new threads
+#define NATRON_RENDER_TRACE_MAX_THREADS 256
+
+namespace {
+///The ring buffer of one thread
+struct RenderTraceThreadBuffer
+{
+    QMutex lock; //< taken by its thread to record and by getEvents(), so it is not contended while rendering
+    std::vector<RenderTraceEvent> ring; //< grows up to the capacity, then the oldest event is overwritten
+    U64 nRecorded;
+    std::string threadName;
+    QAtomicInt threadExited; //< the buffer can be given to another thread
+
+    RenderTraceThreadBuffer(const std::string& name)
+    : lock()
+    , ring()
+    , nRecorded(0)
+    , threadName(name)
+    , threadExited(0)
+    {
+    }
+};
+
+///What a thread knows of a trace, deleted by Qt when the thread exits
+struct RenderTraceThreadData
+{
+    int generation; //< of the trace when the thread registered
+    int index; //< -1 if the thread has no buffer
+    boost::shared_ptr<RenderTraceThreadBuffer> buffer;
+    std::map<std::string,int> nameIds; //< the names this thread already interned
+
+    RenderTraceThreadData()
+    : generation(-1)
+    , index(-1)
+    , buffer()
+    , nameIds()
+    {
+    }
+
+    ~RenderTraceThreadData()
+    {
+        if (buffer) {
+            buffer->threadExited.fetchAndStoreRelaxed(1);
+        }
+    }
+};
+
+///The generations are unique across the traces: Qt gives the thread storage of a deleted trace to the next one created,
+///the threads must not take the data they had in the deleted trace for theirs
+static QAtomicInt lastGeneration(0);
+
+static int
+newGeneration()
+{
+    return lastGeneration.fetchAndAddOrdered(1) + 1;
+}
+
+static bool
+startsBefore(const RenderTraceEvent& first,
+             const RenderTraceEvent& second)
+{
+    return first.start < second.start;
+}
+}
+
+struct RenderTracePrivate
+{
+    QAtomicInt enabled;
+    TimeLapse clock;
+    int capacity;
+    QThreadStorage<RenderTraceThreadData*> threadData;
+    QAtomicInt generation; //< changed by clear() so that the threads register again, written under the lock
+    mutable QMutex lock; //< protects all the fields below, taken when a thread first records or interns a name
+    std::vector< boost::shared_ptr<RenderTraceThreadBuffer> > threads; //< indexed by thread index
+    std::vector<std::string> names; //< indexed by name id
+    std::map<std::string,int> nameIds;
+
+    RenderTracePrivate(int capacity)
+    : enabled(0)
+    , clock()
+    , capacity( std::max(1, capacity) )
+    , threadData()
+    , generation( newGeneration() )
+    , lock()
+    , threads()
+    , names()
+    , nameIds()
+    {
+    }
+
+    /**
+     * @brief Returns the data of the calling thread, registering it if it did not record since the trace was last cleared.
+     **/
+    RenderTraceThreadData* getThreadData();
+};
+
+RenderTraceThreadData*
+RenderTracePrivate::getThreadData()
+{
+    RenderTraceThreadData* data;
+    if ( threadData.hasLocalData() ) {
+        data = threadData.localData();
+    } else {
+        data = new RenderTraceThreadData;
+        threadData.setLocalData(data);
+    }
+
+    if ( data->generation == (int)generation ) {
+        return data;
+    }
+
+    std::string name;
+    QThread* thread = QThread::currentThread();
+    if ( thread && !thread->objectName().isEmpty() ) {
+        name = thread->objectName().toStdString();
+    }
+    if (data->buffer) {
+        data->buffer->threadExited.fetchAndStoreRelaxed(1);
+        data->buffer.reset();
+    }
+    data->index = -1;
+    data->nameIds.clear();
+
+    QMutexLocker l(&lock);
+    data->generation = (int)generation;
+    if ( (int)threads.size() < NATRON_RENDER_TRACE_MAX_THREADS ) {
+        data->index = (int)threads.size();
+        threads.push_back( boost::shared_ptr<RenderTraceThreadBuffer>( new RenderTraceThreadBuffer(name) ) );
+    } else {
+        ///Give the buffer of an exited thread, its events are dropped
+        for (std::size_t i = 0; i < threads.size(); ++i) {
+            if ( (int)threads[i]->threadExited ) {
+                data->index = (int)i;
+                threads[i].reset( new RenderTraceThreadBuffer(name) );
+                break;
+            }
+        }
+    }
+    if (data->index != -1) {
+        data->buffer = threads[data->index];
+    }
+
+    return data;
+}
+
+RenderTrace::RenderTrace(int capacity)
+: _imp( new RenderTracePrivate(capacity) )
+{
+}
+
+RenderTrace::~RenderTrace()
+{
+}
+
+void
+RenderTrace::setEnabled(bool enabled)
+{
+    _imp->enabled.fetchAndStoreRelaxed(enabled ? 1 : 0);
+}
+
+bool
+RenderTrace::isEnabled() const
+{
+    return (int)_imp->enabled != 0;
+}
+
+double
+RenderTrace::getCurrentTime() const
+{
+    return _imp->clock.getTimeSinceCreation() * 1e6;
+}
+
+int
+RenderTrace::getCurrentThreadIndex()
+{
+    return _imp->getThreadData()->index;
+}
+
+int
+RenderTrace::getNameId(const std::string& name)
+{
+    RenderTraceThreadData* data = _imp->getThreadData();
+    std::map<std::string,int>::iterator found = data->nameIds.find(name);
+
+    if ( found != data->nameIds.end() ) {
+        return found->second;
+    }
+
+    int id;
+    {
+        QMutexLocker l(&_imp->lock);
+        std::map<std::string,int>::iterator it = _imp->nameIds.find(name);
+        if ( it != _imp->nameIds.end() ) {
+            id = it->second;
+        } else {
+            id = (int)_imp->names.size();
+            _imp->names.push_back(name);
+            _imp->nameIds.insert( std::make_pair(name, id) );
+        }
+    }
+    data->nameIds.insert( std::make_pair(name, id) );
+
+    return id;
+}
+
+void
+RenderTrace::getNames(std::vector<std::string>* names) const
+{
+    QMutexLocker l(&_imp->lock);
+
+    *names = _imp->names;
+}
+
+void
+RenderTrace::record(const RenderTraceEvent& event)
+{
+    RenderTraceThreadData* data = _imp->getThreadData();
+
+    if (!data->buffer) {
+        return;
+    }
+    RenderTraceThreadBuffer& buffer = *data->buffer;
+    QMutexLocker l(&buffer.lock);
+    if ( (int)buffer.ring.size() < _imp->capacity ) {
+        buffer.ring.push_back(event);
+        buffer.ring.back().threadIndex = data->index;
+    } else {
+        RenderTraceEvent& slot = buffer.ring[buffer.nRecorded % buffer.ring.size()];
+        slot = event;
+        slot.threadIndex = data->index;
+    }
+    ++buffer.nRecorded;
+}
+
+void
+RenderTrace::getEvents(std::vector<RenderTraceEvent>* events) const
+{
+    std::vector< boost::shared_ptr<RenderTraceThreadBuffer> > threads;
+    {
+        QMutexLocker l(&_imp->lock);
+        threads = _imp->threads;
+    }
+
+    events->clear();
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+        QMutexLocker l(&threads[i]->lock);
+        const std::vector<RenderTraceEvent> & ring = threads[i]->ring;
+        U64 n = ring.size();
+        if (n == 0) {
+            continue;
+        }
+        ///The ring is full when it wrapped, so the oldest event is the next one to be overwritten
+        U64 first = (threads[i]->nRecorded - n) % n;
+        for (U64 e = 0; e < n; ++e) {
+            events->push_back(ring[(first + e) % n]);
+        }
+    }
+    std::stable_sort(events->begin(), events->end(), startsBefore);
+}
+
+void
+RenderTrace::clear()
+{
+    QMutexLocker l(&_imp->lock);
+
+    _imp->generation.fetchAndStoreOrdered( newGeneration() );
+    _imp->threads.clear();
+    _imp->names.clear();
+    _imp->nameIds.clear();
+}
+
+bool
+RenderTrace::exportChromeTrace(const std::string& filePath) const
+{
+    std::vector<RenderTraceEvent> events;
+    getEvents(&events);
+
+    std::vector<std::string> threadNames;
+    std::vector<std::string> names;
+    {
+        QMutexLocker l(&_imp->lock);
+        for (std::size_t i = 0; i < _imp->threads.size(); ++i) {
+            threadNames.push_back(_imp->threads[i]->threadName);
+        }
+        names = _imp->names;
+    }
+
+    std::ofstream ofile( filePath.c_str() );
+    if ( !ofile.good() ) {
+        return false;
+    }
+
+    qint64 pid = QCoreApplication::applicationPid();
+    ofile << std::fixed << std::setprecision(3);
+    ofile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    ///Name the threads so that the render threads can be told apart from the thread pool
+    for (std::size_t i = 0; i < threadNames.size(); ++i) {
+        std::stringstream name;
+        if ( threadNames[i].empty() ) {
+            name << "Thread " << i;
+        } else {
+            name << threadNames[i] << " " << i;
+        }
+        ofile << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << i
+              << ",\"args\":{\"name\":\"" << escapeJSON( name.str() ) << "\"}}";
+        first = false;
+    }
+
+    for (std::vector<RenderTraceEvent>::const_iterator it = events.begin(); it != events.end(); ++it) {
+        const char* kindName = getSpanKindName(it->kind);
+        ///A span which began before the trace was cleared may refer to a name which is gone
+        std::string nodeName;
+        if ( (it->nodeNameId >= 0) && ( it->nodeNameId < (int)names.size() ) ) {
+            nodeName = escapeJSON(names[it->nodeNameId]);
+        }
+        ofile << (first ? "" : ",") << "\n{\"name\":\"" << kindName;
+        if ( !nodeName.empty() ) {
+            ofile << " " << nodeName;
+        }
+        ofile << "\",\"cat\":\"" << kindName << "\",\"ph\":\"X\",\"ts\":" << it->start << ",\"dur\":" << it->duration
+              << ",\"pid\":" << pid << ",\"tid\":" << it->threadIndex
+              << ",\"args\":{\"node\":\"" << nodeName << "\",\"time\":" << it->time << ",\"mipmap\":" << it->mipMapLevel
+              << ",\"bytes\":" << it->bytes << "}}";
+        first = false;
+    }
+    ofile << "\n]}\n";
+
+    return ofile.good();
+}
+
+RenderTraceSpan::RenderTraceSpan(RenderTraceEvent::SpanKindEnum kind,
+                                 const Natron::EffectInstance* effect,
+                                 SequenceTime time,
+                                 unsigned int mipMapLevel,
+                                 U64 bytes)
+: _trace(0)
+, _event()
+, _parent(0)
+{
+    RenderTrace* trace = appPTR ? appPTR->getRenderTrace() : 0;
+    if ( !trace || !trace->isEnabled() ) {
+        return;
+    }
+    _trace = trace;
+    if (effect) {
+        _event.nodeNameId = trace->getNameId( effect->getName_mt_safe() );
+    }
+    _event.time = time;
+    _event.mipMapLevel = mipMapLevel;
+    begin(kind, bytes);
+}
+
+RenderTraceSpan::RenderTraceSpan(RenderTraceEvent::SpanKindEnum kind,
+                                 U64 bytes)
+: _trace(0)
+, _event()
+, _parent(0)
+{
+    RenderTrace* trace = appPTR ? appPTR->getRenderTrace() : 0;
+    if ( !trace || !trace->isEnabled() ) {
+        return;
+    }
+    _trace = trace;
+    const RenderTraceSpan* parent = currentSpan.localData().span;
+    if (parent) {
+        _event.nodeNameId = parent->_event.nodeNameId;
+        _event.time = parent->_event.time;
+        _event.mipMapLevel = parent->_event.mipMapLevel;
+    }
+    begin(kind, bytes);
+}
+
+void
+RenderTraceSpan::begin(RenderTraceEvent::SpanKindEnum kind,
+                       U64 bytes)
+{
+    assert(_trace);
+    _event.kind = kind;
+    _event.bytes = bytes;
+    CurrentSpan& current = currentSpan.localData();
+    _parent = current.span;
+    current.span = this;
+    _event.start = _trace->getCurrentTime();
+}
+
+RenderTraceSpan::~RenderTraceSpan()
+{
+    if (!_trace) {
+        return;
+    }
+    _event.duration = _trace->getCurrentTime() - _event.start;
+    _trace->record(_event);
+    currentSpan.localData().span = _parent;
+}
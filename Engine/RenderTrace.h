@@ -0,0 +1,174 @@
+//  Natron
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+
+#ifndef NATRON_ENGINE_RENDERTRACE_H_
+#define NATRON_ENGINE_RENDERTRACE_H_
+
+#include <string>
+#include <vector>
+
+#ifndef Q_MOC_RUN
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#endif
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+namespace Natron {
+class EffectInstance;
+}
+
+/**
+ * @brief One timed step of a render, as recorded by a RenderTraceSpan
+ **/
+struct RenderTraceEvent
+{
+    enum SpanKindEnum
+    {
+        eSpanKindRenderRoI = 0, //< EffectInstance::renderRoI
+        eSpanKindRenderRoIInternal, //< EffectInstance::renderRoIInternal
+        eSpanKindTile, //< EffectInstance::tiledRenderingFunctor
+        eSpanKindCacheLookup, //< looking up an image in the node or disk cache
+        eSpanKindConversion, //< converting an image to other components/bit depth
+        eSpanKindMipMap, //< building a mipmap level of an image
+        eSpanKindPluginRender //< the render action of the plug-in
+    };
+
+    SpanKindEnum kind;
+    int nodeNameId; //< the name of the node interned in the trace, @see RenderTrace::getNameId, -1 if none
+    SequenceTime time;
+    unsigned int mipMapLevel;
+    int threadIndex; //< small number identifying the thread, @see RenderTrace::getCurrentThreadIndex
+    double start; //< in microseconds since the RenderTrace was created
+    double duration; //< in microseconds
+    U64 bytes; //< amount of image memory touched by the step, 0 if unknown
+
+    RenderTraceEvent()
+    : kind(eSpanKindRenderRoI)
+    , nodeNameId(-1)
+    , time(0)
+    , mipMapLevel(0)
+    , threadIndex(0)
+    , start(0.)
+    , duration(0.)
+    , bytes(0)
+    {
+    }
+};
+
+/**
+ * @brief Records the steps of the renders (@see RenderTraceEvent::SpanKindEnum) in ring buffers of fixed capacity,
+ * so that the last few seconds of rendering can be exported at any time as a Chrome trace (chrome://tracing or Perfetto)
+ * to find out which node, which tile or which thread takes the time.
+ * Each thread records in its own ring buffer and the events only hold the id of the node name, so that recording an event
+ * neither contends with the other render threads nor allocates.
+ * When disabled, a span costs a single atomic read. The recording is off unless asked for: in background mode
+ * by NatronRenderer --trace <file>, which writes the trace when the render is finished, and in the GUI from the Render menu.
+ * The AppManager owns the instance the spans record to.
+ **/
+struct RenderTracePrivate;
+class RenderTrace
+    : public boost::noncopyable
+{
+public:
+
+    /**
+     * @param capacity The number of events kept for each thread, older events are overwritten.
+     **/
+    RenderTrace(int capacity = 16384);
+
+    ~RenderTrace();
+
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the time in microseconds elapsed since the trace was created, this is the time base of the events.
+     **/
+    double getCurrentTime() const WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns a small number identifying the calling thread in this trace, assigned the first time the thread records an event.
+     * Returns -1 if the maximum number of threads recording is reached and none of them has exited: the thread does not record.
+     **/
+    int getCurrentThreadIndex() WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the id of the given name in this trace. The ids the calling thread already asked for are found without locking.
+     **/
+    int getNameId(const std::string& name) WARN_UNUSED_RETURN;
+
+    /**
+     * @brief Returns the names interned since the trace was last cleared, indexed by their id.
+     **/
+    void getNames(std::vector<std::string>* names) const;
+
+    /**
+     * @brief Records the event in the ring buffer of the calling thread. The threadIndex of the event is set to the calling thread's.
+     **/
+    void record(const RenderTraceEvent& event);
+
+    /**
+     * @brief Returns the events currently in the ring buffers of all threads, oldest first.
+     **/
+    void getEvents(std::vector<RenderTraceEvent>* events) const;
+
+    /**
+     * @brief Drops the events, the threads and the names: the threads recording afterwards are numbered from 0 again.
+     **/
+    void clear();
+
+    /**
+     * @brief Writes the events currently in the ring buffers to the given file in the Chrome trace event format.
+     * Returns false if the file could not be written.
+     **/
+    bool exportChromeTrace(const std::string& filePath) const WARN_UNUSED_RETURN;
+
+private:
+
+    boost::scoped_ptr<RenderTracePrivate> _imp;
+};
+
+/**
+ * @brief Records a RenderTraceEvent covering the lifetime of the object, if the trace of the AppManager is enabled.
+ * The spans not given an effect (e.g: in Image, which knows nothing about nodes) inherit the node, time and mipmap level
+ * of the innermost span of the same thread.
+ **/
+class RenderTraceSpan
+{
+    RenderTrace* _trace; //< NULL if not recording
+    RenderTraceEvent _event;
+    const RenderTraceSpan* _parent;
+
+public:
+
+    RenderTraceSpan(RenderTraceEvent::SpanKindEnum kind,
+                    const Natron::EffectInstance* effect,
+                    SequenceTime time,
+                    unsigned int mipMapLevel,
+                    U64 bytes = 0);
+
+    RenderTraceSpan(RenderTraceEvent::SpanKindEnum kind,
+                    U64 bytes = 0);
+
+    ~RenderTraceSpan();
+
+    /**
+     * @brief To set the bytes once they are known, e.g: after the image has been fetched
+     **/
+    void setBytes(U64 bytes)
+    {
+        _event.bytes = bytes;
+    }
+
+private:
+
+    void begin(RenderTraceEvent::SpanKindEnum kind,U64 bytes);
+};
+
+#endif // NATRON_ENGINE_RENDERTRACE_H_
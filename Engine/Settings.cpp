@@ -26,6 +26,7 @@
 #include "Engine/Project.h"
 #include "Engine/Plugin.h"
 #include "Engine/Node.h"
+#include "Engine/NUMA.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/StandardPaths.h"
 #include "SequenceParsing.h"
@@ -111,6 +112,15 @@ Settings::initializeKnobs()
                                    " wait until it is done to actually auto-save.");
     _generalTab->addKnob(_autoSaveDelay);
 
+    _saveProjectsAsBinary = Natron::createKnob<Bool_Knob>(this, "Save projects in binary format");
+    _saveProjectsAsBinary->setName("saveProjectsAsBinary");
+    _saveProjectsAsBinary->setAnimationEnabled(false);
+    _saveProjectsAsBinary->setHintToolTip("When checked, projects and auto-saves are written in a compact binary encoding "
+                                          "which loads much faster than XML for large projects. The binary files can only "
+                                          "be read back by " NATRON_APPLICATION_NAME " on a machine with the same architecture. "
+                                          "Both formats are always loaded, whatever the value of this setting.");
+    _generalTab->addKnob(_saveProjectsAsBinary);
+
 
     _linearPickers = Natron::createKnob<Bool_Knob>(this, "Linear color pickers");
     _linearPickers->setName("linearPickers");
@@ -159,6 +169,18 @@ Settings::initializeKnobs()
     _useThreadPool->setAnimationEnabled(false);
     _generalTab->addKnob(_useThreadPool);
 
+    _numaAwareRendering = Natron::createKnob<Bool_Knob>(this, "NUMA-aware rendering");
+    _numaAwareRendering->setName("numaAwareRendering");
+    _numaAwareRendering->setHintToolTip("When checked, on computers with several processors each having its own memory (NUMA), "
+                                        "each render thread is bound to one processor, the threads it uses to render tiles run "
+                                        "on the same processor and the images it produces are stored in the memory of that "
+                                        "processor. This avoids slow accesses to the memory of another processor and may "
+                                        "speed-up renders on multi-socket workstations. It has no effect on computers with "
+                                        "a single processor. The render threads already running keep their placement until "
+                                        "the next render.");
+    _numaAwareRendering->setAnimationEnabled(false);
+    _generalTab->addKnob(_numaAwareRendering);
+
     _nThreadsPerEffect = Natron::createKnob<Int_Knob>(this, "Max threads usable per effect (0=\"guess\")");
     _nThreadsPerEffect->setName("nThreadsPerEffect");
     _nThreadsPerEffect->setAnimationEnabled(false);
@@ -178,6 +200,18 @@ Settings::initializeKnobs()
     _renderInSeparateProcess->setHintToolTip("If true, " NATRON_APPLICATION_NAME " renders frames to disk in "
                                              "a separate process (disabling it is only useful for debugging).");
     _generalTab->addKnob(_renderInSeparateProcess);
+    
+    _writersBandHeight = Natron::createKnob<Int_Knob>(this, "Writers band height (0=\"whole frame\")");
+    _writersBandHeight->setName("writersBandHeight");
+    _writersBandHeight->setAnimationEnabled(false);
+    _writersBandHeight->setHintToolTip("When rendering to disk with a writer that supports tiles and does not need the frames "
+                                       "in sequence (e.g: image sequences), each frame is rendered and handed to the writer in "
+                                       "horizontal bands of this many scanlines, starting from the top of the image. Each band is "
+                                       "released before the next one is rendered, so that very large formats can be written "
+                                       "without holding the whole frame in memory. 0 renders whole frames.");
+    _writersBandHeight->setMinimum(0);
+    _writersBandHeight->disableSlider();
+    _generalTab->addKnob(_writersBandHeight);
 
     _autoPreviewEnabledForNewProjects = Natron::createKnob<Bool_Knob>(this, "Auto-preview enabled by default for new projects");
     _autoPreviewEnabledForNewProjects->setName("enableAutoPreviewNewProjects");
@@ -542,6 +576,24 @@ Settings::initializeKnobs()
     _autoWipe->setAnimationEnabled(false);
     _viewersTab->addKnob(_autoWipe);
     
+    _realTimePlayback = Natron::createKnob<Bool_Knob>(this, "Drop frames to play in real-time");
+    _realTimePlayback->setName("realTimePlayback");
+    _realTimePlayback->setHintToolTip("When checked, the frames that are not rendered by the time they should be displayed "
+                                      "are skipped so that playback stays at the frame rate of the viewer. The number of frames "
+                                      "dropped is shown next to the frame rate. When unchecked, playback slows down "
+                                      "to the rendering speed instead.");
+    _realTimePlayback->setAnimationEnabled(false);
+    _viewersTab->addKnob(_realTimePlayback);
+    
+    _playbackRenderAhead = Natron::createKnob<Int_Knob>(this, "Playback render-ahead (frames)");
+    _playbackRenderAhead->setName("playbackRenderAhead");
+    _playbackRenderAhead->setHintToolTip("The number of frames rendered ahead of the playhead during playback. Playback only "
+                                         "starts once that many frames are ready, so that a slow frame does not stall it. "
+                                         "0 means to render as many frames ahead as there are parallel renders.");
+    _playbackRenderAhead->setMinimum(0);
+    _playbackRenderAhead->setAnimationEnabled(false);
+    _viewersTab->addKnob(_playbackRenderAhead);
+    
     /////////// Nodegraph tab
     _nodegraphTab = Natron::createKnob<Page_Knob>(this, "Nodegraph");
     
@@ -926,6 +978,7 @@ Settings::setDefaultValues()
     _checkForUpdates->setDefaultValue(false);
     _notifyOnFileChange->setDefaultValue(true);
     _autoSaveDelay->setDefaultValue(5, 0);
+    _saveProjectsAsBinary->setDefaultValue(false);
     _maxUndoRedoNodeGraph->setDefaultValue(20, 0);
     _linearPickers->setDefaultValue(true,0);
     _snapNodesToConnections->setDefaultValue(true);
@@ -934,8 +987,10 @@ Settings::setDefaultValues()
     _numberOfThreads->setDefaultValue(0,0);
     _numberOfParallelRenders->setDefaultValue(0,0);
     _useThreadPool->setDefaultValue(true);
+    _numaAwareRendering->setDefaultValue(false);
     _nThreadsPerEffect->setDefaultValue(0);
     _renderInSeparateProcess->setDefaultValue(false,0);
+    _writersBandHeight->setDefaultValue(0);
     _autoPreviewEnabledForNewProjects->setDefaultValue(true,0);
     _firstReadSetProjectFormat->setDefaultValue(true);
     _fixPathsOnProjectPathChanged->setDefaultValue(true);
@@ -959,6 +1014,8 @@ Settings::setDefaultValues()
     _checkerboardColor2->setDefaultValue(0.,2);
     _checkerboardColor2->setDefaultValue(0.,3);
     _autoWipe->setDefaultValue(false);
+    _realTimePlayback->setDefaultValue(false);
+    _playbackRenderAhead->setDefaultValue(0);
     
     _warnOcioConfigKnobChanged->setDefaultValue(true);
     _ocioStartupCheck->setDefaultValue(true);
@@ -1245,6 +1302,7 @@ Settings::restoreSettings()
         appPTR->setNThreadsPerEffect(getNumberOfThreadsPerEffect());
         appPTR->setNThreadsToRender(getNumberOfThreads());
         appPTR->setUseThreadPool(_useThreadPool->getValue());
+        Natron::NUMA::setEnabled( _numaAwareRendering->getValue() );
     } catch (std::logic_error) {
         // ignore
     }
@@ -1384,7 +1442,7 @@ Settings::onKnobValueChanged(KnobI* k,
             QThreadPool::globalInstance()->setMaxThreadCount(1);
             appPTR->abortAnyProcessing();
         } else if (nbThreads == 0) {
-            QThreadPool::globalInstance()->setMaxThreadCount( QThread::idealThreadCount() );
+            QThreadPool::globalInstance()->setMaxThreadCount( appPTR->getHardwareIdealThreadCount() );
         } else {
             QThreadPool::globalInstance()->setMaxThreadCount(nbThreads);
         }
@@ -1412,6 +1470,8 @@ Settings::onKnobValueChanged(KnobI* k,
     } else if ( k == _useThreadPool.get() ) {
         bool useTP = _useThreadPool->getValue();
         appPTR->setUseThreadPool(useTP);
+    } else if ( k == _numaAwareRendering.get() ) {
+        Natron::NUMA::setEnabled( _numaAwareRendering->getValue() );
     } else if ( k == _customOcioConfigFile.get() ) {
         if (_customOcioConfigFile->isEnabled(0)) {
             tryLoadOpenColorIOConfig();
@@ -1732,6 +1792,26 @@ Settings::populatePluginsTab(std::vector<Natron::Plugin*>& pluginsToIgnore)
     
     const PluginsMap& plugins = appPTR->getPluginsList();
     
+    if ( appPTR->isBackground() ) {
+        ///The preferences are never shown in background mode: only keep the values the knobs would hold
+        ///instead of creating several knobs per plug-in on every start of the renderer
+        for (PluginsMap::const_iterator it = plugins.begin(); it != plugins.end(); ++it) {
+            if (it->first.empty()) {
+                continue;
+            }
+            assert(it->second.size() > 0);
+            Natron::Plugin* plugin  = *it->second.rbegin();
+            if ( !filterDefaultActivatedPlugin( plugin->getPluginID() ) ) {
+                pluginsToIgnore.push_back(plugin);
+            } else {
+                _perPluginRenderScaleSupportDefaults.insert( std::make_pair( plugin->getPluginID().toStdString(),
+                                                                             filterDefaultRenderScaleSupportPlugin( plugin->getPluginID() ) ) );
+            }
+        }
+        
+        return;
+    }
+    
     std::vector<boost::shared_ptr<KnobI> > knobsToRestore;
     
     std::map<Natron::Plugin*,PerPluginKnobs> pluginsMap;
@@ -1975,6 +2055,12 @@ Settings::isRenderInSeparatedProcessEnabled() const
     return _renderInSeparateProcess->getValue();
 }
 
+int
+Settings::getWritersBandHeight() const
+{
+    return _writersBandHeight->getValue();
+}
+
 int
 Settings::getMaximumUndoRedoNodeGraph() const
 {
@@ -1987,6 +2073,12 @@ Settings::getAutoSaveDelayMS() const
     return _autoSaveDelay->getValue() * 1000;
 }
 
+bool
+Settings::isSaveProjectsAsBinaryEnabled() const
+{
+    return _saveProjectsAsBinary->getValue();
+}
+
 bool
 Settings::isSnapToNodeEnabled() const
 {
@@ -2379,6 +2471,18 @@ Settings::isAutoWipeEnabled() const
     return _autoWipe->getValue();
 }
 
+bool
+Settings::isRealTimePlaybackEnabled() const
+{
+    return _realTimePlayback->getValue();
+}
+
+int
+Settings::getPlaybackRenderAhead() const
+{
+    return _playbackRenderAhead->getValue();
+}
+
 int
 Settings::getRenderScaleSupportPreference(const std::string& pluginID) const
 {
@@ -2386,6 +2490,10 @@ Settings::getRenderScaleSupportPreference(const std::string& pluginID) const
     if (found != _perPluginRenderScaleSupport.end()) {
         return found->second->getValue();
     }
+    std::map<std::string,int>::const_iterator foundDefault = _perPluginRenderScaleSupportDefaults.find(pluginID);
+    if (foundDefault != _perPluginRenderScaleSupportDefaults.end()) {
+        return foundDefault->second;
+    }
     return -1;
 }
 
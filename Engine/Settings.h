@@ -126,6 +126,11 @@ public:
     QStringList getPluginsExtraSearchPaths() const;
 
     bool isRenderInSeparatedProcessEnabled() const;
+    
+    /**
+     * @brief Returns the number of scanlines of the bands in which frames are streamed to writers, 0 to render whole frames
+     **/
+    int getWritersBandHeight() const;
 
     void restoreDefault();
 
@@ -133,6 +138,8 @@ public:
 
     int getAutoSaveDelayMS() const;
 
+    bool isSaveProjectsAsBinaryEnabled() const;
+
     bool isSnapToNodeEnabled() const;
 
     bool isCheckForUpdatesEnabled() const;
@@ -209,6 +216,10 @@ public:
     
     bool isAutoWipeEnabled() const;
     
+    bool isRealTimePlaybackEnabled() const;
+    
+    int getPlaybackRenderAhead() const;
+    
     /**
      * @brief Return whether the render scale support is set to its default value (0)  or deactivated (1)
      * for the given plug-in.
@@ -259,12 +270,15 @@ private:
     boost::shared_ptr<Bool_Knob> _checkForUpdates;
     boost::shared_ptr<Bool_Knob> _notifyOnFileChange;
     boost::shared_ptr<Int_Knob> _autoSaveDelay;
+    boost::shared_ptr<Bool_Knob> _saveProjectsAsBinary;
     boost::shared_ptr<Bool_Knob> _linearPickers;
     boost::shared_ptr<Int_Knob> _numberOfThreads;
     boost::shared_ptr<Int_Knob> _numberOfParallelRenders;
     boost::shared_ptr<Bool_Knob> _useThreadPool;
+    boost::shared_ptr<Bool_Knob> _numaAwareRendering;
     boost::shared_ptr<Int_Knob> _nThreadsPerEffect;
     boost::shared_ptr<Bool_Knob> _renderInSeparateProcess;
+    boost::shared_ptr<Int_Knob> _writersBandHeight;
     boost::shared_ptr<Bool_Knob> _autoPreviewEnabledForNewProjects;
     boost::shared_ptr<Bool_Knob> _firstReadSetProjectFormat;
     boost::shared_ptr<Bool_Knob> _fixPathsOnProjectPathChanged;
@@ -312,6 +326,8 @@ private:
     boost::shared_ptr<Color_Knob> _checkerboardColor1;
     boost::shared_ptr<Color_Knob> _checkerboardColor2;
     boost::shared_ptr<Bool_Knob> _autoWipe;
+    boost::shared_ptr<Bool_Knob> _realTimePlayback;
+    boost::shared_ptr<Int_Knob> _playbackRenderAhead;
     boost::shared_ptr<Page_Knob> _nodegraphTab;
     boost::shared_ptr<Bool_Knob> _autoTurbo;
     boost::shared_ptr<Bool_Knob> _useNodeGraphHints;
@@ -373,6 +389,7 @@ private:
     
     
     std::map<std::string,boost::shared_ptr<Choice_Knob> > _perPluginRenderScaleSupport;
+    std::map<std::string,int> _perPluginRenderScaleSupportDefaults; //< used instead of the knobs in background mode
     bool _wereChangesMadeSinceLastSave;
     bool _restoringSettings;
     bool _ocioRestored;
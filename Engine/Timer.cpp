@@ -39,8 +39,15 @@
 #include <iostream>
 #include <time.h>
 #include <QMutexLocker>
+#include <QThread>
 #define NATRON_FPS_REFRESH_RATE_SECONDS 1.5
 
+///Below this many nanoseconds before a deadline, yield instead of sleeping: the sleep granularity of the OS is coarser
+#define NATRON_TIMER_SPIN_NANOSECONDS 2000000
+
+///In real-time mode, the deadlines are pushed back anyway when the display is that late, in seconds
+#define NATRON_TIMER_MAX_LATENESS_SECONDS 1.
+
 
 #ifdef _WIN32
 int
@@ -65,16 +72,39 @@ gettimeofday (struct timeval *tv,
 #endif
 
 
+namespace {
+static void
+sleepNanoseconds(qint64 ns)
+{
+    #ifdef _WIN32
+
+    Sleep( DWORD(ns / 1000000) );
+
+    #else
+
+    timespec ts;
+    ts.tv_sec = (time_t) (ns / 1000000000LL);
+    ts.tv_nsec = (long) (ns % 1000000000LL);
+    nanosleep (&ts, 0);
+
+    #endif
+}
+}
+
 Timer::Timer ()
     : playState (ePlayStateRunning),
       _spf (1 / 24.0),
-      _timingError (0),
+      _realTime (false),
+      _clock (),
+      _nextFrameDeadline (-1),
+      _lastFpsFrameTime (0),
       _framesSinceLastFpsFrame (0),
       _actualFrameRate (0),
+      _droppedFrames (0),
+      _lastReportedDroppedFrames (0),
       _mutex(new QMutex)
 {
-    gettimeofday (&_lastFrameTime, 0);
-    _lastFpsFrameTime = _lastFrameTime;
+    _clock.start();
 }
 
 Timer::~Timer()
@@ -91,82 +121,80 @@ Timer::waitUntilNextFrameIsDue ()
         // variables and return without waiting.
         //
 
-        gettimeofday (&_lastFrameTime, 0);
-        _timingError = 0;
-        _lastFpsFrameTime = _lastFrameTime;
+        QMutexLocker l(_mutex);
+        _nextFrameDeadline = -1;
+        _lastFpsFrameTime = _clock.nsecsElapsed();
         _framesSinceLastFpsFrame = 0;
+        _droppedFrames = 0;
+        _lastReportedDroppedFrames = 0;
 
         return;
     }
 
     
-    double spf;
+    qint64 deadline;
+    qint64 spf;
+    bool realTime;
     {
         QMutexLocker l(_mutex);
-        spf = _spf;
+        deadline = _nextFrameDeadline;
+        spf = (qint64)(_spf * 1e9);
+        realTime = _realTime;
     }
+
     //
-    // If less than _spf seconds have passed since the last frame
-    // was displayed, sleep until exactly _spf seconds have gone by.
+    // Sleep until the deadline of the frame. The deadlines are absolute
+    // times on a monotonic clock, so that the errors of the sleeps do not
+    // accumulate and the wall clock being adjusted does not matter.
+    // The last few milliseconds are spent yielding, which is much more
+    // accurate than sleeping.
     //
 
-    timeval now;
-    gettimeofday (&now, 0);
-
-    double timeSinceLastFrame =  now.tv_sec  - _lastFrameTime.tv_sec +
-                               (now.tv_usec - _lastFrameTime.tv_usec) * 1e-6f;
-    double timeToSleep = spf - timeSinceLastFrame - _timingError;
-
-    #ifdef _WIN32
-
-    if (timeToSleep > 0) {
-        Sleep ( int (timeToSleep * 1000.0f) );
+    qint64 now = _clock.nsecsElapsed();
+    if (deadline < 0) {
+        // First frame of the playback, display it right away
+        deadline = now;
     }
-
-    #else
-
-    if (timeToSleep > 0) {
-        timespec ts;
-        ts.tv_sec = (time_t) timeToSleep;
-        ts.tv_nsec = (long) ( (timeToSleep - ts.tv_sec) * 1e9f );
-        nanosleep (&ts, 0);
+    for (qint64 remaining = deadline - now; remaining > 0; remaining = deadline - now) {
+        if (remaining > NATRON_TIMER_SPIN_NANOSECONDS) {
+            sleepNanoseconds(remaining - NATRON_TIMER_SPIN_NANOSECONDS / 2);
+        } else {
+            QThread::yieldCurrentThread();
+        }
+        now = _clock.nsecsElapsed();
     }
 
-    #endif
-
     //
-    // If we slept, it is possible that we woke up a little too early
-    // or a little too late.  Keep track of the difference between
-    // now and the exact time when we wanted to wake up; next time
-    // we'll try sleep that much longer or shorter.  This should
-    // keep our average frame rate close to one fame every _spf seconds.
+    // If the frame is late by more than a frame, playback slows down
+    // to the rendering speed: the next deadlines start from now.
+    // In real-time mode, the deadlines are kept so that the caller
+    // can drop the frames it has no time to display.
     //
 
-    gettimeofday (&now, 0);
-
-    timeSinceLastFrame =  now.tv_sec  - _lastFrameTime.tv_sec +
-                         (now.tv_usec - _lastFrameTime.tv_usec) * 1e-6f;
-
-    _timingError += timeSinceLastFrame - spf;
-
-    if (_timingError < -2 * spf) {
-        _timingError = -2 * spf;
+    qint64 lateness = now - deadline;
+    if ( (!realTime && lateness > spf) || (lateness > (qint64)(NATRON_TIMER_MAX_LATENESS_SECONDS * 1e9)) ) {
+        deadline = now;
     }
 
-    if (_timingError >  2 * spf) {
-        _timingError =  2 * spf;
+    int droppedFrames;
+    {
+        QMutexLocker l(_mutex);
+        _nextFrameDeadline = deadline + spf;
+        droppedFrames = _droppedFrames;
     }
 
-    _lastFrameTime = now;
-
     //
     // Calculate our actual frame rate, averaged over several frames.
     //
     
-    double t =  now.tv_sec  - _lastFpsFrameTime.tv_sec +
-    (now.tv_usec - _lastFpsFrameTime.tv_usec) * 1e-6f;
+    double t = (now - _lastFpsFrameTime) * 1e-9;
     
     if (t > NATRON_FPS_REFRESH_RATE_SECONDS) {
+        // the dropped frames are reported along with the fps, first
+        if (droppedFrames != _lastReportedDroppedFrames) {
+            _lastReportedDroppedFrames = droppedFrames;
+            emit droppedFramesChanged(droppedFrames);
+        }
         double actualFrameRate = _framesSinceLastFpsFrame / t;
         if (actualFrameRate != _actualFrameRate) {
             _actualFrameRate = actualFrameRate;
@@ -197,11 +225,53 @@ Timer::getDesiredFrameRate() const
     return 1.f / _spf;
 }
 
+void
+Timer::setRealTime(bool realTime)
+{
+    QMutexLocker l(_mutex);
+    _realTime = realTime;
+}
+
+bool
+Timer::isRealTime() const
+{
+    QMutexLocker l(_mutex);
+    return _realTime;
+}
+
+int
+Timer::getFramesLate() const
+{
+    QMutexLocker l(_mutex);
+    if (playState != ePlayStateRunning || _nextFrameDeadline < 0) {
+        return 0;
+    }
+    double lateness = (_clock.nsecsElapsed() - _nextFrameDeadline) * 1e-9;
+    return lateness <= 0. ? 0 : (int)(lateness / _spf);
+}
+
+void
+Timer::notifyFramesDropped(int nFrames)
+{
+    QMutexLocker l(_mutex);
+    if (_nextFrameDeadline >= 0) {
+        _nextFrameDeadline += (qint64)(nFrames * _spf * 1e9);
+    }
+    _droppedFrames += nFrames;
+}
+
+int
+Timer::getDroppedFramesCount() const
+{
+    QMutexLocker l(_mutex);
+    return _droppedFrames;
+}
+
 
 TimeLapse::TimeLapse()
 {
-    gettimeofday(&prev, 0);
-    constructorTime = prev;
+    prev.start();
+    constructorTime.start();
 }
 
 TimeLapse::~TimeLapse()
@@ -213,40 +283,24 @@ TimeLapse::~TimeLapse()
 double
 TimeLapse::getTimeElapsedReset()
 {
-    timeval now;
-    gettimeofday(&now, 0);
+    double dt = prev.nsecsElapsed() * 1e-9;
     
-    double dt =  now.tv_sec  - prev.tv_sec +
-    (now.tv_usec - prev.tv_usec) * 1e-6f;
-    
-    prev = now;
+    prev.restart();
     return dt;
 }
 
 double
 TimeLapse::getTimeSinceCreation() const
 {
-    timeval now;
-    gettimeofday(&now, 0);
-    
-    double dt =  now.tv_sec  - constructorTime.tv_sec +
-    (now.tv_usec - constructorTime.tv_usec) * 1e-6f;
-    
-    return dt;
-
+    return constructorTime.nsecsElapsed() * 1e-9;
 }
 
 TimeLapseReporter::TimeLapseReporter()
 {
-    gettimeofday(&prev, 0);
+    prev.start();
 }
 
 TimeLapseReporter::~TimeLapseReporter()
 {
-    timeval now;
-    gettimeofday(&now, 0);
-    
-    double dt =  now.tv_sec  - prev.tv_sec +
-    (now.tv_usec - prev.tv_usec) * 1e-6f;
-    std::cout << dt << std::endl;
+    std::cout << prev.nsecsElapsed() * 1e-9 << std::endl;
 }
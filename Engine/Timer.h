@@ -43,6 +43,7 @@
 //----------------------------------------------------------------------------
 
 #include <QObject>
+#include <QElapsedTimer>
 #ifdef _WIN32
     #include <windows.h>
 #else
@@ -81,8 +82,8 @@ public:
     // waitUntilNextFrameIsDue() before displaying each frame.
     //
     // If playState == ePlayStateRunning, then waitUntilNextFrameIsDue()
-    // sleeps until the apropriate amount of time has elapsed
-    // since the last call to waitUntilNextFrameIsDue().
+    // sleeps until the deadline of the frame, the deadlines being
+    // spaced by exactly 1 / fps seconds on a monotonic clock.
     // If playState != ePlayStateRunning, then waitUntilNextFrameIsDue()
     // returns immediately.
     //--------------------------------------------------------
@@ -97,6 +98,31 @@ public:
     void  setDesiredFrameRate (double fps);
     double getDesiredFrameRate() const;
 
+    //-------------------------------------------------
+    // Real-time mode: when the display falls behind, the
+    // deadlines are kept instead of being pushed back and
+    // the caller catches up by dropping frames.
+    // Otherwise playback slows down to the rendering speed.
+    //-------------------------------------------------
+
+    void setRealTime(bool realTime);
+    bool isRealTime() const;
+
+    /**
+     * @brief Returns by how many whole frames the deadline of the next frame to display has passed, 0 if it is not late
+     * or if playback has not started yet.
+     **/
+    int getFramesLate() const;
+
+    /**
+     * @brief Called when the display skipped nFrames frames to catch up: their deadlines are skipped too.
+     **/
+    void notifyFramesDropped(int nFrames);
+
+    /**
+     * @brief Returns the number of frames dropped since playback started.
+     **/
+    int getDroppedFramesCount() const;
 
     //-------------------
     // Current play state
@@ -107,26 +133,31 @@ public:
 signals:
     
     void fpsChanged(double actualfps,double desiredfps);
+    
+    void droppedFramesChanged(int nDropped);
 
 private:
 
     double _spf;                 // desired frame rate,
     // in seconds per frame
-    timeval _lastFrameTime;         // time when we displayed the
-    // last frame
-    double _timingError;             // cumulative timing error
-    timeval _lastFpsFrameTime;      // state to keep track of the
+    bool _realTime;
+    QElapsedTimer _clock;           // monotonic
+    qint64 _nextFrameDeadline;      // in nanoseconds on _clock, -1 when
+    // playback has not started
+    qint64 _lastFpsFrameTime;       // state to keep track of the
     int _framesSinceLastFpsFrame;       // actual frame rate, averaged
     double _actualFrameRate;         // over several frames
+    int _droppedFrames;
+    int _lastReportedDroppedFrames;
     
-    QMutex* _mutex; //< protects _spf which is the only member that can 
+    QMutex* _mutex; //< protects _spf, _realTime, _nextFrameDeadline and _droppedFrames
 };
 
 
 class TimeLapse
 {
-    timeval prev;
-    timeval constructorTime;
+    QElapsedTimer prev;
+    QElapsedTimer constructorTime;
 public:
     
     TimeLapse();
@@ -150,7 +181,7 @@ public:
  **/
 class TimeLapseReporter
 {
-    timeval prev;
+    QElapsedTimer prev;
 public:
     
     TimeLapseReporter();
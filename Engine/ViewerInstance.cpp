@@ -41,6 +41,12 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/Image.h"
 #include "Engine/OutputSchedulerThread.h"
 
+///MSVC does not define __SSE2__, but SSE2 is always there on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NATRON_AUTOCONTRAST_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #ifndef M_LN2
 #define M_LN2       0.693147180559945309417232121458176568  /* loge(2)        */
 #endif
@@ -880,7 +886,10 @@ ViewerInstance::renderViewer_internal(int view,
         
         ///if autoContrast is enabled, find out the vmin/vmax before rendering and mapping against new values
         if (autoContrast) {
-            rowsPerThread = std::ceil( (double)( roi.width() ) / (double)appPTR->getHardwareIdealThreadCount() );
+            ///Split along the rows of tiles of the image so that the min/max of the tiles cached in the image can be reused
+            int tileRowsPerThread = std::ceil( (double)( roi.height() ) / (NATRON_IMAGE_MINMAX_TILE_SIZE * appPTR->getHardwareIdealThreadCount()) );
+            rowsPerThread = std::max(1, tileRowsPerThread) * NATRON_IMAGE_MINMAX_TILE_SIZE;
+            const RectI & imageBounds = inArgs.params->image->getBounds();
             
             std::vector<RectI> splitRects;
             
@@ -891,9 +900,10 @@ ViewerInstance::renderViewer_internal(int view,
                 int k = roi.y1;
                 while (k < roi.y2) {
                     int top = k + rowsPerThread;
+                    top -= (top - imageBounds.y1) % NATRON_IMAGE_MINMAX_TILE_SIZE;
                     int realTop = top > roi.top() ? roi.top() : top;
                     splitRects.push_back( RectI(roi.left(), k, roi.right(), realTop) );
-                    k += rowsPerThread;
+                    k = realTop;
                 }
                 
                 
@@ -980,103 +990,306 @@ renderFunctor(std::pair<int,int> yRange,
     }
 }
 
-template <int nComps>
-std::pair<double, double>
-findAutoContrastVminVmax_internal(boost::shared_ptr<const Natron::Image> inputImage,
-                         ViewerInstance::DisplayChannelsEnum channels,
-                         const RectI & rect)
+///Number of independent accumulators of the auto-contrast kernel
+#define NATRON_AUTOCONTRAST_LANES 8
+
+template <int nComps, ViewerInstance::DisplayChannelsEnum channels>
+inline void
+getAutoContrastMinMax(const float* pix,
+                      float* mini,
+                      float* maxi)
+{
+    ///nComps and channels are known at compile-time: the branches below are resolved by the compiler
+    float r = nComps >= 3 ? pix[0] : 0.f;
+    float g = nComps >= 3 ? pix[1] : 0.f;
+    float b = nComps >= 3 ? pix[2] : 0.f;
+    float a = nComps == 4 ? pix[3] : (nComps == 1 ? pix[0] : 1.f);
+
+    switch (channels) {
+    case ViewerInstance::eDisplayChannelsRGB:
+        *mini = std::min(std::min(r,g),b);
+        *maxi = std::max(std::max(r,g),b);
+        break;
+    case ViewerInstance::eDisplayChannelsY:
+        *mini = *maxi = 0.299f * r + 0.587f * g + 0.114f * b;
+        break;
+    case ViewerInstance::eDisplayChannelsR:
+        *mini = *maxi = r;
+        break;
+    case ViewerInstance::eDisplayChannelsG:
+        *mini = *maxi = g;
+        break;
+    case ViewerInstance::eDisplayChannelsB:
+        *mini = *maxi = b;
+        break;
+    case ViewerInstance::eDisplayChannelsA:
+        *mini = *maxi = a;
+        break;
+    }
+}
+
+#ifdef NATRON_AUTOCONTRAST_USE_SSE2
+///Same as getAutoContrastMinMax for 4 RGBA pixels at once, the components being transposed in r, g, b and a.
+///The operands are in the order that gives the results of std::min and std::max, NaNs included.
+template <ViewerInstance::DisplayChannelsEnum channels>
+inline void
+getAutoContrastMinMaxSSE2(__m128 r,
+                          __m128 g,
+                          __m128 b,
+                          __m128 a,
+                          __m128* mini,
+                          __m128* maxi)
+{
+    switch (channels) {
+    case ViewerInstance::eDisplayChannelsRGB:
+        *mini = _mm_min_ps( b, _mm_min_ps(g, r) );
+        *maxi = _mm_max_ps( b, _mm_max_ps(g, r) );
+        break;
+    case ViewerInstance::eDisplayChannelsY:
+        *mini = *maxi = _mm_add_ps( _mm_add_ps( _mm_mul_ps(_mm_set1_ps(0.299f), r), _mm_mul_ps(_mm_set1_ps(0.587f), g) ),
+                                    _mm_mul_ps(_mm_set1_ps(0.114f), b) );
+        break;
+    case ViewerInstance::eDisplayChannelsR:
+        *mini = *maxi = r;
+        break;
+    case ViewerInstance::eDisplayChannelsG:
+        *mini = *maxi = g;
+        break;
+    case ViewerInstance::eDisplayChannelsB:
+        *mini = *maxi = b;
+        break;
+    case ViewerInstance::eDisplayChannelsA:
+        *mini = *maxi = a;
+        break;
+    }
+}
+
+///The RGBA case of findAutoContrastVminVmax_internal: 4 pixels are loaded and transposed per iteration.
+///_mm_min_ps(v, acc) returns acc when v is NaN, so the NaNs are skipped as in the scalar code.
+template <ViewerInstance::DisplayChannelsEnum channels>
+void
+findAutoContrastVminVmaxRGBA_SSE2(const Natron::Image & inputImage,
+                                  const RectI & rect,
+                                  float* vmin,
+                                  float* vmax)
 {
-    double localVmin = std::numeric_limits<double>::infinity();
-    double localVmax = -std::numeric_limits<double>::infinity();
-    
+    __m128 accMin = _mm_set1_ps( std::numeric_limits<float>::infinity() );
+    __m128 accMax = _mm_set1_ps( -std::numeric_limits<float>::infinity() );
+    float restMin = std::numeric_limits<float>::infinity();
+    float restMax = -std::numeric_limits<float>::infinity();
+
+    int width = rect.width();
     for (int y = rect.bottom(); y < rect.top(); ++y) {
-        const float* src_pixels = (const float*)inputImage->pixelAt(rect.left(),y);
-        ///we fill the scan-line with all the pixels of the input image
-        for (int x = rect.left(); x < rect.right(); ++x) {
-            
-            double r,g,b,a;
-            switch (nComps) {
-                case 4:
-                    r = src_pixels[0];
-                    g = src_pixels[1];
-                    b = src_pixels[2];
-                    a = src_pixels[3];
-                    break;
-                case 3:
-                    r = src_pixels[0];
-                    g = src_pixels[1];
-                    b = src_pixels[2];
-                    a = 1.;
-                    break;
-                case 1:
-                    a = src_pixels[0];
-                    r = g = b = 0.;
-                    break;
-                default:
-                    r = g = b = 0.;
-            }
-            
-            double mini, maxi;
-            switch (channels) {
-                case ViewerInstance::eDisplayChannelsRGB:
-                    mini = std::min(std::min(r,g),b);
-                    maxi = std::max(std::max(r,g),b);
-                    break;
-                case ViewerInstance::eDisplayChannelsY:
-                    mini = r = 0.299 * r + 0.587 * g + 0.114 * b;
-                    maxi = mini;
-                    break;
-                case ViewerInstance::eDisplayChannelsR:
-                    mini = r;
-                    maxi = mini;
-                    break;
-                case ViewerInstance::eDisplayChannelsG:
-                    mini = g;
-                    maxi = mini;
-                    break;
-                case ViewerInstance::eDisplayChannelsB:
-                    mini = b;
-                    maxi = mini;
-                    break;
-                case ViewerInstance::eDisplayChannelsA:
-                    mini = a;
-                    maxi = mini;
-                    break;
-                default:
-                    mini = 0.;
-                    maxi = 0.;
-                    break;
-            }
-            if (mini < localVmin) {
-                localVmin = mini;
-            }
-            if (maxi > localVmax) {
-                localVmax = maxi;
+        const float* src_pixels = (const float*)inputImage.pixelAt(rect.left(),y);
+        int x = 0;
+        for (; x + 4 <= width; x += 4) {
+            __m128 r = _mm_loadu_ps(src_pixels + x * 4);
+            __m128 g = _mm_loadu_ps(src_pixels + x * 4 + 4);
+            __m128 b = _mm_loadu_ps(src_pixels + x * 4 + 8);
+            __m128 a = _mm_loadu_ps(src_pixels + x * 4 + 12);
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+            __m128 mini, maxi;
+            getAutoContrastMinMaxSSE2<channels>(r, g, b, a, &mini, &maxi);
+            accMin = _mm_min_ps(mini, accMin);
+            accMax = _mm_max_ps(maxi, accMax);
+        }
+        for (; x < width; ++x) {
+            float mini, maxi;
+            getAutoContrastMinMax<4, channels>(src_pixels + x * 4, &mini, &maxi);
+            restMin = mini < restMin ? mini : restMin;
+            restMax = maxi > restMax ? maxi : restMax;
+        }
+    }
+
+    float lanesMin[5];
+    float lanesMax[5];
+    _mm_storeu_ps(lanesMin, accMin);
+    _mm_storeu_ps(lanesMax, accMax);
+    lanesMin[4] = restMin;
+    lanesMax[4] = restMax;
+    for (int l = 0; l < 5; ++l) {
+        if (lanesMin[l] < *vmin) {
+            *vmin = lanesMin[l];
+        }
+        if (lanesMax[l] > *vmax) {
+            *vmax = lanesMax[l];
+        }
+    }
+}
+#endif // NATRON_AUTOCONTRAST_USE_SSE2
+
+template <int nComps, ViewerInstance::DisplayChannelsEnum channels>
+void
+findAutoContrastVminVmax_internal(const Natron::Image & inputImage,
+                                  const RectI & rect,
+                                  float* vmin,
+                                  float* vmax)
+{
+#ifdef NATRON_AUTOCONTRAST_USE_SSE2
+    if (nComps == 4) {
+        findAutoContrastVminVmaxRGBA_SSE2<channels>(inputImage, rect, vmin, vmax);
+
+        return;
+    }
+#endif
+
+    ///Without SSE2, and for RGB and alpha images, the pixels are dispatched to independent accumulators so that
+    ///consecutive iterations do not depend on each other and the compiler may vectorize the loop.
+    ///The comparisons skip NaNs, as the scalar code did.
+    float lanesMin[NATRON_AUTOCONTRAST_LANES];
+    float lanesMax[NATRON_AUTOCONTRAST_LANES];
+
+    for (int l = 0; l < NATRON_AUTOCONTRAST_LANES; ++l) {
+        lanesMin[l] = std::numeric_limits<float>::infinity();
+        lanesMax[l] = -std::numeric_limits<float>::infinity();
+    }
+
+    int width = rect.width();
+    for (int y = rect.bottom(); y < rect.top(); ++y) {
+        const float* src_pixels = (const float*)inputImage.pixelAt(rect.left(),y);
+        int x = 0;
+        for (; x + NATRON_AUTOCONTRAST_LANES <= width; x += NATRON_AUTOCONTRAST_LANES) {
+            for (int l = 0; l < NATRON_AUTOCONTRAST_LANES; ++l) {
+                float mini, maxi;
+                getAutoContrastMinMax<nComps, channels>(src_pixels + (x + l) * nComps, &mini, &maxi);
+                lanesMin[l] = mini < lanesMin[l] ? mini : lanesMin[l];
+                lanesMax[l] = maxi > lanesMax[l] ? maxi : lanesMax[l];
             }
-            
-            src_pixels += nComps;
+        }
+        for (; x < width; ++x) {
+            float mini, maxi;
+            getAutoContrastMinMax<nComps, channels>(src_pixels + x * nComps, &mini, &maxi);
+            lanesMin[0] = mini < lanesMin[0] ? mini : lanesMin[0];
+            lanesMax[0] = maxi > lanesMax[0] ? maxi : lanesMax[0];
+        }
+    }
+
+    for (int l = 0; l < NATRON_AUTOCONTRAST_LANES; ++l) {
+        if (lanesMin[l] < *vmin) {
+            *vmin = lanesMin[l];
+        }
+        if (lanesMax[l] > *vmax) {
+            *vmax = lanesMax[l];
         }
     }
-    
-    return std::make_pair(localVmin, localVmax);
 }
 
+template <int nComps>
+void
+findAutoContrastVminVmaxForComps(const Natron::Image & inputImage,
+                                 ViewerInstance::DisplayChannelsEnum channels,
+                                 const RectI & rect,
+                                 float* vmin,
+                                 float* vmax)
+{
+    switch (channels) {
+    case ViewerInstance::eDisplayChannelsRGB:
+        findAutoContrastVminVmax_internal<nComps, ViewerInstance::eDisplayChannelsRGB>(inputImage, rect, vmin, vmax);
+        break;
+    case ViewerInstance::eDisplayChannelsR:
+        findAutoContrastVminVmax_internal<nComps, ViewerInstance::eDisplayChannelsR>(inputImage, rect, vmin, vmax);
+        break;
+    case ViewerInstance::eDisplayChannelsG:
+        findAutoContrastVminVmax_internal<nComps, ViewerInstance::eDisplayChannelsG>(inputImage, rect, vmin, vmax);
+        break;
+    case ViewerInstance::eDisplayChannelsB:
+        findAutoContrastVminVmax_internal<nComps, ViewerInstance::eDisplayChannelsB>(inputImage, rect, vmin, vmax);
+        break;
+    case ViewerInstance::eDisplayChannelsA:
+        findAutoContrastVminVmax_internal<nComps, ViewerInstance::eDisplayChannelsA>(inputImage, rect, vmin, vmax);
+        break;
+    case ViewerInstance::eDisplayChannelsY:
+        findAutoContrastVminVmax_internal<nComps, ViewerInstance::eDisplayChannelsY>(inputImage, rect, vmin, vmax);
+        break;
+    }
+}
 
-std::pair<double, double>
-findAutoContrastVminVmax(boost::shared_ptr<const Natron::Image> inputImage,
-                         ViewerInstance::DisplayChannelsEnum channels,
-                         const RectI & rect)
+static void
+findAutoContrastVminVmaxInRect(const Natron::Image & inputImage,
+                               ViewerInstance::DisplayChannelsEnum channels,
+                               const RectI & rect,
+                               float* vmin,
+                               float* vmax)
 {
-    switch (inputImage->getComponents()) {
+    switch (inputImage.getComponents()) {
         case Natron::eImageComponentRGBA:
-            return findAutoContrastVminVmax_internal<4>(inputImage, channels, rect);
+            findAutoContrastVminVmaxForComps<4>(inputImage, channels, rect, vmin, vmax);
+            break;
         case Natron::eImageComponentRGB:
-            return findAutoContrastVminVmax_internal<3>(inputImage, channels, rect);
+            findAutoContrastVminVmaxForComps<3>(inputImage, channels, rect, vmin, vmax);
+            break;
         case Natron::eImageComponentAlpha:
-            return findAutoContrastVminVmax_internal<1>(inputImage, channels, rect);
+            findAutoContrastVminVmaxForComps<1>(inputImage, channels, rect, vmin, vmax);
+            break;
         default:
-            return std::make_pair(0,1);
+            break;
     }
+}
+
+std::pair<double, double>
+findAutoContrastVminVmax(boost::shared_ptr<const Natron::Image> inputImage,
+                         ViewerInstance::DisplayChannelsEnum channels,
+                         const RectI & rect_)
+{
+    if ( (inputImage->getComponents() != Natron::eImageComponentRGBA) &&
+         (inputImage->getComponents() != Natron::eImageComponentRGB) &&
+         (inputImage->getComponents() != Natron::eImageComponentAlpha) ) {
+        return std::make_pair(0,1);
+    }
+
+    float vmin = std::numeric_limits<float>::infinity();
+    float vmax = -std::numeric_limits<float>::infinity();
+
+    const RectI & bounds = inputImage->getBounds();
+    RectI rect;
+    if ( !rect_.intersect(bounds, &rect) ) {
+        return std::make_pair(vmin, vmax);
+    }
+
+    if ( !inputImage->usesBitMap() ) {
+        findAutoContrastVminVmaxInRect(*inputImage, channels, rect, &vmin, &vmax);
+
+        return std::make_pair(vmin, vmax);
+    }
+
+    ///The image is cached: the tiles entirely in the rect are measured once and their min/max are stored in the image,
+    ///so that the auto-contrast of a frame found in the cache only scans the tiles on the border of the rect.
+    U64 age = inputImage->getTilesMinMaxAge();
+    int ty1 = (rect.y1 - bounds.y1) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    int ty2 = (rect.y2 - 1 - bounds.y1) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    int tx1 = (rect.x1 - bounds.x1) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    int tx2 = (rect.x2 - 1 - bounds.x1) / NATRON_IMAGE_MINMAX_TILE_SIZE;
+    for (int ty = ty1; ty <= ty2; ++ty) {
+        for (int tx = tx1; tx <= tx2; ++tx) {
+            RectI tile(bounds.x1 + tx * NATRON_IMAGE_MINMAX_TILE_SIZE,
+                       bounds.y1 + ty * NATRON_IMAGE_MINMAX_TILE_SIZE,
+                       std::min(bounds.x1 + (tx + 1) * NATRON_IMAGE_MINMAX_TILE_SIZE, bounds.x2),
+                       std::min(bounds.y1 + (ty + 1) * NATRON_IMAGE_MINMAX_TILE_SIZE, bounds.y2));
+            RectI part;
+            if ( !tile.intersect(rect, &part) ) {
+                continue;
+            }
+            if (part == tile) {
+                float tileMin, tileMax;
+                if ( !inputImage->getTileMinMax(channels, tx, ty, &tileMin, &tileMax) ) {
+                    tileMin = std::numeric_limits<float>::infinity();
+                    tileMax = -std::numeric_limits<float>::infinity();
+                    findAutoContrastVminVmaxInRect(*inputImage, channels, tile, &tileMin, &tileMax);
+                    inputImage->setTileMinMax(channels, tx, ty, tileMin, tileMax, age);
+                }
+                if (tileMin < vmin) {
+                    vmin = tileMin;
+                }
+                if (tileMax > vmax) {
+                    vmax = tileMax;
+                }
+            } else {
+                findAutoContrastVminVmaxInRect(*inputImage, channels, part, &vmin, &vmax);
+            }
+        }
+    }
+
+    return std::make_pair(vmin, vmax);
 } // findAutoContrastVminVmax
 
 template <typename PIX,int maxValue,int nComps,bool opaque,int rOffset,int gOffset,int bOffset>
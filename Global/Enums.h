@@ -339,6 +339,14 @@ enum SchedulingPolicyEnum
     eSchedulingPolicyFFA = 0, ///frames will be rendered concurrently without ordering (free for all)
     eSchedulingPolicyOrdered ///frames will be rendered in order
 };
+
+///Ordered from the most urgent to the least urgent, @see RenderQueue
+enum RenderPriorityEnum
+{
+    eRenderPriorityInteractive = 0, ///the current frame requested by the user (e.g: parameter change, timeline seek)
+    eRenderPriorityPlayback, ///frames rendered ahead of the viewer during playback
+    eRenderPriorityBackground ///renders on disk
+};
     
 }
 Q_DECLARE_METATYPE(Natron::StandardButtons)
@@ -74,6 +74,14 @@ typedef OfxRangeD RangeD;
 
 #define kBgProcessServerCreatedShort "--bg_server_created"
 
+///these are used between the coordinator of a render farm and its worker processes, @see RenderFarm
+///the worker asks for frames to render
+#define kRenderChunkRequestShort "-q"
+///the coordinator replies with the frames to render: -k<first> <last> <writer name>
+#define kRenderChunkStringShort "-k"
+///the coordinator replies there is nothing left to render
+#define kNoMoreRenderChunksStringShort "-n"
+
 
 #define kNodeGraphObjectName "NodeGraph"
 #define kCurveEditorObjectName "CurveEditor"
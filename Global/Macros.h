@@ -27,6 +27,9 @@
 #define NATRON_APPLICATION_NAME "Natron"
 #define NATRON_PROJECT_FILE_EXT "ntp"
 #define NATRON_PROJECT_UNTITLED "Untitled." NATRON_PROJECT_FILE_EXT
+///First line of the projects saved in binary format, followed by the version of the encoding
+#define NATRON_PROJECT_BINARY_HEADER "NatronBinaryProject"
+#define NATRON_PROJECT_BINARY_VERSION 1
 #define NATRON_CACHE_FILE_EXT "ntc"
 #define NATRON_LAYOUT_FILE_EXT "nl"
 #define NATRON_PRESETS_FILE_EXT "nps"
@@ -92,6 +92,12 @@
 #define kShortcutIDActionRenderAll "renderAll"
 #define kShortcutDescActionRenderAll "Render all writers"
 
+#define kShortcutIDActionRecordRenderTrace "recordRenderTrace"
+#define kShortcutDescActionRecordRenderTrace "Record render trace"
+
+#define kShortcutIDActionExportRenderTrace "exportRenderTrace"
+#define kShortcutDescActionExportRenderTrace "Export render trace..."
+
 #define kShortcutIDActionConnectViewerToInput1 "connectViewerInput1"
 #define kShortcutDescActionConnectViewerToInput1 "Connect viewer to input 1"
 
@@ -69,6 +69,7 @@ CLANG_DIAG_ON(unused-parameter)
 #include "Engine/Node.h"
 #include "Engine/KnobSerialization.h"
 #include "Engine/OutputSchedulerThread.h"
+#include "Engine/RenderTrace.h"
 
 #include "Gui/GuiApplicationManager.h"
 #include "Gui/GuiAppInstance.h"
@@ -234,6 +235,8 @@ struct GuiPrivate
     QAction *actionsOpenRecentFile[NATRON_MAX_RECENT_FILES];
     ActionWithShortcut *renderAllWriters;
     ActionWithShortcut *renderSelectedNode;
+    ActionWithShortcut *actionRecordRenderTrace;
+    ActionWithShortcut *actionExportRenderTrace;
     ActionWithShortcut* actionConnectInput1;
     ActionWithShortcut* actionConnectInput2;
     ActionWithShortcut* actionConnectInput3;
@@ -392,6 +395,8 @@ struct GuiPrivate
           , actionsOpenRecentFile()
           , renderAllWriters(0)
           , renderSelectedNode(0)
+          , actionRecordRenderTrace(0)
+          , actionExportRenderTrace(0)
           , actionConnectInput1(0)
           , actionConnectInput2(0)
           , actionConnectInput3(0)
@@ -862,6 +867,14 @@ Gui::createMenuActions()
     _imp->renderSelectedNode = new ActionWithShortcut(kShortcutGroupGlobal,kShortcutIDActionRenderSelected,kShortcutDescActionRenderSelected,this);
     QObject::connect( _imp->renderSelectedNode,SIGNAL( triggered() ),this,SLOT( renderSelectedNode() ) );
 
+    _imp->actionRecordRenderTrace = new ActionWithShortcut(kShortcutGroupGlobal,kShortcutIDActionRecordRenderTrace,kShortcutDescActionRecordRenderTrace,this);
+    _imp->actionRecordRenderTrace->setCheckable(true);
+    _imp->actionRecordRenderTrace->setChecked( appPTR->getRenderTrace()->isEnabled() );
+    QObject::connect( _imp->actionRecordRenderTrace,SIGNAL( toggled(bool) ),this,SLOT( onRecordRenderTraceToggled(bool) ) );
+
+    _imp->actionExportRenderTrace = new ActionWithShortcut(kShortcutGroupGlobal,kShortcutIDActionExportRenderTrace,kShortcutDescActionExportRenderTrace,this);
+    QObject::connect( _imp->actionExportRenderTrace,SIGNAL( triggered() ),this,SLOT( exportRenderTrace() ) );
+
 
     for (int c = 0; c < NATRON_MAX_RECENT_FILES; ++c) {
         _imp->actionsOpenRecentFile[c] = new QAction(this);
@@ -961,6 +974,9 @@ Gui::createMenuActions()
 
     _imp->menuRender->addAction(_imp->renderAllWriters);
     _imp->menuRender->addAction(_imp->renderSelectedNode);
+    _imp->menuRender->addSeparator();
+    _imp->menuRender->addAction(_imp->actionRecordRenderTrace);
+    _imp->menuRender->addAction(_imp->actionExportRenderTrace);
 
     _imp->cacheMenu->addAction(_imp->actionClearDiskCache);
     _imp->cacheMenu->addAction(_imp->actionClearPlayBackCache);
@@ -2560,6 +2576,7 @@ Gui::openProjectInternal(const std::string & absoluteFileName)
         _imp->_appInstance->getProject()->loadProject( path.c_str(), fileUnPathed.c_str() );
     } else {
         ///remove autosaves otherwise the new instance might try to load an autosave
+        _imp->_appInstance->getProject()->waitForAutoSaves();
         Project::removeAutoSaves();
         AppInstance* newApp = appPTR->newAppInstance(QString(),QStringList(),std::list<std::pair<int,int> >());
         newApp->getProject()->loadProject( path.c_str(), fileUnPathed.c_str() );
@@ -2893,6 +2910,28 @@ Gui::saveProjectGui(boost::archive::xml_oarchive & archive)
     _imp->_projectGui->save(archive);
 }
 
+void
+Gui::loadProjectGui(boost::archive::binary_iarchive & obj) const
+{
+    assert(_imp->_projectGui);
+    _imp->_projectGui->load(obj);
+}
+
+void
+Gui::saveProjectGui(boost::archive::binary_oarchive & archive)
+{
+    assert(_imp->_projectGui);
+    _imp->_projectGui->save(archive);
+}
+
+boost::shared_ptr<ProjectGuiSnapshot>
+Gui::snapshotProjectGui() const
+{
+    assert(_imp->_projectGui);
+
+    return _imp->_projectGui->snapshot();
+}
+
 void
 Gui::errorDialog(const std::string & title,
                  const std::string & text,
@@ -3537,6 +3576,7 @@ Gui::openRecentFile()
             _imp->_appInstance->getProject()->loadProject( path,f.fileName() );
         } else {
             ///remove autosaves otherwise the new instance might try to load an autosave
+            _imp->_appInstance->getProject()->waitForAutoSaves();
             Project::removeAutoSaves();
             AppInstance* newApp = appPTR->newAppInstance(QString(),QStringList(),std::list<std::pair<int,int> >());
             newApp->getProject()->loadProject( path,f.fileName() );
@@ -4060,6 +4100,35 @@ Gui::renderSelectedNode()
     }
 }
 
+void
+Gui::onRecordRenderTraceToggled(bool recording)
+{
+    RenderTrace* trace = appPTR->getRenderTrace();
+
+    ///Start from an empty trace so that the export only contains what was recorded since
+    if ( recording && !trace->isEnabled() ) {
+        trace->clear();
+    }
+    trace->setEnabled(recording);
+}
+
+void
+Gui::exportRenderTrace()
+{
+    std::vector<std::string> filter;
+    filter.push_back("json");
+    std::string outFile = popSaveFileDialog( false, filter, _imp->_lastSaveProjectOpenedDir.toStdString(), false );
+    if ( outFile.empty() ) {
+        return;
+    }
+    if (outFile.find(".json") == std::string::npos) {
+        outFile.append(".json");
+    }
+    if ( !appPTR->getRenderTrace()->exportChromeTrace(outFile) ) {
+        Natron::errorDialog( tr("Export render trace").toStdString(), tr("Could not write ").toStdString() + outFile );
+    }
+}
+
 void
 Gui::setUndoRedoStackLimit(int limit)
 {
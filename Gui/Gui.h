@@ -36,6 +36,8 @@ namespace boost {
 namespace archive {
 class xml_iarchive;
 class xml_oarchive;
+class binary_iarchive;
+class binary_oarchive;
 }
 }
 
@@ -51,6 +53,7 @@ class QMutex;
 //Natron gui
 class GuiLayoutSerialization;
 class GuiAppInstance;
+class ProjectGuiSnapshot;
 class NodeGui;
 class TabWidget;
 class ToolButton;
@@ -303,6 +306,12 @@ public:
 
     void saveProjectGui(boost::archive::xml_oarchive & archive);
 
+    void loadProjectGui(boost::archive::binary_iarchive & obj) const;
+
+    void saveProjectGui(boost::archive::binary_oarchive & archive);
+
+    boost::shared_ptr<ProjectGuiSnapshot> snapshotProjectGui() const;
+
     void setColorPickersColor(const QColor & c);
 
     void registerNewColorPicker(boost::shared_ptr<Color_Knob> knob);
@@ -544,6 +553,16 @@ public slots:
 
     void renderSelectedNode();
 
+    /**
+     * @brief Turns the recording of the render steps by the RenderTrace on or off
+     **/
+    void onRecordRenderTraceToggled(bool recording);
+
+    /**
+     * @brief Asks for a file and writes the last render steps recorded by the RenderTrace to it
+     **/
+    void exportRenderTrace();
+
     void onRotoSelectedToolChanged(int tool);
 
     void onMaxVisibleDockablePanelChanged(int maxPanels);
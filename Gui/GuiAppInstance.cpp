@@ -595,6 +595,24 @@ GuiAppInstance::saveProjectGui(boost::archive::xml_oarchive & archive)
     _imp->_gui->saveProjectGui(archive);
 }
 
+void
+GuiAppInstance::loadProjectGui(boost::archive::binary_iarchive & archive) const
+{
+    _imp->_gui->loadProjectGui(archive);
+}
+
+void
+GuiAppInstance::saveProjectGui(boost::archive::binary_oarchive & archive)
+{
+    _imp->_gui->saveProjectGui(archive);
+}
+
+boost::shared_ptr<ProjectGuiSnapshot>
+GuiAppInstance::snapshotProjectGui() const
+{
+    return _imp->_gui->snapshotProjectGui();
+}
+
 void
 GuiAppInstance::setupViewersForViews(int viewsCount)
 {
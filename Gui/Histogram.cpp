@@ -42,6 +42,10 @@ CLANG_DIAG_ON(unused-private-field)
 #include "Gui/NodeGraph.h"
 #include "Gui/CurveWidget.h"
 #include "Gui/GuiApplicationManager.h"
+
+///When sampling downscaled images, images above this many pixels are replaced by a lower mipmap level if the viewer has one
+#define NATRON_HISTOGRAM_MAX_SAMPLED_PIXELS (1024 * 1024)
+#define NATRON_HISTOGRAM_MAX_SAMPLED_MIPMAP_LEVEL 5
 // warning: 'gluErrorString' is deprecated: first deprecated in OS X 10.9 [-Wdeprecated-declarations]
 CLANG_DIAG_OFF(deprecated-declarations)
 GCC_DIAG_OFF(deprecated-declarations)
@@ -69,6 +73,7 @@ struct HistogramPrivate
           , modeActions(0)
           , modeMenu(NULL)
           , fullImage(NULL)
+          , downscaledImage(NULL)
           , filterActions(0)
           , filterMenu(NULL)
           , widget(widget)
@@ -110,6 +115,9 @@ struct HistogramPrivate
     }
 
     boost::shared_ptr<Natron::Image> getHistogramImage(RectI* imagePortion) const;
+    
+    boost::shared_ptr<Natron::Image> getDownscaledImage(ViewerGL* viewer,int textureIndex,
+                                                        const boost::shared_ptr<Natron::Image>& image) const;
 
 
     void showMenu(const QPoint & globalPos);
@@ -154,6 +162,7 @@ struct HistogramPrivate
     QActionGroup* modeActions;
     QMenu* modeMenu;
     QAction* fullImage;
+    QAction* downscaledImage;
     QActionGroup* filterActions;
     QMenu* filterMenu;
     Histogram* widget;
@@ -309,6 +318,13 @@ Histogram::Histogram(Gui* gui,
     _imp->fullImage->setChecked(false);
     QObject::connect( _imp->fullImage, SIGNAL( triggered() ), this, SLOT( computeHistogramAndRefresh() ) );
     _imp->rightClickMenu->addAction(_imp->fullImage);
+    
+    _imp->downscaledImage = new QAction(_imp->rightClickMenu);
+    _imp->downscaledImage->setText( tr("Sample downscaled image") );
+    _imp->downscaledImage->setCheckable(true);
+    _imp->downscaledImage->setChecked(false);
+    QObject::connect( _imp->downscaledImage, SIGNAL( triggered() ), this, SLOT( computeHistogramAndRefresh() ) );
+    _imp->rightClickMenu->addAction(_imp->downscaledImage);
 
     _imp->filterMenu = new QMenu(tr("Smoothing"),_imp->rightClickMenu);
     _imp->filterMenu->setFont( QFont(appFont,appFontSize) );
@@ -438,6 +454,7 @@ boost::shared_ptr<Natron::Image> HistogramPrivate::getHistogramImage(RectI* imag
         boost::shared_ptr<Natron::Image> ret;
         if (lastSelectedViewer) {
             ret = lastSelectedViewer->getViewer()->getLastRenderedImageByMipMapLevel(textureIndex,lastSelectedViewer->getInternalNode()->getMipMapLevelFromZoomFactor());
+            ret = getDownscaledImage(lastSelectedViewer->getViewer(), textureIndex, ret);
         }
         if (ret) {
             if (!useImageRoD) {
@@ -455,7 +472,7 @@ boost::shared_ptr<Natron::Image> HistogramPrivate::getHistogramImage(RectI* imag
         const std::list<ViewerTab*> & viewerTabs = gui->getViewersList();
         for (std::list<ViewerTab*>::const_iterator it = viewerTabs.begin(); it != viewerTabs.end(); ++it) {
             if ( (*it)->getInternalNode()->getName() == viewerName ) {
-                ret = (*it)->getViewer()->getLastRenderedImage(textureIndex);
+                ret = getDownscaledImage( (*it)->getViewer(), textureIndex, (*it)->getViewer()->getLastRenderedImage(textureIndex) );
                 if (ret) {
                     if (!useImageRoD) {
                         *imagePortion = (*it)->getViewer()->getImageRectangleDisplayed(ret->getBounds(), ret->getPixelAspectRatio(), ret->getMipMapLevel());
@@ -472,6 +489,37 @@ boost::shared_ptr<Natron::Image> HistogramPrivate::getHistogramImage(RectI* imag
     }
 } // getHistogramImage
 
+boost::shared_ptr<Natron::Image>
+HistogramPrivate::getDownscaledImage(ViewerGL* viewer,
+                                     int textureIndex,
+                                     const boost::shared_ptr<Natron::Image>& image) const
+{
+    // always running in the main thread
+    assert( qApp && qApp->thread() == QThread::currentThread() );
+
+    if ( !image || !downscaledImage->isChecked() ) {
+        return image;
+    }
+
+    unsigned int mipMapLevel = image->getMipMapLevel();
+    double pixelsCount = (double)image->getBounds().area();
+    while (pixelsCount > NATRON_HISTOGRAM_MAX_SAMPLED_PIXELS && mipMapLevel < NATRON_HISTOGRAM_MAX_SAMPLED_MIPMAP_LEVEL) {
+        pixelsCount /= 4.;
+        ++mipMapLevel;
+    }
+    if ( mipMapLevel == image->getMipMapLevel() ) {
+        return image;
+    }
+
+    ///This falls back on other levels: only use a smaller image of the same frame, the other levels may be from an older render
+    boost::shared_ptr<Natron::Image> ret = viewer->getLastRenderedImageByMipMapLevel(textureIndex, mipMapLevel);
+    if ( ret && ( ret->getMipMapLevel() > image->getMipMapLevel() ) && ( ret->getHashKey() == image->getHashKey() ) ) {
+        return ret;
+    }
+
+    return image;
+}
+
 void
 HistogramPrivate::showMenu(const QPoint & globalPos)
 {
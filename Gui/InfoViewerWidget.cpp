@@ -35,6 +35,7 @@ InfoViewerWidget::InfoViewerWidget(ViewerGL* v,
       , _comp(eImageComponentNone)
       , _colorValid(false)
       , _colorApprox(false)
+      , _droppedFrames(0)
 {
     for (int i = 0; i < 4; ++i) {
         currentColor[i] = 0;
@@ -182,8 +183,12 @@ InfoViewerWidget::setFps(double actualFps,
     } else if ( actualFps < (desiredFps / 2.f) ) {
         colorStr = QString("red");
     }
-    QString str = QString("<font color=\""+ colorStr + "\" face=\"%2\" size=%3>%1 fps</font>")
-    .arg( QString::number(actualFps,'f',1) )
+    QString fpsStr = QString::number(actualFps,'f',1) + " fps";
+    if (_droppedFrames > 0) {
+        fpsStr += QString(", %1 dropped").arg(_droppedFrames);
+    }
+    QString str = QString("<font color=\""+ colorStr + "\" face=\"%2\" size=%3>%1</font>")
+    .arg(fpsStr)
     .arg(font.family())
     .arg(font.pixelSize());
 
@@ -193,9 +198,16 @@ InfoViewerWidget::setFps(double actualFps,
     }
 }
 
+void
+InfoViewerWidget::setDroppedFrames(int nDropped)
+{
+    _droppedFrames = nDropped;
+}
+
 void
 InfoViewerWidget::hideFps()
 {
+    _droppedFrames = 0;
     if ( _fpsLabel->isVisible() ) {
         _fpsLabel->hide();
     }
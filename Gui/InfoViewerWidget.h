@@ -63,6 +63,11 @@ public slots:
     void showColorAndMouseInfo();
     void setFps(double actualFps,double desiredFps);
     void hideFps();
+    
+    /**
+     * @brief Shown along with the fps on the next call to setFps
+     **/
+    void setDroppedFrames(int nDropped);
 
 private:
     
@@ -87,6 +92,7 @@ private:
     Natron::ImageComponentsEnum _comp;
     bool _colorValid;
     bool _colorApprox;
+    int _droppedFrames; //< frames dropped by real-time playback
     double currentColor[4];
 };
 
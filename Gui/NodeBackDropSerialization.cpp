@@ -22,7 +22,8 @@ NodeBackDropSerialization::initialize(const NodeBackDrop* n)
     posY = pos.y();
     n->getSize(width,height);
 
-    label.reset(new KnobSerialization(n->getLabelKnob(),false));
+    ///Copy the label so that the serialization may be encoded later, e.g: by an auto-save
+    label.reset(new KnobSerialization(n->getLabelKnob(),true));
     QColor color = n->getCurrentColor();
     r = color.redF();
     g = color.greenF();
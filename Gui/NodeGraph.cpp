@@ -3398,9 +3398,7 @@ NodeGraphPrivate::pasteNode(const NodeSerialization & internalSerialization,
 
     const std::string & masterNodeName = internalSerialization.getMasterNodeName();
     if ( masterNodeName.empty() ) {
-        std::vector<boost::shared_ptr<Natron::Node> > allNodes;
-        _gui->getApp()->getActiveNodes(&allNodes);
-        n->restoreKnobsLinks(internalSerialization,allNodes);
+        n->restoreKnobsLinks(internalSerialization);
     } else {
         boost::shared_ptr<Natron::Node> masterNode = _gui->getApp()->getProject()->getNodeByName(masterNodeName);
 
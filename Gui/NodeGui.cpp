@@ -17,7 +17,6 @@ CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
 #include <QLayout>
 #include <QAction>
-#include <QtConcurrentRun>
 #include <QFontMetrics>
 #include <QMenu>
 #include <QTextDocument> // for Qt::convertFromPlainText
@@ -51,6 +50,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/Image.h"
 #include "Engine/Settings.h"
 #include "Engine/Knob.h"
+#include "Engine/PreviewScheduler.h"
 #define NATRON_STATE_INDICATOR_OFFSET 5
 
 #define NATRON_EDGE_DROP_TOLERANCE 15
@@ -737,7 +737,7 @@ NodeGui::updatePreviewImage(int time)
         
         ensurePreviewCreated();
 
-        QtConcurrent::run(this,&NodeGui::computePreviewImage,time);
+        appPTR->getPreviewScheduler()->schedulePreview(_internalNode, time);
     }
 }
 
@@ -754,7 +754,7 @@ NodeGui::forceComputePreview(int time)
         
         ensurePreviewCreated();
 
-        QtConcurrent::run(this,&NodeGui::computePreviewImage,time);
+        appPTR->getPreviewScheduler()->schedulePreview(_internalNode, time);
     }
 }
 
@@ -1880,6 +1880,9 @@ void
 NodeGui::deleteReferences()
 {
     removeUndoStack();
+    if (_internalNode) {
+        appPTR->getPreviewScheduler()->cancelPreviews( _internalNode.get() );
+    }
     for (InputEdgesMap::const_iterator it = _inputEdges.begin(); it != _inputEdges.end(); ++it) {
         Edge* e = it->second;
         if (e) {
@@ -162,6 +162,8 @@ public:
     
     virtual void setPosition(double x,double y) OVERRIDE FINAL;
 
+    virtual void computePreviewImage(int time) OVERRIDE FINAL;
+
     /*Returns true if the NodeGUI contains the point (in items coordinates)*/
     virtual bool contains(const QPointF &point) const OVERRIDE FINAL;
 
@@ -435,8 +437,6 @@ private:
     
     void setAboveItem(QGraphicsItem* item);
 
-    void computePreviewImage(int time);
-
     void populateMenu();
 
     void refreshCurrentBrush();
@@ -10,6 +10,8 @@
 #include "ProjectGui.h"
 
 #include <fstream>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
@@ -254,13 +256,68 @@ ProjectGui::save(boost::archive::xml_oarchive & archive) const
     archive << boost::serialization::make_nvp("ProjectGui",projectGuiSerializationObj);
 }
 
+void
+ProjectGui::save(boost::archive::binary_oarchive & archive) const
+{
+    ProjectGuiSerialization projectGuiSerializationObj;
+
+    projectGuiSerializationObj.initialize(this);
+    archive << boost::serialization::make_nvp("ProjectGui",projectGuiSerializationObj);
+}
+
+namespace {
+class ProjectGuiSerializationSnapshot
+    : public ProjectGuiSnapshot
+{
+    ProjectGuiSerialization _serialization;
+
+public:
+
+    ProjectGuiSerializationSnapshot(const ProjectGui* projectGui)
+    : ProjectGuiSnapshot()
+    , _serialization()
+    {
+        _serialization.initialize(projectGui);
+    }
+
+    virtual ~ProjectGuiSerializationSnapshot()
+    {
+    }
+
+    virtual void encode(boost::archive::binary_oarchive & archive) const OVERRIDE FINAL
+    {
+        archive << boost::serialization::make_nvp("ProjectGui",_serialization);
+    }
+};
+}
+
+boost::shared_ptr<ProjectGuiSnapshot>
+ProjectGui::snapshot() const
+{
+    return boost::shared_ptr<ProjectGuiSnapshot>( new ProjectGuiSerializationSnapshot(this) );
+}
+
 void
 ProjectGui::load(boost::archive::xml_iarchive & archive)
 {
     ProjectGuiSerialization obj;
 
     archive >> boost::serialization::make_nvp("ProjectGui",obj);
+    restore(obj);
+}
 
+void
+ProjectGui::load(boost::archive::binary_iarchive & archive)
+{
+    ProjectGuiSerialization obj;
+
+    archive >> boost::serialization::make_nvp("ProjectGui",obj);
+    restore(obj);
+}
+
+void
+ProjectGui::restore(const ProjectGuiSerialization & obj)
+{
     const std::map<std::string, ViewerData > & viewersProjections = obj.getViewersProjections();
     
 
@@ -469,7 +526,7 @@ ProjectGui::load(boost::archive::xml_iarchive & archive)
         _gui->getNodeGraph()->clearSelection();
     }
     QTimer::singleShot( 25, _gui->getNodeGraph(), SLOT(centerOnAllNodes()));
-} // load
+} // restore
 
 std::list<boost::shared_ptr<NodeGui> > ProjectGui::getVisibleNodes() const
 {
@@ -33,12 +33,16 @@ class LineEdit;
 class Color_Knob;
 class DockablePanel;
 class ProjectGuiSerialization;
+class ProjectGuiSnapshot;
 class Gui;
 class NodeGui;
 class NodeGuiSerialization;
 namespace boost {
 namespace archive {
-class xml_archive;
+class xml_iarchive;
+class xml_oarchive;
+class binary_iarchive;
+class binary_oarchive;
 }
 }
 
@@ -75,6 +79,15 @@ public:
 
     void load(boost::archive::xml_iarchive & archive);
 
+    void save(boost::archive::binary_oarchive & archive) const;
+
+    /**
+     * @brief Same as save() but the serialization is only encoded when calling ProjectGuiSnapshot::encode, possibly from another thread.
+     **/
+    boost::shared_ptr<ProjectGuiSnapshot> snapshot() const;
+
+    void load(boost::archive::binary_iarchive & archive);
+
     void registerNewColorPicker(boost::shared_ptr<Color_Knob> knob);
 
     void removeColorPicker(boost::shared_ptr<Color_Knob> knob);
@@ -105,6 +118,10 @@ public slots:
 
 private:
 
+    /**
+     * @brief Restores the GUI of the project (viewers, panes, backdrops...) read by load().
+     **/
+    void restore(const ProjectGuiSerialization & obj);
 
     Gui* _gui;
     boost::shared_ptr<Natron::Project> _project;
@@ -3186,9 +3186,12 @@ ViewerTab::manageSlotsForInfoWidget(int textureIndex,
     RenderEngine* engine = _imp->viewerNode->getRenderEngine();
     assert(engine);
     if (connect) {
+        QObject::connect( engine, SIGNAL( droppedFramesChanged(int) ), _imp->infoWidget[textureIndex], SLOT( setDroppedFrames(int) ) );
         QObject::connect( engine, SIGNAL( fpsChanged(double,double) ), _imp->infoWidget[textureIndex], SLOT( setFps(double,double) ) );
         QObject::connect( engine,SIGNAL( renderFinished(int) ),_imp->infoWidget[textureIndex],SLOT( hideFps() ) );
     } else {
+        QObject::disconnect( engine, SIGNAL( droppedFramesChanged(int) ), _imp->infoWidget[textureIndex],
+                            SLOT( setDroppedFrames(int) ) );
         QObject::disconnect( engine, SIGNAL( fpsChanged(double,double) ), _imp->infoWidget[textureIndex],
                             SLOT( setFps(double,double) ) );
         QObject::disconnect( engine,SIGNAL( renderFinished(int) ),_imp->infoWidget[textureIndex],SLOT( hideFps() ) );
@@ -12,12 +12,15 @@
 
 #include "BaseTest.h"
 
+#include <cstring>
+
 #include "Engine/Node.h"
 #include "Engine/Project.h"
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Plugin.h"
+#include "Engine/Image.h"
 using namespace Natron;
 
 
@@ -223,6 +226,64 @@ TEST_F(BaseTest,GenerateDot)
     _app->startWritersRendering(works);
 }
 
+///Renders the generator in bands as when streaming a frame to a writer, then the whole frame: the bands must only cover
+///their region of interest, even though the generator is cached, and reassemble into the full frame
+TEST_F(BaseTest,BandsReassembleIntoTheFullFrame)
+{
+    boost::shared_ptr<Node> generator = createNode(_dotGeneratorPluginID);
+
+    ///Referenced by 2 writers, the generator caches its output
+    boost::shared_ptr<Node> writer1 = createNode(_writeOIIOPluginID);
+    boost::shared_ptr<Node> writer2 = createNode(_writeOIIOPluginID);
+    connectNodes(generator, writer1, 0, true);
+    connectNodes(generator, writer2, 0, true);
+    ASSERT_TRUE( generator->shouldCacheOutput() );
+
+    EffectInstance* effect = generator->getLiveInstance();
+    RenderScale scale;
+    scale.x = scale.y = 1.;
+    U64 hash = effect->getHash();
+    RectD rod;
+    bool isProjectFormat;
+    ASSERT_EQ( eStatusOK, effect->getRegionOfDefinition_public(hash, 0, scale, 0, &rod, &isProjectFormat) );
+    RectI renderWindow;
+    rod.toPixelEnclosing(scale, effect->getPreferredAspectRatio(), &renderWindow);
+    ImageComponentsEnum components;
+    ImageBitDepthEnum depth;
+    effect->getPreferredDepthAndComponents(-1, &components, &depth);
+
+    std::vector<RectI> bands = RectI::splitRectIntoBands(renderWindow, renderWindow.height() / 7);
+    ASSERT_GT(bands.size(), 1U);
+    std::vector<boost::shared_ptr<Image> > bandImages;
+    {
+        ParallelRenderArgsSetter frameArgs(generator.get(), 0, 0, false, false, true, hash, false, _app->getTimeLine().get());
+        generator->setStreamingBands(true);
+        for (std::vector<RectI>::iterator it = bands.begin(); it != bands.end(); ++it) {
+            boost::shared_ptr<Image> band = effect->renderRoI( EffectInstance::RenderRoIArgs(0, scale, 0, 0, false, *it, rod,
+                                                                                            components, depth) );
+            ASSERT_TRUE(band);
+            EXPECT_EQ( *it, band->getBounds() );
+            bandImages.push_back(band);
+        }
+        generator->setStreamingBands(false);
+    }
+
+    boost::shared_ptr<Image> full;
+    {
+        ParallelRenderArgsSetter frameArgs(generator.get(), 0, 0, false, false, true, hash, false, _app->getTimeLine().get());
+        full = effect->renderRoI( EffectInstance::RenderRoIArgs(0, scale, 0, 0, false, renderWindow, rod, components, depth) );
+    }
+    ASSERT_TRUE(full);
+
+    std::size_t rowSize = renderWindow.width() * full->getComponentsCount() * getSizeOfForBitDepth(depth);
+    for (std::size_t i = 0; i < bands.size(); ++i) {
+        for (int y = bands[i].y1; y < bands[i].y2; ++y) {
+            ASSERT_EQ( 0, std::memcmp( bandImages[i]->pixelAt(renderWindow.x1, y), full->pixelAt(renderWindow.x1, y), rowSize ) )
+                << "scan-line " << y;
+        }
+    }
+}
+
 ///High level test: simple node connections test
 TEST_F(BaseTest,SimpleNodeConnections) {
     ///create the generator
@@ -0,0 +1,175 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <list>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QFuture>
+#include <QtConcurrentRun>
+
+#include "Engine/BoundedMPMCQueue.h"
+
+TEST(BoundedMPMCQueue,FIFOAndBounds) {
+    BoundedMPMCQueue<int> queue(3);
+
+    ///The capacity is rounded up to a power of 2
+    ASSERT_EQ( 4, queue.capacity() );
+
+    int value;
+    EXPECT_FALSE( queue.tryPop(&value) );
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE( queue.tryPush(i) );
+    }
+    EXPECT_FALSE( queue.tryPush(4) );
+    EXPECT_EQ( 4, queue.size() );
+
+    ///Go around the ring several times
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE( queue.tryPop(&value) );
+        EXPECT_EQ(i, value);
+        ASSERT_TRUE( queue.tryPush(i + 4) );
+    }
+    EXPECT_EQ( 4, queue.size() );
+
+    queue.clear();
+    EXPECT_TRUE( queue.isEmpty() );
+    EXPECT_FALSE( queue.tryPop(&value) );
+}
+
+TEST(BoundedMPMCQueue,Peek) {
+    BoundedMPMCQueue<int> queue(8);
+
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE( queue.tryPush(10 + i) );
+    }
+    int value;
+    ASSERT_TRUE( queue.tryPop(&value) );
+
+    std::list<int> values;
+    queue.peek(3, &values);
+    ASSERT_EQ( 3u, values.size() );
+    EXPECT_EQ( 11, values.front() );
+    EXPECT_EQ( 13, values.back() );
+
+    ///Peeking does not remove anything
+    values.clear();
+    queue.peek(10, &values);
+    EXPECT_EQ( 4u, values.size() );
+    EXPECT_EQ( 4, queue.size() );
+}
+
+TEST(BoundedMPMCQueue,CountersWrapAround) {
+    ///Start a few values before the counters overflow
+    BoundedMPMCQueue<int> queue(4, 0xFFFFFFFFu - 5);
+    int value;
+
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE( queue.tryPush(i) );
+    }
+    for (int i = 3; i < 40; ++i) {
+        ASSERT_TRUE( queue.tryPush(i) );
+        EXPECT_EQ( 4, queue.size() );
+        EXPECT_FALSE( queue.tryPush(-1) );
+        ASSERT_TRUE( queue.tryPop(&value) );
+        EXPECT_EQ(i - 3, value);
+    }
+    std::list<int> values;
+    queue.peek(10, &values);
+    ASSERT_EQ( 3u, values.size() );
+    EXPECT_EQ( 37, values.front() );
+}
+
+namespace {
+struct StressQueue
+{
+    BoundedMPMCQueue<int> queue;
+    QAtomicInt nPopped;
+    int nValues;
+
+    StressQueue(int capacity,
+                int nValues)
+    : queue(capacity)
+    , nPopped(0)
+    , nValues(nValues)
+    {
+    }
+};
+
+///Pushes firstValue, firstValue + step, ... up to nValues
+static void
+produce(StressQueue* q,
+        int firstValue,
+        int step)
+{
+    for (int v = firstValue; v < q->nValues; v += step) {
+        while ( !q->queue.tryPush(v) ) {
+            QThread::yieldCurrentThread();
+        }
+    }
+}
+
+///Pops until all the values were popped, by any consumer
+static std::vector<int>
+consume(StressQueue* q)
+{
+    std::vector<int> popped;
+    int value;
+
+    while (q->nPopped.fetchAndAddRelaxed(0) < q->nValues) {
+        if ( q->queue.tryPop(&value) ) {
+            popped.push_back(value);
+            q->nPopped.fetchAndAddRelaxed(1);
+        } else {
+            QThread::yieldCurrentThread();
+        }
+    }
+
+    return popped;
+}
+}
+
+TEST(BoundedMPMCQueue,ConcurrentValuesAreDeliveredExactlyOnce) {
+    const int nProducers = 4;
+    const int nConsumers = 4;
+    StressQueue q(8, 200000);
+
+    ///The threads are not taken from the global pool which may have fewer threads than needed here
+    QThreadPool pool;
+    pool.setMaxThreadCount(nProducers + nConsumers);
+    std::list<QFuture<std::vector<int> > > consumers;
+    for (int i = 0; i < nConsumers; ++i) {
+        consumers.push_back( QtConcurrent::run(&pool, consume, &q) );
+    }
+    std::list<QFuture<void> > producers;
+    for (int i = 0; i < nProducers; ++i) {
+        producers.push_back( QtConcurrent::run(&pool, produce, &q, i, nProducers) );
+    }
+
+    std::vector<int> nDelivered(q.nValues, 0);
+    for (std::list<QFuture<std::vector<int> > >::iterator it = consumers.begin(); it != consumers.end(); ++it) {
+        std::vector<int> popped = it->result();
+        std::vector<int> lastOfProducer(nProducers, -1);
+        for (std::size_t i = 0; i < popped.size(); ++i) {
+            ASSERT_TRUE(popped[i] >= 0 && popped[i] < q.nValues);
+            ++nDelivered[popped[i]];
+            ///A consumer sees the values of a producer in the order they were pushed
+            int producer = popped[i] % nProducers;
+            EXPECT_LT(lastOfProducer[producer], popped[i]);
+            lastOfProducer[producer] = popped[i];
+        }
+    }
+    for (std::list<QFuture<void> >::iterator it = producers.begin(); it != producers.end(); ++it) {
+        it->waitForFinished();
+    }
+
+    for (int v = 0; v < q.nValues; ++v) {
+        ASSERT_EQ(1, nDelivered[v]) << "value " << v;
+    }
+    EXPECT_TRUE( q.queue.isEmpty() );
+}
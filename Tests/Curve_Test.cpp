@@ -6,10 +6,15 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
 #include <QString>
 #include <QDir>
 
 #include "Engine/Curve.h"
+#include "Engine/Interpolation.h"
 
 TEST(KeyFrame,Basic)
 {
@@ -101,3 +106,203 @@ TEST(Curve,Basic)
 }
 
 
+
+namespace {
+/// Interpolate the keyframes at t from the keyframe they follow, the way Curve::getValueAt
+/// used to do it before the keyframes were flattened into segments.
+double
+interpolateFromKeyFrames(const KeyFrameSet & keys,
+                         double t)
+{
+    KeyFrameSet::const_iterator itup = keys.upper_bound( KeyFrame(t,0.) );
+    double tcur,vcur,vcurDerivRight,tnext,vnext,vnextDerivLeft;
+    Natron::KeyframeTypeEnum interp,interpNext;
+
+    if ( itup == keys.begin() ) {
+        tnext = itup->getTime();
+        vnext = itup->getValue();
+        vnextDerivLeft = itup->getLeftDerivative();
+        interpNext = itup->getInterpolation();
+        tcur = tnext - 1.;
+        vcur = vnext;
+        vcurDerivRight = 0.;
+        interp = Natron::eKeyframeTypeNone;
+    } else {
+        KeyFrameSet::const_iterator itcur = itup;
+        --itcur;
+        tcur = itcur->getTime();
+        vcur = itcur->getValue();
+        vcurDerivRight = itcur->getRightDerivative();
+        interp = itcur->getInterpolation();
+        if ( itup == keys.end() ) {
+            tnext = tcur + 1.;
+            vnext = vcur;
+            vnextDerivLeft = 0.;
+            interpNext = Natron::eKeyframeTypeNone;
+        } else {
+            tnext = itup->getTime();
+            vnext = itup->getValue();
+            vnextDerivLeft = itup->getLeftDerivative();
+            interpNext = itup->getInterpolation();
+        }
+    }
+
+    return Natron::interpolate(tcur,vcur,vcurDerivRight,vnextDerivLeft,tnext,vnext,t,interp,interpNext);
+}
+}
+
+TEST(Curve,GetValuesAt)
+{
+    Curve c;
+
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(0.,10.) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(10.,20.,0.,0.,Natron::eKeyframeTypeLinear) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(15.,-5.,0.,0.,Natron::eKeyframeTypeConstant) ) );
+    EXPECT_TRUE( c.addKeyFrame( KeyFrame(30.,7.,0.,0.,Natron::eKeyframeTypeCatmullRom) ) );
+
+    // increasing times, with a few jumps backward and forward
+    std::vector<double> times;
+    for (double t = -5.; t <= 35.; t += 0.25) {
+        times.push_back(t);
+    }
+    times.push_back(12.);
+    times.push_back(-20.);
+    times.push_back(40.);
+    times.push_back(0.);
+
+    // getValueAt and getValuesAt share the segments, compare both with the keyframes interpolated directly
+    KeyFrameSet keys = c.getKeyFrames_mt_safe();
+    std::vector<double> values( times.size() );
+    c.getValuesAt(&times[0], (int)times.size(), &values[0]);
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        double expected = interpolateFromKeyFrames(keys, times[i]);
+        EXPECT_NEAR( expected, values[i], 1e-9 );
+        EXPECT_NEAR( expected, c.getValueAt(times[i]), 1e-9 );
+    }
+
+    // values known without interpolating: at the keyframes and along the constant segment
+    double known[] = { 0., 10., 15., 20., 29.5, 30. };
+    double knownValues[] = { 10., 20., -5., -5., -5., 7. };
+    const int knownCount = sizeof(known) / sizeof(known[0]);
+    double knownResults[knownCount];
+    c.getValuesAt(known, knownCount, knownResults);
+    for (int i = 0; i < knownCount; ++i) {
+        EXPECT_EQ( knownValues[i], knownResults[i] );
+        EXPECT_EQ( knownValues[i], c.getValueAt(known[i]) );
+    }
+
+    // the batch must see keyframe modifications
+    EXPECT_FALSE( c.addKeyFrame( KeyFrame(10.,0.) ) );
+    keys = c.getKeyFrames_mt_safe();
+    c.getValuesAt(&times[0], (int)times.size(), &values[0]);
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_NEAR( interpolateFromKeyFrames(keys, times[i]), values[i], 1e-9 );
+    }
+    double t = 10.;
+    double v;
+    c.getValuesAt(&t, 1, &v);
+    EXPECT_EQ( 0., v );
+}
+
+namespace {
+/// Integrate the keyframes from t1 to t2 by walking every segment in between, the way
+/// Curve::getIntegrateFromTo used to do it before the integrals were tabulated.
+double
+integrateByWalkingSegments(const KeyFrameSet & keys,
+                           double t1,
+                           double t2,
+                           bool clamp,
+                           double vmin,
+                           double vmax)
+{
+    bool opposite = false;
+
+    if (t1 > t2) {
+        opposite = true;
+        std::swap(t1,t2);
+    }
+    double sum = 0.;
+    KeyFrameSet::const_iterator itup = keys.upper_bound( KeyFrame(t1,0.) );
+    for (;; ) {
+        double tcur,vcur,vcurDerivRight,tnext,vnext,vnextDerivLeft;
+        Natron::KeyframeTypeEnum interp,interpNext;
+        if ( itup == keys.begin() ) {
+            tnext = itup->getTime();
+            vnext = itup->getValue();
+            vnextDerivLeft = itup->getLeftDerivative();
+            interpNext = itup->getInterpolation();
+            tcur = tnext - 1.;
+            vcur = vnext;
+            vcurDerivRight = 0.;
+            interp = Natron::eKeyframeTypeNone;
+        } else {
+            KeyFrameSet::const_iterator itcur = itup;
+            --itcur;
+            tcur = itcur->getTime();
+            vcur = itcur->getValue();
+            vcurDerivRight = itcur->getRightDerivative();
+            interp = itcur->getInterpolation();
+            if ( itup == keys.end() ) {
+                tnext = tcur + 1.;
+                vnext = vcur;
+                vnextDerivLeft = 0.;
+                interpNext = Natron::eKeyframeTypeNone;
+            } else {
+                tnext = itup->getTime();
+                vnext = itup->getValue();
+                vnextDerivLeft = itup->getLeftDerivative();
+                interpNext = itup->getInterpolation();
+            }
+        }
+        bool last = itup == keys.end() || itup->getTime() >= t2;
+        double end = last ? t2 : itup->getTime();
+        if (clamp) {
+            sum += Natron::integrate_clamp(tcur,vcur,vcurDerivRight,vnextDerivLeft,tnext,vnext,t1,end,vmin,vmax,interp,interpNext);
+        } else {
+            sum += Natron::integrate(tcur,vcur,vcurDerivRight,vnextDerivLeft,tnext,vnext,t1,end,interp,interpNext);
+        }
+        if (last) {
+            break;
+        }
+        t1 = end;
+        ++itup;
+    }
+
+    return opposite ? -sum : sum;
+}
+}
+
+TEST(Curve,IntegrateRandom)
+{
+    const Natron::KeyframeTypeEnum types[] = {
+        Natron::eKeyframeTypeConstant, Natron::eKeyframeTypeLinear, Natron::eKeyframeTypeSmooth,
+        Natron::eKeyframeTypeCatmullRom, Natron::eKeyframeTypeCubic, Natron::eKeyframeTypeHorizontal,
+        Natron::eKeyframeTypeFree, Natron::eKeyframeTypeBroken
+    };
+    const int typesCount = sizeof(types) / sizeof(types[0]);
+
+    std::srand(2015);
+    for (int trial = 0; trial < 100; ++trial) {
+        Curve c;
+        int nKeys = 1 + std::rand() % 10;
+        for (int i = 0; i < nKeys; ++i) {
+            double time = std::rand() % 100;
+            double value = 10. * std::rand() / RAND_MAX;
+            double left = std::rand() / (double)RAND_MAX - 0.5;
+            double right = std::rand() / (double)RAND_MAX - 0.5;
+            c.addKeyFrame( KeyFrame(time, value, left, right, types[std::rand() % typesCount]) );
+        }
+        // clamp half of the curves
+        bool clamp = trial % 2;
+        if (clamp) {
+            c.setYRange(2., 8.);
+        }
+        KeyFrameSet keys = c.getKeyFrames_mt_safe();
+        for (int i = 0; i < 100; ++i) {
+            double t1 = std::rand() % 130 - 15 + 0.25 * (std::rand() % 4);
+            double t2 = std::rand() % 130 - 15 + 0.5 * (std::rand() % 2);
+            double expected = integrateByWalkingSegments(keys, t1, t2, clamp, 2., 8.);
+            EXPECT_NEAR( expected, c.getIntegrateFromTo(t1, t2), 1e-9 * std::max( 1., std::abs(expected) ) );
+        }
+    }
+}
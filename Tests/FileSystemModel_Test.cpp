@@ -0,0 +1,103 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#ifndef Q_MOC_RUN
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <SequenceParsing.h>
+
+#include "Engine/FileSystemModel.h"
+
+namespace {
+///Groups the files into sequences the way the file dialog's gatherer does, trying each file against the sequences
+///found so far, either all of them or only the ones with the same skeleton.
+///Returns a description of each sequence, sorted.
+static std::vector<std::string>
+groupIntoSequences(const std::vector<std::string> & fileNames,
+                   bool bySkeleton)
+{
+    std::vector< boost::shared_ptr<SequenceParsing::SequenceFromFiles> > sequences;
+    std::map< std::string, std::vector<int> > sequencesBySkeleton;
+
+    for (std::size_t i = 0; i < fileNames.size(); ++i) {
+        SequenceParsing::FileNameContent fileContent("/shots/" + fileNames[i]);
+        std::vector<int> allSequences;
+        for (std::size_t s = 0; s < sequences.size(); ++s) {
+            allSequences.push_back( (int)s );
+        }
+        std::vector<int> & candidates = bySkeleton ? sequencesBySkeleton[FileSystemModel::getSequenceSkeleton(fileNames[i])] : allSequences;
+
+        bool found = false;
+        for (std::vector<int>::reverse_iterator it = candidates.rbegin(); it != candidates.rend(); ++it) {
+            if ( sequences[*it]->tryInsertFile(fileContent,false) ) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            candidates.push_back( (int)sequences.size() );
+            sequences.push_back( boost::shared_ptr<SequenceParsing::SequenceFromFiles>( new SequenceParsing::SequenceFromFiles(fileContent,false) ) );
+        }
+    }
+
+    std::vector<std::string> ret;
+    for (std::size_t s = 0; s < sequences.size(); ++s) {
+        std::stringstream ss;
+        ss << sequences[s]->generateValidSequencePattern() << ':';
+        const std::map<int,SequenceParsing::FileNameContent> & frames = sequences[s]->getFrameIndexes();
+        for (std::map<int,SequenceParsing::FileNameContent>::const_iterator it = frames.begin(); it != frames.end(); ++it) {
+            ss << ' ' << it->second.absoluteFileName();
+        }
+        ret.push_back( ss.str() );
+    }
+    std::sort( ret.begin(), ret.end() );
+
+    return ret;
+}
+}
+
+TEST(FileSystemModel,SequenceSkeleton) {
+    EXPECT_EQ( std::string("img.#.exr"), FileSystemModel::getSequenceSkeleton("img.0001.exr") );
+    EXPECT_EQ( std::string("img.#.exr"), FileSystemModel::getSequenceSkeleton("img.1.exr") );
+    EXPECT_EQ( std::string("shot#_v#.#.exr"), FileSystemModel::getSequenceSkeleton("shot010_v2.0001.exr") );
+    EXPECT_EQ( std::string("#.exr"), FileSystemModel::getSequenceSkeleton("001.exr") );
+    EXPECT_EQ( std::string("readme.txt"), FileSystemModel::getSequenceSkeleton("readme.txt") );
+}
+
+///Only trying the sequences with the same skeleton must not change the sequences found
+TEST(FileSystemModel,SkeletonGroupsLikeTryInsertFile) {
+    const char* names[] = {
+        ///padded frames, with a gap
+        "img.0001.exr", "img.0002.exr", "img.0003.exr", "img.0010.exr",
+        ///unpadded frames with the same name
+        "img.1.exr", "img.2.exr", "img.10.exr", "img.100.exr",
+        ///multiple groups of digits: versions and shots
+        "shot010_v2.0001.exr", "shot010_v2.0002.exr", "shot010_v3.0001.exr", "shot010_v3.0002.exr",
+        "shot020_v2.0001.exr", "shot020_v2.0002.exr",
+        "shot010_v2_0001.exr", "shot010_v2_0002.exr",
+        ///digits first, and no digits at all
+        "001.exr", "002.exr", "0003.exr",
+        "readme.txt", "img.exr",
+    };
+    std::vector<std::string> fileNames( names, names + sizeof(names) / sizeof(names[0]) );
+
+    ///The gatherer sees them sorted by name, or in the reverse order when sorting in descending order
+    std::sort( fileNames.begin(), fileNames.end() );
+    std::vector<std::string> all = groupIntoSequences(fileNames, false);
+    EXPECT_EQ( all, groupIntoSequences(fileNames, true) );
+    EXPECT_LT( all.size(), fileNames.size() );
+
+    std::reverse( fileNames.begin(), fileNames.end() );
+    EXPECT_EQ( groupIntoSequences(fileNames, false), groupIntoSequences(fileNames, true) );
+}
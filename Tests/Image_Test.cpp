@@ -104,3 +104,31 @@ TEST(ImageKeyTest,Difference) {
     ASSERT_TRUE(keyHash1 != keyHash2);
 }
 
+
+TEST(ImageTest,TilesMinMax) {
+    RectI bounds(0,0,3 * NATRON_IMAGE_MINMAX_TILE_SIZE,2 * NATRON_IMAGE_MINMAX_TILE_SIZE);
+    RectD rod(0,0,bounds.x2,bounds.y2);
+    Natron::Image img(Natron::eImageComponentRGBA,rod,bounds,0,1.,Natron::eImageBitDepthFloat,true);
+    float vmin,vmax;
+
+    ASSERT_FALSE( img.getTileMinMax(0,1,1,&vmin,&vmax) );
+
+    img.setTileMinMax(0,1,1,-1.,2.,img.getTilesMinMaxAge());
+    img.setTileMinMax(0,2,0,0.,1.,img.getTilesMinMaxAge());
+    ASSERT_TRUE( img.getTileMinMax(0,1,1,&vmin,&vmax) );
+    EXPECT_EQ(-1.f, vmin);
+    EXPECT_EQ(2.f, vmax);
+    ///another key was not measured
+    ASSERT_FALSE( img.getTileMinMax(1,1,1,&vmin,&vmax) );
+
+    ///a value measured before the tiles were invalidated is discarded
+    U64 age = img.getTilesMinMaxAge();
+    img.markForRendered( RectI(0,0,1,1) );
+    img.setTileMinMax(0,0,0,0.,1.,age);
+    ASSERT_FALSE( img.getTileMinMax(0,0,0,&vmin,&vmax) );
+
+    ///writing to a tile only invalidates the tiles it intersects
+    img.fill( RectI(NATRON_IMAGE_MINMAX_TILE_SIZE + 1,NATRON_IMAGE_MINMAX_TILE_SIZE + 1,NATRON_IMAGE_MINMAX_TILE_SIZE + 2,NATRON_IMAGE_MINMAX_TILE_SIZE + 2),0.,0.,0.,0. );
+    ASSERT_FALSE( img.getTileMinMax(0,1,1,&vmin,&vmax) );
+    ASSERT_TRUE( img.getTileMinMax(0,2,0,&vmin,&vmax) );
+}
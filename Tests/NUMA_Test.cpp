@@ -0,0 +1,196 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+
+#if defined(__NATRON_LINUX__)
+#include <sched.h>
+#endif
+
+#include "Engine/NUMA.h"
+#include "Engine/Timer.h"
+
+using namespace Natron;
+
+namespace {
+///Number of floats of the buffers of the benchmark: 256MB, much larger than the caches
+#define NUMA_TEST_BUFFER_COUNT (64 * 1024 * 1024)
+
+///Reads a buffer a few times from a thread pinned to a node and records the bandwidth in GB/s
+class ReaderThread
+    : public QThread
+{
+    int _node;
+    const std::vector<float>* _buffer;
+
+public:
+
+    double bandwidth;
+
+    ReaderThread(int node,
+                 const std::vector<float>* buffer)
+    : QThread()
+    , _node(node)
+    , _buffer(buffer)
+    , bandwidth(0.)
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        NUMA::ThreadNodeSetter setter(_node);
+        const int nPasses = 4;
+        volatile float sum = 0.f;
+        TimeLapse timer;
+
+        for (int p = 0; p < nPasses; ++p) {
+            float s = 0.f;
+            for (std::size_t i = 0; i < _buffer->size(); ++i) {
+                s += (*_buffer)[i];
+            }
+            sum = sum + s;
+        }
+        double elapsed = timer.getTimeSinceCreation();
+        bandwidth = (double)nPasses * _buffer->size() * sizeof(float) / elapsed / 1e9;
+    }
+};
+
+///Allocates a buffer from a thread pinned to a node, so that its pages are first touched on that node
+class AllocatorThread
+    : public QThread
+{
+    int _node;
+    std::vector<float>* _buffer;
+
+public:
+
+    AllocatorThread(int node,
+                    std::vector<float>* buffer)
+    : QThread()
+    , _node(node)
+    , _buffer(buffer)
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        NUMA::ThreadNodeSetter setter(_node);
+
+        _buffer->resize(NUMA_TEST_BUFFER_COUNT, 1.f);
+    }
+};
+
+static double
+readBandwidth(int readerNode,
+              const std::vector<float>& buffer)
+{
+    ReaderThread reader(readerNode, &buffer);
+
+    reader.start();
+    reader.wait();
+
+    return reader.bandwidth;
+}
+}
+
+TEST(NUMA,ThreadNodeSetterRestoresPlacement) {
+    ASSERT_GE(NUMA::getNodesCount(), 1);
+    EXPECT_EQ( -1, NUMA::getCurrentThreadNode() );
+    {
+        NUMA::ThreadNodeSetter setter(NUMA::getNodesCount() - 1);
+#if defined(__NATRON_LINUX__)
+        EXPECT_EQ( NUMA::getNodesCount() - 1, NUMA::getCurrentThreadNode() );
+#endif
+    }
+    EXPECT_EQ( -1, NUMA::getCurrentThreadNode() );
+
+    ///Disabled: render threads are not placed
+    NUMA::setEnabled(false);
+    EXPECT_EQ( -1, NUMA::getNextRenderThreadNode() );
+}
+
+#if defined(__NATRON_LINUX__)
+///The process may have been restricted to some cores, e.g: by taskset: unpinning must not give the thread the others
+TEST(NUMA,UnpinningRestoresTheOriginalAffinity) {
+    cpu_set_t original;
+    ASSERT_EQ( 0, sched_getaffinity(0, sizeof(cpu_set_t), &original) );
+
+    cpu_set_t restricted;
+    CPU_ZERO(&restricted);
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if ( CPU_ISSET(c, &original) ) {
+            CPU_SET(c, &restricted);
+            break;
+        }
+    }
+    ASSERT_EQ( 0, sched_setaffinity(0, sizeof(cpu_set_t), &restricted) );
+
+    ///Only the node of that core can be pinned to, and the thread keeps running on that core only
+    int pinnedNode = -1;
+    for (int node = 0; node < NUMA::getNodesCount() && pinnedNode == -1; ++node) {
+        if ( NUMA::pinCurrentThreadToNode(node) ) {
+            pinnedNode = node;
+        }
+    }
+    cpu_set_t current;
+    if (pinnedNode != -1) {
+        EXPECT_EQ( pinnedNode, NUMA::getCurrentThreadNode() );
+        ASSERT_EQ( 0, sched_getaffinity(0, sizeof(cpu_set_t), &current) );
+        EXPECT_TRUE( CPU_EQUAL(&current, &restricted) );
+
+        EXPECT_TRUE( NUMA::pinCurrentThreadToNode(-1) );
+        EXPECT_EQ( -1, NUMA::getCurrentThreadNode() );
+    }
+    ASSERT_EQ( 0, sched_getaffinity(0, sizeof(cpu_set_t), &current) );
+    EXPECT_TRUE( CPU_EQUAL(&current, &restricted) );
+
+    EXPECT_EQ( 0, sched_setaffinity(0, sizeof(cpu_set_t), &original) );
+}
+#endif
+
+TEST(NUMA,RemoteReadBenchmark) {
+    if (NUMA::getNodesCount() < 2) {
+        std::cout << "NUMA benchmark skipped: this machine has a single NUMA node" << std::endl;
+
+        return;
+    }
+
+    ///A buffer first touched on node 0, read from node 1 (what happens when render threads are not placed)
+    std::vector<float> remote;
+    {
+        AllocatorThread allocator(0, &remote);
+        allocator.start();
+        allocator.wait();
+    }
+    double remoteBandwidth = readBandwidth(1, remote);
+
+    ///The same buffer placed on node 1 as Buffer::allocate does for a render thread pinned to node 1
+    double movedBandwidth;
+    {
+        NUMA::ThreadNodeSetter setter(1);
+        NUMA::moveMemoryToCurrentThreadNode( &remote.front(), remote.size() * sizeof(float) );
+        movedBandwidth = readBandwidth(1, remote);
+    }
+
+    ///A buffer first touched on node 1
+    std::vector<float> local;
+    {
+        AllocatorThread allocator(1, &local);
+        allocator.start();
+        allocator.wait();
+    }
+    double localBandwidth = readBandwidth(1, local);
+
+    EXPECT_GT(remoteBandwidth, 0.);
+    std::cout << "read bandwidth from node 1: "
+              << "buffer on node 0 " << remoteBandwidth << " GB/s, "
+              << "buffer moved to node 1 " << movedBandwidth << " GB/s, "
+              << "buffer allocated on node 1 " << localBandwidth << " GB/s" << std::endl;
+}
@@ -0,0 +1,105 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QCoreApplication>
+
+#include "Global/QtCompat.h" // for removeRecursively
+#include "Engine/OfxDescriptorsCache.h"
+
+namespace {
+static void
+removeDir(const QString & dirPath)
+{
+#   if QT_VERSION < 0x050000
+    Natron::removeRecursively(dirPath);
+#   else
+    QDir(dirPath).removeRecursively();
+#endif
+}
+
+///A plug-ins directory with one bundle, and the cache describing it
+class OfxDescriptorsCacheTest
+    : public ::testing::Test
+{
+protected:
+
+    QString _dir;
+    QString _cacheFile;
+    std::list<std::string> _searchPath;
+    std::string _bundle;
+    std::string _binary;
+
+    virtual void SetUp() OVERRIDE FINAL
+    {
+        _dir = QDir::tempPath() + "/NatronOfxDescriptorsCacheTest" + QString::number( QCoreApplication::applicationPid() );
+        removeDir(_dir);
+        _cacheFile = _dir + "/OFXDescriptorsCache.bin";
+        _searchPath.push_back( QString(_dir + "/Plugins").toStdString() );
+        _bundle = QString(_dir + "/Plugins/Sub/Test.ofx.bundle").toStdString();
+        _binary = _bundle + "/Contents/Linux-x86-64/Test.ofx";
+        writeBinary(_binary, "binary");
+
+        OfxDescriptorsCache cache;
+        cache.searchPath = _searchPath;
+        cache.bundles[_bundle] = OfxBundleStamp(_bundle, _binary);
+        OfxPluginDescription plugin;
+        plugin.openfxId = "net.sf.openfx.Test";
+        plugin.formats.push_back("exr");
+        cache.plugins.push_back(plugin);
+        cache.write(_cacheFile);
+    }
+
+    virtual void TearDown() OVERRIDE FINAL
+    {
+        removeDir(_dir);
+    }
+
+    static void writeBinary(const std::string & filePath,
+                            const char* content)
+    {
+        QFileInfo info( filePath.c_str() );
+        QDir().mkpath( info.absolutePath() );
+        QFile file( filePath.c_str() );
+        ASSERT_TRUE( file.open(QIODevice::WriteOnly | QIODevice::Append) );
+        file.write(content);
+    }
+};
+}
+
+TEST_F(OfxDescriptorsCacheTest,ReadsBackWhatWasWritten) {
+    OfxDescriptorsCache cache;
+
+    ASSERT_TRUE( cache.read(_cacheFile, _searchPath) );
+    ASSERT_EQ( 1, (int)cache.plugins.size() );
+    EXPECT_EQ( std::string("net.sf.openfx.Test"), cache.plugins[0].openfxId );
+    ASSERT_EQ( 1, (int)cache.plugins[0].formats.size() );
+    EXPECT_EQ( std::string("exr"), cache.plugins[0].formats[0] );
+}
+
+TEST_F(OfxDescriptorsCacheTest,AStaleStampInvalidatesTheCache) {
+    ///The binary was rebuilt
+    writeBinary(_binary, " rebuilt");
+    OfxDescriptorsCache cache;
+    EXPECT_FALSE( cache.read(_cacheFile, _searchPath) );
+}
+
+TEST_F(OfxDescriptorsCacheTest,ANewBundleInvalidatesTheCache) {
+    writeBinary( QString(_dir + "/Plugins/Other.ofx.bundle/Contents/Linux-x86-64/Other.ofx").toStdString(), "binary" );
+    OfxDescriptorsCache cache;
+    EXPECT_FALSE( cache.read(_cacheFile, _searchPath) );
+}
+
+TEST_F(OfxDescriptorsCacheTest,AnotherSearchPathInvalidatesTheCache) {
+    std::list<std::string> searchPath = _searchPath;
+    searchPath.push_back( QString(_dir + "/MorePlugins").toStdString() );
+    OfxDescriptorsCache cache;
+    EXPECT_FALSE( cache.read(_cacheFile, searchPath) );
+}
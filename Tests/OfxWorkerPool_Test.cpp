@@ -0,0 +1,229 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QFuture>
+#include <QtConcurrentRun>
+
+#include "Engine/OfxWorkerPool.h"
+#include "Engine/Timer.h"
+
+#include "Sleeper.h"
+
+using namespace Natron;
+
+namespace {
+static OfxStatus
+runThreadIndex(OfxThreadFunctionV1 func,
+               unsigned int threadIndex,
+               unsigned int threadMax,
+               void *customArg)
+{
+    func(threadIndex, threadMax, customArg);
+
+    return kOfxStatOK;
+}
+
+static void
+countIndex(unsigned int threadIndex,
+           unsigned int /*threadMax*/,
+           void *customArg)
+{
+    std::vector<QAtomicInt>* counts = static_cast<std::vector<QAtomicInt>*>(customArg);
+    (*counts)[threadIndex].fetchAndAddOrdered(1);
+}
+
+///Counts the thread indexes run by the thread calling multiThread
+struct CallerThread
+{
+    QThread* thread;
+    QAtomicInt nIndexesRun;
+};
+
+static void
+recordThread(unsigned int /*threadIndex*/,
+             unsigned int /*threadMax*/,
+             void *customArg)
+{
+    CallerThread* caller = static_cast<CallerThread*>(customArg);
+
+    if (QThread::currentThread() == caller->thread) {
+        caller->nIndexesRun.fetchAndAddOrdered(1);
+    }
+}
+
+///A tiny work item, so that the dispatch overhead dominates
+static void
+tinyWork(unsigned int threadIndex,
+         unsigned int /*threadMax*/,
+         void *customArg)
+{
+    static_cast<QAtomicInt*>(customArg)->fetchAndAddRelaxed( (int)threadIndex + 1 );
+}
+
+///A thread index of a plug-in whose render function takes a mutex of the plug-in
+struct LockingWork
+{
+    QMutex* pluginMutex;
+    QAtomicInt entered; //< thread indexes which started, and possibly wait for the mutex
+    QAtomicInt done;
+};
+
+static void
+lockingWork(unsigned int /*threadIndex*/,
+            unsigned int /*threadMax*/,
+            void *customArg)
+{
+    LockingWork* work = static_cast<LockingWork*>(customArg);
+
+    work->entered.fetchAndAddOrdered(1);
+    QMutexLocker l(work->pluginMutex);
+    work->done.fetchAndAddOrdered(1);
+}
+
+static OfxStatus
+dispatchLockingWork(OfxWorkerPool* pool,
+                    LockingWork* work)
+{
+    return pool->dispatch(lockingWork, 4, 4, work);
+}
+
+///What multiThread used to do: one fresh thread per thread index
+class SpawnedThread
+    : public QThread
+{
+    unsigned int _threadIndex,_threadMax;
+    void* _customArg;
+
+public:
+
+    SpawnedThread(unsigned int threadIndex,
+                  unsigned int threadMax,
+                  void* customArg)
+    : QThread()
+    , _threadIndex(threadIndex)
+    , _threadMax(threadMax)
+    , _customArg(customArg)
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        tinyWork(_threadIndex, _threadMax, _customArg);
+    }
+};
+}
+
+TEST(OfxWorkerPool,EachIndexRunsOnce) {
+    OfxWorkerPool pool(runThreadIndex, 4);
+
+    for (unsigned int nThreads = 1; nThreads <= 16; ++nThreads) {
+        std::vector<QAtomicInt> counts(nThreads);
+        ASSERT_EQ( kOfxStatOK, pool.dispatch(countIndex, nThreads, 3, &counts) );
+        for (unsigned int i = 0; i < nThreads; ++i) {
+            EXPECT_EQ( 1, (int)counts[i] ) << "thread index " << i << " of " << nThreads;
+        }
+    }
+    ///The pool never grows beyond the concurrency asked for
+    EXPECT_LE(pool.getNWorkers(), 3);
+}
+
+///Plug-ins keeping a thread-local state must only ever see the threads of their own pool
+TEST(OfxWorkerPool,IndexesOnlyRunOnWorkers) {
+    OfxWorkerPool pool(runThreadIndex, 4);
+    CallerThread caller;
+
+    caller.thread = QThread::currentThread();
+    caller.nIndexesRun = 0;
+    for (unsigned int nThreads = 1; nThreads <= 16; ++nThreads) {
+        ASSERT_EQ( kOfxStatOK, pool.dispatch(recordThread, nThreads, 4, &caller) );
+    }
+    EXPECT_EQ(0, (int)caller.nIndexesRun);
+}
+
+///A render thread holding a mutex of the plug-in calls multiThread while the workers of the plug-in's pool are all
+///blocked on that mutex in the multiThread call of another render thread: a worker must be started for the first call.
+TEST(OfxWorkerPool,CallerHoldingAPluginMutex) {
+    OfxWorkerPool pool(runThreadIndex, 2);
+    QMutex pluginMutex;
+    LockingWork blocked;
+
+    blocked.pluginMutex = &pluginMutex;
+
+    pluginMutex.lock();
+    QFuture<OfxStatus> other = QtConcurrent::run(dispatchLockingWork, &pool, &blocked);
+
+    ///Wait for both workers to be stuck on the mutex
+    for (int i = 0; i < 1000 && (int)blocked.entered < 2; ++i) {
+        Sleeper::msleep(1);
+    }
+    EXPECT_EQ(2, (int)blocked.entered);
+    EXPECT_EQ(0, (int)blocked.done);
+
+    std::vector<QAtomicInt> counts(4);
+    EXPECT_EQ( kOfxStatOK, pool.dispatch(countIndex, 4, 4, &counts) );
+    for (unsigned int i = 0; i < 4; ++i) {
+        EXPECT_EQ( 1, (int)counts[i] ) << "thread index " << i;
+    }
+    ///One worker was started beyond the limit for the second call
+    EXPECT_EQ( 3, pool.getNWorkers() );
+    pluginMutex.unlock();
+
+    EXPECT_EQ( kOfxStatOK, other.result() );
+    EXPECT_EQ(4, (int)blocked.done);
+}
+
+TEST(OfxWorkerPool,DispatchLatencyBenchmark) {
+    const int nCalls = 500;
+    const unsigned int nThreads = (unsigned int)std::max(2, QThread::idealThreadCount());
+    const int expected = nCalls * (int)(nThreads * (nThreads + 1) / 2);
+
+    QAtomicInt spawnedSum(0);
+    double spawnedTime;
+    {
+        TimeLapse timer;
+        for (int c = 0; c < nCalls; ++c) {
+            std::vector<SpawnedThread*> threads(nThreads);
+            for (unsigned int i = 0; i < nThreads; ++i) {
+                threads[i] = new SpawnedThread(i, nThreads, &spawnedSum);
+                threads[i]->start();
+            }
+            for (unsigned int i = 0; i < nThreads; ++i) {
+                threads[i]->wait();
+                delete threads[i];
+            }
+        }
+        spawnedTime = timer.getTimeSinceCreation();
+    }
+    EXPECT_EQ(expected, (int)spawnedSum);
+
+    QAtomicInt pooledSum(0);
+    double pooledTime;
+    {
+        OfxWorkerPool pool( runThreadIndex, (int)nThreads );
+        ///Warm up so that the workers creation is not accounted
+        ASSERT_EQ( kOfxStatOK, pool.dispatch(tinyWork, nThreads, nThreads, &pooledSum) );
+        pooledSum = 0;
+
+        TimeLapse timer;
+        for (int c = 0; c < nCalls; ++c) {
+            ASSERT_EQ( kOfxStatOK, pool.dispatch(tinyWork, nThreads, nThreads, &pooledSum) );
+        }
+        pooledTime = timer.getTimeSinceCreation();
+    }
+    EXPECT_EQ(expected, (int)pooledSum);
+
+    std::cout << "multiThread dispatch of " << nThreads << " tiny work items: "
+              << "spawned threads " << spawnedTime * 1e6 / nCalls << " us/call, "
+              << "worker pool " << pooledTime * 1e6 / nCalls << " us/call" << std::endl;
+}
@@ -0,0 +1,257 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <sstream>
+#include <iostream>
+#include <cmath>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "BaseTest.h"
+
+#include "Engine/AppInstance.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/ProjectSerialization.h"
+#include "Engine/RotoContext.h"
+#include "Engine/StandardPaths.h"
+#include "Engine/Timer.h"
+
+#ifndef M_PI
+#define M_PI        3.14159265358979323846264338327950288   /* pi             */
+#endif
+
+///Number of nodes of the generated project
+#define PROJECT_BENCHMARK_NODES 2000
+
+///One node in this many is a Roto node, the others are generators
+#define PROJECT_BENCHMARK_ROTO_EVERY 10
+
+///Number of beziers of each Roto node
+#define PROJECT_BENCHMARK_BEZIERS 4
+
+///Number of control points of each bezier
+#define PROJECT_BENCHMARK_BEZIER_POINTS 8
+
+///Number of keyframes set on each animated parameter and bezier
+#define PROJECT_BENCHMARK_KEYFRAMES 20
+
+namespace {
+template <typename ARCHIVE>
+std::string
+saveProject(const ProjectSerialization & obj)
+{
+    std::ostringstream ss;
+    {
+        ARCHIVE oArchive(ss);
+        oArchive << boost::serialization::make_nvp("Project",obj);
+    }
+
+    return ss.str();
+}
+
+template <typename ARCHIVE>
+void
+loadProject(const std::string & data,
+            ProjectSerialization* obj)
+{
+    std::istringstream ss(data);
+    ARCHIVE iArchive(ss);
+
+    iArchive >> boost::serialization::make_nvp("Project",*obj);
+}
+}
+
+///Generates a large project of animated generators and Roto nodes with animated beziers, checks that the binary
+///encoding gives back exactly the same XML and measures how long both encodings take to deserialize
+TEST_F(BaseTest,ProjectBinaryRoundTripAndLoadBenchmark)
+{
+    boost::shared_ptr<Natron::Node> lastGenerator;
+    for (int i = 0; i < PROJECT_BENCHMARK_NODES; ++i) {
+        if ( lastGenerator && (i % PROJECT_BENCHMARK_ROTO_EVERY == 0) ) {
+            boost::shared_ptr<Natron::Node> roto = createNode(PLUGINID_OFX_ROTO);
+            ASSERT_TRUE(roto);
+            connectNodes(lastGenerator, roto, 0, true);
+            boost::shared_ptr<RotoContext> context = roto->getRotoContext();
+            ASSERT_TRUE(context);
+            for (int b = 0; b < PROJECT_BENCHMARK_BEZIERS; ++b) {
+                ///A closed shape around a circle, each point moving on its own path over the keyframes
+                boost::shared_ptr<Bezier> bezier = context->makeBezier(100. * b + 100., 0., kRotoBezierBaseName);
+                for (int p = 1; p < PROJECT_BENCHMARK_BEZIER_POINTS; ++p) {
+                    double angle = 2. * M_PI * p / PROJECT_BENCHMARK_BEZIER_POINTS;
+                    bezier->addControlPoint( (100. * b + 100.) * std::cos(angle), (100. * b + 100.) * std::sin(angle) );
+                }
+                bezier->setCurveFinished(true);
+                for (int t = 1; t < PROJECT_BENCHMARK_KEYFRAMES; ++t) {
+                    for (int p = 0; p < PROJECT_BENCHMARK_BEZIER_POINTS; ++p) {
+                        bezier->movePointByIndex(p, t, (p + t) * 0.37, (p - t) * 0.53);
+                    }
+                }
+            }
+            continue;
+        }
+
+        boost::shared_ptr<Natron::Node> node = createNode(_dotGeneratorPluginID);
+        ASSERT_TRUE(node);
+        lastGenerator = node;
+        const std::vector< boost::shared_ptr<KnobI> > & knobs = node->getKnobs();
+        for (U32 k = 0; k < knobs.size(); ++k) {
+            Double_Knob* knob = dynamic_cast<Double_Knob*>( knobs[k].get() );
+            if ( !knob || !knob->isAnimationEnabled() ) {
+                continue;
+            }
+            for (int d = 0; d < knob->getDimension(); ++d) {
+                for (int t = 0; t < PROJECT_BENCHMARK_KEYFRAMES; ++t) {
+                    knob->setValueAtTime(t, i + t * 0.37 + d, d);
+                }
+            }
+        }
+    }
+
+    ProjectSerialization original(_app);
+    original.initialize( _app->getProject().get() );
+    ASSERT_EQ( PROJECT_BENCHMARK_NODES, (int)original.getNodesSerialization().size() );
+
+    std::string xml = saveProject<boost::archive::xml_oarchive>(original);
+    std::string binary = saveProject<boost::archive::binary_oarchive>(original);
+
+    double xmlLoadTime;
+    {
+        ProjectSerialization fromXml(_app);
+        TimeLapse timer;
+        loadProject<boost::archive::xml_iarchive>(xml, &fromXml);
+        xmlLoadTime = timer.getTimeSinceCreation();
+        EXPECT_EQ( PROJECT_BENCHMARK_NODES, (int)fromXml.getNodesSerialization().size() );
+    }
+
+    double binaryLoadTime;
+    {
+        ProjectSerialization fromBinary(_app);
+        TimeLapse timer;
+        loadProject<boost::archive::binary_iarchive>(binary, &fromBinary);
+        binaryLoadTime = timer.getTimeSinceCreation();
+
+        ///Lossless: saving what was read from the binary encoding as XML gives the original XML
+        EXPECT_EQ( xml, saveProject<boost::archive::xml_oarchive>(fromBinary) );
+    }
+
+    RecordProperty( "nodes", PROJECT_BENCHMARK_NODES );
+    RecordProperty( "xmlSizeKB", (int)(xml.size() / 1024) );
+    RecordProperty( "xmlLoadTimeMs", (int)(xmlLoadTime * 1000.) );
+    RecordProperty( "binarySizeKB", (int)(binary.size() / 1024) );
+    RecordProperty( "binaryLoadTimeMs", (int)(binaryLoadTime * 1000.) );
+}
+
+///Looks up every node of projects of growing size by name and by pointer, as done when restoring a project or from scripts.
+///With the nodes indexed, the time per lookup should stay about the same from 100 to 10000 nodes
+TEST_F(BaseTest,NodeLookupScaling)
+{
+    boost::shared_ptr<Natron::Project> project = _app->getProject();
+
+    for (int nNodes = 100; nNodes <= 10000; nNodes *= 10) {
+        project->clearNodes(false);
+
+        TimeLapse creationTimer;
+        std::vector< boost::shared_ptr<Natron::Node> > nodes;
+        for (int i = 0; i < nNodes; ++i) {
+            nodes.push_back( createNode(_dotGeneratorPluginID) );
+            ASSERT_TRUE( nodes.back() );
+        }
+        double creationTime = creationTimer.getTimeSinceCreation();
+
+        TimeLapse lookupTimer;
+        for (int i = 0; i < nNodes; ++i) {
+            EXPECT_EQ( nodes[i], project->getNodeByName( nodes[i]->getName() ) );
+            EXPECT_EQ( nodes[i], project->getNodePointer( nodes[i].get() ) );
+        }
+        double lookupTime = lookupTimer.getTimeSinceCreation();
+
+        ///The index follows renames
+        std::string oldName = nodes[0]->getName();
+        nodes[0]->setName("renamedNode");
+        EXPECT_EQ( nodes[0], project->getNodeByName("renamedNode") );
+        EXPECT_FALSE( project->getNodeByName(oldName) );
+
+        std::cout << nNodes << " nodes: created in " << creationTime * 1000. << " ms, "
+                  << lookupTime * 1e9 / (2 * nNodes) << " ns per lookup" << std::endl;
+    }
+    project->clearNodes(false);
+}
+
+///When several nodes or knobs have the same name, the lookups return the first one, even after renames
+TEST_F(BaseTest,DuplicateNamesReturnTheFirst)
+{
+    boost::shared_ptr<Natron::Project> project = _app->getProject();
+    std::vector< boost::shared_ptr<Natron::Node> > nodes;
+
+    for (int i = 0; i < 3; ++i) {
+        nodes.push_back( createNode(_dotGeneratorPluginID) );
+        ASSERT_TRUE( nodes.back() );
+    }
+    std::string name = nodes[0]->getName();
+    nodes[2]->setName( name.c_str() );
+    EXPECT_EQ( nodes[0], project->getNodeByName(name) );
+    nodes[0]->setName("renamedNode");
+    EXPECT_EQ( nodes[2], project->getNodeByName(name) );
+    nodes[0]->setName( name.c_str() );
+    EXPECT_EQ( nodes[0], project->getNodeByName(name) );
+
+    const std::vector< boost::shared_ptr<KnobI> > & knobs = nodes[1]->getKnobs();
+    ASSERT_GE( knobs.size(), 2u );
+    std::string knobName = knobs[0]->getName();
+    knobs[1]->setName(knobName);
+    EXPECT_EQ( knobs[0], nodes[1]->getKnobByName(knobName) );
+    knobs[0]->setName("renamedKnob");
+    EXPECT_EQ( knobs[1], nodes[1]->getKnobByName(knobName) );
+    EXPECT_EQ( knobs[0], nodes[1]->getKnobByName("renamedKnob") );
+    knobs[0]->setName(knobName);
+    EXPECT_EQ( knobs[0], nodes[1]->getKnobByName(knobName) );
+
+    project->clearNodes(false);
+}
+
+///The tests run in background mode: loading a project loads the plug-ins it uses concurrently before creating its nodes
+TEST_F(BaseTest,ProjectRestoreLoadsItsPlugins)
+{
+    boost::shared_ptr<Natron::Project> project = _app->getProject();
+
+    ///Plug-ins of two different bundles, one of them used several times
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE( createNode(_dotGeneratorPluginID) );
+    }
+    ASSERT_TRUE( createNode(_writeOIIOPluginID) );
+
+    QString path = Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationTemp);
+    QDir().mkpath(path);
+    path.append( QDir::separator() );
+    QString name("NatronUnitTestRestore.ntp");
+    QString filePath = project->saveProject(path, name, false);
+    ASSERT_FALSE( filePath.isEmpty() );
+
+    project->clearNodes(false);
+    EXPECT_TRUE( project->loadProject(path, name) );
+    QFile::remove(filePath);
+
+    std::vector< boost::shared_ptr<Natron::Node> > nodes = project->getCurrentNodes();
+    ASSERT_EQ( 4, (int)nodes.size() );
+    int nDotGenerators = 0;
+    int nWriters = 0;
+    for (U32 i = 0; i < nodes.size(); ++i) {
+        if ( nodes[i]->getPluginID() == _dotGeneratorPluginID.toStdString() ) {
+            ++nDotGenerators;
+        } else if ( nodes[i]->getPluginID() == _writeOIIOPluginID.toStdString() ) {
+            ++nWriters;
+        }
+    }
+    EXPECT_EQ(3, nDotGenerators);
+    EXPECT_EQ(1, nWriters);
+    project->clearNodes(false);
+}
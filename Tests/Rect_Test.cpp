@@ -0,0 +1,56 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/Rect.h"
+
+TEST(RectI,BandsGoFromTopToBottom) {
+    RectI rect(10,0,110,100);
+    std::vector<RectI> bands = RectI::splitRectIntoBands(rect, 30);
+
+    ASSERT_EQ( 4u, bands.size() );
+    EXPECT_TRUE( bands[0] == RectI(10,70,110,100) );
+    EXPECT_TRUE( bands[1] == RectI(10,40,110,70) );
+    EXPECT_TRUE( bands[2] == RectI(10,10,110,40) );
+    ///The last band is clipped to the rect
+    EXPECT_TRUE( bands[3] == RectI(10,0,110,10) );
+
+    ///They cover the rect exactly
+    RectI covered = bands[0];
+    U64 area = bands[0].area();
+    for (std::size_t i = 1; i < bands.size(); ++i) {
+        EXPECT_EQ( bands[i - 1].bottom(), bands[i].top() );
+        covered.merge(bands[i]);
+        area += bands[i].area();
+    }
+    EXPECT_TRUE(covered == rect);
+    EXPECT_EQ( rect.area(), area );
+}
+
+TEST(RectI,SingleBand) {
+    RectI rect(0,-50,100,50);
+    std::vector<RectI> bands = RectI::splitRectIntoBands(rect, 0);
+
+    ASSERT_EQ( 1u, bands.size() );
+    EXPECT_TRUE(bands[0] == rect);
+
+    bands = RectI::splitRectIntoBands(rect, -1);
+    ASSERT_EQ( 1u, bands.size() );
+    EXPECT_TRUE(bands[0] == rect);
+
+    bands = RectI::splitRectIntoBands(rect, 100);
+    ASSERT_EQ( 1u, bands.size() );
+    EXPECT_TRUE(bands[0] == rect);
+
+    bands = RectI::splitRectIntoBands(rect, 50);
+    ASSERT_EQ( 2u, bands.size() );
+    EXPECT_TRUE( bands[0] == RectI(0,0,100,50) );
+    EXPECT_TRUE( bands[1] == RectI(0,-50,100,0) );
+
+    EXPECT_TRUE( RectI::splitRectIntoBands(RectI(), 10).empty() );
+}
@@ -0,0 +1,155 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <set>
+#include <gtest/gtest.h>
+
+#include "Engine/RenderFarm.h"
+
+namespace {
+static std::list<RenderFarm::WriterRange>
+makeWork(int firstFrame,
+         int lastFrame)
+{
+    RenderFarm::WriterRange r;
+
+    r.writerName = "Write1";
+    r.firstFrame = firstFrame;
+    r.lastFrame = lastFrame;
+
+    return std::list<RenderFarm::WriterRange>(1, r);
+}
+
+///Renders all the frames left with the given worker, returns the frames it rendered
+static std::set<int>
+renderEverything(RenderFarmFrames* frames,
+                 int worker)
+{
+    std::set<int> ret;
+    RenderFarm::WriterRange chunk;
+
+    while ( frames->takeChunk(worker, &chunk) ) {
+        for (int f = chunk.firstFrame; f <= chunk.lastFrame; ++f) {
+            EXPECT_TRUE( frames->notifyFrameRendered(worker, f) );
+            ret.insert(f);
+        }
+        frames->releaseChunk(worker);
+    }
+
+    return ret;
+}
+}
+
+TEST(RenderFarm,WorkerQuittingMidChunk) {
+    RenderFarmFrames frames(makeWork(1, 100), 2);
+    RenderFarm::WriterRange chunk;
+
+    ///Worker 0 renders the first frame of its chunk and quits
+    ASSERT_TRUE( frames.takeChunk(0, &chunk) );
+    ASSERT_LT(chunk.firstFrame, chunk.lastFrame);
+    EXPECT_TRUE( frames.notifyFrameRendered(0, chunk.firstFrame) );
+    EXPECT_FALSE( frames.notifyFrameRendered(0, chunk.firstFrame) ); //< already reported
+    EXPECT_FALSE( frames.notifyFrameRendered(1, chunk.firstFrame + 1) ); //< not the chunk of worker 1
+    frames.releaseChunk(0);
+    EXPECT_FALSE( frames.hasChunksInFlight() );
+
+    ///Worker 1 renders the rest, including the frames worker 0 did not report
+    std::set<int> rendered = renderEverything(&frames, 1);
+    EXPECT_EQ( 99U, rendered.size() );
+    for (int f = chunk.firstFrame + 1; f <= chunk.lastFrame; ++f) {
+        EXPECT_TRUE( rendered.count(f) ) << "frame " << f;
+    }
+    EXPECT_FALSE( rendered.count(chunk.firstFrame) );
+    EXPECT_EQ( 100, frames.getNFramesRendered() );
+    EXPECT_EQ( frames.getNFramesTotal(), frames.getNFramesRendered() );
+}
+
+TEST(RenderFarm,FailingFrameIsGivenUp) {
+    RenderFarmFrames frames(makeWork(1, 20), 1);
+    RenderFarm::WriterRange chunk;
+
+    ///Frame 7 always fails: it is handed out a few times, then the render ends without it
+    int nChunks = 0;
+    while ( frames.takeChunk(0, &chunk) && nChunks < 100 ) {
+        for (int f = chunk.firstFrame; f <= chunk.lastFrame; ++f) {
+            if (f != 7) {
+                frames.notifyFrameRendered(0, f);
+            }
+        }
+        frames.releaseChunk(0);
+        ++nChunks;
+    }
+    EXPECT_LT(nChunks, 100);
+    EXPECT_EQ( 19, frames.getNFramesRendered() );
+    EXPECT_LT( frames.getNFramesRendered(), frames.getNFramesTotal() );
+}
+
+TEST(RenderFarm,AbortHandsOutNothing) {
+    RenderFarmFrames frames(makeWork(1, 20), 2);
+    RenderFarm::WriterRange chunk;
+
+    ASSERT_TRUE( frames.takeChunk(0, &chunk) );
+    frames.abort();
+    frames.releaseChunk(0);
+    EXPECT_FALSE( frames.takeChunk(1, &chunk) );
+    EXPECT_FALSE( frames.hasChunksInFlight() );
+}
+
+TEST(RenderFarm,SequentialWriterIsNotSplit) {
+    std::list<RenderFarm::WriterRange> work = makeWork(1, 50);
+    RenderFarm::WriterRange sequential;
+
+    sequential.writerName = "WriteMovie";
+    sequential.firstFrame = 1;
+    sequential.lastFrame = 50;
+    sequential.sequential = true;
+    work.push_back(sequential);
+
+    RenderFarmFrames frames(work, 4);
+    RenderFarm::WriterRange chunk;
+    int worker = 0;
+    bool sequentialHandedOut = false;
+    while ( frames.takeChunk(worker, &chunk) ) {
+        if (chunk.writerName == "WriteMovie") {
+            ///All the frames of the sequential writer go to a single worker at once
+            EXPECT_FALSE(sequentialHandedOut);
+            EXPECT_TRUE(chunk.sequential);
+            EXPECT_EQ(1, chunk.firstFrame);
+            EXPECT_EQ(50, chunk.lastFrame);
+            sequentialHandedOut = true;
+        } else {
+            EXPECT_LT(chunk.lastFrame - chunk.firstFrame + 1, 50);
+        }
+        for (int f = chunk.firstFrame; f <= chunk.lastFrame; ++f) {
+            EXPECT_TRUE( frames.notifyFrameRendered(worker, f) );
+        }
+        frames.releaseChunk(worker);
+        worker = (worker + 1) % 4;
+    }
+    EXPECT_TRUE(sequentialHandedOut);
+    EXPECT_EQ( 100, frames.getNFramesRendered() );
+}
+
+TEST(RenderFarm,SequentialWriterResumesOnAnotherWorker) {
+    std::list<RenderFarm::WriterRange> work = makeWork(1, 30);
+
+    work.front().sequential = true;
+
+    RenderFarmFrames frames(work, 2);
+    RenderFarm::WriterRange chunk;
+
+    ///Worker 0 dies after rendering 10 frames: the 20 others go to worker 1 in one chunk
+    ASSERT_TRUE( frames.takeChunk(0, &chunk) );
+    EXPECT_EQ(30, chunk.lastFrame);
+    for (int f = 1; f <= 10; ++f) {
+        EXPECT_TRUE( frames.notifyFrameRendered(0, f) );
+    }
+    frames.releaseChunk(0);
+    ASSERT_TRUE( frames.takeChunk(1, &chunk) );
+    EXPECT_TRUE(chunk.sequential);
+    EXPECT_EQ(11, chunk.firstFrame);
+    EXPECT_EQ(30, chunk.lastFrame);
+}
@@ -0,0 +1,117 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QFuture>
+#include <QtConcurrentRun>
+
+#include "Engine/RenderQueue.h"
+#include "Engine/Timer.h"
+
+#include "Sleeper.h"
+
+using namespace Natron;
+
+namespace {
+///Yields from a pool thread tagged with the given priority, returns how long it waited in milliseconds
+static double
+yieldAs(RenderQueue* queue,
+        Natron::RenderPriorityEnum priority)
+{
+    RenderPrioritySetter prioritySetter(priority);
+    TimeLapse timer;
+
+    queue->yieldToHigherPriority();
+
+    return timer.getTimeSinceCreation() * 1000.;
+}
+}
+
+TEST(RenderQueue,BackgroundWaitsForInteractive) {
+    RenderQueue queue;
+
+    queue.beginTask(eRenderPriorityInteractive);
+    QFuture<double> waited = QtConcurrent::run(yieldAs, &queue, eRenderPriorityBackground);
+    Sleeper::msleep(30);
+    queue.endTask(eRenderPriorityInteractive, 0.03);
+
+    ///It waited for the interactive task to end
+    EXPECT_GE(waited.result(), 20.);
+    EXPECT_EQ( 1U, queue.getStats(eRenderPriorityBackground).preemptions );
+    EXPECT_EQ( 0U, queue.getStats(eRenderPriorityInteractive).preemptions );
+}
+
+TEST(RenderQueue,WaitIsBounded) {
+    RenderQueue queue;
+
+    ///The interactive task never ends while the playback thread yields: the yield returns once the whole bounded wait elapsed
+    queue.beginTask(eRenderPriorityInteractive);
+    EXPECT_GE(QtConcurrent::run(yieldAs, &queue, eRenderPriorityPlayback).result(), 90.);
+    queue.endTask(eRenderPriorityInteractive, 0.);
+}
+
+TEST(RenderQueue,TimedOutWaitIsNotRepeated) {
+    RenderQueue queue;
+
+    ///Every tile of a frame yields: once a wait timed out on a task, the next tiles don't wait for it again
+    queue.beginTask(eRenderPriorityInteractive);
+    EXPECT_GE(QtConcurrent::run(yieldAs, &queue, eRenderPriorityBackground).result(), 90.);
+    for (int tile = 0; tile < 10; ++tile) {
+        QtConcurrent::run(yieldAs, &queue, eRenderPriorityBackground).waitForFinished();
+    }
+    EXPECT_EQ( 1U, queue.getStats(eRenderPriorityBackground).preemptions );
+
+    ///Until a more urgent task completes
+    queue.beginTask(eRenderPriorityInteractive);
+    queue.endTask(eRenderPriorityInteractive, 0.);
+    EXPECT_GE(QtConcurrent::run(yieldAs, &queue, eRenderPriorityBackground).result(), 90.);
+    EXPECT_EQ( 2U, queue.getStats(eRenderPriorityBackground).preemptions );
+    queue.endTask(eRenderPriorityInteractive, 0.);
+}
+
+TEST(RenderQueue,MoreUrgentNeverWaits) {
+    RenderQueue queue;
+
+    queue.beginTask(eRenderPriorityBackground);
+    queue.beginTask(eRenderPriorityPlayback);
+    QtConcurrent::run(yieldAs, &queue, eRenderPriorityInteractive).waitForFinished();
+    QtConcurrent::run(yieldAs, &queue, eRenderPriorityPlayback).waitForFinished();
+    EXPECT_EQ( 0U, queue.getStats(eRenderPriorityInteractive).preemptions );
+    EXPECT_EQ( 0U, queue.getStats(eRenderPriorityPlayback).preemptions );
+    queue.endTask(eRenderPriorityPlayback, 0.);
+    queue.endTask(eRenderPriorityBackground, 0.);
+}
+
+TEST(RenderQueue,LatencyAccounting) {
+    RenderQueue queue;
+
+    queue.beginTask(eRenderPriorityPlayback);
+    queue.beginTask(eRenderPriorityPlayback);
+    EXPECT_EQ( 2, queue.getStats(eRenderPriorityPlayback).activeTasks );
+    queue.endTask(eRenderPriorityPlayback, 0.1);
+    queue.endTask(eRenderPriorityPlayback, 0.3);
+
+    RenderQueueStats stats = queue.getStats(eRenderPriorityPlayback);
+    EXPECT_EQ(0, stats.activeTasks);
+    EXPECT_EQ(2U, stats.tasksCompleted);
+    EXPECT_DOUBLE_EQ(0.2, stats.averageLatency);
+    EXPECT_DOUBLE_EQ(0.3, stats.maxLatency);
+    EXPECT_GT(stats.throughput, 0.);
+
+    ///The other classes are not affected
+    EXPECT_EQ( 0U, queue.getStats(eRenderPriorityBackground).tasksCompleted );
+
+    ///Resetting keeps the tasks in flight
+    queue.beginTask(eRenderPriorityPlayback);
+    queue.resetStats();
+    stats = queue.getStats(eRenderPriorityPlayback);
+    EXPECT_EQ(1, stats.activeTasks);
+    EXPECT_EQ(0U, stats.tasksCompleted);
+    EXPECT_EQ(0., stats.maxLatency);
+    queue.endTask(eRenderPriorityPlayback, 0.5);
+    EXPECT_DOUBLE_EQ( 0.5, queue.getStats(eRenderPriorityPlayback).averageLatency );
+}
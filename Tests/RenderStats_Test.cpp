@@ -0,0 +1,186 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <QtCore/QFuture>
+#include <QtConcurrentRun>
+
+#include "Engine/RenderStats.h"
+
+///The nodes are only used as keys, they are named by the registry itself
+class TestRenderStatsRegistry
+    : public RenderStatsRegistry
+{
+    std::map<const Natron::EffectInstance*,std::string> _names;
+
+public:
+
+    TestRenderStatsRegistry()
+    : RenderStatsRegistry()
+    , _names()
+    {
+        setEnabled(true);
+    }
+
+    const Natron::EffectInstance* makeNode(const std::string& name)
+    {
+        ///Any distinct address will do
+        const Natron::EffectInstance* node = reinterpret_cast<const Natron::EffectInstance*>(_names.size() + 1);
+
+        _names[node] = name;
+
+        return node;
+    }
+
+protected:
+
+    virtual std::string getNodeName(const Natron::EffectInstance* node) const
+    {
+        std::map<const Natron::EffectInstance*,std::string>::const_iterator found = _names.find(node);
+
+        return found == _names.end() ? std::string() : found->second;
+    }
+};
+
+static const std::string natronCache("NatronCache");
+
+static void
+recordBlur(TestRenderStatsRegistry* stats,
+           const Natron::EffectInstance* blur)
+{
+    stats->addRenderRoICall(blur);
+    stats->addRenderTime(blur, 2, 1.);
+    stats->addPluginMemory(blur, -40);
+    stats->addCacheLookup(&natronCache, false);
+}
+
+TEST(RenderStats,NodesAccumulate) {
+    TestRenderStatsRegistry stats;
+    const Natron::EffectInstance* blur1 = stats.makeNode("Blur1");
+
+    stats.addRenderRoICall(blur1);
+    stats.addRenderRoICall(blur1);
+    stats.addRenderTime(blur1, 1, 0.5);
+    stats.addRenderTime(blur1, 1, 0.25);
+    stats.addRenderTime(blur1, 2, 1.);
+    stats.addNodeCacheLookup(blur1, RenderStatsRegistry::eCacheLookupResultMiss);
+    stats.addNodeCacheLookup(blur1, RenderStatsRegistry::eCacheLookupResultExactHit);
+    stats.addNodeCacheLookup(blur1, RenderStatsRegistry::eCacheLookupResultConvertedHit);
+    stats.addNodeBytesAllocated(blur1, 1024);
+    stats.addPluginMemory(blur1, 100);
+    stats.addPluginMemory(blur1, -40);
+
+    std::map<std::string,NodeRenderStats> nodes;
+    stats.getNodesStats(&nodes);
+    ASSERT_EQ( 1u, nodes.size() );
+    const NodeRenderStats& blur = nodes["Blur1"];
+    EXPECT_EQ(2u, blur.nRenderRoICalls);
+    EXPECT_DOUBLE_EQ(1.75, blur.cumulativeRenderTime);
+    EXPECT_EQ(2, blur.lastFrame);
+    EXPECT_DOUBLE_EQ(1., blur.lastFrameRenderTime);
+    EXPECT_EQ(1u, blur.cacheMisses);
+    EXPECT_EQ(1u, blur.cacheExactHits);
+    EXPECT_EQ(1u, blur.cacheConvertedHits);
+    EXPECT_EQ(1024u, blur.bytesAllocated);
+    EXPECT_EQ(60u, blur.pluginMemory);
+
+    stats.reset();
+    stats.getNodesStats(&nodes);
+    EXPECT_TRUE( nodes.empty() );
+}
+
+TEST(RenderStats,DisabledRecordsNothing) {
+    TestRenderStatsRegistry stats;
+    const Natron::EffectInstance* blur1 = stats.makeNode("Blur1");
+
+    stats.setEnabled(false);
+    stats.addRenderRoICall(blur1);
+    stats.addRenderTime(blur1, 1, 0.5);
+    stats.addCacheLookup(&natronCache, true);
+
+    std::map<std::string,NodeRenderStats> nodes;
+    stats.getNodesStats(&nodes);
+    EXPECT_TRUE( nodes.empty() );
+    std::map<std::string,CacheRenderStats> caches;
+    stats.getCachesStats(&caches);
+    EXPECT_TRUE( caches.empty() );
+}
+
+TEST(RenderStats,ThreadsAreSummedUp) {
+    TestRenderStatsRegistry stats;
+    const Natron::EffectInstance* blur1 = stats.makeNode("Blur1");
+
+    ///The memory registered by this thread is unregistered in part by another one
+    stats.addRenderRoICall(blur1);
+    stats.addRenderTime(blur1, 1, 0.5);
+    stats.addPluginMemory(blur1, 100);
+    stats.addCacheLookup(&natronCache, true);
+    QtConcurrent::run(recordBlur, &stats, blur1).waitForFinished();
+
+    std::map<std::string,NodeRenderStats> nodes;
+    stats.getNodesStats(&nodes);
+    ASSERT_EQ( 1u, nodes.size() );
+    const NodeRenderStats& blur = nodes["Blur1"];
+    EXPECT_EQ(2u, blur.nRenderRoICalls);
+    EXPECT_DOUBLE_EQ(1.5, blur.cumulativeRenderTime);
+    EXPECT_EQ(2, blur.lastFrame);
+    EXPECT_DOUBLE_EQ(1., blur.lastFrameRenderTime);
+    EXPECT_EQ(60u, blur.pluginMemory);
+
+    std::map<std::string,CacheRenderStats> caches;
+    stats.getCachesStats(&caches);
+    EXPECT_EQ(1u, caches[natronCache].hits);
+    EXPECT_EQ(1u, caches[natronCache].misses);
+}
+
+TEST(RenderStats,DeletedNodesAreKeptByName) {
+    TestRenderStatsRegistry stats;
+    const Natron::EffectInstance* blur1 = stats.makeNode("Blur1");
+    const Natron::EffectInstance* otherBlur1 = stats.makeNode("Blur1");
+
+    stats.addRenderTime(blur1, 1, 0.5);
+    stats.onNodeDeleted(blur1);
+    stats.addRenderTime(otherBlur1, 1, 0.25);
+
+    std::map<std::string,NodeRenderStats> nodes;
+    stats.getNodesStats(&nodes);
+    ASSERT_EQ( 1u, nodes.size() );
+    EXPECT_DOUBLE_EQ(0.75, nodes["Blur1"].cumulativeRenderTime);
+}
+
+TEST(RenderStats,PrintSortsByRenderTime) {
+    TestRenderStatsRegistry stats;
+
+    stats.addRenderTime(stats.makeNode("Cheap"), 1, 0.1);
+    stats.addRenderTime(stats.makeNode("Expensive"), 1, 2.);
+    stats.addCacheLookup(&natronCache, true);
+    stats.addCacheLookup(&natronCache, false);
+    stats.addCacheEntryCreated(&natronCache, 1024 * 1024);
+
+    std::map<std::string,CacheRenderStats> caches;
+    stats.getCachesStats(&caches);
+    ASSERT_EQ( 1u, caches.size() );
+    EXPECT_EQ(1u, caches[natronCache].hits);
+    EXPECT_EQ(1u, caches[natronCache].misses);
+    EXPECT_EQ(1u, caches[natronCache].entriesCreated);
+
+    std::stringstream ss;
+    std::streamsize precision = ss.precision();
+    stats.print(ss);
+    EXPECT_EQ( precision, ss.precision() );
+    std::string str = ss.str();
+    std::size_t expensive = str.find("Expensive");
+    std::size_t cheap = str.find("Cheap");
+    ASSERT_NE(std::string::npos, expensive);
+    ASSERT_NE(std::string::npos, cheap);
+    EXPECT_LT(expensive, cheap);
+    EXPECT_NE( std::string::npos, str.find("NatronCache") );
+    EXPECT_NE( std::string::npos, str.find("50.0%") );
+}
@@ -0,0 +1,78 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <gtest/gtest.h>
+
+#include "Engine/RenderThreadsController.h"
+
+TEST(RenderThreadsController,StartsFromTheCoresCount) {
+    RenderThreadsController controller;
+
+    controller.reset(1, 8);
+    EXPECT_EQ( 8, controller.getOptimalNThreads(1) );
+    EXPECT_EQ( 1, controller.getTilesThreadsPerFrame() );
+}
+
+TEST(RenderThreadsController,BacksOffWhenThreadsMakeRenderingSlower) {
+    RenderThreadsController controller;
+
+    controller.reset(8, 8);
+
+    ///The throughput scales up to 3 threads, then the memory bandwidth is saturated and more threads thrash it
+    const double fps[] = { 10., 20., 30., 30., 30., 28., 25., 20. };
+    int n = 8;
+    for (int i = 0; i < 6; ++i) {
+        n = controller.onIntervalMeasured(n, fps[n - 1]);
+    }
+    EXPECT_EQ(5, n);
+    EXPECT_EQ( 8 / 5, controller.getTilesThreadsPerFrame() );
+    EXPECT_FALSE( controller.getLastDecision().empty() );
+
+    ///Once settled it stays there, and when probing again it comes back to it
+    for (int i = 0; i < 20; ++i) {
+        n = controller.onIntervalMeasured(n, fps[n - 1]);
+        EXPECT_GE(n, 5);
+        EXPECT_LE(n, 6);
+    }
+    n = controller.onIntervalMeasured(n, fps[n - 1]);
+    EXPECT_EQ(5, n);
+}
+
+TEST(RenderThreadsController,KeepsThreadsThatDoNotMakeRenderingSlower) {
+    RenderThreadsController controller;
+
+    controller.reset(8, 8);
+
+    ///Threads beyond 3 do not pay off, but they do not cost anything either
+    const double fps[] = { 10., 20., 30., 30., 30., 30., 30., 30. };
+    int n = 8;
+    for (int i = 0; i < 20; ++i) {
+        n = controller.onIntervalMeasured(n, fps[n - 1]);
+        EXPECT_GE(n, 7);
+    }
+    n = controller.onIntervalMeasured(n, fps[n - 1]);
+    EXPECT_EQ(8, n);
+}
+
+TEST(RenderThreadsController,ProbingAgainKeepsItsOwnSample) {
+    RenderThreadsController controller;
+
+    ///A single core: there is no neighbour to probe
+    controller.reset(1, 1);
+    for (int i = 0; i < 25; ++i) {
+        EXPECT_EQ( 1, controller.onIntervalMeasured(1, 10.) );
+    }
+
+    ///With one thread less the throughput is higher: the probe of the count above must not make it forget that
+    controller.reset(2, 2);
+    int n = 2;
+    const double fps[] = { 12., 10. };
+    for (int i = 0; i < 25; ++i) {
+        n = controller.onIntervalMeasured(n, fps[n - 1]);
+    }
+    n = controller.onIntervalMeasured(n, fps[n - 1]);
+    EXPECT_EQ(1, n);
+}
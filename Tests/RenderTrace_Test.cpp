@@ -0,0 +1,196 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+#include <QtCore/QFuture>
+#include <QtConcurrentRun>
+
+#include "Global/Macros.h"
+#include "Engine/RenderTrace.h"
+
+static RenderTraceEvent
+makeEvent(RenderTrace* trace,
+          int i)
+{
+    RenderTraceEvent e;
+
+    e.kind = RenderTraceEvent::eSpanKindTile;
+    e.nodeNameId = trace->getNameId("Blur1");
+    e.time = i;
+    e.start = i * 10.;
+    e.duration = 5.;
+    e.bytes = 1024;
+
+    return e;
+}
+
+static int
+getThreadIndex(RenderTrace* trace)
+{
+    return trace->getCurrentThreadIndex();
+}
+
+static void
+recordOddEvents(RenderTrace* trace,
+                int count)
+{
+    for (int i = 1; i < count; i += 2) {
+        trace->record( makeEvent(trace, i) );
+    }
+}
+
+static int
+getGradeId(RenderTrace* trace)
+{
+    return trace->getNameId("Grade1");
+}
+
+///A thread recording one event and exiting, as the threads of the global pool do when they expire
+class RecordingThread
+    : public QThread
+{
+    RenderTrace* _trace;
+
+public:
+
+    int threadIndex;
+
+    RecordingThread(RenderTrace* trace)
+    : QThread()
+    , _trace(trace)
+    , threadIndex(-1)
+    {
+    }
+
+    virtual void run() OVERRIDE FINAL
+    {
+        threadIndex = _trace->getCurrentThreadIndex();
+        _trace->record( makeEvent(_trace, 0) );
+    }
+};
+
+TEST(RenderTrace,RingBufferKeepsTheLastEvents) {
+    RenderTrace trace(4);
+
+    for (int i = 0; i < 10; ++i) {
+        trace.record( makeEvent(&trace, i) );
+    }
+    std::vector<RenderTraceEvent> events;
+    trace.getEvents(&events);
+    ASSERT_EQ( 4, (int)events.size() );
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(6 + i, events[i].time);
+    }
+
+    trace.clear();
+    trace.getEvents(&events);
+    EXPECT_TRUE( events.empty() );
+}
+
+TEST(RenderTrace,ExportChromeTrace) {
+    RenderTrace trace(16);
+    RenderTraceEvent e = makeEvent(&trace, 1);
+
+    e.nodeNameId = trace.getNameId("My \"Node\"");
+    trace.record(e);
+
+    const std::string filePath = "RenderTrace_Test.json";
+    ASSERT_TRUE( trace.exportChromeTrace(filePath) );
+
+    std::ifstream ifile( filePath.c_str() );
+    std::stringstream ss;
+    ss << ifile.rdbuf();
+    std::string json = ss.str();
+    ifile.close();
+    std::remove( filePath.c_str() );
+
+    EXPECT_EQ(0u, json.find("{\"displayTimeUnit\""));
+    EXPECT_NE( std::string::npos, json.find("\"name\":\"tile My \\\"Node\\\"\"") );
+    EXPECT_NE( std::string::npos, json.find("\"ph\":\"X\"") );
+    EXPECT_NE( std::string::npos, json.find("\"bytes\":1024") );
+    EXPECT_NE( std::string::npos, json.find("\"thread_name\"") );
+    EXPECT_EQ( std::string::npos, json.find(",\n]") );
+}
+
+TEST(RenderTrace,ThreadIndexesArePerTrace) {
+    RenderTrace first(16);
+
+    EXPECT_EQ( 0, first.getCurrentThreadIndex() );
+    EXPECT_EQ( 0, first.getCurrentThreadIndex() );
+    EXPECT_EQ( 1, QtConcurrent::run(getThreadIndex, &first).result() );
+
+    ///Another trace numbers the threads from 0 in the order they record into it
+    RenderTrace second(16);
+    EXPECT_EQ( 0, QtConcurrent::run(getThreadIndex, &second).result() );
+    EXPECT_EQ( 1, second.getCurrentThreadIndex() );
+    EXPECT_EQ( 0, first.getCurrentThreadIndex() );
+}
+
+TEST(RenderTrace,EachThreadHasItsOwnRing) {
+    RenderTrace trace(4);
+
+    ///The main thread records the even times, another thread the odd ones, more than the capacity each
+    for (int i = 0; i < 10; i += 2) {
+        trace.record( makeEvent(&trace, i) );
+    }
+    QtConcurrent::run(recordOddEvents, &trace, 10).waitForFinished();
+    std::vector<RenderTraceEvent> events;
+    trace.getEvents(&events);
+
+    ///Each thread keeps its last 4 events, merged oldest first
+    ASSERT_EQ( 8, (int)events.size() );
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(2 + i, events[i].time);
+        EXPECT_EQ( (i % 2 == 0) ? 0 : 1, events[i].threadIndex );
+    }
+}
+
+TEST(RenderTrace,NamesAreInterned) {
+    RenderTrace trace(16);
+    int blur = trace.getNameId("Blur1");
+    int grade = trace.getNameId("Grade1");
+
+    EXPECT_NE(blur, grade);
+    EXPECT_EQ( blur, trace.getNameId("Blur1") );
+    EXPECT_EQ( grade, QtConcurrent::run(getGradeId, &trace).result() );
+
+    std::vector<std::string> names;
+    trace.getNames(&names);
+    ASSERT_EQ( 2, (int)names.size() );
+    EXPECT_EQ("Blur1", names[blur]);
+    EXPECT_EQ("Grade1", names[grade]);
+
+    ///Clearing forgets the names and the threads
+    trace.clear();
+    trace.getNames(&names);
+    EXPECT_TRUE( names.empty() );
+    EXPECT_EQ( 0, QtConcurrent::run(getThreadIndex, &trace).result() );
+    EXPECT_EQ( 1, trace.getCurrentThreadIndex() );
+    EXPECT_EQ( 0, trace.getNameId("Grade1") );
+}
+
+TEST(RenderTrace,ExitedThreadsGiveTheirBuffer) {
+    RenderTrace trace(4);
+
+    ///Many more threads than the table holds record one after the other
+    for (int i = 0; i < 300; ++i) {
+        RecordingThread thread(&trace);
+        thread.start();
+        thread.wait();
+        ASSERT_GE(thread.threadIndex, 0);
+        ASSERT_LT(thread.threadIndex, 256);
+    }
+    std::vector<RenderTraceEvent> events;
+    trace.getEvents(&events);
+    EXPECT_LE( (int)events.size(), 256 );
+}
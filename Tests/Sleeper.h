@@ -0,0 +1,24 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef SLEEPER_H
+#define SLEEPER_H
+
+#include <QtCore/QThread>
+
+///QThread::msleep is protected in Qt 4
+class Sleeper
+    : public QThread
+{
+public:
+
+    static void msleep(unsigned long msecs)
+    {
+        QThread::msleep(msecs);
+    }
+};
+
+#endif // SLEEPER_H
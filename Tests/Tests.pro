@@ -153,11 +153,25 @@ SOURCES += \
     google-test/src/gtest_main.cc \
     google-mock/src/gmock-all.cc \
     BaseTest.cpp \
+    BoundedMPMCQueue_Test.cpp \
     Hash64_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
     File_Knob_Test.cpp \
-    Curve_Test.cpp
+    FileSystemModel_Test.cpp \
+    Curve_Test.cpp \
+    NUMA_Test.cpp \
+    OfxDescriptorsCache_Test.cpp \
+    OfxWorkerPool_Test.cpp \
+    ProjectSerialization_Test.cpp \
+    Rect_Test.cpp \
+    RenderFarm_Test.cpp \
+    RenderQueue_Test.cpp \
+    RenderStats_Test.cpp \
+    RenderThreadsController_Test.cpp \
+    RenderTrace_Test.cpp \
+    Timer_Test.cpp
 
 HEADERS += \
-    BaseTest.h
+    BaseTest.h \
+    Sleeper.h
@@ -0,0 +1,85 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QElapsedTimer>
+
+#include "Engine/Timer.h"
+
+#include "Sleeper.h"
+
+TEST(Timer,DeadlinesAreSpacedByOneFrame) {
+    Timer timer;
+    timer.setDesiredFrameRate(100.);
+
+    QElapsedTimer clock;
+    clock.start();
+    ///The first frame is displayed right away, the next ones every 10 ms
+    for (int i = 0; i < 21; ++i) {
+        timer.waitUntilNextFrameIsDue();
+    }
+    qint64 elapsed = clock.elapsed();
+    EXPECT_GE(elapsed, 199);
+    EXPECT_EQ( 0, timer.getDroppedFramesCount() );
+}
+
+TEST(Timer,PausedDoesNotWait) {
+    Timer timer;
+    timer.setDesiredFrameRate(0.1);
+    timer.waitUntilNextFrameIsDue();
+
+    ///Waiting for the next frame would take 10 seconds: the paused calls all return before it is due
+    timer.playState = ePlayStatePause;
+    QElapsedTimer clock;
+    clock.start();
+    for (int i = 0; i < 5; ++i) {
+        timer.waitUntilNextFrameIsDue();
+    }
+    EXPECT_LT(clock.elapsed(), 10000);
+    EXPECT_EQ( 0, timer.getFramesLate() );
+}
+
+TEST(Timer,SlowsDownToTheRenderingSpeed) {
+    Timer timer;
+    timer.setDesiredFrameRate(100.);
+    timer.waitUntilNextFrameIsDue();
+
+    ///The display takes 5 frames: the deadlines start again from the late frame
+    Sleeper::msleep(55);
+    EXPECT_GE(timer.getFramesLate(), 4);
+    timer.waitUntilNextFrameIsDue();
+    EXPECT_EQ( 0, timer.getFramesLate() );
+
+    QElapsedTimer clock;
+    clock.start();
+    timer.waitUntilNextFrameIsDue();
+    EXPECT_GE(clock.elapsed(), 8);
+}
+
+TEST(Timer,RealTimeDropsLateFrames) {
+    Timer timer;
+    timer.setDesiredFrameRate(100.);
+    timer.setRealTime(true);
+    timer.waitUntilNextFrameIsDue();
+
+    Sleeper::msleep(55);
+    int framesLate = timer.getFramesLate();
+    ASSERT_GE(framesLate, 4);
+    ASSERT_LE(framesLate, 8);
+
+    ///The deadlines are kept: skipping the late frames catches up with the clock
+    timer.notifyFramesDropped(framesLate);
+    EXPECT_EQ( framesLate, timer.getDroppedFramesCount() );
+    EXPECT_EQ( 0, timer.getFramesLate() );
+    timer.waitUntilNextFrameIsDue();
+    EXPECT_EQ( framesLate, timer.getDroppedFramesCount() );
+
+    ///Pausing resets the count
+    timer.playState = ePlayStatePause;
+    timer.waitUntilNextFrameIsDue();
+    EXPECT_EQ( 0, timer.getDroppedFramesCount() );
+}